@@ -37,6 +37,11 @@ CREATE FUNCTION public.gstore_fdw_compaction(regclass, bool = false)
   AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_compaction'
   LANGUAGE C STRICT;
 
+CREATE FUNCTION public.gstore_fdw_grow(regclass, bigint)
+  RETURNS int
+  AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_grow'
+  LANGUAGE C STRICT;
+
 SELECT pgstrom.define_shell_type('gstore_fdw_sysattr',6116,'pgstrom');
 CREATE FUNCTION pgstrom.gstore_fdw_sysattr_in(cstring)
   RETURNS pgstrom.gstore_fdw_sysattr
@@ -65,3 +70,35 @@ CREATE FUNCTION pgstrom.gstore_fdw_replication_redo(regclass, bigint,
   RETURNS bytea
   AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_replication_redo'
   LANGUAGE C STRICT;
+CREATE TYPE pgstrom.__gstore_fdw_redo_sync_info AS (
+  num_requests    int8,
+  num_groups      int8,
+  avg_group_size  float8,
+  last_group_size int4,
+  max_group_size  int4
+);
+CREATE FUNCTION pgstrom.gstore_fdw_redo_sync_info(regclass)
+  RETURNS pgstrom.__gstore_fdw_redo_sync_info
+  AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_redo_sync_info'
+  LANGUAGE C STRICT;
+
+--
+-- Functions for Arrow_Fdw
+--
+CREATE FUNCTION pgstrom.arrow_export(text,      -- query
+                                     text,      -- path
+                                     int = 0)   -- num of parallel workers
+  RETURNS bigint
+  AS 'MODULE_PATHNAME','pgstrom_arrow_export'
+  LANGUAGE C STRICT;
+
+--
+-- Functions for shared memory buffer
+--
+CREATE FUNCTION pgstrom.shmbuf_bench(int = 1000000,   -- num of loops
+                                     bigint = 128,    -- min chunk size
+                                     bigint = 4096,   -- max chunk size
+                                     int = 64)        -- num of alive chunks
+  RETURNS float8
+  AS 'MODULE_PATHNAME','pgstrom_shmbuf_bench'
+  LANGUAGE C STRICT;
@@ -66,7 +66,7 @@ typedef struct
 typedef struct
 {
 	dlist_node	chain;
-	dlist_node	lru_chain;
+	pg_atomic_uint32 refbit;	/* set on reference, cleared by clock-sweep */
 	dlist_head	siblings;	/* if two or more record batches per file */
 	/* key of RecordBatch metadata cache */
 	struct stat	stat_buf;
@@ -82,12 +82,20 @@ typedef struct
 } arrowMetadataCache;
 
 #define ARROW_METADATA_HASH_NSLOTS		2048
+#define ARROW_METADATA_CLOCK_NPARTS		16
+#define ARROW_METADATA_CLOCK_PART_NSLOTS	\
+	(ARROW_METADATA_HASH_NSLOTS / ARROW_METADATA_CLOCK_NPARTS)
 #define ARROW_GPUBUF_HASH_NSLOTS		512
 typedef struct
 {
-	slock_t		lru_lock;
-	dlist_head	lru_list;
 	pg_atomic_uint64 consumed;
+	/*
+	 * clock-sweep of the metadata cache; hash slots are partitioned into
+	 * ARROW_METADATA_CLOCK_NPARTS groups, and each partition has its own
+	 * clock-hand, so concurrent reclaimers sweep different hash slots.
+	 */
+	pg_atomic_uint32 clock_next_part;
+	pg_atomic_uint32 clock_hands[ARROW_METADATA_CLOCK_NPARTS];
 
 	LWLock		lock_slots[ARROW_METADATA_HASH_NSLOTS];
 	dlist_head	hash_slots[ARROW_METADATA_HASH_NSLOTS];
@@ -2055,24 +2063,20 @@ ArrowBeginForeignModify(ModifyTableState *mtstate,
 }
 
 /*
- * ArrowExecForeignInsert
+ * arrowPutTupleTableSlot
+ *
+ * It puts values of the slot onto the SQLtable buffer, then returns the
+ * current usage of the buffer. Caller must switch the memory context to
+ * the one where the SQLtable buffer shall be allocated.
  */
-static TupleTableSlot *
-ArrowExecForeignInsert(EState *estate,
-					   ResultRelInfo *rrinfo,
-					   TupleTableSlot *slot,
-					   TupleTableSlot *planSlot)
+static size_t
+arrowPutTupleTableSlot(SQLtable *table, TupleDesc tupdesc,
+					   TupleTableSlot *slot)
 {
-	Relation		frel = rrinfo->ri_RelationDesc;
-	TupleDesc		tupdesc = RelationGetDescr(frel);
-	arrowWriteState *aw_state = rrinfo->ri_FdwState;
-	SQLtable	   *table = &aw_state->sql_table;
-	MemoryContext	oldcxt;
-	size_t			usage = 0;
-	int				j;
+	size_t		usage = 0;
+	int			j;
 
 	slot_getallattrs(slot);
-	oldcxt = MemoryContextSwitchTo(aw_state->memcxt);
 	for (j=0; j < tupdesc->natts; j++)
 	{
 		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
@@ -2091,11 +2095,15 @@ ArrowExecForeignInsert(EState *estate,
 		}
 		else if (attr->attlen == -1)
 		{
-			int		vl_len = VARSIZE_ANY_EXHDR(datum);
-			char   *vl_ptr = VARDATA_ANY(datum);
+			struct varlena *vl = (struct varlena *)DatumGetPointer(datum);
+			struct varlena *__vl = pg_detoast_datum_packed(vl);
 
 			Assert(column->sql_type.pgsql.typlen == -1);
-			usage += sql_field_put_value(column, vl_ptr, vl_len);
+			usage += sql_field_put_value(column,
+										 VARDATA_ANY(__vl),
+										 VARSIZE_ANY_EXHDR(__vl));
+			if (__vl != vl)
+				pfree(__vl);
 		}
 		else
 		{
@@ -2103,6 +2111,28 @@ ArrowExecForeignInsert(EState *estate,
 		}
 	}
 	table->nitems++;
+
+	return usage;
+}
+
+/*
+ * ArrowExecForeignInsert
+ */
+static TupleTableSlot *
+ArrowExecForeignInsert(EState *estate,
+					   ResultRelInfo *rrinfo,
+					   TupleTableSlot *slot,
+					   TupleTableSlot *planSlot)
+{
+	Relation		frel = rrinfo->ri_RelationDesc;
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	arrowWriteState *aw_state = rrinfo->ri_FdwState;
+	SQLtable	   *table = &aw_state->sql_table;
+	MemoryContext	oldcxt;
+	size_t			usage;
+
+	oldcxt = MemoryContextSwitchTo(aw_state->memcxt);
+	usage = arrowPutTupleTableSlot(table, tupdesc, slot);
 	MemoryContextSwitchTo(oldcxt);
 
 	/*
@@ -3477,7 +3507,7 @@ PG_FUNCTION_INFO_V1(pgstrom_arrow_fdw_precheck_schema);
  * NOTE: caller must have lock_slots[] with EXCLUSIVE mode
  */
 static uint64
-arrowInvalidateMetadataCache(arrowMetadataCache *mcache, bool detach_lru)
+arrowInvalidateMetadataCache(arrowMetadataCache *mcache)
 {
 	arrowMetadataCache *mtemp;
 	dlist_node	   *dnode;
@@ -3487,8 +3517,7 @@ arrowInvalidateMetadataCache(arrowMetadataCache *mcache, bool detach_lru)
 	{
 		dnode = dlist_pop_head_node(&mcache->siblings);
 		mtemp = dlist_container(arrowMetadataCache, chain, dnode);
-		Assert(dlist_is_empty(&mtemp->siblings) &&
-			   !mtemp->lru_chain.prev && !mtemp->lru_chain.next);
+		Assert(dlist_is_empty(&mtemp->siblings));
 		dlist_delete(&mtemp->chain);
 		released += MAXALIGN(offsetof(arrowMetadataCache,
 									  fstate[mtemp->nfields]));
@@ -3496,12 +3525,6 @@ arrowInvalidateMetadataCache(arrowMetadataCache *mcache, bool detach_lru)
 	}
 	released += MAXALIGN(offsetof(arrowMetadataCache,
 								  fstate[mcache->nfields]));
-	if (detach_lru)
-	{
-		SpinLockAcquire(&arrow_metadata_state->lru_lock);
-		dlist_delete(&mcache->lru_chain);
-		SpinLockRelease(&arrow_metadata_state->lru_lock);
-	}
 	dlist_delete(&mcache->chain);
 	pfree(mcache);
 
@@ -3572,61 +3595,61 @@ makeRecordBatchStateFromCache(arrowMetadataCache *mcache, File fdesc)
 
 /*
  * arrowReclaimMetadataCache
+ *
+ * It reclaims unreferenced metadata cache entries by clock-sweep, if shared-
+ * memory consumption exceeds the configured threshold. The clock-hand of
+ * the partition advances by a hash slot, then the entries in the slot are
+ * released unless its refbit is set. The refbit is cleared instead, so the
+ * entry shall be released on the next round unless referenced again.
+ * Busy hash slots are skipped, not to wait for the concurrent lookup.
  */
 static void
 arrowReclaimMetadataCache(void)
 {
-	arrowMetadataCache *mcache;
-	LWLock	   *lock = NULL;
-	dlist_node *dnode;
-	uint32		lru_hash;
-	uint32		lru_index;
 	uint64		consumed;
+	uint32		part;
+	int			loop;
 
 	consumed = pg_atomic_read_u64(&arrow_metadata_state->consumed);
 	if (consumed <= arrow_metadata_cache_size)
 		return;
 
-	SpinLockAcquire(&arrow_metadata_state->lru_lock);
-	if (dlist_is_empty(&arrow_metadata_state->lru_list))
+	part = pg_atomic_fetch_add_u32(&arrow_metadata_state->clock_next_part, 1)
+		% ARROW_METADATA_CLOCK_NPARTS;
+	/*
+	 * Two rounds over all the hash slots are sufficient to release any
+	 * entries; the first one clears refbit, and the second one releases.
+	 */
+	for (loop = 0;
+		 loop < 2 * ARROW_METADATA_HASH_NSLOTS &&
+			 consumed > arrow_metadata_cache_size;
+		 loop++)
 	{
-		SpinLockRelease(&arrow_metadata_state->lru_lock);
-		return;
-	}
-	dnode = dlist_tail_node(&arrow_metadata_state->lru_list);
-	mcache = dlist_container(arrowMetadataCache, lru_chain, dnode);
-	lru_hash = mcache->hash;
-	SpinLockRelease(&arrow_metadata_state->lru_lock);
+		uint32		hand;
+		uint32		index;
+		LWLock	   *lock;
+		dlist_mutable_iter iter;
 
-	do {
-		lru_index = lru_hash % ARROW_METADATA_HASH_NSLOTS;
-		lock = &arrow_metadata_state->lock_slots[lru_index];
+		/* move to the next partition once per round of the partition */
+		if (loop > 0 && loop % ARROW_METADATA_CLOCK_PART_NSLOTS == 0)
+			part = (part + 1) % ARROW_METADATA_CLOCK_NPARTS;
+		hand = pg_atomic_fetch_add_u32(&arrow_metadata_state->clock_hands[part], 1);
+		index = (part * ARROW_METADATA_CLOCK_PART_NSLOTS +
+				 hand % ARROW_METADATA_CLOCK_PART_NSLOTS);
+		lock = &arrow_metadata_state->lock_slots[index];
 
-		LWLockAcquire(lock, LW_EXCLUSIVE);
-		SpinLockAcquire(&arrow_metadata_state->lru_lock);
-		if (dlist_is_empty(&arrow_metadata_state->lru_list))
-		{
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
-			LWLockRelease(lock);
-			break;
-		}
-		dnode = dlist_tail_node(&arrow_metadata_state->lru_list);
-		mcache = dlist_container(arrowMetadataCache, lru_chain, dnode);
-		if (mcache->hash == lru_hash)
-		{
-			dlist_delete(&mcache->lru_chain);
-			memset(&mcache->lru_chain, 0, sizeof(dlist_node));
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
-			consumed = arrowInvalidateMetadataCache(mcache, false);
-		}
-		else
+		if (!LWLockConditionalAcquire(lock, LW_EXCLUSIVE))
+			continue;
+		dlist_foreach_modify(iter, &arrow_metadata_state->hash_slots[index])
 		{
-			/* LRU-tail was referenced by someone, try again */
-			lru_hash = mcache->hash;
-            SpinLockRelease(&arrow_metadata_state->lru_lock);
+			arrowMetadataCache *mcache
+				= dlist_container(arrowMetadataCache, chain, iter.cur);
+
+			if (pg_atomic_exchange_u32(&mcache->refbit, 0) == 0)
+				consumed = arrowInvalidateMetadataCache(mcache);
 		}
 		LWLockRelease(lock);
-	} while (consumed > arrow_metadata_cache_size);
+	}
 }
 
 /*
@@ -3793,7 +3816,7 @@ retry:
 				for (tail=buf4+strlen(buf4)-1; isspace(*tail); *tail--='\0');
 				elog(DEBUG2, "arrow_fdw: metadata cache for '%s' (m:%s, c:%s) is older than the latest file (m:%s, c:%s), so invalidated",
 					 FilePathName(fdesc), buf1, buf2, buf3, buf4);
-				arrowInvalidateMetadataCache(mcache, true);
+				arrowInvalidateMetadataCache(mcache);
 				break;
 			}
 			/*
@@ -3810,10 +3833,9 @@ retry:
 				if (checkArrowRecordBatchIsVisible(rbstate, mvcc_slot))
 					results = lappend(results, rbstate);
 			}
-			SpinLockAcquire(&arrow_metadata_state->lru_lock);
-			dlist_move_head(&arrow_metadata_state->lru_list,
-							&mcache->lru_chain);
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
+			/* avoid cache-line bouncing if refbit is already set */
+			if (pg_atomic_read_u32(&mcache->refbit) == 0)
+				pg_atomic_write_u32(&mcache->refbit, 1);
 			LWLockRelease(lock);
 
 			return results;
@@ -3867,16 +3889,13 @@ retry:
 		mcache = __arrowBuildMetadataCache(rb_state_any, key.hash);
 		if (mcache)
 		{
+			pg_atomic_init_u32(&mcache->refbit, 1);
 			dlist_push_head(hash_slot, &mcache->chain);
-			SpinLockAcquire(&arrow_metadata_state->lru_lock);
-            dlist_push_head(&arrow_metadata_state->lru_list,
-							&mcache->lru_chain);
-			SpinLockRelease(&arrow_metadata_state->lru_lock);
 		}
 	}
 	LWLockRelease(lock);
 	/*
-	 * reclaim unreferenced metadata cache entries based on LRU, if shared-
+	 * reclaim unreferenced metadata cache entries by clock-sweep, if shared-
 	 * memory consumption exceeds the configured threshold.
 	 */
 	arrowReclaimMetadataCache();
@@ -4256,6 +4275,349 @@ writeOutArrowRecordBatch(arrowWriteState *aw_state, bool with_footer)
 	PG_END_TRY();
 }
 
+/*
+ * pgstrom_arrow_export
+ *
+ * It runs the supplied query inside of the backend, then writes out the
+ * results to Apache Arrow file(s) without serialization to the client.
+ * If nworkers > 0, it launches parallel workers; the path is considered
+ * as a directory, and each participant runs the query for a partition
+ * with $1 (partition index) and $2 (number of partitions), then writes
+ * out the result to PATH/part-NNNN.arrow.
+ */
+#define ARROW_EXPORT_SHM_KEY		UINT64CONST(0xA000000000000001)
+
+typedef struct
+{
+	pg_atomic_uint64 nitems;	/* total number of rows written */
+	pg_atomic_uint32 next_part;	/* next partition to be processed */
+	uint32		nparts;			/* number of partitions */
+	char		pathname[MAXPGPATH];
+	char		query[FLEXIBLE_ARRAY_MEMBER];
+} arrowExportShared;
+
+typedef struct
+{
+	DestReceiver pub;			/* publicly-known function pointers */
+	const char *filename;
+	MemoryContext memcxt;		/* memory context for SQLtable */
+	SQLtable   *table;
+	uint64		nitems;
+} arrowExportDestReceiver;
+
+PGDLLEXPORT void	arrowExportParallelMain(dsm_segment *seg, shm_toc *toc);
+Datum	pgstrom_arrow_export(PG_FUNCTION_ARGS);
+
+static void
+arrowExportStartup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	arrowExportDestReceiver *dest = (arrowExportDestReceiver *)self;
+	SQLtable	   *table;
+	MemoryContext	oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(dest->memcxt);
+	table = palloc0(offsetof(SQLtable, columns[typeinfo->natts]));
+	setupArrowSQLbufferSchema(table, typeinfo);
+#if PG_VERSION_NUM < 110000
+	table->fdesc = OpenTransientFile(dest->filename,
+									 O_RDWR | O_CREAT | O_TRUNC | PG_BINARY,
+									 0600);
+#else
+	table->fdesc = OpenTransientFile(dest->filename,
+									 O_RDWR | O_CREAT | O_TRUNC | PG_BINARY);
+#endif
+	if (table->fdesc < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", dest->filename)));
+	table->filename = dest->filename;
+	if (__writeFile(table->fdesc, "ARROW1\0\0", 8) != 8)
+		elog(ERROR, "failed on __writeFile('%s'): %m", table->filename);
+	writeArrowSchema(table);
+	dest->table = table;
+	MemoryContextSwitchTo(oldcxt);
+}
+
+static bool
+arrowExportReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+{
+	arrowExportDestReceiver *dest = (arrowExportDestReceiver *)self;
+	SQLtable	   *table = dest->table;
+	MemoryContext	oldcxt;
+	size_t			usage;
+
+	oldcxt = MemoryContextSwitchTo(dest->memcxt);
+	usage = arrowPutTupleTableSlot(table, slot->tts_tupleDescriptor, slot);
+	if (usage > table->segment_sz)
+		writeArrowRecordBatch(table);
+	MemoryContextSwitchTo(oldcxt);
+	dest->nitems++;
+
+	return true;
+}
+
+static void
+arrowExportShutdown(DestReceiver *self)
+{
+	arrowExportDestReceiver *dest = (arrowExportDestReceiver *)self;
+	SQLtable	   *table = dest->table;
+	MemoryContext	oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(dest->memcxt);
+	if (table->nitems > 0)
+		writeArrowRecordBatch(table);
+	writeArrowFooter(table);
+	MemoryContextSwitchTo(oldcxt);
+
+	if (CloseTransientFile(table->fdesc) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", table->filename)));
+	table->fdesc = -1;
+}
+
+static void
+arrowExportDestroy(DestReceiver *self)
+{
+	pfree(self);
+}
+
+static Query *
+__arrowExportAnalyzeQuery(const char *query)
+{
+	List	   *raw_parsetree_list;
+	List	   *rewritten;
+	Query	   *q;
+	Oid			argtypes[2] = { INT4OID, INT4OID };
+
+	raw_parsetree_list = pg_parse_query(query);
+	if (list_length(raw_parsetree_list) != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("arrow_export: only a single SELECT query is supported")));
+	rewritten = pg_analyze_and_rewrite(linitial_node(RawStmt,
+													 raw_parsetree_list),
+									   query, argtypes, 2, NULL);
+	if (list_length(rewritten) != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("arrow_export: only a single SELECT query is supported")));
+	q = linitial_node(Query, rewritten);
+	if (q->commandType != CMD_SELECT ||
+		q->utilityStmt != NULL ||
+		q->rowMarks != NIL ||
+		q->hasModifyingCTE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("arrow_export: only a single SELECT query is supported")));
+	return q;
+}
+
+static bool
+__arrowExportPartitionParamWalker(Node *node, void *context)
+{
+	if (!node)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param  *param = (Param *)node;
+
+		if (param->paramkind == PARAM_EXTERN && param->paramid == 1)
+			return true;
+	}
+	if (IsA(node, Query))
+		return query_tree_walker((Query *)node,
+								 __arrowExportPartitionParamWalker,
+								 context, 0);
+	return expression_tree_walker(node,
+								  __arrowExportPartitionParamWalker,
+								  context);
+}
+
+static uint64
+__arrowExportRunQuery(arrowExportShared *aex, uint32 part)
+{
+	arrowExportDestReceiver *dest;
+	char			filename[MAXPGPATH];
+	Query		   *q;
+	PlannedStmt	   *plan;
+	QueryDesc	   *qdesc;
+	ParamListInfo	params;
+	uint64			nitems;
+
+	if (aex->nparts > 1)
+		snprintf(filename, sizeof(filename), "%s/part-%04u.arrow",
+				 aex->pathname, part);
+	else
+		strncpy(filename, aex->pathname, sizeof(filename));
+
+	/* $1 = partition index, $2 = number of partitions */
+#if PG_VERSION_NUM < 110000
+	params = palloc0(offsetof(ParamListInfoData, params) +
+					 2 * sizeof(ParamExternData));
+	params->numParams = 2;
+#else
+	params = makeParamList(2);
+#endif
+	params->params[0].value = Int32GetDatum(part);
+	params->params[0].isnull = false;
+	params->params[0].pflags = PARAM_FLAG_CONST;
+	params->params[0].ptype = INT4OID;
+	params->params[1].value = Int32GetDatum(aex->nparts);
+	params->params[1].isnull = false;
+	params->params[1].pflags = PARAM_FLAG_CONST;
+	params->params[1].ptype = INT4OID;
+
+	q = __arrowExportAnalyzeQuery(aex->query);
+	plan = pg_plan_query(q, (aex->nparts > 1 ? 0 : CURSOR_OPT_PARALLEL_OK),
+						 params);
+
+	dest = palloc0(sizeof(arrowExportDestReceiver));
+	dest->pub.receiveSlot = arrowExportReceiveSlot;
+	dest->pub.rStartup = arrowExportStartup;
+	dest->pub.rShutdown = arrowExportShutdown;
+	dest->pub.rDestroy = arrowExportDestroy;
+	dest->pub.mydest = DestNone;
+	dest->filename = filename;
+	dest->memcxt = AllocSetContextCreate(CurrentMemoryContext,
+										 "arrow_export buffer",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	PushCopiedSnapshot(GetActiveSnapshot());
+	UpdateActiveSnapshotCommandId();
+	qdesc = CreateQueryDesc(plan,
+							aex->query,
+							GetActiveSnapshot(),
+							InvalidSnapshot,
+							(DestReceiver *)dest,
+							params, NULL, 0);
+	ExecutorStart(qdesc, 0);
+	ExecutorRun(qdesc, ForwardScanDirection, 0L, true);
+	ExecutorFinish(qdesc);
+	ExecutorEnd(qdesc);
+	nitems = dest->nitems;
+	MemoryContextDelete(dest->memcxt);
+	FreeQueryDesc(qdesc);
+	PopActiveSnapshot();
+
+	return nitems;
+}
+
+void
+arrowExportParallelMain(dsm_segment *seg, shm_toc *toc)
+{
+	arrowExportShared *aex;
+	uint64		nitems = 0;
+	uint32		part;
+
+	aex = shm_toc_lookup(toc, ARROW_EXPORT_SHM_KEY, false);
+	while ((part = pg_atomic_fetch_add_u32(&aex->next_part, 1)) < aex->nparts)
+		nitems += __arrowExportRunQuery(aex, part);
+	pg_atomic_fetch_add_u64(&aex->nitems, nitems);
+}
+
+Datum
+pgstrom_arrow_export(PG_FUNCTION_ARGS)
+{
+	char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	char	   *pathname = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	int32		nworkers = PG_GETARG_INT32(2);
+	arrowExportShared *aex;
+	size_t		aex_sz;
+	uint64		nitems = 0;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to export query results to files")));
+	if (!is_absolute_path(pathname))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_NAME),
+				 errmsg("relative path not allowed for arrow_export")));
+	if (strlen(pathname) >= MAXPGPATH - 20)
+		ereport(ERROR,
+				(errcode(ERRCODE_NAME_TOO_LONG),
+				 errmsg("path name too long: \"%s\"", pathname)));
+	if (nworkers < 0 || nworkers > max_worker_processes)
+		elog(ERROR, "arrow_export: number of workers (%d) is out of range",
+			 nworkers);
+
+	aex_sz = offsetof(arrowExportShared, query[strlen(query) + 1]);
+	aex = palloc0(aex_sz);
+	pg_atomic_init_u64(&aex->nitems, 0);
+	pg_atomic_init_u32(&aex->next_part, 0);
+	strcpy(aex->pathname, pathname);
+	strcpy(aex->query, query);
+
+	if (nworkers == 0)
+	{
+		aex->nparts = 1;
+		nitems = __arrowExportRunQuery(aex, 0);
+	}
+	else
+	{
+		ParallelContext *pcxt;
+		arrowExportShared *shared;
+		Query	   *q;
+		uint32		part;
+
+		/* query must be split by the partition index */
+		q = __arrowExportAnalyzeQuery(query);
+		if (!query_tree_walker(q, __arrowExportPartitionParamWalker, NULL, 0))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("arrow_export: query must reference $1 (partition index) and $2 (number of partitions) on parallel execution"),
+					 errhint("e.g, SELECT * FROM t WHERE id %% $2 = $1")));
+		if (max_parallel_hazard(q) != PROPARALLEL_SAFE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("arrow_export: query is not parallel safe")));
+		if (mkdir(pathname, 0755) != 0 && errno != EEXIST)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not create directory \"%s\": %m",
+							pathname)));
+		aex->nparts = nworkers + 1;
+
+		EnterParallelMode();
+#if PG_VERSION_NUM < 110000
+		pcxt = CreateParallelContextForExternalFunction("$libdir/pg_strom",
+														"arrowExportParallelMain",
+														nworkers);
+#elif PG_VERSION_NUM < 120000
+		pcxt = CreateParallelContext("$libdir/pg_strom",
+									 "arrowExportParallelMain",
+									 nworkers, false);
+#else
+		pcxt = CreateParallelContext("$libdir/pg_strom",
+									 "arrowExportParallelMain",
+									 nworkers);
+#endif
+		shm_toc_estimate_chunk(&pcxt->estimator, aex_sz);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+		InitializeParallelDSM(pcxt);
+		shared = shm_toc_allocate(pcxt->toc, aex_sz);
+		memcpy(shared, aex, aex_sz);
+		shm_toc_insert(pcxt->toc, ARROW_EXPORT_SHM_KEY, shared);
+		LaunchParallelWorkers(pcxt);
+
+		/*
+		 * Leader also processes the partitions, including the ones for
+		 * the workers not launched.
+		 */
+		while ((part = pg_atomic_fetch_add_u32(&shared->next_part,
+											   1)) < shared->nparts)
+			nitems += __arrowExportRunQuery(shared, part);
+		WaitForParallelWorkersToFinish(pcxt);
+		nitems += pg_atomic_read_u64(&shared->nitems);
+
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+	}
+	PG_RETURN_INT64(nitems);
+}
+PG_FUNCTION_INFO_V1(pgstrom_arrow_export);
+
 /*
  * TRUNCATE support
  */
@@ -5387,9 +5749,10 @@ pgstrom_startup_arrow_fdw(void)
 						&found);
 	if (!IsUnderPostmaster)
 	{
-		SpinLockInit(&arrow_metadata_state->lru_lock);
-		dlist_init(&arrow_metadata_state->lru_list);
 		pg_atomic_init_u64(&arrow_metadata_state->consumed, 0UL);
+		pg_atomic_init_u32(&arrow_metadata_state->clock_next_part, 0);
+		for (i=0; i < ARROW_METADATA_CLOCK_NPARTS; i++)
+			pg_atomic_init_u32(&arrow_metadata_state->clock_hands[i], 0);
 		for (i=0; i < ARROW_METADATA_HASH_NSLOTS; i++)
 		{
 			LWLockInitialize(&arrow_metadata_state->lock_slots[i], -1);
@@ -106,7 +106,7 @@ kds_get_column_sysattr(kern_data_store *kds, cl_uint rowid)
  *
  * phase = 0 : zero clear the owner_id field of the sysattr
  * phase = 1 : assign max of get_global_id() who tries to update the row
- *             according to the INSERT/DELETE log
+ *             according to the INSERT/DELETE/UPDATE log
  * phase = 3 : assign max of get_global_id() who tries to apply commit log
  */
 KERNEL_FUNCTION(void)
@@ -154,6 +154,16 @@ kern_gpustore_setup_owner(kern_gpustore_redolog *redo,
 			else if (phase == 1)
 				atomicMax(&sysattr->owner_id, owner_id);
 		}
+		else if (tx_log->type == GSTORE_TX_LOG__UPDATE)
+		{
+			rowid = ((GstoreTxLogUpdate *)tx_log)->rowid;
+
+			sysattr = kds_get_column_sysattr(kds, rowid);
+			if (phase == 0)
+				sysattr->owner_id = 0;
+			else if (phase == 1)
+				atomicMax(&sysattr->owner_id, owner_id);
+		}
 		else if (tx_log->type == GSTORE_TX_LOG__COMMIT)
 		{
 			GstoreTxLogCommit *c_log = (GstoreTxLogCommit *)tx_log;
@@ -173,6 +183,22 @@ kern_gpustore_setup_owner(kern_gpustore_redolog *redo,
 						atomicMax(&sysattr->owner_id, owner_id);
 					pos += 5;
 				}
+				else if (*pos == 'B')
+				{
+					cl_uint		nrows;
+
+					memcpy(&rowid, pos+1, sizeof(cl_uint));
+					memcpy(&nrows, pos+5, sizeof(cl_uint));
+					for (cl_uint k=0; k < nrows; k++)
+					{
+						sysattr = kds_get_column_sysattr(kds, rowid + k);
+						if (phase == 0)
+							sysattr->owner_id = 0;
+						else if (phase == 3)
+							atomicMax(&sysattr->owner_id, owner_id);
+					}
+					pos += 9;
+				}
 				else
 				{
 					printf("unknown commit log entry '%c'\n", *pos);
@@ -294,6 +320,105 @@ __gpustore_apply_insert(kern_context *kcxt,
 	return true;
 }
 
+/*
+ * __gpustore_apply_update
+ *
+ * It applies column-delta UPDATE log. Unchanged columns are copied from
+ * the older version at oldid; host side never put INSERT/UPDATE logs
+ * that overwrite oldid into the same batch.
+ */
+STATIC_FUNCTION(cl_bool)
+__gpustore_apply_update(kern_context *kcxt,
+						kern_data_store *kds,
+						kern_data_extra *extra,
+						GstoreTxLogUpdate *u_log,
+						GstoreFdwSysattr *sysattr)
+{
+	char	   *pos = GSTORE_TX_LOG_UPDATE_VALUES(u_log);
+	cl_uint		rowid = u_log->rowid;
+	cl_uint		oldid = u_log->oldid;
+	cl_int		j, k = 0;
+
+	assert(pos == (char *)MAXALIGN(pos));
+	sysattr->xmin = InvalidTransactionId;
+	sysattr->xmax = InvalidTransactionId;
+
+	for (j=0; j < kds->ncols-1; j++)
+	{
+		kern_colmeta   *cmeta = &kds->colmeta[j];
+		char		   *base = ((char *)kds + __kds_unpack(cmeta->values_offset));
+		cl_uint		   *nullmap = NULL;
+		cl_ushort		attr = (k < u_log->nattrs ? u_log->attrs[k] : 0);
+		cl_uint			unitsz;
+		cl_bool			isnull;
+
+		if (cmeta->nullmap_offset != 0)
+			nullmap = (cl_uint *)((char *)kds + __kds_unpack(cmeta->nullmap_offset));
+		unitsz = (cmeta->attlen > 0
+				  ? TYPEALIGN(cmeta->attalign, cmeta->attlen)
+				  : sizeof(cl_uint));
+		if (k >= u_log->nattrs ||
+			(attr & GSTORE_TX_LOG_UPDATE__COLMASK) != j)
+		{
+			/* unchanged column; copy the older version */
+			isnull = (nullmap != NULL &&
+					  (nullmap[oldid>>5] & (1U << (oldid & 0x1f))) == 0);
+			if (!isnull)
+				memcpy(base + unitsz * rowid,
+					   base + unitsz * oldid, unitsz);
+		}
+		else
+		{
+			k++;
+			isnull = ((attr & GSTORE_TX_LOG_UPDATE__ISNULL) != 0);
+			if (isnull)
+			{
+				/* nothing to do */
+			}
+			else if (cmeta->attlen > 0)
+			{
+				pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+				memcpy(base + unitsz * rowid, pos, cmeta->attlen);
+				pos += cmeta->attlen;
+			}
+			else
+			{
+				cl_uint		sz;
+				cl_ulong	offset;
+
+				assert(cmeta->attlen == -1);
+				if (!VARATT_NOT_PAD_BYTE(pos))
+					pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+				sz = VARSIZE_ANY(pos);
+				/* allocation of extra buffer on demand */
+				offset = atomicAdd(&extra->usage, MAXALIGN(sz));
+				if (offset + MAXALIGN(sz) > extra->length)
+				{
+					STROM_EREPORT(kcxt, ERRCODE_OUT_OF_MEMORY,
+								  "out of extra buffer");
+					return false;
+				}
+				memcpy((char *)extra + offset, pos, sz);
+				((cl_uint *)base)[rowid] = __kds_packed(offset);
+				pos += sz;
+			}
+		}
+		if (nullmap)
+		{
+			if (isnull)
+				atomicAnd(&nullmap[rowid>>5], ~(1U << (rowid & 0x1f)));
+			else
+				atomicOr(&nullmap[rowid>>5], (1U << (rowid & 0x1f)));
+		}
+	}
+	/* and, system attributes */
+	sysattr->xmin = u_log->xmin;
+	sysattr->xmax = InvalidTransactionId;
+	atomicMax(&kds->nitems, rowid+1);
+
+	return true;
+}
+
 STATIC_FUNCTION(void)
 __gpustore_apply_delete(kern_context *kcxt,
 						GstoreTxLogDelete *d_log,
@@ -338,6 +463,23 @@ __gpustore_apply_commit(kern_context *kcxt,
 			}
 			pos += 5;
 		}
+		else if (*pos == 'B')
+		{
+			cl_uint		nrows;
+
+			memcpy(&rowid, pos+1, sizeof(cl_uint));
+			memcpy(&nrows, pos+5, sizeof(cl_uint));
+			for (cl_uint k=0; k < nrows; k++)
+			{
+				sysattr = kds_get_column_sysattr(kds, rowid + k);
+				if (sysattr && sysattr->owner_id == owner_id)
+				{
+					sysattr->xmin = FrozenTransactionId;
+					sysattr->xmax = InvalidTransactionId;
+				}
+			}
+			pos += 9;
+		}
 		else
 		{
 			printf("unknown commit log entry '%c'\n", *pos);
@@ -399,6 +541,17 @@ kern_gpustore_apply_redo(kern_gpustore_redolog *redo,
 				redo->log_index[owner_id] = UINT_MAX;
 			}
 		}
+		else if (tx_log->type == GSTORE_TX_LOG__UPDATE)
+		{
+			GstoreTxLogUpdate *u_log = (GstoreTxLogUpdate *)tx_log;
+
+			sysattr = kds_get_column_sysattr(kds, u_log->rowid);
+			if (sysattr->owner_id == owner_id && phase == 2)
+			{
+				if (__gpustore_apply_update(&kcxt, kds, extra, u_log, sysattr))
+					redo->log_index[owner_id] = UINT_MAX;
+			}
+		}
 		else if (tx_log->type == GSTORE_TX_LOG__COMMIT)
 		{
 			GstoreTxLogCommit *c_log = (GstoreTxLogCommit *)tx_log;
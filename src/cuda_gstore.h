@@ -22,7 +22,10 @@
 #define GSTORE_TX_LOG__INSERT		(GSTORE_TX_LOG__MAGIC | 'I')
 #define GSTORE_TX_LOG__DELETE		(GSTORE_TX_LOG__MAGIC | 'D')
 #define GSTORE_TX_LOG__COMMIT		(GSTORE_TX_LOG__MAGIC | 'C')
+#define GSTORE_TX_LOG__UPDATE		(GSTORE_TX_LOG__MAGIC | 'U')
 #define GSTORE_TX_LOG__TERMINATOR	0xFBADBEEF
+/* head of the padding at the tail of REDO log buffer, prior to wrap-around */
+#define GSTORE_TX_LOG__WRAPAROUND	0xFBADCAFE
 
 typedef struct {
 	cl_uint		type;
@@ -49,10 +52,44 @@ typedef struct {
 	cl_uint		xmax;
 } GstoreTxLogDelete;
 
+/*
+ * UPDATE (column-delta)
+ *
+ * A new row version at 'rowid' that shares the values of unchanged columns
+ * with the older version at 'oldid'. attrs[] contains column-index (0-based)
+ * of the updated columns in ascending order, and the values of non-NULL
+ * updated columns follow at GSTORE_TX_LOG_UPDATE_VALUES(). The values are
+ * packed according to the attalign of columns, like heap-tuple doing.
+ * 'oldid' is never reused until the checkpoint and the GPU buffer pass this
+ * log, so REDO replay from the checkpoint reads the same older version.
+ * 'xmin' is the updater's xid, thus xmax of the older version; consumers of
+ * the REDO stream use it to validate the older version.
+ */
+#define GSTORE_TX_LOG_UPDATE__ISNULL	0x8000
+#define GSTORE_TX_LOG_UPDATE__COLMASK	0x7fff
+typedef struct {
+	cl_uint		type;
+	cl_uint		length;
+	cl_ulong	timestamp;
+	cl_uint		rowid;
+	cl_uint		oldid;
+	cl_uint		xmin;
+	cl_ushort	nattrs;			/* number of updated columns */
+	cl_ushort	attrs[1];		/* variable length */
+} GstoreTxLogUpdate;
+
+#define GSTORE_TX_LOG_UPDATE_VALUES(u_log)								\
+	((char *)(u_log) + MAXALIGN(offsetof(GstoreTxLogUpdate,			\
+										 attrs[(u_log)->nattrs])))
+
 /*
  * COMMIT/ABORT
+ *
+ * data[] contains nitems of 'I' or 'D' with rowid(u32), or 'B' with
+ * rowid(u32) + nrows(u32) for the consecutive rows inserted by bulk-load.
  */
 #define GSTORE_TX_LOG_COMMIT_ALLOCSZ	96
+#define GSTORE_TX_LOG_COMMIT_BULK_MAXSZ	4096
 typedef struct {
 	cl_uint		type;
 	cl_uint		length;
@@ -27,6 +27,8 @@
 #define GSTORE_BACKGROUND_CMD__APPLY_REDO		'A'
 #define GSTORE_BACKGROUND_CMD__COMPACTION		'C'
 #define GSTORE_BACKGROUND_CMD__DROP_UNLOAD		'D'
+#define GSTORE_BACKGROUND_CMD__CHECKPOINT		'K'
+#define GSTORE_BACKGROUND_CMD__RELOAD			'R'
 typedef struct
 {
 	dlist_node	chain;
@@ -38,6 +40,47 @@ typedef struct
 	uint64		end_pos;		/* for APPLY_REDO */
 } GpuStoreBackgroundCommand;
 
+/*
+ * GpuStoreDictionary - shared dictionary of a varlena column
+ *
+ * It maps distinct values of the column to the offset of their single copy
+ * in the extra buffer, so rows with identical values share the copy; thus,
+ * the offset in the column array works as a fixed-width code of the value.
+ * It lives in the shared memory, and is rebuilt from the base file when
+ * GpuStoreSharedState is constructed, or after the host buffer compaction.
+ * Items are never removed, and no new items are added once it gets full;
+ * the values are stored individually in this case.
+ */
+#define GSTORE_MAX_DICTIONARIES			8
+#define GSTORE_DICTIONARY_NSLOTS		8192
+#define GSTORE_DICTIONARY_MAX_NITEMS	65536
+typedef struct
+{
+	cl_uint		next;			/* index of the next item, or UINT_MAX */
+	cl_uint		hash;
+	cl_uint		length;			/* VARSIZE_ANY() of the value */
+	cl_uint		offset;			/* packed offset from the extra buffer */
+} GpuStoreDictionaryItem;
+
+typedef struct
+{
+	LWLock		lock;
+	AttrNumber	attnum;
+	cl_uint		nitems;
+	cl_uint		slots[GSTORE_DICTIONARY_NSLOTS];
+	GpuStoreDictionaryItem items[GSTORE_DICTIONARY_MAX_NITEMS];
+} GpuStoreDictionary;
+
+/* a new value of dictionary column on INSERT/UPDATE */
+typedef struct
+{
+	GpuStoreDictionary *dict;
+	Datum		value;			/* canonical form of the value */
+	cl_uint		hash;
+	cl_uint		code;			/* packed offset of the identical value,
+								 * or 0 if not found */
+} GpuStoreDictionaryProbe;
+
 /*
  * GpuStoreSharedHead
  */
@@ -83,8 +126,12 @@ typedef struct
 	/* FDW options */
 	cl_int			cuda_dindex;
 	ssize_t			max_num_rows;
-	ssize_t			num_hash_slots;
+	ssize_t			num_hash_groups;
 	AttrNumber		primary_key;
+	cl_int			num_ordered_indexes;
+	AttrNumber		ordered_index[GPUSTORE_MAX_ORDERED_INDEXES];
+	cl_int			num_dictionaries;
+	AttrNumber		dictionary[GSTORE_MAX_DICTIONARIES];
 	bool			preserve_files;
 	const char	   *base_file;
 	const char	   *redo_log_file;
@@ -93,15 +140,17 @@ typedef struct
 	size_t			gpu_update_threshold;
 
 #define GSTORE_NUM_BASE_ROW_LOCKS		1000
-#define GSTORE_NUM_HASH_SLOT_LOCKS		1200
+#define GSTORE_BACKUP_LEASE_TIMEOUT		60000	/* ms */
 	/* Runtime state */
 	LWLock			base_mmap_lock;
 	uint32			base_mmap_revision;
-	slock_t			rowid_map_lock;		/* lock for RowID-map */
 
-	/* NOTE: hash_slot_lock must be acquired outside of the base_row_lock */
+	/* NOTE: lock of PK hash-group must be acquired outside of the base_row_lock */
 	slock_t			base_row_lock[GSTORE_NUM_BASE_ROW_LOCKS];
-	slock_t			hash_slot_lock[GSTORE_NUM_HASH_SLOT_LOCKS];
+	/* sequence counter of base_row_lock; odd number during the lock */
+	pg_atomic_uint32 base_row_seqno[GSTORE_NUM_BASE_ROW_LOCKS];
+	/* NOTE: lock of ordered-index must not be acquired with base_row_lock */
+	LWLock			ordered_index_lock[GPUSTORE_MAX_ORDERED_INDEXES];
 
 	slock_t			redo_pos_lock;
 	uint64			redo_write_nitems;
@@ -113,6 +162,49 @@ typedef struct
 	uint64			redo_last_timestamp;	/* time when last command sent.
 											 * not a timestamp redo-logs are
 											 * applied on the GPU buffer. */
+	/* Group commit of REDO log; protected by redo_pos_lock */
+	ConditionVariable redo_sync_cond;
+	bool			redo_sync_in_progress;	/* a leader is persisting now */
+	uint32			redo_sync_last_group;	/* size of the last group */
+	uint64			redo_sync_nrequests;	/* total number of sync requests */
+	uint64			redo_sync_ngroups;		/* total number of groups */
+	uint64			redo_sync_grouped;		/* nrequests at the last group */
+	uint32			redo_sync_max_group;	/* largest group size */
+	/* Incremental checkpoint; protected by redo_pos_lock */
+	uint64			redo_checkpoint_pos;	/* REDO position of the last
+											 * checkpoint */
+	bool			redo_checkpoint_requested;
+	/*
+	 * Rowids of the older versions referred by column-delta UPDATE logs.
+	 * REDO replay copies the unchanged columns from them, so they are not
+	 * reused until both of the checkpoint and the GPU buffer pass the REDO
+	 * position at the commit. [0] collects the rowids being pinned, and
+	 * [1] waits for the position. Protected by redo_pos_lock.
+	 */
+	cl_uint			pinned_head[2];
+	cl_uint			pinned_tail[2];
+	uint64			pinned_pos[2];
+	uint64			unpinned_pos;		/* largest pinned_pos released */
+	/*
+	 * The base backup fetching chunks holds the pinned rowids since
+	 * backup_pos, until backup_expire. Protected by redo_pos_lock.
+	 */
+	uint64			backup_pos;
+	TimestampTz		backup_expire;
+	/*
+	 * Dirty tracking of the base file for incremental checkpoint. Each
+	 * column (including the system column) has a bitmap of the dirty
+	 * blocks; a block consists of (1 << dirty_shift) rows. Extra buffer is
+	 * append-only, so the usage at the last checkpoint is sufficient.
+	 */
+	bool			dirty_full;				/* entire base file is dirty */
+	cl_int			dirty_ncols;
+	cl_uint			dirty_shift;
+	cl_uint			dirty_nwords;			/* bitmap words per column */
+	uint64			dirty_extra_usage;
+	pg_atomic_uint32 *dirty_bitmap;			/* [dirty_ncols * dirty_nwords] */
+	/* Shared dictionaries of varlena columns */
+	GpuStoreDictionary *dict_buf[GSTORE_MAX_DICTIONARIES];
 	/* Device data store */
 	pthread_rwlock_t gpu_bufer_lock;
 	CUipcMemHandle	gpu_main_mhandle;		/* mhandle to main portion */
@@ -121,6 +213,11 @@ typedef struct
 	size_t			gpu_extra_size;
 } GpuStoreSharedState;
 
+/*
+ * GpuStoreDesc - per-backend descriptor of GpuStore
+ */
+#define GPUSTORE_ROWID_CACHE_MINSZ		4
+#define GPUSTORE_ROWID_CACHE_MAXSZ		64
 typedef struct
 {
 	Oid				database_oid;
@@ -136,6 +233,13 @@ typedef struct
 	int				base_mmap_is_pmem;
 	GpuStoreRowIdMapHead *rowid_map;	/* RowID map section */
 	GpuStoreHashIndexHead *hash_index;	/* Hash-index section (optional) */
+	GpuStoreOrderedIndexHead *ordered_index[GPUSTORE_MAX_ORDERED_INDEXES];
+	/* comparison function of ordered-index; set on the first use */
+	FmgrInfo	   *ordered_index_cmp[GPUSTORE_MAX_ORDERED_INDEXES];
+	/* rowids reserved by this backend; returned at end of transaction */
+	cl_uint			rowid_cache_batch;
+	cl_uint			rowid_cache_nitems;
+	cl_uint			rowid_cache[GPUSTORE_ROWID_CACHE_MAXSZ];
 	/* redo log mapping */
 	char		   *redo_mmap;
 	size_t			redo_mmap_sz;
@@ -148,6 +252,47 @@ typedef struct
 /*
  * GpuStoreFdwState - runtime state object for READ
  */
+#define GSTORE_INDEX_KIND__NONE			0
+#define GSTORE_INDEX_KIND__PRIMARY_KEY	'p'		/* hash-based PK index */
+#define GSTORE_INDEX_KIND__ORDERED		'o'		/* ordered secondary index */
+/* strategy of 'PK = ANY(array)', in addition to BT*StrategyNumber */
+#define GSTORE_INDEX_STRATEGY__EQ_ANY	(BTMaxStrategyNumber + 1)
+/*
+ * GpuStoreScanQual - a simple qualifier evaluated over the column array
+ */
+#define GSTORE_CPU_SCAN_BLOCKSZ			2048
+#define GSTORE_SCAN_QUAL_MEMO_BITS		10
+#define GSTORE_SCAN_QUAL_MEMO_NSLOTS	(1U << GSTORE_SCAN_QUAL_MEMO_BITS)
+typedef struct
+{
+	AttrNumber		attnum;
+	int				strategy;		/* BT*StrategyNumber */
+	Const		   *con;			/* right-hand constant */
+	Datum			value;
+	bool			native;			/* compared as signed integer */
+	Oid				collation;		/* input collation of the operator */
+	FmgrInfo	   *cmp_finfo;		/* btree comparison function */
+	/*
+	 * Results of the comparison for each code of the dictionary column;
+	 * a direct-mapped cache, so every distinct value is compared once.
+	 */
+	cl_uint		   *memo_code;
+	bool		   *memo_match;
+} GpuStoreScanQual;
+
+/*
+ * GpuStoreSysattrHint - hint of system attribute to be written back
+ */
+#define GSTORE_SYSATTR_HINTS_BATCH		256
+typedef struct
+{
+	cl_uint			rowid;
+	TransactionId	old_xmin;
+	TransactionId	old_xmax;
+	TransactionId	new_xmin;
+	TransactionId	new_xmax;
+} GpuStoreSysattrHint;
+
 struct GpuStoreFdwState
 {
 	GpuStoreDesc   *gs_desc;
@@ -160,7 +305,31 @@ struct GpuStoreFdwState
 	cl_uint			nitems;			/* kds->nitems on BeginScan */
 	cl_bool			is_first;
 	cl_uint			last_rowid;		/* last rowid returned */
-	ExprState	   *indexExprState;
+	/* index scan, if any */
+	int				index_kind;		/* one of GSTORE_INDEX_KIND__* */
+	int				index_id;		/* index of ordered_index[] */
+	AttrNumber		index_attnum;	/* attnum of the indexed column */
+	List		   *index_strategies;	/* BT*StrategyNumber for each expr */
+	List		   *index_exprs;	/* ExprState for each key expression */
+	FmgrInfo	   *index_hash_finfo;	/* hash function of PK */
+	FmgrInfo	   *index_eq_finfo;		/* equal function of PK */
+	int16			index_typlen;	/* element type of 'PK = ANY(array)' */
+	bool			index_typbyval;
+	char			index_typalign;
+	cl_bool			index_fetched;	/* index_rowids[] is valid */
+	cl_uint		   *index_rowids;	/* rowids fetched by the index */
+	cl_uint			index_nrooms;
+	cl_uint			index_nrowids;
+	cl_uint			index_curr;
+	/* quals pushed down to the column-at-a-time scan, if any */
+	int				num_scan_quals;
+	GpuStoreScanQual *scan_qual_items;
+	cl_uint		   *scan_rowids;	/* selection vector of the block */
+	cl_uint			scan_nrowids;
+	cl_uint			scan_curr;
+	/* pending hints of system attributes */
+	int				num_hints;
+	GpuStoreSysattrHint hints[GSTORE_SYSATTR_HINTS_BATCH];
 };
 
 /*
@@ -171,7 +340,9 @@ typedef struct
 	dlist_node		chain;
 	TransactionId	curr_xid;
 	cl_uint			nitems;
+	cl_uint			bulk_nitems;	/* rows inserted by the bulk-load */
 	StringInfoData	buf;
+	StringInfoData	pinned;			/* oldid of column-delta UPDATE logs */
 } GpuStoreUndoLogs;
 
 /*
@@ -184,6 +355,8 @@ typedef struct
 	TransactionId	oldestXmin;
 	AttrNumber		ctid_attno;
 	GpuStoreUndoLogs *gs_undo;
+	bool			bulk_load;		/* INSERT/COPY without RETURNING */
+	uint64			nrows_inserted;
 } GpuStoreFdwModify;
 
 /* ---- static variables ---- */
@@ -192,8 +365,13 @@ static GpuStoreSharedHead  *gstore_shared_head = NULL;
 static HTAB		   *gstore_desc_htab = NULL;
 static shmem_startup_hook_type shmem_startup_next = NULL;
 static bool			gstore_fdw_enabled;		/* GUC */
+static bool			gstore_fdw_enabled_column_scan;	/* GUC */
 static char		   *gstore_fdw_default_base_dir;	/* GUC */
 static char		   *gstore_fdw_default_redo_dir;	/* GUC */
+static int			gstore_fdw_commit_delay;	/* GUC */
+static int			gstore_fdw_recovery_workers;	/* GUC */
+static int			gstore_fdw_checkpoint_threshold;	/* GUC */
+static int			gstore_fdw_bulk_load_threshold;	/* GUC */
 static object_access_hook_type object_access_next = NULL;
 
 /* ---- Forward declarations ---- */
@@ -201,12 +379,14 @@ Datum pgstrom_gstore_fdw_handler(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_validator(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_apply_redo(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_compaction(PG_FUNCTION_ARGS);
+Datum pgstrom_gstore_fdw_grow(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_post_creation(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_sysattr_in(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_sysattr_out(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_replication_base(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_read_debug(PG_FUNCTION_ARGS);
+Datum pgstrom_gstore_fdw_redo_sync_info(PG_FUNCTION_ARGS);
 void  GstoreFdwStartupKicker(Datum arg);
 void  GstoreFdwMaintainerMain(Datum arg);
 
@@ -218,23 +398,47 @@ static CUresult gstoreFdwInvokeApplyRedo(Oid ftable_oid, bool is_async,
 										 uint64 end_pos);
 static CUresult gstoreFdwInvokeCompaction(Relation frel, bool is_async);
 static CUresult gstoreFdwInvokeDropUnload(Oid ftable_oid, bool is_async);
-static cl_uint	gstoreFdwAllocateRowId(GpuStoreSharedState *gs_sstate,
-									   GpuStoreRowIdMapHead *rowid_map);
+static CUresult gstoreFdwInvokeReload(Oid ftable_oid, bool is_async);
+static CUresult gstoreFdwInvokeCheckpoint(Oid ftable_oid, bool is_async);
+static cl_uint	gstoreFdwAllocateRowId(GpuStoreDesc *gs_desc);
+static void		gstoreFdwReleaseRowIdCache(GpuStoreDesc *gs_desc);
 static void		gstoreFdwReleaseRowId(GpuStoreSharedState *gs_sstate,
 									  GpuStoreRowIdMapHead *rowid_map,
 									  cl_uint rowid);
 static void		gstoreFdwReleaseRowIdMulti(GpuStoreSharedState *gs_sstate,
 										   GpuStoreRowIdMapHead *rowid_map,
 										   cl_uint rowid, List *unused_rowids);
+static void		gstoreFdwPinRowIds(GpuStoreSharedState *gs_sstate,
+								   GpuStoreRowIdMapHead *rowid_map,
+								   cl_uint *rowids, cl_uint nitems);
+static bool		gstoreFdwUnpinRowIdsForce(GpuStoreDesc *gs_desc);
 static bool		gstoreFdwCheckRowId(GpuStoreSharedState *gs_sstate,
 									GpuStoreRowIdMapHead *rowid_map,
 									cl_uint rowid);
+static GpuStoreDictionary *gstoreFdwLookupDictionary(GpuStoreSharedState *gs_sstate,
+													 AttrNumber attnum);
 static void		gstoreFdwInsertIntoPrimaryKey(GpuStoreDesc *gs_desc,
 											  GpuStoreUndoLogs *gs_undo,
 											  cl_uint rowid);
 static void		gstoreFdwRemoveFromPrimaryKey(GpuStoreDesc *gs_desc,
 											  GpuStoreUndoLogs *gs_undo,
 											  cl_uint rowid);
+static FmgrInfo *gstoreFdwOrderedIndexCmpFunc(GpuStoreDesc *gs_desc, int k);
+static void		gstoreFdwInsertIntoOrderedIndexes(GpuStoreDesc *gs_desc,
+												  GpuStoreUndoLogs *gs_undo,
+												  cl_uint rowid);
+static void		gstoreFdwRemoveFromOrderedIndexes(GpuStoreDesc *gs_desc,
+												  GpuStoreUndoLogs *gs_undo,
+												  cl_uint rowid);
+static bool		__gstoreFdwOrderedIndexRemoveEntry(GpuStoreOrderedIndexHead *oindex,
+												   FmgrInfo *cmp_finfo,
+												   Datum key, cl_uint rowid);
+static void		gstoreFdwOrderedIndexLookup(GpuStoreDesc *gs_desc, int k,
+											Datum *lower, bool lower_incl,
+											Datum *upper, bool upper_incl,
+											cl_uint **p_rowids,
+											cl_uint *p_nrooms,
+											cl_uint *p_nrowids);
 
 #define __SpinLockAcquire(NUM,LOCK)										\
 	do {																\
@@ -304,6 +508,28 @@ static inline cl_uint atomicMax32(volatile cl_uint *ptr, cl_uint newval)
 	return newval;
 }
 
+/* ---- Dirty tracking for incremental checkpoint ---- */
+#define GSTORE_DIRTY_BLOCK_MIN_SHIFT	12		/* 4096 rows */
+#define GSTORE_DIRTY_BLOCK_MAX_NUMS		65536	/* per column */
+
+static inline void
+gstoreFdwMarkDirty(GpuStoreSharedState *gs_sstate, int cindex, cl_uint rowid)
+{
+	cl_uint		block = (rowid >> gs_sstate->dirty_shift);
+	pg_atomic_uint32 *word;
+	uint32		mask;
+
+	if (cindex >= gs_sstate->dirty_ncols ||
+		block >= 32 * gs_sstate->dirty_nwords)
+		return;
+	word = &gs_sstate->dirty_bitmap[cindex * gs_sstate->dirty_nwords +
+									(block >> 5)];
+	mask = (1U << (block & 0x1f));
+	/* avoid cache-line bouncing if already dirty */
+	if ((pg_atomic_read_u32(word) & mask) == 0)
+		pg_atomic_fetch_or_u32(word, mask);
+}
+
 /* ---- Lock/unlock rows/hash-slot ---- */
 static inline bool
 gstoreFdwSpinLockBaseRow(GpuStoreDesc *gs_desc, cl_uint rowid)
@@ -312,6 +538,8 @@ gstoreFdwSpinLockBaseRow(GpuStoreDesc *gs_desc, cl_uint rowid)
 	cl_uint		lindex = rowid % GSTORE_NUM_BASE_ROW_LOCKS;
 
 	SpinLockAcquire(&gs_sstate->base_row_lock[lindex]);
+	/* makes the sequence counter odd; see gstoreCheckVisibilityOptimistic */
+	pg_atomic_fetch_add_u32(&gs_sstate->base_row_seqno[lindex], 1);
 
 	return true;
 }
@@ -322,33 +550,61 @@ gstoreFdwSpinUnlockBaseRow(GpuStoreDesc *gs_desc, cl_uint rowid)
 	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
 	cl_uint		lindex = rowid % GSTORE_NUM_BASE_ROW_LOCKS;
 
+	/*
+	 * System column may be modified under the row-lock, so mark it dirty
+	 * prior to the unlock; see __gstoreFdwCheckpointWaitForWriters
+	 */
+	gstoreFdwMarkDirty(gs_sstate, gs_sstate->dirty_ncols - 1, rowid);
+	pg_atomic_fetch_add_u32(&gs_sstate->base_row_seqno[lindex], 1);
 	SpinLockRelease(&gs_sstate->base_row_lock[lindex]);
 
 	return false;
 }
 
+/*
+ * Spinlock of the bucket group in the PK hash-index
+ */
 static inline bool
-gstoreFdwSpinLockHashSlot(GpuStoreDesc *gs_desc, Datum hash)
+gstoreFdwSpinLockHashGroup(GpuStoreHashGroup *hgroup)
 {
-	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
-	cl_uint		lindex = hash % GSTORE_NUM_HASH_SLOT_LOCKS;
-
-	SpinLockAcquire(&gs_sstate->hash_slot_lock[lindex]);
+	if (__atomic_exchange_n(&hgroup->lock, 1, __ATOMIC_ACQUIRE) != 0)
+	{
+		SpinDelayStatus	delayStatus;
 
+		init_local_spin_delay(&delayStatus);
+		while (__atomic_exchange_n(&hgroup->lock, 1, __ATOMIC_ACQUIRE) != 0)
+		{
+			while (__atomic_load_n(&hgroup->lock, __ATOMIC_RELAXED) != 0)
+				perform_spin_delay(&delayStatus);
+		}
+		finish_spin_delay(&delayStatus);
+	}
 	return true;
 }
 
 static inline bool
-gstoreFdwSpinUnlockHashSlot(GpuStoreDesc *gs_desc, Datum hash)
+gstoreFdwSpinUnlockHashGroup(GpuStoreHashGroup *hgroup)
 {
-	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
-	cl_uint		lindex = hash % GSTORE_NUM_HASH_SLOT_LOCKS;
-
-	SpinLockRelease(&gs_sstate->hash_slot_lock[lindex]);
+	__atomic_store_n(&hgroup->lock, 0, __ATOMIC_RELEASE);
 
 	return false;
 }
 
+static inline GpuStoreHashGroup *
+gstoreFdwHashHomeGroup(GpuStoreHashIndexHead *hash_index, cl_uint hash)
+{
+	return &hash_index->groups[hash % hash_index->ngroups];
+}
+
+static inline GpuStoreHashGroup *
+gstoreFdwHashNextGroup(GpuStoreHashIndexHead *hash_index,
+					   GpuStoreHashGroup *hgroup)
+{
+	if (++hgroup >= hash_index->groups + hash_index->ngroups)
+		hgroup = hash_index->groups;
+	return hgroup;
+}
+
 /*
  * baseRelIsGstoreFdw
  */
@@ -407,28 +663,69 @@ GstoreGetForeignRelSize(PlannerInfo *root,
 	baserel->fdw_private = gs_desc;
 }
 
+/*
+ * match_clause_to_primary_key
+ *
+ * It checks whether the supplied clause is 'PK = expression', or
+ * 'PK = ANY(array-expression)'. If matched, it returns the expression and
+ * BTEqualStrategyNumber or GSTORE_INDEX_STRATEGY__EQ_ANY.
+ */
 static Node *
 match_clause_to_primary_key(PlannerInfo *root,
 							RelOptInfo *baserel,
 							RestrictInfo *rinfo,
-							int primary_key)
+							int primary_key,
+							int *p_strategy)
 {
 	OpExpr	   *op = (OpExpr *)rinfo->clause;
 	Node	   *left;
 	Node	   *right;
 	TypeCacheEntry *tcache;
 
+	if (IsA(rinfo->clause, ScalarArrayOpExpr))
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *)rinfo->clause;
+
+		if (!saop->useOr || list_length(saop->args) != 2)
+			return NULL;	/* only '= ANY(array)' */
+		left = (Node *) linitial(saop->args);
+		right = (Node *) lsecond(saop->args);
+		if (exprType(left) != get_element_type(exprType(right)))
+			return NULL;	/* type not compatible */
+		tcache = lookup_type_cache(exprType(left),
+								   TYPECACHE_EQ_OPR);
+		if (tcache->eq_opr != saop->opno)
+			return NULL;	/* opno is not equal operator */
+		if (IsA(left, RelabelType))
+			left = (Node *)((RelabelType *)left)->arg;
+		if (IsA(left, Var))
+		{
+			Var	   *var = (Var *)left;
+
+			if (var->varno == baserel->relid &&
+				var->varattno == primary_key &&
+				!bms_is_member(baserel->relid, pull_varnos(right)) &&
+				!contain_volatile_functions(right))
+			{
+				/* Ok, Left-VAR = ANY(Right-Expression) */
+				*p_strategy = GSTORE_INDEX_STRATEGY__EQ_ANY;
+				return right;
+			}
+		}
+		return NULL;
+	}
+
 	if (!IsA(op, OpExpr) || list_length(op->args) != 2)
-		return false;	/* binary operator */
+		return NULL;	/* binary operator */
 
 	left = (Node *) linitial(op->args);
 	right = (Node *) lsecond(op->args);
 	if (exprType(left) != exprType(right))
-		return false;	/* type not compatible */
+		return NULL;	/* type not compatible */
 	tcache = lookup_type_cache(exprType(left),
 							   TYPECACHE_EQ_OPR);
 	if (tcache->eq_opr != op->opno)
-		return false;	/* opno is not equal operator */
+		return NULL;	/* opno is not equal operator */
 
 	if (IsA(left, RelabelType))
 		left = (Node *)((RelabelType *)left)->arg;
@@ -444,6 +741,7 @@ match_clause_to_primary_key(PlannerInfo *root,
 			!contain_volatile_functions(right))
 		{
 			/* Ok, Left-VAR = Right-Expression */
+			*p_strategy = BTEqualStrategyNumber;
 			return right;
 		}
 	}
@@ -458,6 +756,7 @@ match_clause_to_primary_key(PlannerInfo *root,
 			!contain_volatile_functions(left))
 		{
 			/* Ok, Right-Var = Left-Expression */
+			*p_strategy = BTEqualStrategyNumber;
 			return left;
 		}
 	}
@@ -483,68 +782,381 @@ GetOptimalGpuForGstoreFdw(PlannerInfo *root,
 	return gs_desc->gs_sstate->cuda_dindex;
 }
 
+/*
+ * match_clause_to_ordered_index
+ *
+ * It checks whether the supplied clause is a comparison between the column
+ * of ordered-index and an expression that does not depend on the baserel.
+ * If matched, it returns the expression and BT*StrategyNumber of the operator
+ * as if the indexed column would be on the left side.
+ */
+static Node *
+match_clause_to_ordered_index(PlannerInfo *root,
+							  RelOptInfo *baserel,
+							  RestrictInfo *rinfo,
+							  AttrNumber attnum,
+							  int *p_strategy)
+{
+	OpExpr	   *op = (OpExpr *)rinfo->clause;
+	Node	   *left;
+	Node	   *right;
+	TypeCacheEntry *tcache;
+	int			strategy;
+
+	if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+		return NULL;	/* binary operator */
+
+	left = (Node *) linitial(op->args);
+	right = (Node *) lsecond(op->args);
+	if (exprType(left) != exprType(right))
+		return NULL;	/* type not compatible */
+	tcache = lookup_type_cache(exprType(left),
+							   TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(tcache->btree_opf))
+		return NULL;	/* not a sortable data type */
+	strategy = get_op_opfamily_strategy(op->opno, tcache->btree_opf);
+	if (strategy < BTLessStrategyNumber ||
+		strategy > BTGreaterStrategyNumber)
+		return NULL;	/* not a comparison operator */
+
+	if (IsA(left, RelabelType))
+		left = (Node *)((RelabelType *)left)->arg;
+	if (IsA(right, RelabelType))
+		right = (Node *)((RelabelType *)right)->arg;
+	if (IsA(left, Var))
+	{
+		Var	   *var = (Var *)left;
+
+		if (var->varno == baserel->relid &&
+			var->varattno == attnum &&
+			!bms_is_member(baserel->relid, rinfo->right_relids) &&
+			!contain_volatile_functions(right))
+		{
+			/* Ok, Left-VAR <OP> Right-Expression */
+			*p_strategy = strategy;
+			return right;
+		}
+	}
+
+	if (IsA(right, Var))
+	{
+		Var	   *var = (Var *)right;
+
+		if (var->varno == baserel->relid &&
+			var->varattno == attnum &&
+			!bms_is_member(baserel->relid, rinfo->left_relids) &&
+			!contain_volatile_functions(left))
+		{
+			/* Ok, Left-Expression <OP> Right-VAR */
+			*p_strategy = BTCommuteStrategyNumber(strategy);
+			return left;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * gstore_ec_member_matches_attnum - callback of
+ * generate_implied_equalities_for_column()
+ */
+static bool
+gstore_ec_member_matches_attnum(PlannerInfo *root,
+								RelOptInfo *baserel,
+								EquivalenceClass *ec,
+								EquivalenceMember *em,
+								void *arg)
+{
+	AttrNumber	attnum = *((AttrNumber *)arg);
+	Expr	   *expr = em->em_expr;
+
+	if (IsA(expr, RelabelType))
+		expr = ((RelabelType *)expr)->arg;
+	return (IsA(expr, Var) &&
+			((Var *)expr)->varno == baserel->relid &&
+			((Var *)expr)->varattno == attnum);
+}
+
+/*
+ * gstore_collect_join_clauses
+ *
+ * It collects join clauses that may be used for parameterized index-scan
+ * on the column 'attnum'. Equality join clauses are usually kept in the
+ * EquivalenceClass, thus we also generate them from the EC.
+ */
+static List *
+gstore_collect_join_clauses(PlannerInfo *root,
+							RelOptInfo *baserel,
+							AttrNumber attnum)
+{
+	List	   *join_clauses = NIL;
+	ListCell   *lc;
+
+	foreach (lc, baserel->joininfo)
+	{
+		RestrictInfo   *rinfo = lfirst(lc);
+
+		if (join_clause_is_movable_to(rinfo, baserel))
+			join_clauses = lappend(join_clauses, rinfo);
+	}
+	if (baserel->has_eclass_joins)
+	{
+		List   *temp;
+
+		temp = generate_implied_equalities_for_column(root,
+													  baserel,
+													  gstore_ec_member_matches_attnum,
+													  (void *)&attnum,
+													  baserel->lateral_referencers);
+		join_clauses = list_concat(join_clauses, temp);
+	}
+	return join_clauses;
+}
+
+/*
+ * __gstoreAddForeignPath
+ *
+ * 'ntuples' is the number of rows to be fetched, and 'index_cost' is
+ * the cost to walk on the index, if any.
+ */
 static void
-GstoreGetForeignPaths(PlannerInfo *root,
-					  RelOptInfo *baserel,
-					  Oid foreigntableid)
+__gstoreAddForeignPath(PlannerInfo *root,
+					   RelOptInfo *baserel,
+					   Relids required_outer,
+					   double ntuples,
+					   Cost index_cost,
+					   List *fdw_private)
 {
-	GpuStoreDesc   *gs_desc = baserel->fdw_private;
-	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
-	AttrNumber		primary_key = gs_sstate->primary_key;
-	Relids			required_outer = baserel->lateral_relids;
 	ParamPathInfo  *param_info;
 	ForeignPath	   *fpath;
-	ListCell	   *lc;
-	Node		   *indexExpr = NULL;
-	QualCost		qual_cost;
-	Cost			startup_cost = 0.0;
+	QualCost		qual_cost = baserel->baserestrictcost;
+	Cost			startup_cost = index_cost;
 	Cost			run_cost = 0.0;
-	double			ntuples = baserel->tuples;
+	double			nrows = baserel->rows;
 
 	/* gstore_fdw.enabled */
 	if (!gstore_fdw_enabled)
 		startup_cost += disable_cost;
 
-	if (primary_key > 0)
-	{
-		foreach (lc, baserel->baserestrictinfo)
-		{
-			RestrictInfo   *rinfo = lfirst(lc);
-
-			indexExpr = match_clause_to_primary_key(root,
-													baserel,
-													rinfo,
-													primary_key);
-			if (indexExpr)
-				break;
-		}
-	}
 	/* simple cost estimation */
 	param_info = get_baserel_parampathinfo(root, baserel, required_outer);
 	if (param_info)
-		cost_qual_eval(&qual_cost, param_info->ppi_clauses, root);
-	else
-		qual_cost = baserel->baserestrictcost;
-	if (indexExpr)
-		ntuples = 1.0;
+	{
+		QualCost	join_cost;
+
+		cost_qual_eval(&join_cost, param_info->ppi_clauses, root);
+		qual_cost.startup += join_cost.startup;
+		qual_cost.per_tuple += join_cost.per_tuple;
+		nrows = param_info->ppi_rows;
+	}
 	startup_cost += qual_cost.startup;
 	startup_cost += baserel->reltarget->cost.startup;
 	run_cost += (cpu_tuple_cost + qual_cost.per_tuple) * ntuples;
-	run_cost += baserel->reltarget->cost.per_tuple * baserel->rows;
+	run_cost += baserel->reltarget->cost.per_tuple * nrows;
 
 	fpath = create_foreignscan_path(root,
 									baserel,
 									NULL,	/* default pathtarget */
-									baserel->rows,
+									nrows,
 									startup_cost,
 									startup_cost + run_cost,
 									NIL,	/* no pathkeys */
 									required_outer,
 									NULL,	/* no extra plan */
-									list_make1(indexExpr));
+									fdw_private);
 	add_path(baserel, (Path *)fpath);
-	
-	//TODO: parameterized paths
+}
+
+/*
+ * __gstorePrimaryKeyIndexCost
+ *
+ * It returns the cost to walk on the PK index, and number of rows to be
+ * fetched. 'PK = ANY(array)' needs to sort and deduplicate the keys prior
+ * to the batched probe on the hash index.
+ */
+static Cost
+__gstorePrimaryKeyIndexCost(Node *indexExpr, int strategy, double *p_ntuples)
+{
+	double		nkeys;
+
+	if (strategy != GSTORE_INDEX_STRATEGY__EQ_ANY)
+	{
+		*p_ntuples = 1.0;
+		return 0.0;
+	}
+	nkeys = (double)Max(estimate_array_length(indexExpr), 1);
+	*p_ntuples = nkeys;
+	return cpu_operator_cost * nkeys * (log2(nkeys) + 2.0);
+}
+
+/*
+ * __gstoreAddOrderedIndexPath
+ */
+static void
+__gstoreAddOrderedIndexPath(PlannerInfo *root,
+							RelOptInfo *baserel,
+							int index_id,
+							AttrNumber attnum,
+							Relids required_outer,
+							List *index_clauses,
+							List *index_exprs,
+							List *index_strategies)
+{
+	Selectivity	selectivity;
+	double		ntuples;
+	Cost		index_cost;
+	List	   *index_info;
+
+	selectivity = clauselist_selectivity(root,
+										 index_clauses,
+										 baserel->relid,
+										 JOIN_INNER,
+										 NULL);
+	ntuples = clamp_row_est(selectivity * baserel->tuples);
+	/* binary search on the sorted array, and walk on the entries */
+	index_cost = cpu_operator_cost * (log2(baserel->tuples + 1.0) +
+									  (double)list_length(index_exprs));
+	index_cost += cpu_operator_cost * ntuples;
+
+	index_info = list_make3_int(GSTORE_INDEX_KIND__ORDERED, index_id, attnum);
+	__gstoreAddForeignPath(root, baserel, required_outer,
+						   ntuples, index_cost,
+						   list_make3(index_info,
+									  index_exprs,
+									  index_strategies));
+}
+
+static void
+GstoreGetForeignPaths(PlannerInfo *root,
+					  RelOptInfo *baserel,
+					  Oid foreigntableid)
+{
+	GpuStoreDesc   *gs_desc = baserel->fdw_private;
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	AttrNumber		primary_key = gs_sstate->primary_key;
+	Relids			lateral_relids = baserel->lateral_relids;
+	List		   *join_clauses;
+	List		   *index_info;
+	ListCell	   *lc;
+	Node		   *indexExpr;
+	Cost			index_cost;
+	double			ntuples;
+	int				k;
+
+	/* full scan */
+	__gstoreAddForeignPath(root, baserel, lateral_relids,
+						   baserel->tuples, 0.0, NIL);
+
+	/* PK index scan, and parameterized one */
+	if (primary_key > 0)
+	{
+		index_info = list_make3_int(GSTORE_INDEX_KIND__PRIMARY_KEY,
+									-1, primary_key);
+		foreach (lc, baserel->baserestrictinfo)
+		{
+			RestrictInfo   *rinfo = lfirst(lc);
+			int				strategy;
+
+			indexExpr = match_clause_to_primary_key(root,
+													baserel,
+													rinfo,
+													primary_key,
+													&strategy);
+			if (!indexExpr)
+				continue;
+			index_cost = __gstorePrimaryKeyIndexCost(indexExpr, strategy,
+													 &ntuples);
+			__gstoreAddForeignPath(root, baserel, lateral_relids,
+								   ntuples, index_cost,
+								   list_make3(index_info,
+											  list_make1(indexExpr),
+											  list_make1_int(strategy)));
+		}
+
+		join_clauses = gstore_collect_join_clauses(root, baserel, primary_key);
+		foreach (lc, join_clauses)
+		{
+			RestrictInfo   *rinfo = lfirst(lc);
+			Relids			required_outer;
+			int				strategy;
+
+			indexExpr = match_clause_to_primary_key(root,
+													baserel,
+													rinfo,
+													primary_key,
+													&strategy);
+			if (!indexExpr)
+				continue;
+			required_outer = bms_union(rinfo->clause_relids, lateral_relids);
+			required_outer = bms_del_member(required_outer, baserel->relid);
+			if (bms_is_empty(required_outer))
+				continue;
+			index_cost = __gstorePrimaryKeyIndexCost(indexExpr, strategy,
+													 &ntuples);
+			__gstoreAddForeignPath(root, baserel, required_outer,
+								   ntuples, index_cost,
+								   list_make3(index_info,
+											  list_make1(indexExpr),
+											  list_make1_int(strategy)));
+		}
+	}
+
+	/* Ordered index (range) scan, and parameterized one */
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		AttrNumber	attnum = gs_sstate->ordered_index[k];
+		List	   *index_clauses = NIL;
+		List	   *index_exprs = NIL;
+		List	   *index_strategies = NIL;
+		int			strategy;
+
+		foreach (lc, baserel->baserestrictinfo)
+		{
+			RestrictInfo   *rinfo = lfirst(lc);
+
+			indexExpr = match_clause_to_ordered_index(root,
+													  baserel,
+													  rinfo,
+													  attnum,
+													  &strategy);
+			if (indexExpr)
+			{
+				index_clauses = lappend(index_clauses, rinfo);
+				index_exprs = lappend(index_exprs, indexExpr);
+				index_strategies = lappend_int(index_strategies, strategy);
+			}
+		}
+		if (index_exprs != NIL)
+			__gstoreAddOrderedIndexPath(root, baserel, k, attnum,
+										lateral_relids,
+										index_clauses,
+										index_exprs,
+										index_strategies);
+
+		join_clauses = gstore_collect_join_clauses(root, baserel, attnum);
+		foreach (lc, join_clauses)
+		{
+			RestrictInfo   *rinfo = lfirst(lc);
+			Relids			required_outer;
+
+			indexExpr = match_clause_to_ordered_index(root,
+													  baserel,
+													  rinfo,
+													  attnum,
+													  &strategy);
+			if (!indexExpr)
+				continue;
+			required_outer = bms_union(rinfo->clause_relids, lateral_relids);
+			required_outer = bms_del_member(required_outer, baserel->relid);
+			if (bms_is_empty(required_outer))
+				continue;
+			/* join clause with the restriction clauses on the same column */
+			__gstoreAddOrderedIndexPath(root, baserel, k, attnum,
+										required_outer,
+										lappend(list_copy(index_clauses), rinfo),
+										lappend(list_copy(index_exprs), indexExpr),
+										lappend_int(list_copy(index_strategies), strategy));
+		}
+	}
 }
 
 /*
@@ -554,25 +1166,8 @@ GstoreGetForeignPaths(PlannerInfo *root,
  * Caller must have the spinlock of the row.
  */
 static bool
-gstoreCheckVisibilityForRead(GpuStoreDesc *gs_desc, cl_uint rowid,
-							 Snapshot snapshot,
-							 GstoreFdwSysattr *p_sysattr)
+__gstoreCheckVisibilityForRead(GstoreFdwSysattr *sysattr, Snapshot snapshot)
 {
-	kern_data_store *kds = &gs_desc->base_mmap->schema;
-	kern_colmeta   *cmeta = &kds->colmeta[kds->ncols - 1];
-	GstoreFdwSysattr *sysattr;
-	Datum			datum;
-	bool			isnull;
-
-	Assert(kds->format == KDS_FORMAT_COLUMN &&
-		   kds->ncols >= 1 &&
-		   rowid < kds->nrooms);
-	datum = KDS_fetch_datum_column(kds, cmeta, rowid, &isnull);
-	Assert(!isnull);
-	sysattr = (GstoreFdwSysattr *)DatumGetPointer(datum);
-	if (p_sysattr)
-		memcpy(p_sysattr, sysattr, sizeof(GstoreFdwSysattr));
-
 	if (sysattr->xmin != FrozenTransactionId)
 	{
 		if (TransactionIdIsCurrentTransactionId(sysattr->xmin))
@@ -635,12 +1230,165 @@ gstoreCheckVisibilityForRead(GpuStoreDesc *gs_desc, cl_uint rowid,
 	return false;
 }
 
-/*
- * gstoreCheckVisibilityForInsert
- */
 static bool
-gstoreCheckVisibilityForInsert(GpuStoreDesc *gs_desc, cl_uint rowid,
-							   TransactionId oldestXmin)
+gstoreCheckVisibilityForRead(GpuStoreDesc *gs_desc, cl_uint rowid,
+							 Snapshot snapshot,
+							 GstoreFdwSysattr *p_sysattr)
+{
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	kern_colmeta   *cmeta = &kds->colmeta[kds->ncols - 1];
+	GstoreFdwSysattr *sysattr;
+	Datum			datum;
+	bool			isnull;
+
+	Assert(kds->format == KDS_FORMAT_COLUMN &&
+		   kds->ncols >= 1 &&
+		   rowid < kds->nrooms);
+	datum = KDS_fetch_datum_column(kds, cmeta, rowid, &isnull);
+	Assert(!isnull);
+	sysattr = (GstoreFdwSysattr *)DatumGetPointer(datum);
+	if (p_sysattr)
+		memcpy(p_sysattr, sysattr, sizeof(GstoreFdwSysattr));
+
+	return __gstoreCheckVisibilityForRead(sysattr, snapshot);
+}
+
+/*
+ * gstoreFdwApplySysattrHints
+ *
+ * It writes back the pending hints of system attributes, if the row is
+ * not modified since the hint was made.
+ */
+static void
+gstoreFdwApplySysattrHints(GpuStoreFdwState *fdw_state)
+{
+	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	kern_colmeta   *cmeta = &kds->colmeta[kds->ncols - 1];
+	int				i;
+
+	for (i=0; i < fdw_state->num_hints; i++)
+	{
+		GpuStoreSysattrHint *hint = &fdw_state->hints[i];
+		GstoreFdwSysattr *sysattr;
+		Datum			datum;
+		bool			isnull;
+
+		datum = KDS_fetch_datum_column(kds, cmeta, hint->rowid, &isnull);
+		Assert(!isnull);
+		sysattr = (GstoreFdwSysattr *)DatumGetPointer(datum);
+
+		gstoreFdwSpinLockBaseRow(gs_desc, hint->rowid);
+		if (sysattr->xmin == hint->old_xmin &&
+			sysattr->xmax == hint->old_xmax)
+		{
+			sysattr->xmin = hint->new_xmin;
+			sysattr->xmax = hint->new_xmax;
+		}
+		gstoreFdwSpinUnlockBaseRow(gs_desc, hint->rowid);
+	}
+	fdw_state->num_hints = 0;
+}
+
+/*
+ * gstoreCheckVisibilityOptimistic
+ *
+ * It checks visibility of row for read without the row-spinlock. Writers
+ * increment the sequence counter of the lock on acquire and release, so
+ * an even and unchanged counter around the copy ensures that the system
+ * attribute is consistent. Hints (freezing of xmin/xmax) are not written
+ * here, but queued to be written back in batch.
+ * It returns 1 for visible, 0 for invisible, or -1 if concurrent writer
+ * is detected; caller shall check the row again with the row-spinlock.
+ */
+static int
+gstoreCheckVisibilityOptimistic(GpuStoreFdwState *fdw_state, cl_uint rowid,
+								Snapshot snapshot,
+								GstoreFdwSysattr *p_sysattr)
+{
+	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
+	pg_atomic_uint32 *seqno = &gs_desc->gs_sstate->base_row_seqno[rowid % GSTORE_NUM_BASE_ROW_LOCKS];
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	kern_colmeta   *cmeta = &kds->colmeta[kds->ncols - 1];
+	volatile GstoreFdwSysattr *sysattr;
+	GstoreFdwSysattr temp;
+	Datum			datum;
+	bool			isnull;
+	bool			visible;
+	uint32			seq;
+
+	Assert(kds->format == KDS_FORMAT_COLUMN &&
+		   kds->ncols >= 1 &&
+		   rowid < kds->nrooms);
+	datum = KDS_fetch_datum_column(kds, cmeta, rowid, &isnull);
+	Assert(!isnull);
+	sysattr = (volatile GstoreFdwSysattr *)DatumGetPointer(datum);
+
+	seq = pg_atomic_read_u32(seqno);
+	if ((seq & 1) != 0)
+		return -1;		/* row is locked by writer */
+	pg_read_barrier();
+	p_sysattr->xmin = sysattr->xmin;
+	p_sysattr->xmax = sysattr->xmax;
+	p_sysattr->cid  = sysattr->cid;
+	pg_read_barrier();
+	if (pg_atomic_read_u32(seqno) != seq)
+		return -1;		/* concurrent writer */
+
+	memcpy(&temp, p_sysattr, sizeof(GstoreFdwSysattr));
+	visible = __gstoreCheckVisibilityForRead(&temp, snapshot);
+	if (temp.xmin != p_sysattr->xmin ||
+		temp.xmax != p_sysattr->xmax)
+	{
+		GpuStoreSysattrHint *hint;
+
+		if (fdw_state->num_hints >= GSTORE_SYSATTR_HINTS_BATCH)
+			gstoreFdwApplySysattrHints(fdw_state);
+		hint = &fdw_state->hints[fdw_state->num_hints++];
+		hint->rowid    = rowid;
+		hint->old_xmin = p_sysattr->xmin;
+		hint->old_xmax = p_sysattr->xmax;
+		hint->new_xmin = temp.xmin;
+		hint->new_xmax = temp.xmax;
+	}
+	return (visible ? 1 : 0);
+}
+
+/*
+ * gstoreCheckVisibilityForScan
+ *
+ * It checks visibility of row for scan; lock-free unless any concurrent
+ * writer is working on the row (or its neighbor on the same lock).
+ */
+static bool
+gstoreCheckVisibilityForScan(GpuStoreFdwState *fdw_state, cl_uint rowid,
+							 Snapshot snapshot,
+							 GstoreFdwSysattr *p_sysattr)
+{
+	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
+	bool			visible;
+	int				rv;
+
+	rv = gstoreCheckVisibilityOptimistic(fdw_state, rowid,
+										 snapshot, p_sysattr);
+	if (rv >= 0)
+		return (rv > 0);
+
+	gstoreFdwSpinLockBaseRow(gs_desc, rowid);
+	visible = gstoreCheckVisibilityForRead(gs_desc, rowid,
+										   snapshot,
+										   p_sysattr);
+	gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
+
+	return visible;
+}
+
+/*
+ * gstoreCheckVisibilityForInsert
+ */
+static bool
+gstoreCheckVisibilityForInsert(GpuStoreDesc *gs_desc, cl_uint rowid,
+							   TransactionId oldestXmin)
 {
 	/* see logic in HeapTupleSatisfiesVacuum */
 	kern_data_store *kds = &gs_desc->base_mmap->schema;
@@ -910,6 +1658,78 @@ gstoreCheckVisibilityForIndex(GpuStoreDesc *gs_desc, cl_uint rowid)
 
 
 
+/*
+ * match_clause_to_scan_qual
+ *
+ * It checks whether the supplied clause is 'Var <OP> Const' (or commuted)
+ * on a fixed-length and pass-by-value column, or a dictionary-encoded
+ * variable-length column, which can be evaluated over the column array of
+ * the base file directly.
+ */
+static bool
+match_clause_to_scan_qual(Expr *clause, Index relid,
+						  GpuStoreSharedState *gs_sstate,
+						  AttrNumber *p_attnum,
+						  int *p_strategy,
+						  Const **p_const,
+						  Oid *p_collation)
+{
+	OpExpr	   *op = (OpExpr *)clause;
+	Node	   *left;
+	Node	   *right;
+	Var		   *var;
+	Const	   *con;
+	TypeCacheEntry *tcache;
+	int			strategy;
+
+	if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+		return false;	/* binary operator */
+
+	left = (Node *) linitial(op->args);
+	right = (Node *) lsecond(op->args);
+	if (IsA(left, Var) && IsA(right, Const))
+	{
+		var = (Var *)left;
+		con = (Const *)right;
+	}
+	else if (IsA(left, Const) && IsA(right, Var))
+	{
+		var = (Var *)right;
+		con = (Const *)left;
+	}
+	else
+		return false;
+	if (var->varno != relid ||
+		var->varattno <= 0 ||
+		var->vartype != con->consttype ||
+		con->constisnull)
+		return false;
+	if (con->constlen == -1)
+	{
+		/* equality/comparison of the distinct values only */
+		if (!gstoreFdwLookupDictionary(gs_sstate, var->varattno))
+			return false;
+	}
+	else if (!con->constbyval || con->constlen <= 0)
+		return false;
+	tcache = lookup_type_cache(var->vartype,
+							   TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(tcache->btree_opf))
+		return false;	/* not a sortable data type */
+	strategy = get_op_opfamily_strategy(op->opno, tcache->btree_opf);
+	if (strategy < BTLessStrategyNumber ||
+		strategy > BTGreaterStrategyNumber)
+		return false;	/* not a comparison operator */
+
+	*p_attnum = var->varattno;
+	*p_strategy = ((Node *)var == left
+				   ? strategy
+				   : BTCommuteStrategyNumber(strategy));
+	*p_const = con;
+	*p_collation = op->inputcollid;
+	return true;
+}
+
 static ForeignScan *
 GstoreGetForeignPlan(PlannerInfo *root,
 					 RelOptInfo *baserel,
@@ -921,9 +1741,52 @@ GstoreGetForeignPlan(PlannerInfo *root,
 {
 	Bitmapset  *referenced = NULL;
 	List	   *outer_refs = NIL;
+	List	   *index_info = NIL;
+	List	   *index_exprs = NIL;
+	List	   *index_strategies = NIL;
 	int			i, j, k;
 
-	scan_clauses = extract_actual_clauses(scan_clauses, false);
+	if (best_path->fdw_private != NIL)
+	{
+		index_info = linitial(best_path->fdw_private);
+		index_exprs = lsecond(best_path->fdw_private);
+		index_strategies = lthird(best_path->fdw_private);
+		scan_clauses = extract_actual_clauses(scan_clauses, false);
+	}
+	else
+	{
+		/*
+		 * Simple quals on the sequential scan are evaluated over the column
+		 * arrays, prior to the visibility checks and tuple formation.
+		 * Rows are not rechecked by the executor, so these are removed from
+		 * the scan_clauses, and carried by fdw_exprs instead of index_exprs.
+		 */
+		GpuStoreDesc *gs_desc = baserel->fdw_private;
+		List	   *host_quals = NIL;
+		ListCell   *lc;
+
+		foreach (lc, scan_clauses)
+		{
+			RestrictInfo *rinfo = lfirst(lc);
+			AttrNumber	attnum;
+			int			strategy;
+			Const	   *con;
+			Oid			collation;
+
+			Assert(IsA(rinfo, RestrictInfo));
+			if (rinfo->pseudoconstant)
+				continue;
+			if (gstore_fdw_enabled_column_scan &&
+				match_clause_to_scan_qual(rinfo->clause, baserel->relid,
+										  gs_desc->gs_sstate,
+										  &attnum, &strategy, &con,
+										  &collation))
+				index_exprs = lappend(index_exprs, rinfo->clause);
+			else
+				host_quals = lappend(host_quals, rinfo->clause);
+		}
+		scan_clauses = host_quals;
+	}
 	pull_varattnos((Node *)scan_clauses, baserel->relid, &referenced);
 	for (i=baserel->min_attr, j=0; i <= baserel->max_attr; i++, j++)
 	{
@@ -943,8 +1806,10 @@ GstoreGetForeignPlan(PlannerInfo *root,
 	return make_foreignscan(tlist,
 							scan_clauses,
 							baserel->relid,
-							best_path->fdw_private,	/* indexExpr */
-							outer_refs,	/* referenced attnums */
+							index_exprs,	/* index keys, or scan quals */
+							list_make3(outer_refs,	/* referenced attnums */
+									   index_info,
+									   index_strategies),
 							NIL,		/* no custom tlist */
 							NIL,		/* no remote quals */
 							outer_plan);
@@ -964,7 +1829,10 @@ gstoreFdwApplyRedoDeviceBuffer(Relation frel, GpuStoreSharedState *gs_sstate)
 }
 
 static GpuStoreFdwState *
-__ExecInitGstoreFdw(ScanState *ss, Bitmapset *outer_refs, Expr *indexExpr,
+__ExecInitGstoreFdw(ScanState *ss, Bitmapset *outer_refs,
+					List *index_info,
+					List *index_exprs,
+					List *index_strategies,
 					bool apply_redo_log)
 {
 	Relation		frel = ss->ss_currentRelation;
@@ -1020,8 +1888,107 @@ __ExecInitGstoreFdw(ScanState *ss, Bitmapset *outer_refs, Expr *indexExpr,
 	fdw_state->last_rowid = UINT_MAX;
 	fdw_state->is_first = true;
 	fdw_state->referenced = referenced;
-	if (indexExpr != NULL)
-		fdw_state->indexExprState = ExecInitExpr(indexExpr, &ss->ps);
+	if (index_info != NIL)
+	{
+		GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+
+		fdw_state->index_kind = linitial_int(index_info);
+		fdw_state->index_id = lsecond_int(index_info);
+		fdw_state->index_attnum = lthird_int(index_info);
+		/* index definition might be changed after the planning */
+		if (fdw_state->index_kind == GSTORE_INDEX_KIND__PRIMARY_KEY
+			? fdw_state->index_attnum != gs_sstate->primary_key
+			: (fdw_state->index_id < 0 ||
+			   fdw_state->index_id >= gs_sstate->num_ordered_indexes ||
+			   fdw_state->index_attnum != gs_sstate->ordered_index[fdw_state->index_id]))
+			elog(ERROR, "index of foreign table '%s' was changed after the planning",
+				 RelationGetRelationName(frel));
+		fdw_state->index_strategies = index_strategies;
+		fdw_state->index_exprs = ExecInitExprList(index_exprs, &ss->ps);
+		if (fdw_state->index_kind == GSTORE_INDEX_KIND__PRIMARY_KEY)
+		{
+			Form_pg_attribute attr = tupleDescAttr(tupdesc, fdw_state->index_attnum - 1);
+			TypeCacheEntry *tcache;
+
+			tcache = lookup_type_cache(attr->atttypid,
+									   TYPECACHE_HASH_PROC_FINFO |
+									   TYPECACHE_EQ_OPR_FINFO);
+			fdw_state->index_hash_finfo = &tcache->hash_proc_finfo;
+			fdw_state->index_eq_finfo = &tcache->eq_opr_finfo;
+			get_typlenbyvalalign(attr->atttypid,
+								 &fdw_state->index_typlen,
+								 &fdw_state->index_typbyval,
+								 &fdw_state->index_typalign);
+		}
+	}
+	else if (index_exprs != NIL)
+	{
+		/* quals pushed down to the column-at-a-time scan */
+		Index		scanrelid = ((Scan *)ss->ps.plan)->scanrelid;
+		ListCell   *lc;
+
+		fdw_state->scan_qual_items = palloc0(sizeof(GpuStoreScanQual) *
+											 list_length(index_exprs));
+		foreach (lc, index_exprs)
+		{
+			GpuStoreScanQual *qual;
+			Form_pg_attribute attr;
+			TypeCacheEntry *tcache;
+			AttrNumber	attnum;
+			int			strategy;
+			Const	   *con;
+			Oid			collation;
+
+			qual = &fdw_state->scan_qual_items[fdw_state->num_scan_quals++];
+			/* dictionary definition might be changed after the planning */
+			if (!match_clause_to_scan_qual(lfirst(lc), scanrelid,
+										   gs_desc->gs_sstate,
+										   &attnum, &strategy, &con,
+										   &collation))
+				elog(ERROR, "scan qual of foreign table '%s' was changed after the planning: %s",
+					 RelationGetRelationName(frel),
+					 nodeToString(lfirst(lc)));
+			attr = tupleDescAttr(tupdesc, attnum - 1);
+			if (attr->attlen == -1)
+			{
+				qual->memo_code = palloc0(sizeof(cl_uint) *
+										  GSTORE_SCAN_QUAL_MEMO_NSLOTS);
+				qual->memo_match = palloc0(sizeof(bool) *
+										   GSTORE_SCAN_QUAL_MEMO_NSLOTS);
+			}
+			else if (!attr->attbyval || attr->attlen <= 0)
+				elog(ERROR, "Bug? column '%s' is not a fixed-length pass-by-value",
+					 NameStr(attr->attname));
+			tcache = lookup_type_cache(attr->atttypid,
+									   TYPECACHE_CMP_PROC_FINFO);
+			if (!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+				elog(ERROR, "no comparison function for type %s",
+					 format_type_be(attr->atttypid));
+			qual->attnum = attnum;
+			qual->strategy = strategy;
+			qual->con = con;
+			qual->value = con->constvalue;
+			qual->collation = collation;
+			qual->cmp_finfo = &tcache->cmp_proc_finfo;
+			switch (attr->atttypid)
+			{
+				case INT2OID:
+				case INT4OID:
+				case INT8OID:
+				case DATEOID:
+				case TIMEOID:
+				case TIMESTAMPOID:
+				case TIMESTAMPTZOID:
+					qual->native = true;
+					break;
+				default:
+					qual->native = false;
+					break;
+			}
+		}
+		fdw_state->scan_rowids = palloc(sizeof(cl_uint) *
+										GSTORE_CPU_SCAN_BLOCKSZ);
+	}
 	/* synchronize device buffer prior to the kernel call */
 	if (apply_redo_log)
 		gstoreFdwApplyRedoDeviceBuffer(frel, gs_desc->gs_sstate);
@@ -1035,7 +2002,7 @@ ExecInitGstoreFdw(ScanState *ss, int eflags,
 {
 	bool	apply_redo_log = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0);
 
-	return __ExecInitGstoreFdw(ss, outer_refs, NULL, apply_redo_log);
+	return __ExecInitGstoreFdw(ss, outer_refs, NIL, NIL, NIL, apply_redo_log);
 }
 
 static void
@@ -1043,21 +2010,22 @@ GstoreBeginForeignScan(ForeignScanState *node, int eflags)
 {
 	ForeignScan	   *fscan = (ForeignScan *)node->ss.ps.plan;
 	Bitmapset	   *outer_refs = NULL;
-	Expr		   *indexExpr = NULL;
+	List		   *index_info = lsecond(fscan->fdw_private);
+	List		   *index_strategies = lthird(fscan->fdw_private);
 	ListCell	   *lc;
 
-	foreach (lc, fscan->fdw_private)
+	foreach (lc, (List *)linitial(fscan->fdw_private))
 	{
 		int		anum = lfirst_int(lc);
 
 		outer_refs = bms_add_member(outer_refs, anum -
 									FirstLowInvalidHeapAttributeNumber);
 	}
-
-	if (fscan->fdw_exprs != NIL)
-		indexExpr = linitial(fscan->fdw_exprs);
-
-	node->fdw_state = __ExecInitGstoreFdw(&node->ss, outer_refs, indexExpr, false);
+	node->fdw_state = __ExecInitGstoreFdw(&node->ss, outer_refs,
+										  index_info,
+										  fscan->fdw_exprs,
+										  index_strategies,
+										  false);
 }
 
 /*
@@ -1215,102 +2183,287 @@ __gstoreFillupTupleTableSlot(TupleTableSlot *slot,
 	return slot;
 }
 
-static TupleTableSlot *
-__gstoreIterateForeignIndexScan(ForeignScanState *node)
+/*
+ * __gstoreFdwPrimaryKeyProbe
+ *
+ * It walks on the PK hash-index, then returns rowid of the row visible to
+ * the snapshot, or UINT_MAX if not found.
+ */
+static cl_uint
+__gstoreFdwPrimaryKeyProbe(GpuStoreDesc *gs_desc,
+						   FmgrInfo *eq_finfo,
+						   Snapshot snapshot,
+						   Datum kdatum, cl_uint hash)
 {
-	Relation		frel __attribute__((unused))
-		= node->ss.ss_currentRelation;
-	EState		   *estate = node->ss.ps.state;
-	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
-	GpuStoreFdwState *fdw_state = node->fdw_state;
-	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
 	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
 	GpuStoreHashIndexHead *hash_index = gs_desc->hash_index;
 	kern_data_store *kds = &gs_desc->base_mmap->schema;
 	kern_colmeta *cmeta = &kds->colmeta[gs_sstate->primary_key - 1];
-	cl_uint		   *rowmap;
-	TypeCacheEntry *tcache;
+	GpuStoreHashGroup *hhome;
+	GpuStoreHashGroup *hgroup = NULL;
+	bool			curr_locked = false;
 	cl_uint			rowid = UINT_MAX;
-	Datum			kdatum;
-	Datum			vdatum;
-	Datum			hash;
-	bool			isnull;
-	GstoreFdwSysattr sysattr;
-
-	Assert(hash_index != NULL &&
-		   gs_sstate->primary_key > 0 &&
-		   gs_sstate->primary_key <= RelationGetNumberOfAttributes(frel));
-	if (pg_atomic_fetch_add_u64(fdw_state->read_pos, 1) > 0)
-		return NULL;
-	rowmap = &hash_index->slots[hash_index->nslots];
-		
-	/* extract the key value */
-	kdatum = ExecEvalExpr(fdw_state->indexExprState,
-						  node->ss.ps.ps_ExprContext,
-						  &isnull);
-	if (isnull)
-		return NULL;
-	/* calculation of hash-value */
-	tcache = lookup_type_cache(cmeta->atttypid,
-							   TYPECACHE_HASH_PROC_FINFO |
-							   TYPECACHE_EQ_OPR_FINFO);
-	hash = FunctionCall1(&tcache->hash_proc_finfo, kdatum);
 
-	/* walk on the hash-table */
-	gstoreFdwSpinLockHashSlot(gs_desc, hash);
+	hhome = gstoreFdwHashHomeGroup(hash_index, hash);
+	gstoreFdwSpinLockHashGroup(hhome);
 	PG_TRY();
 	{
 		GstoreFdwSysattr __sysattr;
-		cl_uint		curr_id;
+		Datum		vdatum;
+		bool		isnull;
+		uint64		count;
+		cl_uint		overflow;
+		int			i;
 
-		curr_id = hash_index->slots[hash % hash_index->nslots];
-		while (curr_id < hash_index->nrooms)
+		hgroup = hhome;
+		for (count=0; count < hash_index->ngroups; count++)
 		{
-			gstoreFdwSpinLockBaseRow(gs_desc, curr_id);
-			PG_TRY();
+			if (hgroup != hhome)
+				curr_locked = gstoreFdwSpinLockHashGroup(hgroup);
+			for (i=0; i < GPUSTORE_HASHINDEX_NBUCKETS; i++)
 			{
-				if (gstoreCheckVisibilityForRead(gs_desc, curr_id,
-												 estate->es_snapshot,
-												 &__sysattr))
+				cl_uint		curr_id = hgroup->rowid[i];
+
+				/* compare the fingerprint first */
+				if (curr_id >= hash_index->nrooms ||
+					hgroup->hash[i] != hash)
+					continue;
+				gstoreFdwSpinLockBaseRow(gs_desc, curr_id);
+				PG_TRY();
 				{
-					vdatum = KDS_fetch_datum_column(kds, cmeta,
-													curr_id,
-													&isnull);
-					if (!isnull && FunctionCall2(&tcache->eq_opr_finfo,
-												 kdatum, vdatum))
+					if (gstoreCheckVisibilityForRead(gs_desc, curr_id,
+													 snapshot,
+													 &__sysattr))
 					{
-						if (rowid != UINT_MAX)
-							elog(ERROR, "index corruption? duplicate primary key");
-						rowid = curr_id;
-						sysattr = __sysattr;
+						vdatum = KDS_fetch_datum_column(kds, cmeta,
+														curr_id,
+														&isnull);
+						if (!isnull && FunctionCall2(eq_finfo,
+													 kdatum, vdatum))
+						{
+							if (rowid != UINT_MAX)
+								elog(ERROR, "index corruption? duplicate primary key");
+							rowid = curr_id;
+						}
 					}
 				}
-			}
-			PG_CATCH();
-			{
+				PG_CATCH();
+				{
+					gstoreFdwSpinUnlockBaseRow(gs_desc, curr_id);
+					PG_RE_THROW();
+				}
+				PG_END_TRY();
 				gstoreFdwSpinUnlockBaseRow(gs_desc, curr_id);
-				PG_RE_THROW();
 			}
-			PG_END_TRY();
-			gstoreFdwSpinUnlockBaseRow(gs_desc, curr_id);
-
-			curr_id = rowmap[curr_id];
+			overflow = hgroup->overflow;
+			if (curr_locked)
+				curr_locked = gstoreFdwSpinUnlockHashGroup(hgroup);
+			if (overflow == 0)
+				break;
+			hgroup = gstoreFdwHashNextGroup(hash_index, hgroup);
 		}
 	}
 	PG_CATCH();
 	{
-		gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
+		if (curr_locked)
+			gstoreFdwSpinUnlockHashGroup(hgroup);
+		gstoreFdwSpinUnlockHashGroup(hhome);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
-	gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
+	gstoreFdwSpinUnlockHashGroup(hhome);
 
-	if (rowid == UINT_MAX)
-		return NULL;	/* not found */
+	return rowid;
+}
 
-	return __gstoreFillupTupleTableSlot(slot, gs_desc,
-										rowid, &sysattr,
-										fdw_state);
+/*
+ * __gstoreFdwAppendIndexRowId
+ */
+static inline void
+__gstoreFdwAppendIndexRowId(cl_uint **p_rowids,
+							cl_uint *p_nrooms,
+							cl_uint *p_nrowids,
+							cl_uint rowid)
+{
+	if (*p_nrowids >= *p_nrooms)
+	{
+		*p_nrooms = Max(2 * *p_nrooms, 1024);
+		*p_rowids = repalloc_huge(*p_rowids, sizeof(cl_uint) * *p_nrooms);
+	}
+	(*p_rowids)[(*p_nrowids)++] = rowid;
+}
+
+/*
+ * __gstoreFdwCompareRowId - comparator for qsort
+ */
+static int
+__gstoreFdwCompareRowId(const void *__a, const void *__b)
+{
+	cl_uint		a = *((const cl_uint *)__a);
+	cl_uint		b = *((const cl_uint *)__b);
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
+/*
+ * GpuStorePrimaryKeyProbe - a key to be probed on the PK hash-index
+ */
+typedef struct
+{
+	GpuStoreHashGroup *hhome;
+	cl_uint		hash;
+	Datum		key;
+} GpuStorePrimaryKeyProbe;
+
+static int
+__gstoreFdwComparePrimaryKeyProbe(const void *__a, const void *__b)
+{
+	const GpuStorePrimaryKeyProbe *a = __a;
+	const GpuStorePrimaryKeyProbe *b = __b;
+
+	if (a->hhome != b->hhome)
+		return (a->hhome < b->hhome ? -1 : 1);
+	if (a->hash != b->hash)
+		return (a->hash < b->hash ? -1 : 1);
+	return 0;
+}
+
+/*
+ * number of keys to prefetch the hash-group prior to the probe
+ */
+#define GSTORE_PK_PREFETCH_DISTANCE		8
+
+/*
+ * __gstoreFetchPrimaryKeyRowIds
+ *
+ * It fetches rowids of the rows that match 'PK = key' or 'PK = ANY(array)'.
+ * In case of the array, keys are sorted by the location of the home hash-
+ * group, and duplicated keys are removed, then probed one by one with
+ * prefetch of the hash-groups to be walked on later.
+ */
+static void
+__gstoreFetchPrimaryKeyRowIds(ForeignScanState *node)
+{
+	EState		   *estate = node->ss.ps.state;
+	ExprContext	   *econtext = node->ss.ps.ps_ExprContext;
+	GpuStoreFdwState *fdw_state = node->fdw_state;
+	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
+	GpuStoreHashIndexHead *hash_index = gs_desc->hash_index;
+	ExprState	   *key_state = linitial(fdw_state->index_exprs);
+	GpuStorePrimaryKeyProbe *probes;
+	Datum			kdatum;
+	bool			isnull;
+	cl_uint			rowid;
+	int				i, j, nkeys;
+
+	Assert(hash_index != NULL);
+	kdatum = ExecEvalExpr(key_state, econtext, &isnull);
+	if (isnull)
+		return;		/* equal operator is strict, so nothing matches */
+
+	if (linitial_int(fdw_state->index_strategies) != GSTORE_INDEX_STRATEGY__EQ_ANY)
+	{
+		/* simple 'PK = key' */
+		rowid = __gstoreFdwPrimaryKeyProbe(gs_desc,
+										   fdw_state->index_eq_finfo,
+										   estate->es_snapshot,
+										   kdatum,
+										   DatumGetUInt32(FunctionCall1(fdw_state->index_hash_finfo,
+																		kdatum)));
+		if (rowid != UINT_MAX)
+			__gstoreFdwAppendIndexRowId(&fdw_state->index_rowids,
+										&fdw_state->index_nrooms,
+										&fdw_state->index_nrowids,
+										rowid);
+		return;
+	}
+
+	/* 'PK = ANY(array)'; extract the keys and calculate the hash-values */
+	{
+		ArrayType  *array = DatumGetArrayTypeP(kdatum);
+		Datum	   *elem_values;
+		bool	   *elem_nulls;
+		int			nelems;
+
+		deconstruct_array(array,
+						  ARR_ELEMTYPE(array),
+						  fdw_state->index_typlen,
+						  fdw_state->index_typbyval,
+						  fdw_state->index_typalign,
+						  &elem_values,
+						  &elem_nulls,
+						  &nelems);
+		probes = palloc(sizeof(GpuStorePrimaryKeyProbe) * Max(nelems, 1));
+		for (i=0, nkeys=0; i < nelems; i++)
+		{
+			cl_uint		hash;
+
+			if (elem_nulls[i])
+				continue;	/* NULL never matches */
+			hash = DatumGetUInt32(FunctionCall1(fdw_state->index_hash_finfo,
+												elem_values[i]));
+			probes[nkeys].hhome = gstoreFdwHashHomeGroup(hash_index, hash);
+			probes[nkeys].hash = hash;
+			probes[nkeys].key = elem_values[i];
+			nkeys++;
+		}
+	}
+	if (nkeys == 0)
+		return;
+
+	/*
+	 * Sort the keys by the home hash-group, to walk on the hash-index
+	 * sequentially; it also makes duplicated keys adjacent.
+	 */
+	if (nkeys > 1)
+	{
+		qsort(probes, nkeys, sizeof(GpuStorePrimaryKeyProbe),
+			  __gstoreFdwComparePrimaryKeyProbe);
+		for (i=1, j=0; i < nkeys; i++)
+		{
+			int		k;
+
+			/* keys with the same hash value may be equal */
+			for (k=j; k >= 0 && probes[k].hash == probes[i].hash; k--)
+			{
+				if (DatumGetBool(FunctionCall2(fdw_state->index_eq_finfo,
+											   probes[k].key,
+											   probes[i].key)))
+					break;
+			}
+			if (k < 0 || probes[k].hash != probes[i].hash)
+				probes[++j] = probes[i];
+		}
+		nkeys = j + 1;
+	}
+
+	for (i=0; i < nkeys; i++)
+	{
+		if (i + GSTORE_PK_PREFETCH_DISTANCE < nkeys)
+			__builtin_prefetch(probes[i + GSTORE_PK_PREFETCH_DISTANCE].hhome);
+		rowid = __gstoreFdwPrimaryKeyProbe(gs_desc,
+										   fdw_state->index_eq_finfo,
+										   estate->es_snapshot,
+										   probes[i].key,
+										   probes[i].hash);
+		if (rowid != UINT_MAX)
+			__gstoreFdwAppendIndexRowId(&fdw_state->index_rowids,
+										&fdw_state->index_nrooms,
+										&fdw_state->index_nrowids,
+										rowid);
+	}
+	pfree(probes);
+
+	/* rowid order is friendly to the columnar layout */
+	if (fdw_state->index_nrowids > 1)
+		qsort(fdw_state->index_rowids,
+			  fdw_state->index_nrowids,
+			  sizeof(cl_uint),
+			  __gstoreFdwCompareRowId);
 }
 
 static TupleTableSlot *
@@ -1331,12 +2484,13 @@ __gstoreIterateForeignSeqScan(ForeignScanState *node)
 	do {
 		rowid = pg_atomic_fetch_add_u64(fdw_state->read_pos, 1);
 		if (rowid >= fdw_state->nitems)
+		{
+			gstoreFdwApplySysattrHints(fdw_state);
 			return NULL;
-		gstoreFdwSpinLockBaseRow(gs_desc, rowid);
-		visible = gstoreCheckVisibilityForRead(gs_desc, rowid,
+		}
+		visible = gstoreCheckVisibilityForScan(fdw_state, rowid,
 											   estate->es_snapshot,
 											   &sysattr);
-		gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
 	} while (!visible);
 
 	return __gstoreFillupTupleTableSlot(slot, gs_desc,
@@ -1344,14 +2498,335 @@ __gstoreIterateForeignSeqScan(ForeignScanState *node)
 										fdw_state);
 }
 
-static TupleTableSlot *
-GstoreIterateForeignScan(ForeignScanState *node)
+/*
+ * __gstoreScanQualMatch
+ */
+static inline bool
+__gstoreScanQualMatch(int strategy, int cmp)
 {
-	GpuStoreFdwState *fdw_state = node->fdw_state;
-
-	ExecClearTuple(node->ss.ss_ScanTupleSlot);
-	if (fdw_state->indexExprState)
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:			return (cmp <  0);
+		case BTLessEqualStrategyNumber:		return (cmp <= 0);
+		case BTEqualStrategyNumber:			return (cmp == 0);
+		case BTGreaterEqualStrategyNumber:	return (cmp >= 0);
+		case BTGreaterStrategyNumber:		return (cmp >  0);
+		default:
+			elog(ERROR, "unexpected strategy number: %d", strategy);
+	}
+	return false;
+}
+
+#define __GSTORE_SCAN_QUAL_NATIVE(TYPE,KEY)							\
+	do {															\
+		TYPE   *values = (TYPE *)base;								\
+		TYPE	key = (KEY);										\
+																	\
+		for (i=0, j=0; i < nrowids; i++)							\
+		{															\
+			cl_uint	rowid = rowids[i];								\
+			TYPE	val;											\
+																	\
+			if (nullmap && att_isnull(rowid, nullmap))				\
+				continue;											\
+			val = values[rowid];									\
+			if (__gstoreScanQualMatch(qual->strategy,				\
+									  (val > key) - (val < key)))	\
+				rowids[j++] = rowid;								\
+		}															\
+	} while(0)
+
+/*
+ * __gstoreEvalScanQuals
+ *
+ * It evaluates the pushed-down quals over the column arrays for rows in
+ * [start, start + nitems), then makes a selection vector of the candidate
+ * rows. Values of invisible rows may be under the update, but no matter,
+ * because visibility is checked on the candidate rows later, and values of
+ * visible rows are never modified.
+ * Quals on the dictionary-encoded columns are evaluated once per code; it
+ * is a location of the distinct value on the extra buffer, thus never
+ * reused unless compaction under AccessExclusiveLock.
+ */
+static void
+__gstoreEvalScanQuals(GpuStoreFdwState *fdw_state,
+					  cl_uint start, cl_uint nitems)
+{
+	GpuStoreDesc *gs_desc = fdw_state->gs_desc;
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	cl_uint	   *rowids = fdw_state->scan_rowids;
+	cl_uint		nrowids = nitems;
+	cl_uint		i, j;
+	int			k;
+
+	Assert(nitems <= GSTORE_CPU_SCAN_BLOCKSZ);
+	for (i=0; i < nitems; i++)
+		rowids[i] = start + i;
+
+	for (k=0; k < fdw_state->num_scan_quals && nrowids > 0; k++)
+	{
+		GpuStoreScanQual *qual = &fdw_state->scan_qual_items[k];
+		kern_colmeta   *cmeta = &kds->colmeta[qual->attnum - 1];
+		bits8		   *nullmap = NULL;
+		char		   *base;
+
+		Assert((cmeta->attbyval && cmeta->attlen > 0) || cmeta->attlen == -1);
+		if (cmeta->nullmap_offset != 0)
+			nullmap = (bits8 *)((char *)kds + __kds_unpack(cmeta->nullmap_offset));
+		base = (char *)kds + __kds_unpack(cmeta->values_offset);
+
+		if (qual->native && cmeta->attlen == sizeof(cl_short))
+			__GSTORE_SCAN_QUAL_NATIVE(cl_short, DatumGetInt16(qual->value));
+		else if (qual->native && cmeta->attlen == sizeof(cl_int))
+			__GSTORE_SCAN_QUAL_NATIVE(cl_int, DatumGetInt32(qual->value));
+		else if (qual->native && cmeta->attlen == sizeof(cl_long))
+			__GSTORE_SCAN_QUAL_NATIVE(cl_long, DatumGetInt64(qual->value));
+		else if (cmeta->attlen == -1)
+		{
+			kern_data_extra *extra = (kern_data_extra *)
+				((char *)kds + kds->extra_hoffset);
+			char	   *tail = (char *)gs_desc->base_mmap + gs_desc->base_mmap_sz;
+			cl_uint	   *codes = (cl_uint *)base;
+
+			for (i=0, j=0; i < nrowids; i++)
+			{
+				cl_uint		rowid = rowids[i];
+				cl_uint		code = codes[rowid];
+				cl_uint		hindex;
+				char	   *vl;
+				int			cmp;
+
+				if ((nullmap && att_isnull(rowid, nullmap)) || code == 0)
+					continue;
+				hindex = (code * 0x9e3779b1U) >> (32 - GSTORE_SCAN_QUAL_MEMO_BITS);
+				if (qual->memo_code[hindex] != code)
+				{
+					/*
+					 * Values out of the current mapping are written by
+					 * the concurrent transactions that extended the extra
+					 * buffer after this scan began; invisible anyway.
+					 */
+					vl = (char *)extra + __kds_unpack(code);
+					if (vl >= tail || vl + VARSIZE_ANY(vl) > tail)
+						continue;
+					cmp = DatumGetInt32(FunctionCall2Coll(qual->cmp_finfo,
+														  qual->collation,
+														  PointerGetDatum(vl),
+														  qual->value));
+					qual->memo_code[hindex] = code;
+					qual->memo_match[hindex] = __gstoreScanQualMatch(qual->strategy, cmp);
+				}
+				if (qual->memo_match[hindex])
+					rowids[j++] = rowid;
+			}
+		}
+		else
+		{
+			for (i=0, j=0; i < nrowids; i++)
+			{
+				cl_uint		rowid = rowids[i];
+				Datum		datum;
+				bool		isnull;
+				int			cmp;
+
+				datum = KDS_fetch_datum_column(kds, cmeta, rowid, &isnull);
+				if (isnull)
+					continue;
+				cmp = DatumGetInt32(FunctionCall2Coll(qual->cmp_finfo,
+													  qual->collation,
+													  datum, qual->value));
+				if (__gstoreScanQualMatch(qual->strategy, cmp))
+					rowids[j++] = rowid;
+			}
+		}
+		nrowids = j;
+	}
+	fdw_state->scan_nrowids = nrowids;
+	fdw_state->scan_curr = 0;
+}
+
+static TupleTableSlot *
+__gstoreIterateForeignColumnScan(ForeignScanState *node)
+{
+	EState		   *estate = node->ss.ps.state;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	GpuStoreFdwState *fdw_state = node->fdw_state;
+	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
+	GstoreFdwSysattr sysattr;
+	cl_uint			rowid;
+	uint64			start;
+
+	for (;;)
+	{
+		while (fdw_state->scan_curr < fdw_state->scan_nrowids)
+		{
+			rowid = fdw_state->scan_rowids[fdw_state->scan_curr++];
+			if (gstoreCheckVisibilityForScan(fdw_state, rowid,
+											 estate->es_snapshot,
+											 &sysattr))
+				return __gstoreFillupTupleTableSlot(slot, gs_desc,
+													rowid, &sysattr,
+													fdw_state);
+		}
+		start = pg_atomic_fetch_add_u64(fdw_state->read_pos,
+										GSTORE_CPU_SCAN_BLOCKSZ);
+		if (start >= fdw_state->nitems)
+		{
+			gstoreFdwApplySysattrHints(fdw_state);
+			return NULL;
+		}
+		__gstoreEvalScanQuals(fdw_state, start,
+							  Min(fdw_state->nitems - start,
+								  GSTORE_CPU_SCAN_BLOCKSZ));
+	}
+}
+
+/*
+ * __gstoreTightenIndexBound
+ *
+ * It replaces the lower (or upper) bound of the ordered-index scan if the
+ * supplied key is tighter than the current one.
+ */
+static void
+__gstoreTightenIndexBound(FmgrInfo *cmp_finfo, bool is_lower,
+						  Datum key, bool key_incl,
+						  Datum *p_bound, bool *p_incl, bool *p_valid)
+{
+	if (*p_valid)
+	{
+		int		cmp = DatumGetInt32(FunctionCall2(cmp_finfo, key, *p_bound));
+
+		if (cmp == 0 ? key_incl : (is_lower ? cmp < 0 : cmp > 0))
+			return;		/* current bound is tighter */
+	}
+	*p_bound = key;
+	*p_incl  = key_incl;
+	*p_valid = true;
+}
+
+/*
+ * __gstoreFetchOrderedIndexRowIds
+ *
+ * It fetches rowids of the rows in the range of the ordered-index scan.
+ */
+static void
+__gstoreFetchOrderedIndexRowIds(ForeignScanState *node)
+{
+	ExprContext	   *econtext = node->ss.ps.ps_ExprContext;
+	GpuStoreFdwState *fdw_state = node->fdw_state;
+	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
+	FmgrInfo	   *cmp_finfo;
+	Datum			lower = 0;
+	Datum			upper = 0;
+	bool			lower_incl = false;
+	bool			upper_incl = false;
+	bool			has_lower = false;
+	bool			has_upper = false;
+	ListCell	   *lc1, *lc2;
+
+	cmp_finfo = gstoreFdwOrderedIndexCmpFunc(gs_desc, fdw_state->index_id);
+	forboth (lc1, fdw_state->index_exprs,
+			 lc2, fdw_state->index_strategies)
+	{
+		ExprState  *key_state = lfirst(lc1);
+		int			strategy = lfirst_int(lc2);
+		Datum		key;
+		bool		isnull;
+
+		key = ExecEvalExpr(key_state, econtext, &isnull);
+		if (isnull)
+			return;		/* comparison operators are strict, so nothing matches */
+		if (strategy == BTLessStrategyNumber ||
+			strategy == BTLessEqualStrategyNumber ||
+			strategy == BTEqualStrategyNumber)
+			__gstoreTightenIndexBound(cmp_finfo, false,
+									  key, strategy != BTLessStrategyNumber,
+									  &upper, &upper_incl, &has_upper);
+		if (strategy == BTGreaterStrategyNumber ||
+			strategy == BTGreaterEqualStrategyNumber ||
+			strategy == BTEqualStrategyNumber)
+			__gstoreTightenIndexBound(cmp_finfo, true,
+									  key, strategy != BTGreaterStrategyNumber,
+									  &lower, &lower_incl, &has_lower);
+	}
+	gstoreFdwOrderedIndexLookup(gs_desc, fdw_state->index_id,
+								has_lower ? &lower : NULL, lower_incl,
+								has_upper ? &upper : NULL, upper_incl,
+								&fdw_state->index_rowids,
+								&fdw_state->index_nrooms,
+								&fdw_state->index_nrowids);
+}
+
+static TupleTableSlot *
+__gstoreIterateForeignIndexScan(ForeignScanState *node)
+{
+	EState		   *estate = node->ss.ps.state;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	GpuStoreFdwState *fdw_state = node->fdw_state;
+	GpuStoreDesc   *gs_desc = fdw_state->gs_desc;
+	cl_uint			rowid;
+	bool			visible;
+	GstoreFdwSysattr sysattr;
+
+	/*
+	 * Fetch rowids by the index at the first call, then returns the rows
+	 * visible to the snapshot one by one. The rowid buffer is kept across
+	 * rescans, to avoid allocation for each outer row of nested-loop.
+	 */
+	if (!fdw_state->index_fetched)
+	{
+		MemoryContext	oldcxt;
+
+		if (!fdw_state->index_rowids)
+		{
+			fdw_state->index_nrooms = 1024;
+			fdw_state->index_rowids =
+				MemoryContextAlloc(estate->es_query_cxt,
+								   sizeof(cl_uint) * fdw_state->index_nrooms);
+		}
+		fdw_state->index_nrowids = 0;
+		fdw_state->index_curr = 0;
+		/* key values are transient */
+		oldcxt = MemoryContextSwitchTo(node->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+		if (fdw_state->index_kind == GSTORE_INDEX_KIND__PRIMARY_KEY)
+			__gstoreFetchPrimaryKeyRowIds(node);
+		else
+			__gstoreFetchOrderedIndexRowIds(node);
+		MemoryContextSwitchTo(oldcxt);
+		fdw_state->index_fetched = true;
+	}
+
+	do {
+		if (fdw_state->index_curr >= fdw_state->index_nrowids)
+		{
+			gstoreFdwApplySysattrHints(fdw_state);
+			return NULL;
+		}
+		rowid = fdw_state->index_rowids[fdw_state->index_curr++];
+		visible = gstoreCheckVisibilityForScan(fdw_state, rowid,
+											   estate->es_snapshot,
+											   &sysattr);
+	} while (!visible);
+
+	/*
+	 * NOTE: rowid may be released and reused by other rows after the index
+	 * lookup, however, scan_clauses are always re-checked by the executor.
+	 */
+	return __gstoreFillupTupleTableSlot(slot, gs_desc,
+										rowid, &sysattr,
+										fdw_state);
+}
+
+static TupleTableSlot *
+GstoreIterateForeignScan(ForeignScanState *node)
+{
+	GpuStoreFdwState *fdw_state = node->fdw_state;
+
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	if (fdw_state->index_kind != GSTORE_INDEX_KIND__NONE)
 		return __gstoreIterateForeignIndexScan(node);
+	else if (fdw_state->num_scan_quals > 0)
+		return __gstoreIterateForeignColumnScan(node);
 	else
 		return __gstoreIterateForeignSeqScan(node);
 }
@@ -1360,18 +2835,39 @@ void
 ExecReScanGstoreFdw(GpuStoreFdwState *fdw_state)
 {
 	pg_atomic_write_u64(fdw_state->read_pos, 0);
+	/* index scan shall lookup the index again, but buffer is reused */
+	fdw_state->index_fetched = false;
+	fdw_state->index_nrowids = 0;
+	fdw_state->index_curr = 0;
+	/* also, selection vector of the column scan */
+	fdw_state->scan_nrowids = 0;
+	fdw_state->scan_curr = 0;
 }
 
 static void
 GstoreReScanForeignScan(ForeignScanState *node)
 {
-	ExecReScanGstoreFdw((GpuStoreFdwState *)node->fdw_state);
+	GpuStoreFdwState *fdw_state = node->fdw_state;
+
+	/*
+	 * Rows fetched by the index are reusable unless any parameters of
+	 * the index keys are changed; visibility is checked on iteration.
+	 */
+	if (fdw_state->index_kind != GSTORE_INDEX_KIND__NONE &&
+		fdw_state->index_fetched &&
+		node->ss.ps.chgParam == NULL)
+	{
+		fdw_state->index_curr = 0;
+		return;
+	}
+	ExecReScanGstoreFdw(fdw_state);
 }
 
 void
 ExecEndGstoreFdw(GpuStoreFdwState *fdw_state)
 {
-	/* nothing to do */
+	/* write back the hints, if scan is terminated in the middle */
+	gstoreFdwApplySysattrHints(fdw_state);
 }
 
 static void
@@ -1413,6 +2909,60 @@ ExecShutdownGstoreFdw(GpuStoreFdwState *fdw_state)
 }
 #endif
 
+/*
+ * __gstoreFdwPersistBaseRange
+ */
+static bool
+__gstoreFdwPersistBaseRange(GpuStoreDesc *gs_desc, void *addr, size_t len)
+{
+	if (len == 0)
+		return true;
+	if (gs_desc->base_mmap_is_pmem)
+		pmem_persist(addr, len);
+	else if (pmem_msync(addr, len) != 0)
+	{
+		elog(WARNING, "failed on pmem_msync('%s'): %m",
+			 gs_desc->gs_sstate->base_file);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * __gstoreFdwSetReplayPos
+ *
+ * It records the REDO position to start replay on the next recovery, once
+ * the base file is persisted. Caller must hold redo_pos_lock.
+ */
+static void
+__gstoreFdwSetReplayPos(GpuStoreDesc *gs_desc, uint64 replay_pos)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	GpuStoreBaseFileHead *base_mmap = gs_desc->base_mmap;
+
+	if (replay_pos <= gs_sstate->redo_checkpoint_pos)
+		return;
+	base_mmap->redo_replay_pos = (replay_pos % gs_sstate->redo_log_limit);
+	__gstoreFdwPersistBaseRange(gs_desc, &base_mmap->redo_replay_pos,
+								sizeof(uint64));
+	gs_sstate->redo_checkpoint_pos = replay_pos;
+}
+
+/*
+ * __gstoreFdwCheckpointBaseFile
+ *
+ * It persists the entire base file, then records the REDO position to start
+ * replay on the next recovery. Caller must hold redo_pos_lock.
+ */
+static void
+__gstoreFdwCheckpointBaseFile(GpuStoreDesc *gs_desc, uint64 replay_pos)
+{
+	if (!__gstoreFdwPersistBaseRange(gs_desc, gs_desc->base_mmap,
+									 gs_desc->base_mmap_sz))
+		return;		/* keep the older replay position */
+	__gstoreFdwSetReplayPos(gs_desc, replay_pos);
+}
+
 static uint64
 __gstoreFdwAppendRedoLog(GpuStoreDesc *gs_desc,
 						 GstoreTxLogCommon *tx_log)
@@ -1430,6 +2980,7 @@ __gstoreFdwAppendRedoLog(GpuStoreDesc *gs_desc,
 		char	   *dest_ptr;
 		size_t		dest_pos;
 		size_t		len;
+		size_t		unread;
 
 		SpinLockAcquire(&gs_sstate->redo_pos_lock);
 		Assert(gs_sstate->redo_write_pos >= gs_sstate->redo_read_pos);
@@ -1439,7 +2990,16 @@ __gstoreFdwAppendRedoLog(GpuStoreDesc *gs_desc,
 		 * buffer.
 		 */
 		dest_pos = gs_sstate->redo_write_pos % gs_sstate->redo_log_limit;
-		if (dest_pos + required > gs_sstate->redo_log_limit)
+		len = (dest_pos + required > gs_sstate->redo_log_limit
+			   ? gs_sstate->redo_log_limit - dest_pos : 0);
+		/*
+		 * The background worker usually makes the incremental checkpoint
+		 * ahead of the wrap-around, according to the fill level of the
+		 * REDO log. If it is still behind, we have to persist the entire
+		 * base file synchronously.
+		 */
+		if (gs_sstate->redo_write_pos + len + required >
+			gs_sstate->redo_checkpoint_pos + gs_sstate->redo_log_limit)
 		{
 			struct timeval	tv1, tv2;
 
@@ -1453,29 +3013,22 @@ __gstoreFdwAppendRedoLog(GpuStoreDesc *gs_desc,
 				has_base_mmap_lock = true;
 				continue;
 			}
-			len = gs_sstate->redo_log_limit - dest_pos;
-			memset(gs_desc->redo_mmap + dest_pos, 0, len);
-			gs_sstate->redo_write_pos += len;
-
-			/* checkpoint of the base file */
+			/*
+			 * checkpoint of the base file; the next recovery starts at the
+			 * current write position (that has the terminator right now),
+			 * not the head of REDO log buffer, because the wrap-around
+			 * marker and this log are not written yet.
+			 */
 			gettimeofday(&tv1, NULL);
-			if (gs_desc->base_mmap_is_pmem)
-				pmem_persist(gs_desc->base_mmap,
-							 gs_desc->base_mmap_sz);
-			else if (pmem_msync(gs_desc->base_mmap,
-								gs_desc->base_mmap_sz) != 0)
-			{
-				elog(WARNING, "failed on pmem_msync('%s'): %m", gs_sstate->base_file);
-			}
+			__gstoreFdwCheckpointBaseFile(gs_desc, gs_sstate->redo_write_pos);
 			gettimeofday(&tv2, NULL);
 
 			elog(LOG, "gstore_fdw: checkpoint applied on '%s' [%.2fms]",
 				 gs_sstate->base_file, TV_DIFF(tv2,tv1));
-			dest_pos = 0;
 		}
 
-		len = gs_sstate->redo_write_pos - gs_sstate->redo_read_pos;
-		if (len + required > gs_sstate->redo_log_limit)
+		unread = gs_sstate->redo_write_pos + len - gs_sstate->redo_read_pos;
+		if (unread + required > gs_sstate->redo_log_limit)
 		{
 			/*
 			 * We have no space to write out redo-log any more, so we must
@@ -1503,7 +3056,7 @@ __gstoreFdwAppendRedoLog(GpuStoreDesc *gs_desc,
 			continue;
 		}
 		/* Ok, we have enough space to write out redo-log buffer */
-		if (len > gs_sstate->gpu_update_threshold)
+		if (unread > gs_sstate->gpu_update_threshold)
 		{
 			uint64	curr_timestamp = GetCurrentTimestamp();
 			uint64	last_timestamp = gs_sstate->redo_last_timestamp;
@@ -1520,10 +3073,26 @@ __gstoreFdwAppendRedoLog(GpuStoreDesc *gs_desc,
 				gstoreFdwInvokeApplyRedo(gs_desc->ftable_oid, true, end_pos);
 			}
 		}
-		dest_ptr = gs_desc->redo_mmap + dest_pos;
-		gs_sstate->redo_write_pos += tx_log->length;
-		gs_sstate->redo_write_nitems++;
+
+		/*
+		 * The terminator tells the recovery where the REDO log ends, because
+		 * the following area still contains the logs of the previous lap.
+		 * 'required' has the room for the terminator always.
+		 * If this log wraps around, the marker is written after the log and
+		 * the terminator at the head of buffer, because the marker leads the
+		 * recovery to the head; until then, the recovery stops at the older
+		 * terminator at dest_pos.
+		 */
+		dest_ptr = gs_desc->redo_mmap + (len > 0 ? 0 : dest_pos);
 		memcpy(dest_ptr, tx_log, tx_log->length);
+		*((cl_uint *)(dest_ptr + tx_log->length)) = GSTORE_TX_LOG__TERMINATOR;
+		if (len > 0)
+		{
+			memset(gs_desc->redo_mmap + dest_pos, 0, len);
+			*((cl_uint *)(gs_desc->redo_mmap + dest_pos)) = GSTORE_TX_LOG__WRAPAROUND;
+		}
+		gs_sstate->redo_write_pos += len + tx_log->length;
+		gs_sstate->redo_write_nitems++;
 		written_pos = gs_sstate->redo_write_pos;
 		SpinLockRelease(&gs_sstate->redo_pos_lock);
 		break;
@@ -1562,6 +3131,106 @@ gstoreFdwAppendInsertLog(Relation frel,
 	__gstoreFdwAppendRedoLog(gs_desc, (GstoreTxLogCommon *)i_log);
 }
 
+/*
+ * __gstoreFdwFormUpdateLogValues
+ *
+ * It packs the values of updated columns, then returns the length.
+ * If 'dest' is NULL, it just computes the required length.
+ */
+static size_t
+__gstoreFdwFormUpdateLogValues(kern_data_store *kds,
+							   TupleTableSlot *slot,
+							   Bitmapset *updatedCols,
+							   char *dest)
+{
+	size_t		off = 0;
+	int			j = -1;
+
+	while ((j = bms_next_member(updatedCols, j)) >= 0)
+	{
+		kern_colmeta *cmeta = &kds->colmeta[j-1];
+		Datum		datum = slot->tts_values[j-1];
+		size_t		sz;
+
+		if (slot->tts_isnull[j-1])
+			continue;
+		if (cmeta->attlen > 0)
+		{
+			off = TYPEALIGN(cmeta->attalign, off);
+			sz = cmeta->attlen;
+			if (dest)
+			{
+				if (cmeta->attbyval)
+					store_att_byval(dest + off, datum, cmeta->attlen);
+				else
+					memcpy(dest + off, DatumGetPointer(datum), sz);
+			}
+		}
+		else
+		{
+			Assert(cmeta->attlen == -1);
+			/* short varlena is not aligned, like heap_fill_tuple */
+			if (!VARATT_IS_1B(DatumGetPointer(datum)))
+				off = TYPEALIGN(cmeta->attalign, off);
+			sz = VARSIZE_ANY(DatumGetPointer(datum));
+			if (dest)
+				memcpy(dest + off, DatumGetPointer(datum), sz);
+		}
+		off += sz;
+	}
+	return off;
+}
+
+/*
+ * gstoreFdwAppendUpdateLog
+ *
+ * It writes a column-delta UPDATE log, that contains only the updated
+ * columns. Unchanged columns are picked up from the older version, that
+ * is pinned on commit until the checkpoint passes this log.
+ */
+static void
+gstoreFdwAppendUpdateLog(Relation frel,
+						 GpuStoreDesc *gs_desc,
+						 cl_uint rowid,
+						 cl_uint oldid,
+						 TransactionId xmin,
+						 TupleTableSlot *slot,
+						 Bitmapset *updatedCols)
+{
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	GstoreTxLogUpdate *u_log;
+	int			nattrs = bms_num_members(updatedCols);
+	int			j = -1, k = 0;
+	size_t		head_sz;
+	size_t		sz;
+
+	Assert(nattrs > 0 && nattrs <= GSTORE_TX_LOG_UPDATE__COLMASK);
+	head_sz = MAXALIGN(offsetof(GstoreTxLogUpdate, attrs[nattrs]));
+	sz = MAXALIGN(head_sz + __gstoreFdwFormUpdateLogValues(kds, slot,
+														   updatedCols,
+														   NULL));
+	u_log = alloca(sz + sizeof(cl_uint));
+	memset(u_log, 0, sz + sizeof(cl_uint));
+	u_log->type = GSTORE_TX_LOG__UPDATE;
+	u_log->length = sz;
+	u_log->timestamp = GetCurrentTimestamp();
+	u_log->rowid = rowid;
+	u_log->oldid = oldid;
+	u_log->xmin = xmin;
+	u_log->nattrs = nattrs;
+	while ((j = bms_next_member(updatedCols, j)) >= 0)
+	{
+		u_log->attrs[k] = (j - 1);
+		if (slot->tts_isnull[j-1])
+			u_log->attrs[k] |= GSTORE_TX_LOG_UPDATE__ISNULL;
+		k++;
+	}
+	__gstoreFdwFormUpdateLogValues(kds, slot, updatedCols,
+								   GSTORE_TX_LOG_UPDATE_VALUES(u_log));
+
+	__gstoreFdwAppendRedoLog(gs_desc, (GstoreTxLogCommon *)u_log);
+}
+
 static void
 gstoreFdwAppendDeleteLog(Relation frel,
 						 GpuStoreDesc *gs_desc,
@@ -1602,6 +3271,7 @@ gstoreFdwLookupUndoLogs(GpuStoreDesc *gs_desc)
 	gs_undo->curr_xid = curr_xid;
 	gs_undo->nitems = 0;
 	initStringInfo(&gs_undo->buf);
+	initStringInfo(&gs_undo->pinned);
 	MemoryContextSwitchTo(oldcxt);
 
 	dlist_push_head(&gs_desc->gs_undo_logs,
@@ -1689,6 +3359,32 @@ GstoreBeginForeignModify(ModifyTableState *mtstate,
 	gs_mstate->oldestXmin = GetOldestXmin(frel, PROCARRAY_FLAGS_VACUUM);
 	gs_mstate->ctid_attno = ctid_attno;
 	gs_mstate->gs_undo = gstoreFdwLookupUndoLogs(gs_mstate->gs_desc);
+	gs_mstate->bulk_load = (mtstate->operation == CMD_INSERT &&
+							((ModifyTable *)mtstate->ps.plan)->returningLists == NIL &&
+							gstore_fdw_bulk_load_threshold >= 0);
+	rinfo->ri_FdwState = gs_mstate;
+}
+
+/*
+ * GstoreBeginForeignInsert
+ *
+ * COPY FROM, or INSERT routed to the partition.
+ */
+static void
+GstoreBeginForeignInsert(ModifyTableState *mtstate,
+						 ResultRelInfo *rinfo)
+{
+	GpuStoreFdwModify *gs_mstate = palloc0(sizeof(GpuStoreFdwModify));
+	Relation	frel = rinfo->ri_RelationDesc;
+
+	gs_mstate->gs_desc = gstoreFdwLookupGpuStoreDesc(frel);
+	gs_mstate->updatedCols = NULL;
+	gs_mstate->oldestXmin = GetOldestXmin(frel, PROCARRAY_FLAGS_VACUUM);
+	gs_mstate->ctid_attno = InvalidAttrNumber;
+	gs_mstate->gs_undo = gstoreFdwLookupUndoLogs(gs_mstate->gs_desc);
+	gs_mstate->bulk_load = ((!mtstate ||
+							 ((ModifyTable *)mtstate->ps.plan)->returningLists == NIL) &&
+							gstore_fdw_bulk_load_threshold >= 0);
 	rinfo->ri_FdwState = gs_mstate;
 }
 
@@ -1856,20 +3552,47 @@ __gstoreExecForeignModify(EState *estate,
 		size_t		extra_sz = 0;
 		char	   *extra_buf = NULL;
 		List	   *unused_rowids = NIL;
+		GpuStoreDictionaryProbe *probes = NULL;
+		bool		bulk_load = false;
+		bool		row_locked = false;
+		bool		unpin_forced = false;
 
+		/*
+		 * Once INSERT/COPY loads rows more than the threshold, the rest of
+		 * rows are written without REDO logs; see the comment at
+		 * __gstoreFdwXactOnPreCommitBulkLoad.
+		 */
+		if (operation == CMD_INSERT && gs_mstate->bulk_load)
+			bulk_load = (gs_mstate->nrows_inserted++ >=
+						 gstore_fdw_bulk_load_threshold);
 		slot_getallattrs(slot);
 		/* calculation of required extra buffer size */
 		if (kds->has_varlena)
 		{
+			if (gs_desc->gs_sstate->num_dictionaries > 0)
+			{
+				probes = alloca(sizeof(GpuStoreDictionaryProbe) * natts);
+				gstoreFdwDictionaryProbe(gs_desc, slot, updatedCols, probes);
+				/* base file might be remapped */
+				kds = &gs_desc->base_mmap->schema;
+			}
 			for (j=0; j < natts; j++)
 			{
 				kern_colmeta   *cmeta = &kds->colmeta[j];
 				Datum			datum = slot->tts_values[j];
 				bool			isnull = slot->tts_isnull[j];
 
-			if (cmeta->attlen == -1 && !isnull &&
-				(!updatedCols || bms_is_member(cmeta->attnum, updatedCols)))
-				extra_sz += MAXALIGN(VARSIZE_ANY(datum));
+				if (cmeta->attlen == -1 && !isnull &&
+					(!updatedCols || bms_is_member(cmeta->attnum, updatedCols)))
+				{
+					if (probes && probes[j].dict)
+					{
+						if (probes[j].code != 0)
+							continue;	/* share the identical value */
+						datum = probes[j].value;
+					}
+					extra_sz += MAXALIGN(VARSIZE_ANY(datum));
+				}
 			}
 		}
 
@@ -1881,23 +3604,56 @@ __gstoreExecForeignModify(EState *estate,
 			/* new RowId allocation */
 			for (;;)
 			{
-				rowid = gstoreFdwAllocateRowId(gs_desc->gs_sstate,
-											   gs_desc->rowid_map);
+				rowid = gstoreFdwAllocateRowId(gs_desc);
+				if (rowid >= kds->nrooms && !unpin_forced)
+				{
+					/* rowids pinned by UPDATE may be released */
+					unpin_forced = true;
+					if (gstoreFdwUnpinRowIdsForce(gs_desc))
+						continue;
+				}
 				if (rowid >= kds->nrooms)
 					elog(ERROR, "gstore_fdw: '%s' has no room to INSERT any rows %u",
 						 RelationGetRelationName(frel), rowid);
-				gstoreFdwSpinLockBaseRow(gs_desc, rowid);
+				/*
+				 * Rows beyond the nitems are never used, and nobody else
+				 * looks at them, so bulk-load skips the row-lock.
+				 */
+				if (bulk_load && rowid >= atomicRead32(&kds->nitems))
+					break;
+				row_locked = gstoreFdwSpinLockBaseRow(gs_desc, rowid);
 				if (gstoreCheckVisibilityForInsert(gs_desc, rowid,
 												   gs_mstate->oldestXmin))
 					break;
-				gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
+				row_locked = gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
 				unused_rowids = lappend_int(unused_rowids, rowid);
 			}
-			/* Put INSERT Log */
-			tuple = ExecFetchSlotHeapTuple(slot, false, false);
-			gstoreFdwAppendInsertLog(frel, gs_desc, rowid, oldid, curr_xid, tuple);
+			/*
+			 * Put INSERT Log, or UPDATE Log that contains only the updated
+			 * columns if UPDATE does not change all the columns.
+			 * Bulk-load writes no REDO logs.
+			 * The UPDATE log refers the unchanged columns of the oldid, so
+			 * it shall be pinned on commit; see gstoreFdwPinRowIds.
+			 */
+			if (bulk_load)
+				gs_undo->bulk_nitems++;
+			else if (operation == CMD_UPDATE &&
+				!bms_is_empty(updatedCols) &&
+				bms_num_members(updatedCols) < natts)
+			{
+				gstoreFdwAppendUpdateLog(frel, gs_desc, rowid, oldid, curr_xid,
+										 slot, updatedCols);
+				appendBinaryStringInfo(&gs_undo->pinned,
+									   (char *)&oldid, sizeof(cl_uint));
+			}
+			else
+			{
+				tuple = ExecFetchSlotHeapTuple(slot, false, false);
+				gstoreFdwAppendInsertLog(frel, gs_desc, rowid, oldid, curr_xid,
+										 tuple);
+			}
 			/* UNDO Log also */
-			temp[0] = 'I';
+			temp[0] = (bulk_load ? 'B' : 'I');
 			*((uint32 *)(temp + 1)) = rowid;
 			appendBinaryStringInfo(&gs_undo->buf, temp, 5);
 			gs_undo->nitems++;
@@ -1913,11 +3669,28 @@ __gstoreExecForeignModify(EState *estate,
 
 				if (cmeta->attlen == -1 && !isnull)
 				{
-					size_t		sz = VARSIZE_ANY(datum);
+					kern_data_extra *extra = (kern_data_extra *)
+						((char *)kds + kds->extra_hoffset);
 
-					if (!updatedCols || bms_is_member(cmeta->attnum, updatedCols))
+					if (probes && probes[j].dict && probes[j].code != 0)
+					{
+						/* identical value is already in the extra buffer */
+						datum = PointerGetDatum((char *)extra +
+												__kds_unpack(probes[j].code));
+					}
+					else if (!updatedCols || bms_is_member(cmeta->attnum, updatedCols))
 					{
+						size_t		sz;
+
+						if (probes && probes[j].dict)
+							datum = probes[j].value;
+						sz = VARSIZE_ANY(datum);
 						memcpy(extra_buf, DatumGetPointer(datum), sz);
+						if (probes && probes[j].dict)
+							__gstoreFdwDictionaryInsert(probes[j].dict,
+														probes[j].hash, sz,
+														__kds_packed(extra_buf -
+																	 (char *)extra));
 						datum = PointerGetDatum(extra_buf);
 						extra_buf += MAXALIGN(sz);
 					}
@@ -1930,8 +3703,6 @@ __gstoreExecForeignModify(EState *estate,
 						 * of the unchanged value. It also saves consumption of
 						 * GPU device memory.
 						 */
-						kern_data_extra *extra __attribute__((unused))
-							= (kern_data_extra *)((char *)kds + kds->extra_hoffset);
 						datum = KDS_fetch_datum_column(kds, cmeta, oldid, &isnull);
 						if (isnull)
 							elog(ERROR, "Bug? unchanged column has different value");
@@ -1940,6 +3711,7 @@ __gstoreExecForeignModify(EState *estate,
 					}
 				}
 				__KDS_store_datum_column(kds, cmeta, rowid, datum, isnull);
+				gstoreFdwMarkDirty(gs_desc->gs_sstate, j, rowid);
 			}
 			sysattr.xmin = curr_xid;
 			sysattr.xmax = InvalidTransactionId;
@@ -1947,18 +3719,22 @@ __gstoreExecForeignModify(EState *estate,
 			KDS_store_datum_column(kds, &kds->colmeta[natts], rowid,
 								   PointerGetDatum(&sysattr),
 								   false);
+			if (!row_locked)
+				gstoreFdwMarkDirty(gs_desc->gs_sstate, natts, rowid);
 			atomicMax32(&kds->nitems, rowid + 1);
 		}
 		PG_CATCH();
 		{
-			gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
+			if (row_locked)
+				gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
 			gstoreFdwReleaseRowIdMulti(gs_desc->gs_sstate,
 									   gs_desc->rowid_map,
 									   rowid, unused_rowids);
 			PG_RE_THROW();
 		}
 		PG_END_TRY();
-		gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
+		if (row_locked)
+			gstoreFdwSpinUnlockBaseRow(gs_desc, rowid);
 		gstoreFdwReleaseRowIdMulti(gs_desc->gs_sstate,
 								   gs_desc->rowid_map,
 								   UINT_MAX, unused_rowids);
@@ -1968,12 +3744,14 @@ __gstoreExecForeignModify(EState *estate,
 	{
 		Assert(operation == CMD_UPDATE || operation == CMD_DELETE);
 		gstoreFdwRemoveFromPrimaryKey(gs_desc, gs_undo, oldid);
+		gstoreFdwRemoveFromOrderedIndexes(gs_desc, gs_undo, oldid);
 	}
 	/* INSERT or UPDATE */
 	if (rowid != UINT_MAX)
 	{
 		Assert(operation == CMD_INSERT || operation == CMD_UPDATE);
 		gstoreFdwInsertIntoPrimaryKey(gs_desc, gs_undo, rowid);
+		gstoreFdwInsertIntoOrderedIndexes(gs_desc, gs_undo, rowid);
 	}
 	return slot;
 }
@@ -2009,6 +3787,10 @@ static void
 GstoreEndForeignModify(EState *estate, ResultRelInfo *rinfo)
 {}
 
+static void
+GstoreEndForeignInsert(EState *estate, ResultRelInfo *rinfo)
+{}
+
 void
 ExplainGstoreFdw(GpuStoreFdwState *fdw_state,
 				 Relation frel, ExplainState *es)
@@ -2045,20 +3827,71 @@ ExplainGstoreFdw(GpuStoreFdwState *fdw_state,
 
 	/* shows index condition */
 	resetStringInfo(&buf);
-	if (fdw_state->indexExprState)
+	if (fdw_state->index_kind != GSTORE_INDEX_KIND__NONE)
 	{
-		Node	   *indexExpr = (Node *)fdw_state->indexExprState->expr;
 		Form_pg_attribute attr;
+		ListCell   *lc1, *lc2;
 
-		Assert(gs_sstate->primary_key > 0 &&
-			   gs_sstate->primary_key <= tupdesc->natts);
-		attr = tupleDescAttr(tupdesc, gs_sstate->primary_key - 1);
-		appendStringInfo(&buf, "%s = %s",
-						 quote_identifier(NameStr(attr->attname)),
-						 deparse_expression(indexExpr, dcontext, false, false));
+		Assert(fdw_state->index_attnum > 0 &&
+			   fdw_state->index_attnum <= tupdesc->natts);
+		attr = tupleDescAttr(tupdesc, fdw_state->index_attnum - 1);
+		forboth (lc1, fdw_state->index_exprs,
+				 lc2, fdw_state->index_strategies)
+		{
+			Node	   *indexExpr = (Node *)((ExprState *)lfirst(lc1))->expr;
+			const char *opname;
+
+			switch (lfirst_int(lc2))
+			{
+				case GSTORE_INDEX_STRATEGY__EQ_ANY:	opname = "= ANY"; break;
+				case BTLessStrategyNumber:			opname = "<";  break;
+				case BTLessEqualStrategyNumber:		opname = "<="; break;
+				case BTEqualStrategyNumber:			opname = "=";  break;
+				case BTGreaterEqualStrategyNumber:	opname = ">="; break;
+				case BTGreaterStrategyNumber:		opname = ">";  break;
+				default:							opname = "??"; break;
+			}
+			if (buf.len > 0)
+				appendStringInfoString(&buf, " AND ");
+			appendStringInfo(&buf, (lfirst_int(lc2) == GSTORE_INDEX_STRATEGY__EQ_ANY
+									 ? "%s %s (%s)"
+									 : "%s %s %s"),
+							 quote_identifier(NameStr(attr->attname)),
+							 opname,
+							 deparse_expression(indexExpr, dcontext,
+												false, false));
+		}
 		ExplainPropertyText("Index Cond", buf.data, es);
 	}
 
+	/* shows quals evaluated over the column arrays */
+	resetStringInfo(&buf);
+	for (j=0; j < fdw_state->num_scan_quals; j++)
+	{
+		GpuStoreScanQual *qual = &fdw_state->scan_qual_items[j];
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, qual->attnum - 1);
+		const char *opname;
+
+		switch (qual->strategy)
+		{
+			case BTLessStrategyNumber:			opname = "<";  break;
+			case BTLessEqualStrategyNumber:		opname = "<="; break;
+			case BTEqualStrategyNumber:			opname = "=";  break;
+			case BTGreaterEqualStrategyNumber:	opname = ">="; break;
+			case BTGreaterStrategyNumber:		opname = ">";  break;
+			default:							opname = "??"; break;
+		}
+		if (buf.len > 0)
+			appendStringInfoString(&buf, " AND ");
+		appendStringInfo(&buf, "%s %s %s",
+						 quote_identifier(NameStr(attr->attname)),
+						 opname,
+						 deparse_expression((Node *)qual->con, dcontext,
+											false, false));
+	}
+	if (buf.len > 0)
+		ExplainPropertyText("Column Filter", buf.data, es);
+
 	/* shows base&redo filename */
 	if (es->verbose)
 	{
@@ -2083,12 +3916,382 @@ GstoreExplainForeignModify(ModifyTableState *mtstate,
 						   ExplainState *es)
 {}
 
+/*
+ * __gstoreAnalyzeColumn - exact statistics of a column
+ *
+ * It walks on the null-bitmap and the values array of the column, masked
+ * by the bitmap of live rows, 32 rows at once. Min/Max are computed for
+ * fixed-length columns, and the rowids of these rows are returned.
+ */
+typedef struct
+{
+	uint64		nnulls;
+	bool		has_minmax;
+	cl_uint		min_rowid;
+	cl_uint		max_rowid;
+} GpuStoreAnalyzeColumn;
+
+#define __GSTORE_ANALYZE_MINMAX(TYPE)									\
+	do {																\
+		const TYPE *__values = (const TYPE *)values;					\
+		TYPE		__min = 0;											\
+		TYPE		__max = 0;											\
+		cl_uint		__min_word = UINT_MAX;								\
+		cl_uint		__max_word = UINT_MAX;								\
+		cl_uint		__k;												\
+																		\
+		for (i=0; i < nwords; i++)										\
+		{																\
+			cl_uint		mask = live_map[i] & (nullmap ? nullmap[i] : ~0U); \
+			const TYPE *__v = __values + (i << 5);						\
+			TYPE		__wmin, __wmax;									\
+																		\
+			if (mask == 0)												\
+				continue;												\
+			__k = __builtin_ctz(mask);									\
+			__wmin = __wmax = __v[__k];									\
+			if (mask == ~0U)											\
+			{															\
+				/* dense word; simple loop to be vectorized */			\
+				for (__k=1; __k < 32; __k++)							\
+				{														\
+					__wmin = Min(__wmin, __v[__k]);						\
+					__wmax = Max(__wmax, __v[__k]);						\
+				}														\
+			}															\
+			else														\
+			{															\
+				for (mask &= mask - 1; mask != 0; mask &= mask - 1)		\
+				{														\
+					__k = __builtin_ctz(mask);							\
+					__wmin = Min(__wmin, __v[__k]);						\
+					__wmax = Max(__wmax, __v[__k]);						\
+				}														\
+			}															\
+			if (__min_word == UINT_MAX || __wmin < __min)				\
+			{															\
+				__min = __wmin;											\
+				__min_word = i;											\
+			}															\
+			if (__max_word == UINT_MAX || __wmax > __max)				\
+			{															\
+				__max = __wmax;											\
+				__max_word = i;											\
+			}															\
+		}																\
+		if (__min_word == UINT_MAX)										\
+			break;		/* no valid rows */								\
+		/* lookup the rowids in the word of min/max */					\
+		for (__k=0; __k < 32; __k++)									\
+		{																\
+			cl_uint		__rowid = (__min_word << 5) + __k;				\
+																		\
+			if ((live_map[__min_word] & (1U << __k)) != 0 &&			\
+				(!nullmap || (nullmap[__min_word] & (1U << __k)) != 0) && \
+				__values[__rowid] == __min)								\
+			{															\
+				astate->min_rowid = __rowid;							\
+				break;													\
+			}															\
+		}																\
+		for (__k=0; __k < 32; __k++)									\
+		{																\
+			cl_uint		__rowid = (__max_word << 5) + __k;				\
+																		\
+			if ((live_map[__max_word] & (1U << __k)) != 0 &&			\
+				(!nullmap || (nullmap[__max_word] & (1U << __k)) != 0) && \
+				__values[__rowid] == __max)								\
+			{															\
+				astate->max_rowid = __rowid;							\
+				break;													\
+			}															\
+		}																\
+		astate->has_minmax = true;										\
+	} while(0)
+
+static void
+__gstoreAnalyzeColumn(GpuStoreDesc *gs_desc, int colidx, Oid collation,
+					  cl_uint *live_map, cl_uint nwords,
+					  GpuStoreAnalyzeColumn *astate)
+{
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	kern_colmeta   *cmeta = &kds->colmeta[colidx];
+	cl_uint		   *nullmap = NULL;
+	char		   *values;
+	cl_uint			i, k;
+
+	memset(astate, 0, sizeof(GpuStoreAnalyzeColumn));
+	if (cmeta->nullmap_offset != 0)
+	{
+		nullmap = (cl_uint *)((char *)kds + __kds_unpack(cmeta->nullmap_offset));
+		for (i=0; i < nwords; i++)
+			astate->nnulls += __builtin_popcount(live_map[i] & ~nullmap[i]);
+	}
+	if (cmeta->attlen <= 0)
+		return;		/* no min/max for varlena */
+	values = (char *)kds + __kds_unpack(cmeta->values_offset);
+
+	switch (cmeta->atttypid)
+	{
+		case INT2OID:
+			__GSTORE_ANALYZE_MINMAX(int16);
+			break;
+		case INT4OID:
+		case DATEOID:
+			__GSTORE_ANALYZE_MINMAX(int32);
+			break;
+		case INT8OID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			__GSTORE_ANALYZE_MINMAX(int64);
+			break;
+		default:
+			{
+				/* other fixed-length types, by the btree comparator */
+				TypeCacheEntry *tcache;
+				Datum		min_datum = 0;
+				Datum		max_datum = 0;
+				Datum		datum;
+				bool		isnull;
+				cl_uint		rowid;
+
+				tcache = lookup_type_cache(cmeta->atttypid,
+										   TYPECACHE_CMP_PROC_FINFO);
+				if (!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+					return;
+				for (i=0; i < nwords; i++)
+				{
+					cl_uint		mask = live_map[i] & (nullmap ? nullmap[i] : ~0U);
+
+					for (; mask != 0; mask &= mask - 1)
+					{
+						k = __builtin_ctz(mask);
+						rowid = (i << 5) + k;
+						datum = KDS_fetch_datum_column(kds, cmeta, rowid, &isnull);
+						Assert(!isnull);
+						if (!astate->has_minmax)
+						{
+							min_datum = max_datum = datum;
+							astate->min_rowid = astate->max_rowid = rowid;
+							astate->has_minmax = true;
+							continue;
+						}
+						if (DatumGetInt32(FunctionCall2Coll(&tcache->cmp_proc_finfo,
+															collation,
+															datum, min_datum)) < 0)
+						{
+							min_datum = datum;
+							astate->min_rowid = rowid;
+						}
+						if (DatumGetInt32(FunctionCall2Coll(&tcache->cmp_proc_finfo,
+															collation,
+															datum, max_datum)) > 0)
+						{
+							max_datum = datum;
+							astate->max_rowid = rowid;
+						}
+					}
+					CHECK_FOR_INTERRUPTS();
+				}
+			}
+			break;
+	}
+}
+#undef __GSTORE_ANALYZE_MINMAX
+
+/*
+ * GstoreAcquireSampleRows
+ *
+ * It picks up random visible rows by reservoir sampling on the rowids.
+ * Only the system attribute column is walked on to check visibility, and
+ * the heap-tuples are formed for the sampled rows only.
+ * The rows with exact min/max values of fixed-length columns are always
+ * included in the samples, so the histogram covers the exact range.
+ */
+static int
+GstoreAcquireSampleRows(Relation frel,
+						int elevel,
+						HeapTuple *rows,
+						int nrooms,
+						double *p_totalrows,
+						double *p_totaldeadrows)
+{
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	GpuStoreDesc   *gs_desc = gstoreFdwLookupGpuStoreDesc(frel);
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	GpuStoreFdwState *fdw_state;
+	GpuStoreAnalyzeColumn astate;
+	GstoreFdwSysattr sysattr;
+	Snapshot		snapshot;
+	cl_uint			nitems = kds->nitems;
+	cl_uint			nwords = (nitems + 31) / 32;
+	cl_uint		   *live_map;
+	cl_uint		   *rowids;
+	cl_uint		   *extremes;
+	int				nextremes = 0;
+	uint64			nlives = 0;
+	uint64			ndeads = 0;
+	Datum		   *values;
+	bool		   *isnull;
+	cl_uint			rowid;
+	int				nsamples = 0;
+	int				i, j;
+
+	Assert(tupdesc->natts == kds->ncols - 1);
+	snapshot = (ActiveSnapshotSet()
+				? GetActiveSnapshot()
+				: GetTransactionSnapshot());
+	fdw_state = palloc0(sizeof(GpuStoreFdwState));
+	fdw_state->gs_desc = gs_desc;
+
+	/* bitmap of live rows, and reservoir sampling */
+	live_map = palloc_huge(sizeof(cl_uint) * (nwords + 1));
+	memset(live_map, 0, sizeof(cl_uint) * (nwords + 1));
+	rowids = palloc(sizeof(cl_uint) * nrooms);
+	for (rowid=0; rowid < nitems; rowid++)
+	{
+		if ((rowid & 0xffffU) == 0)
+			CHECK_FOR_INTERRUPTS();
+		if (!gstoreFdwCheckRowId(gs_sstate, gs_desc->rowid_map, rowid))
+			continue;
+		if (!gstoreCheckVisibilityForScan(fdw_state, rowid,
+										  snapshot, &sysattr))
+		{
+			ndeads++;
+			continue;
+		}
+		live_map[rowid >> 5] |= (1U << (rowid & 0x1f));
+		if (nsamples < nrooms)
+			rowids[nsamples++] = rowid;
+		else
+		{
+			uint64	k = (double)(nlives + 1) * ((double)random() /
+												((double)MAX_RANDOM_VALUE + 1));
+			if (k < nrooms)
+				rowids[k] = rowid;
+		}
+		nlives++;
+	}
+	gstoreFdwApplySysattrHints(fdw_state);
+
+	/* exact null fraction and min/max */
+	extremes = palloc(sizeof(cl_uint) * 2 * tupdesc->natts);
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupleDescAttr(tupdesc, j);
+		kern_colmeta   *cmeta = &kds->colmeta[j];
+		char		   *min_str = NULL;
+		char		   *max_str = NULL;
+
+		if (attr->attisdropped)
+			continue;
+		__gstoreAnalyzeColumn(gs_desc, j, attr->attcollation,
+							  live_map, nwords, &astate);
+		if (astate.has_minmax)
+		{
+			Oid		typoutput;
+			bool	typisvarlena;
+			Datum	datum;
+			bool	__isnull;
+
+			extremes[nextremes++] = astate.min_rowid;
+			extremes[nextremes++] = astate.max_rowid;
+
+			getTypeOutputInfo(cmeta->atttypid, &typoutput, &typisvarlena);
+			datum = KDS_fetch_datum_column(kds, cmeta, astate.min_rowid, &__isnull);
+			min_str = OidOutputFunctionCall(typoutput, datum);
+			datum = KDS_fetch_datum_column(kds, cmeta, astate.max_rowid, &__isnull);
+			max_str = OidOutputFunctionCall(typoutput, datum);
+		}
+		elog(elevel, "gstore_fdw: \"%s\".\"%s\" null_frac=%.6f min=%s max=%s",
+			 RelationGetRelationName(frel),
+			 NameStr(attr->attname),
+			 nlives > 0 ? (double)astate.nnulls / (double)nlives : 0.0,
+			 min_str ? min_str : "(none)",
+			 max_str ? max_str : "(none)");
+	}
+
+	/*
+	 * Replace random samples by the min/max rows not sampled yet, unless
+	 * all the live rows are already sampled.
+	 */
+	qsort(rowids, nsamples, sizeof(cl_uint), __gstoreFdwCompareRowId);
+	if (nlives > nsamples && nextremes > 0 && nextremes < nsamples / 2)
+	{
+		qsort(extremes, nextremes, sizeof(cl_uint), __gstoreFdwCompareRowId);
+		for (i=0; i < nextremes; i++)
+		{
+			if (i > 0 && extremes[i] == extremes[i-1])
+				continue;
+			if (bsearch(&extremes[i], rowids, nsamples, sizeof(cl_uint),
+						__gstoreFdwCompareRowId))
+				continue;
+			for (;;)
+			{
+				int		k = (double)nsamples * ((double)random() /
+												((double)MAX_RANDOM_VALUE + 1));
+
+				if (!bsearch(&rowids[k], extremes, nextremes, sizeof(cl_uint),
+							 __gstoreFdwCompareRowId))
+				{
+					rowids[k] = extremes[i];
+					break;
+				}
+			}
+		}
+		qsort(rowids, nsamples, sizeof(cl_uint), __gstoreFdwCompareRowId);
+	}
+
+	/* form the sampled rows in physical order */
+	values = palloc(sizeof(Datum) * tupdesc->natts);
+	isnull = palloc(sizeof(bool)  * tupdesc->natts);
+	for (i=0; i < nsamples; i++)
+	{
+		rowid = rowids[i];
+		for (j=0; j < tupdesc->natts; j++)
+		{
+			values[j] = KDS_fetch_datum_column(kds, &kds->colmeta[j],
+											   rowid, &isnull[j]);
+		}
+		rows[i] = heap_form_tuple(tupdesc, values, isnull);
+		rows[i]->t_self.ip_blkid.bi_hi = (rowid >> 16);
+		rows[i]->t_self.ip_blkid.bi_lo = (rowid & 0x0000ffff);
+		rows[i]->t_self.ip_posid       = 0;
+	}
+	pfree(values);
+	pfree(isnull);
+	pfree(extremes);
+	pfree(rowids);
+	pfree(live_map);
+	pfree(fdw_state);
+
+	*p_totalrows = nlives;
+	*p_totaldeadrows = ndeads;
+
+	return nsamples;
+}
+
+/*
+ * GstoreAnalyzeForeignTable
+ */
 static bool
-GstoreAnalyzeForeignTable(Relation relation,
-						  AcquireSampleRowsFunc *func,
-						  BlockNumber *totalpages)
+GstoreAnalyzeForeignTable(Relation frel,
+						  AcquireSampleRowsFunc *p_sample_rows_func,
+						  BlockNumber *p_totalpages)
 {
-	return false;
+	GpuStoreDesc   *gs_desc = gstoreFdwLookupGpuStoreDesc(frel);
+	Size			totalpages;
+
+	totalpages = (gs_desc->base_mmap_sz + BLCKSZ - 1) / BLCKSZ;
+	if (totalpages > MaxBlockNumber)
+		totalpages = MaxBlockNumber;
+
+	*p_sample_rows_func = GstoreAcquireSampleRows;
+	*p_totalpages = totalpages;
+
+	return true;
 }
 
 Datum
@@ -2168,7 +4371,9 @@ pgstrom_gstore_fdw_validator(PG_FUNCTION_ARGS)
 				elog(ERROR, "'%s' is not a valid configuration for '%s'",
 					 token, def->defname);
 		}
-		else if (strcmp(def->defname, "primary_key") == 0)
+		else if (strcmp(def->defname, "primary_key") == 0 ||
+				 strcmp(def->defname, "ordered_index") == 0 ||
+				 strcmp(def->defname, "dictionary") == 0)
 		{
 			/* column name shall be validated later */
 		}
@@ -2198,6 +4403,10 @@ gstoreFdwExtractOptions(Relation frel,
 						cl_long *p_gpu_update_interval,
 						size_t *p_gpu_update_threshold,
 						AttrNumber *p_primary_key,
+						cl_int *p_num_ordered_indexes,
+						AttrNumber *p_ordered_index,
+						cl_int *p_num_dictionaries,
+						AttrNumber *p_dictionary,
 						bool *p_preserve_files)
 {
 	ForeignTable *ft = GetForeignTable(RelationGetRelid(frel));
@@ -2211,6 +4420,8 @@ gstoreFdwExtractOptions(Relation frel,
 	cl_long		gpu_update_interval = 15;		/* default: 15s */
 	ssize_t		gpu_update_threshold = -1;		/* default: 20% of redo_log_limit */
 	AttrNumber	primary_key = -1;
+	cl_int		num_ordered_indexes = 0;
+	cl_int		num_dictionaries = 0;
 	bool		preserve_files = false;
 
 	/*
@@ -2243,7 +4454,8 @@ gstoreFdwExtractOptions(Relation frel,
 		else if (strcmp(def->defname, "max_num_rows") == 0)
 		{
 			max_num_rows = strtol(defGetString(def), &endp, 10);
-			if (max_num_rows < 0 || max_num_rows >= UINT_MAX || *endp != '\0')
+			if (max_num_rows < 0 ||
+				max_num_rows >= GPUSTORE_ROWID_RESERVED || *endp != '\0')
 				elog(ERROR, "unexpected input for max_num_rows: %s",
 					 defGetString(def));
 		}
@@ -2346,6 +4558,91 @@ gstoreFdwExtractOptions(Relation frel,
 				elog(ERROR, "'%s' specified by 'primary_key' option not found",
 					 pk_name);
 		}
+		else if (strcmp(def->defname, "ordered_index") == 0)
+		{
+			char	   *value = pstrdup(defGetString(def));
+			List	   *namelist;
+			ListCell   *cell;
+			int			i, j;
+
+			if (!SplitIdentifierString(value, ',', &namelist))
+				elog(ERROR, "invalid list syntax for 'ordered_index': %s",
+					 defGetString(def));
+			foreach (cell, namelist)
+			{
+				char	   *col_name = lfirst(cell);
+				Form_pg_attribute attr = NULL;
+				TypeCacheEntry *tcache;
+
+				for (j=0; j < tupdesc->natts; j++)
+				{
+					attr = tupleDescAttr(tupdesc,j);
+					if (strcmp(col_name, NameStr(attr->attname)) == 0)
+						break;
+				}
+				if (j >= tupdesc->natts)
+					elog(ERROR, "'%s' specified by 'ordered_index' option not found",
+						 col_name);
+				/* only fixed-length and pass-by-value data types */
+				if (!attr->attbyval || attr->attlen <= 0)
+					elog(ERROR, "'%s' specified by 'ordered_index' option is not a fixed-length, pass-by-value data type",
+						 col_name);
+				tcache = lookup_type_cache(attr->atttypid, TYPECACHE_CMP_PROC);
+				if (!OidIsValid(tcache->cmp_proc))
+					elog(ERROR, "'%s' specified by 'ordered_index' option has no default btree operator class",
+						 col_name);
+				for (i=0; i < num_ordered_indexes; i++)
+				{
+					if (p_ordered_index[i] == attr->attnum)
+						elog(ERROR, "'%s' specified by 'ordered_index' option appeared twice",
+							 col_name);
+				}
+				if (num_ordered_indexes >= GPUSTORE_MAX_ORDERED_INDEXES)
+					elog(ERROR, "too many columns are specified by 'ordered_index' option (up to %d)",
+						 GPUSTORE_MAX_ORDERED_INDEXES);
+				p_ordered_index[num_ordered_indexes++] = attr->attnum;
+			}
+		}
+		else if (strcmp(def->defname, "dictionary") == 0)
+		{
+			char	   *value = pstrdup(defGetString(def));
+			List	   *namelist;
+			ListCell   *cell;
+			int			i, j;
+
+			if (!SplitIdentifierString(value, ',', &namelist))
+				elog(ERROR, "invalid list syntax for 'dictionary': %s",
+					 defGetString(def));
+			foreach (cell, namelist)
+			{
+				char	   *col_name = lfirst(cell);
+				Form_pg_attribute attr = NULL;
+
+				for (j=0; j < tupdesc->natts; j++)
+				{
+					attr = tupleDescAttr(tupdesc,j);
+					if (strcmp(col_name, NameStr(attr->attname)) == 0)
+						break;
+				}
+				if (j >= tupdesc->natts)
+					elog(ERROR, "'%s' specified by 'dictionary' option not found",
+						 col_name);
+				/* only variable-length data types */
+				if (attr->attlen != -1)
+					elog(ERROR, "'%s' specified by 'dictionary' option is not a variable-length data type",
+						 col_name);
+				for (i=0; i < num_dictionaries; i++)
+				{
+					if (p_dictionary[i] == attr->attnum)
+						elog(ERROR, "'%s' specified by 'dictionary' option appeared twice",
+							 col_name);
+				}
+				if (num_dictionaries >= GSTORE_MAX_DICTIONARIES)
+					elog(ERROR, "too many columns are specified by 'dictionary' option (up to %d)",
+						 GSTORE_MAX_DICTIONARIES);
+				p_dictionary[num_dictionaries++] = attr->attnum;
+			}
+		}
 		else if (strcmp(def->defname, "preserve_files") == 0)
 		{
             preserve_files = defGetBoolean(def);
@@ -2378,26 +4675,22 @@ gstoreFdwExtractOptions(Relation frel,
 	*p_gpu_update_interval  = gpu_update_interval;
 	*p_gpu_update_threshold = gpu_update_threshold;
 	*p_primary_key          = primary_key;
+	*p_num_ordered_indexes  = num_ordered_indexes;
+	*p_num_dictionaries     = num_dictionaries;
 	*p_preserve_files       = preserve_files;
 }
 
 /*
- * gstoreFdwAssignDefaultFiles
+ * gstoreFdwUpdateTableOptions
  *
- * assign default name for base/redo files if not specified the options.
- * the supplied 'frel' must have AccessExclusiveLock
+ * It replaces pg_foreign_table.ftoptions of the foreign table by the
+ * supplied list of DefElem.
  */
 static void
-gstoreFdwAssignDefaultFiles(Relation frel)
+gstoreFdwUpdateTableOptions(Relation frel, List *ftoptions)
 {
 	Oid			ftable_oid = RelationGetRelid(frel);
-	ForeignTable *ft = GetForeignTable(ftable_oid);
-	DefElem	   *base_file = NULL;
-	DefElem	   *redo_file = NULL;
 	ListCell   *lc;
-	List	   *ftoptions;
-	char	   *dir_name;
-	char	   *filename;
 	StringInfoData buf;
 	ArrayType  *ap;
 	int16		typlen;
@@ -2409,43 +4702,6 @@ gstoreFdwAssignDefaultFiles(Relation frel)
 	bool		update[Natts_pg_foreign_table];
 	HeapTuple	tuple;
 
-	foreach (lc, ft->options)
-	{
-		DefElem	   *def = lfirst(lc);
-
-		if (strcmp(def->defname, "base_file") == 0)
-			base_file = def;
-		else if (strcmp(def->defname, "redo_log_file") == 0)
-			redo_file = def;
-	}
-	if (base_file && redo_file)
-		return;		/* nothing to do */
-
-	ftoptions = list_copy(ft->options);
-	if (!base_file)
-	{
-		if (gstore_fdw_default_base_dir && *gstore_fdw_default_base_dir != '\0')
-			dir_name = gstore_fdw_default_base_dir;
-		else
-			dir_name = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
-		filename = psprintf("%s/gstore_fdw_%u.base", dir_name, ftable_oid);
-		base_file = makeDefElem("base_file",
-								(Node *)makeString(filename), -1);
-		ftoptions = lappend(ftoptions, base_file);
-	}
-
-	if (!redo_file)
-	{
-		if (gstore_fdw_default_redo_dir && *gstore_fdw_default_redo_dir != '\0')
-			dir_name = gstore_fdw_default_redo_dir;
-		else
-			dir_name = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
-		filename = psprintf("%s/gstore_fdw_%u.redo", dir_name, ftable_oid);
-		redo_file = makeDefElem("redo_log_file",
-								(Node *)makeString(filename), -1);
-		ftoptions = lappend(ftoptions, redo_file);
-	}
-
 	/* setup pg_foreign_table.ftoptions */
 	get_typlenbyvalalign(TEXTOID, &typlen, &typbyval, &typalign);
 	Assert(typlen == -1 && !typbyval);
@@ -2498,6 +4754,64 @@ gstoreFdwAssignDefaultFiles(Relation frel)
 	pfree(buf.data);
 }
 
+/*
+ * gstoreFdwAssignDefaultFiles
+ *
+ * assign default name for base/redo files if not specified the options.
+ * the supplied 'frel' must have AccessExclusiveLock
+ */
+static void
+gstoreFdwAssignDefaultFiles(Relation frel)
+{
+	Oid			ftable_oid = RelationGetRelid(frel);
+	ForeignTable *ft = GetForeignTable(ftable_oid);
+	DefElem	   *base_file = NULL;
+	DefElem	   *redo_file = NULL;
+	ListCell   *lc;
+	List	   *ftoptions;
+	char	   *dir_name;
+	char	   *filename;
+
+	foreach (lc, ft->options)
+	{
+		DefElem	   *def = lfirst(lc);
+
+		if (strcmp(def->defname, "base_file") == 0)
+			base_file = def;
+		else if (strcmp(def->defname, "redo_log_file") == 0)
+			redo_file = def;
+	}
+	if (base_file && redo_file)
+		return;		/* nothing to do */
+
+	ftoptions = list_copy(ft->options);
+	if (!base_file)
+	{
+		if (gstore_fdw_default_base_dir && *gstore_fdw_default_base_dir != '\0')
+			dir_name = gstore_fdw_default_base_dir;
+		else
+			dir_name = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
+		filename = psprintf("%s/gstore_fdw_%u.base", dir_name, ftable_oid);
+		base_file = makeDefElem("base_file",
+								(Node *)makeString(filename), -1);
+		ftoptions = lappend(ftoptions, base_file);
+	}
+
+	if (!redo_file)
+	{
+		if (gstore_fdw_default_redo_dir && *gstore_fdw_default_redo_dir != '\0')
+			dir_name = gstore_fdw_default_redo_dir;
+		else
+			dir_name = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
+		filename = psprintf("%s/gstore_fdw_%u.redo", dir_name, ftable_oid);
+		redo_file = makeDefElem("redo_log_file",
+								(Node *)makeString(filename), -1);
+		ftoptions = lappend(ftoptions, redo_file);
+	}
+
+	gstoreFdwUpdateTableOptions(frel, ftoptions);
+}
+
 /*
  * gstoreFdwDeviceTupleDesc
  *
@@ -2535,14 +4849,21 @@ gstoreFdwAllocSharedState(Relation frel)
 	GpuStoreSharedState *gs_sstate;
 	cl_int		cuda_dindex;
 	ssize_t		max_num_rows;
-	ssize_t		num_hash_slots = -1;
+	ssize_t		num_hash_groups = -1;
 	const char *base_file;
 	const char *redo_log_file;
 	size_t		redo_log_limit;
 	cl_long		gpu_update_interval;
 	size_t		gpu_update_threshold;
 	AttrNumber	primary_key;
+	cl_int		num_ordered_indexes;
+	AttrNumber	ordered_index[GPUSTORE_MAX_ORDERED_INDEXES];
+	cl_int		num_dictionaries;
+	AttrNumber	dictionary[GSTORE_MAX_DICTIONARIES];
 	bool		preserve_files;
+	cl_int		dirty_ncols;
+	cl_uint		dirty_shift = GSTORE_DIRTY_BLOCK_MIN_SHIFT;
+	cl_uint		dirty_nwords;
 	size_t		len;
 	char	   *pos;
 	cl_int		i;
@@ -2557,23 +4878,45 @@ gstoreFdwAllocSharedState(Relation frel)
 							&gpu_update_interval,
 							&gpu_update_threshold,
 							&primary_key,
+							&num_ordered_indexes,
+							ordered_index,
+							&num_dictionaries,
+							dictionary,
 							&preserve_files);
+	/* dirty bitmap for each column, and the system column */
+	dirty_ncols = RelationGetNumberOfAttributes(frel) + 1;
+	while ((max_num_rows >> dirty_shift) >= GSTORE_DIRTY_BLOCK_MAX_NUMS)
+		dirty_shift++;
+	dirty_nwords = (((max_num_rows >> dirty_shift) + 1) + 31) / 32;
+
 	/* allocation of GpuStoreSharedState */
 	len = MAXALIGN(sizeof(GpuStoreSharedState));
+	len += MAXALIGN(sizeof(pg_atomic_uint32) * dirty_ncols * dirty_nwords);
+	len += MAXALIGN(sizeof(GpuStoreDictionary)) * num_dictionaries;
 	if (base_file)
 		len += MAXALIGN(strlen(base_file) + 1);
 	if (redo_log_file)
 		len += MAXALIGN(strlen(redo_log_file) + 1);
 	if (primary_key >= 0)
-	{
-		/* num_hash_slots >= (2^32) does not make sense because hash_any
-		 * shall return hash-value in uint32. */
-		num_hash_slots = 1.2 * (double)max_num_rows + 1000.0;
-		num_hash_slots = Min(num_hash_slots, UINT_MAX);
-	}
+		num_hash_groups = gstoreFdwHashIndexNumGroups(max_num_rows);
 
 	gs_sstate = MemoryContextAllocZero(TopSharedMemoryContext, len);
 	pos = (char *)gs_sstate + MAXALIGN(sizeof(GpuStoreSharedState));
+	gs_sstate->dirty_bitmap = (pg_atomic_uint32 *)pos;
+	for (i=0; i < dirty_ncols * dirty_nwords; i++)
+		pg_atomic_init_u32(&gs_sstate->dirty_bitmap[i], 0);
+	pos += MAXALIGN(sizeof(pg_atomic_uint32) * dirty_ncols * dirty_nwords);
+	for (i=0; i < num_dictionaries; i++)
+	{
+		GpuStoreDictionary *dict = (GpuStoreDictionary *)pos;
+
+		LWLockInitialize(&dict->lock, -1);
+		dict->attnum = dictionary[i];
+		dict->nitems = 0;
+		memset(dict->slots, 0xff, sizeof(dict->slots));
+		gs_sstate->dict_buf[i] = dict;
+		pos += MAXALIGN(sizeof(GpuStoreDictionary));
+	}
 	if (base_file)
 	{
 		strcpy(pos, base_file);
@@ -2594,8 +4937,14 @@ gstoreFdwAllocSharedState(Relation frel)
 							   2 * sizeof(Oid));
 	gs_sstate->cuda_dindex = cuda_dindex;
 	gs_sstate->max_num_rows = max_num_rows;
-	gs_sstate->num_hash_slots = num_hash_slots;
+	gs_sstate->num_hash_groups = num_hash_groups;
 	gs_sstate->primary_key = primary_key;
+	gs_sstate->num_ordered_indexes = num_ordered_indexes;
+	memcpy(gs_sstate->ordered_index, ordered_index,
+		   sizeof(AttrNumber) * num_ordered_indexes);
+	gs_sstate->num_dictionaries = num_dictionaries;
+	memcpy(gs_sstate->dictionary, dictionary,
+		   sizeof(AttrNumber) * num_dictionaries);
 	gs_sstate->preserve_files = preserve_files;
 	gs_sstate->redo_log_limit = redo_log_limit;
 	gs_sstate->gpu_update_interval = gpu_update_interval;
@@ -2604,20 +4953,51 @@ gstoreFdwAllocSharedState(Relation frel)
 	LWLockInitialize(&gs_sstate->base_mmap_lock, -1);
 	gs_sstate->base_mmap_revision = UINT_MAX;
 
-	SpinLockInit(&gs_sstate->rowid_map_lock);
 	for (i=0; i < GSTORE_NUM_BASE_ROW_LOCKS; i++)
+	{
 		SpinLockInit(&gs_sstate->base_row_lock[i]);
-	for (i=0; i < GSTORE_NUM_HASH_SLOT_LOCKS; i++)
-		SpinLockInit(&gs_sstate->hash_slot_lock[i]);
+		pg_atomic_init_u32(&gs_sstate->base_row_seqno[i], 0);
+	}
+	for (i=0; i < GPUSTORE_MAX_ORDERED_INDEXES; i++)
+		LWLockInitialize(&gs_sstate->ordered_index_lock[i], -1);
 	SpinLockInit(&gs_sstate->redo_pos_lock);
 	gs_sstate->redo_write_pos = 0;
 	gs_sstate->redo_read_pos = 0;
-	
+	ConditionVariableInit(&gs_sstate->redo_sync_cond);
+	gs_sstate->redo_sync_in_progress = false;
+	gs_sstate->pinned_head[0] = UINT_MAX;
+	gs_sstate->pinned_head[1] = UINT_MAX;
+	/* the first checkpoint persists the entire base file */
+	gs_sstate->dirty_full = true;
+	gs_sstate->dirty_ncols = dirty_ncols;
+	gs_sstate->dirty_shift = dirty_shift;
+	gs_sstate->dirty_nwords = dirty_nwords;
+
 	pthreadRWLockInit(&gs_sstate->gpu_bufer_lock);
 
 	return gs_sstate;
 }
 
+/*
+ * gstoreFdwResetDirtyShift
+ *
+ * It enlarges the block size of the dirty bitmap, if 'max_num_rows' is
+ * grown beyond the capacity of the bitmap allocated at the creation of
+ * GpuStoreSharedState. The existing dirty bits lose their meaning, so
+ * the next checkpoint persists the entire base file.
+ */
+static void
+gstoreFdwResetDirtyShift(GpuStoreSharedState *gs_sstate)
+{
+	cl_uint		dirty_shift = gs_sstate->dirty_shift;
+
+	while (((gs_sstate->max_num_rows >> dirty_shift) + 1) >
+		   32 * gs_sstate->dirty_nwords)
+		dirty_shift++;
+	gs_sstate->dirty_shift = dirty_shift;
+	gs_sstate->dirty_full = true;
+}
+
 /* ----------------------------------------------------------------
  *
  * Routines to allocate/release RowIDs
@@ -2630,36 +5010,273 @@ gstoreFdwRowIdMapSize(cl_uint nrooms)
 	return MAXALIGN(offsetof(GpuStoreRowIdMapHead, rowid_chain[nrooms]));
 }
 
+/*
+ * __gstoreFdwPopFreeRowIds
+ *
+ * It detaches up to 'nrooms' rowids from the head of the free rowid list
+ * by compare-and-swap on the tagged free_head, then returns the number of
+ * rowids. Because any update of the free list increments the tag, the chain
+ * we walked is consistent if CAS successfully replaced the head.
+ */
+static cl_uint
+__gstoreFdwPopFreeRowIds(GpuStoreRowIdMapHead *rowid_map,
+						 cl_uint *rowids, cl_uint nrooms)
+{
+	cl_ulong	oldhead;
+	cl_ulong	newhead;
+	cl_uint		i, rowid, count;
+
+	Assert(nrooms > 0);
+	oldhead = atomicRead64(&rowid_map->free_head);
+	for (;;)
+	{
+		count = 0;
+		rowid = (cl_uint)(oldhead & 0xffffffffUL);
+		while (rowid < rowid_map->nrooms && count < nrooms)
+		{
+			rowids[count++] = rowid;
+			rowid = atomicRead32(&rowid_map->rowid_chain[rowid]);
+		}
+		if (count == 0)
+			return 0;		/* no free rowids */
+		if (rowid >= rowid_map->nrooms)
+			rowid = UINT_MAX;
+		newhead = GPUSTORE_ROWID_FREE_HEAD(rowid, (oldhead >> 32) + 1);
+		if (atomicCAS64(&rowid_map->free_head, &oldhead, newhead))
+			break;
+	}
+	/* Ok, these rowids are detached from the free list */
+	for (i=0; i < count; i++)
+		rowid_map->rowid_chain[rowids[i]] = GPUSTORE_ROWID_RESERVED;
+	return count;
+}
+
+/*
+ * __gstoreFdwPushFreeRowIdChain
+ *
+ * It attaches the chain of rowids [head ... tail] to the head of the free
+ * rowid list at once.
+ */
+static void
+__gstoreFdwPushFreeRowIdChain(GpuStoreRowIdMapHead *rowid_map,
+							  cl_uint head, cl_uint tail)
+{
+	cl_ulong	oldhead;
+	cl_ulong	newhead;
+
+	Assert(head < rowid_map->nrooms && tail < rowid_map->nrooms);
+	oldhead = atomicRead64(&rowid_map->free_head);
+	do {
+		rowid_map->rowid_chain[tail] = (cl_uint)(oldhead & 0xffffffffUL);
+		newhead = GPUSTORE_ROWID_FREE_HEAD(head, (oldhead >> 32) + 1);
+	} while (!atomicCAS64(&rowid_map->free_head, &oldhead, newhead));
+}
+
+/*
+ * __gstoreFdwPushFreeRowIds
+ *
+ * It attaches the rowids to the head of the free rowid list at once.
+ */
+static void
+__gstoreFdwPushFreeRowIds(GpuStoreRowIdMapHead *rowid_map,
+						  cl_uint *rowids, cl_uint nitems)
+{
+	cl_uint		i;
+
+	if (nitems == 0)
+		return;
+	for (i=1; i < nitems; i++)
+	{
+		Assert(rowids[i-1] < rowid_map->nrooms);
+		rowid_map->rowid_chain[rowids[i-1]] = rowids[i];
+	}
+	__gstoreFdwPushFreeRowIdChain(rowid_map, rowids[0], rowids[nitems-1]);
+}
+
+/*
+ * gstoreFdwPinRowIds
+ *
+ * It attaches the rowids of the older versions referred by column-delta
+ * UPDATE logs to the pinned list, instead of the free list. The current
+ * REDO position already covers the UPDATE logs and the commit log.
+ */
+static void
+gstoreFdwPinRowIds(GpuStoreSharedState *gs_sstate,
+				   GpuStoreRowIdMapHead *rowid_map,
+				   cl_uint *rowids, cl_uint nitems)
+{
+	cl_uint		i;
+
+	if (nitems == 0)
+		return;
+	for (i=1; i < nitems; i++)
+	{
+		Assert(rowid_map->rowid_chain[rowids[i-1]] == UINT_MAX);
+		rowid_map->rowid_chain[rowids[i-1]] = rowids[i];
+	}
+	Assert(rowid_map->rowid_chain[rowids[nitems-1]] == UINT_MAX);
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	if (gs_sstate->pinned_head[0] == UINT_MAX)
+	{
+		/* not UINT_MAX; that means rowid in-use */
+		rowid_map->rowid_chain[rowids[nitems-1]] = GPUSTORE_ROWID_RESERVED;
+		gs_sstate->pinned_tail[0] = rowids[nitems-1];
+	}
+	else
+		rowid_map->rowid_chain[rowids[nitems-1]] = gs_sstate->pinned_head[0];
+	gs_sstate->pinned_head[0] = rowids[0];
+	gs_sstate->pinned_pos[0] = gs_sstate->redo_write_pos;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+}
+
+/*
+ * gstoreFdwUnpinRowIds
+ *
+ * It moves the pinned rowids to the free list, if both of the checkpoint
+ * and the GPU buffer passed the REDO position where they were pinned.
+ * It returns true if any rowids were released.
+ */
+static bool
+gstoreFdwUnpinRowIds(GpuStoreSharedState *gs_sstate,
+					 GpuStoreRowIdMapHead *rowid_map)
+{
+	TimestampTz	now = GetCurrentTimestamp();
+	cl_uint		head = UINT_MAX;
+	cl_uint		tail = UINT_MAX;
+
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	for (;;)
+	{
+		if (gs_sstate->pinned_head[1] != UINT_MAX)
+		{
+			if (gs_sstate->pinned_pos[1] > gs_sstate->redo_checkpoint_pos ||
+				gs_sstate->pinned_pos[1] > gs_sstate->redo_read_pos)
+				break;
+			if (gs_sstate->pinned_pos[1] > gs_sstate->backup_pos &&
+				now < gs_sstate->backup_expire)
+				break;
+			if (head == UINT_MAX)
+				head = gs_sstate->pinned_head[1];
+			else
+				rowid_map->rowid_chain[tail] = gs_sstate->pinned_head[1];
+			tail = gs_sstate->pinned_tail[1];
+			gs_sstate->unpinned_pos = Max(gs_sstate->unpinned_pos,
+										  gs_sstate->pinned_pos[1]);
+			gs_sstate->pinned_head[1] = UINT_MAX;
+		}
+		if (gs_sstate->pinned_head[0] == UINT_MAX)
+			break;
+		/* the rowids pinned so far wait for the current position */
+		gs_sstate->pinned_head[1] = gs_sstate->pinned_head[0];
+		gs_sstate->pinned_tail[1] = gs_sstate->pinned_tail[0];
+		gs_sstate->pinned_pos[1]  = gs_sstate->pinned_pos[0];
+		gs_sstate->pinned_head[0] = UINT_MAX;
+	}
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+
+	if (head == UINT_MAX)
+		return false;
+	__gstoreFdwPushFreeRowIdChain(rowid_map, head, tail);
+	return true;
+}
+
+/*
+ * gstoreFdwUnpinRowIdsForce
+ *
+ * It runs checkpoint and applies the REDO logs written so far on the GPU
+ * buffer synchronously, then releases all the pinned rowids.
+ */
+static bool
+gstoreFdwUnpinRowIdsForce(GpuStoreDesc *gs_desc)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	uint64		end_pos;
+	bool		has_pinned;
+	CUresult	rc;
+
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	has_pinned = (gs_sstate->pinned_head[0] != UINT_MAX ||
+				  gs_sstate->pinned_head[1] != UINT_MAX);
+	end_pos = gs_sstate->redo_write_pos;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+	if (!has_pinned)
+		return false;
+
+	rc = gstoreFdwInvokeCheckpoint(gs_desc->ftable_oid, false);
+	if (rc == CUDA_SUCCESS)
+		rc = gstoreFdwInvokeApplyRedo(gs_desc->ftable_oid, false, end_pos);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(WARNING, "gstore_fdw: unable to release the pinned rowids of '%s': %s",
+			 gs_sstate->base_file, errorText(rc));
+		return false;
+	}
+	return gstoreFdwUnpinRowIds(gs_sstate, gs_desc->rowid_map);
+}
+
+/*
+ * gstoreFdwAllocateRowId
+ *
+ * It allocates a rowid from the per-backend cache; that is refilled by
+ * a batch of rowids reserved from the shared free list. The batch size
+ * grows up to GPUSTORE_ROWID_CACHE_MAXSZ while the transaction continues
+ * to insert rows, so short transactions don't reserve many rowids.
+ */
 static cl_uint
-gstoreFdwAllocateRowId(GpuStoreSharedState *gs_sstate,
-                       GpuStoreRowIdMapHead *rowid_map)
+gstoreFdwAllocateRowId(GpuStoreDesc *gs_desc)
 {
+	GpuStoreRowIdMapHead *rowid_map = gs_desc->rowid_map;
 	cl_uint		rowid;
 
-	SpinLockAcquire(&gs_sstate->rowid_map_lock);
-	rowid = rowid_map->first_free_rowid;
-	if (rowid != UINT_MAX)
+	if (gs_desc->rowid_cache_nitems == 0)
 	{
-		Assert(rowid < rowid_map->nrooms);
-		rowid_map->first_free_rowid = rowid_map->rowid_chain[rowid];
-		rowid_map->rowid_chain[rowid] = UINT_MAX;	/* currently in-use */
+		cl_uint		nrooms = Max(gs_desc->rowid_cache_batch, 1);
+
+		gstoreFdwUnpinRowIds(gs_desc->gs_sstate, rowid_map);
+		gs_desc->rowid_cache_nitems =
+			__gstoreFdwPopFreeRowIds(rowid_map, gs_desc->rowid_cache, nrooms);
+		if (gs_desc->rowid_cache_nitems == 0)
+			return UINT_MAX;
+		gs_desc->rowid_cache_batch = Min(2 * nrooms,
+										 GPUSTORE_ROWID_CACHE_MAXSZ);
 	}
-	SpinLockRelease(&gs_sstate->rowid_map_lock);
+	/* pick up from the head, to keep the order of the free list */
+	rowid = gs_desc->rowid_cache[0];
+	gs_desc->rowid_cache_nitems--;
+	memmove(gs_desc->rowid_cache,
+			gs_desc->rowid_cache + 1,
+			sizeof(cl_uint) * gs_desc->rowid_cache_nitems);
+	Assert(rowid < rowid_map->nrooms &&
+		   rowid_map->rowid_chain[rowid] == GPUSTORE_ROWID_RESERVED);
+	rowid_map->rowid_chain[rowid] = UINT_MAX;	/* currently in-use */
 
 	return rowid;
 }
 
+/*
+ * gstoreFdwReleaseRowIdCache
+ *
+ * It returns the unused rowids reserved by this backend.
+ */
+static void
+gstoreFdwReleaseRowIdCache(GpuStoreDesc *gs_desc)
+{
+	if (gs_desc->rowid_cache_nitems > 0 && gs_desc->rowid_map)
+		__gstoreFdwPushFreeRowIds(gs_desc->rowid_map,
+								  gs_desc->rowid_cache,
+								  gs_desc->rowid_cache_nitems);
+	gs_desc->rowid_cache_nitems = 0;
+	gs_desc->rowid_cache_batch = GPUSTORE_ROWID_CACHE_MINSZ;
+}
+
 static void
 gstoreFdwReleaseRowId(GpuStoreSharedState *gs_sstate,
 					  GpuStoreRowIdMapHead *rowid_map,
 					  cl_uint rowid)
 {
-	SpinLockAcquire(&gs_sstate->rowid_map_lock);
 	Assert(rowid < rowid_map->nrooms);
 	Assert(rowid_map->rowid_chain[rowid] == UINT_MAX);
-	rowid_map->rowid_chain[rowid] = rowid_map->first_free_rowid;
-	rowid_map->first_free_rowid = rowid;
-	SpinLockRelease(&gs_sstate->rowid_map_lock);
+	__gstoreFdwPushFreeRowIds(rowid_map, &rowid, 1);
 }
 
 static void
@@ -2667,15 +5284,15 @@ gstoreFdwReleaseRowIdMulti(GpuStoreSharedState *gs_sstate,
 						   GpuStoreRowIdMapHead *rowid_map,
 						   cl_uint rowid, List *unused_rowids)
 {
+	cl_uint	   *rowids = alloca(sizeof(cl_uint) * (list_length(unused_rowids) + 1));
+	cl_uint		nitems = 0;
 	ListCell   *lc;
 
-    SpinLockAcquire(&gs_sstate->rowid_map_lock);
 	if (rowid != UINT_MAX)
 	{
 		Assert(rowid < rowid_map->nrooms);
 		Assert(rowid_map->rowid_chain[rowid] == UINT_MAX);
-		rowid_map->rowid_chain[rowid] = rowid_map->first_free_rowid;
-		rowid_map->first_free_rowid = rowid;
+		rowids[nitems++] = rowid;
 	}
 
 	foreach (lc, unused_rowids)
@@ -2684,10 +5301,9 @@ gstoreFdwReleaseRowIdMulti(GpuStoreSharedState *gs_sstate,
 
 		Assert(rowid < rowid_map->nrooms);
 		Assert(rowid_map->rowid_chain[rowid] == UINT_MAX);
-		rowid_map->rowid_chain[rowid] = rowid_map->first_free_rowid;
-		rowid_map->first_free_rowid = rowid;
+		rowids[nitems++] = rowid;
 	}
-	SpinLockRelease(&gs_sstate->rowid_map_lock);
+	__gstoreFdwPushFreeRowIds(rowid_map, rowids, nitems);
 }
 
 static bool
@@ -2695,16 +5311,226 @@ gstoreFdwCheckRowId(GpuStoreSharedState *gs_sstate,
 					GpuStoreRowIdMapHead *rowid_map,
 					cl_uint rowid)
 {
-	bool	retval = false;
+	if (rowid < rowid_map->nrooms &&
+		atomicRead32(&rowid_map->rowid_chain[rowid]) == UINT_MAX)
+		return true;
+	return false;
+}
 
-	if (rowid < rowid_map->nrooms)
+/* ----------------------------------------------------------------
+ *
+ * Routines for shared dictionary of varlena columns
+ *
+ * ----------------------------------------------------------------
+ */
+static GpuStoreDictionary *
+gstoreFdwLookupDictionary(GpuStoreSharedState *gs_sstate, AttrNumber attnum)
+{
+	int		k;
+
+	for (k=0; k < gs_sstate->num_dictionaries; k++)
 	{
-		SpinLockAcquire(&gs_sstate->rowid_map_lock);
-		if (rowid_map->rowid_chain[rowid] == UINT_MAX)
-			retval = true;
-		SpinLockRelease(&gs_sstate->rowid_map_lock);
+		if (gs_sstate->dict_buf[k]->attnum == attnum)
+			return gs_sstate->dict_buf[k];
+	}
+	return NULL;
+}
+
+/*
+ * __gstoreFdwDictionaryLookup
+ *
+ * It returns the packed offset of the value identical to 'vl', or 0 if not
+ * found. Caller must ensure the extra buffer is mapped with the latest
+ * revision.
+ */
+static cl_uint
+__gstoreFdwDictionaryLookup(GpuStoreDictionary *dict,
+							kern_data_extra *extra,
+							const char *vl, cl_uint hash)
+{
+	cl_uint		length = VARSIZE_ANY(vl);
+	cl_uint		index;
+	cl_uint		code = 0;
+
+	LWLockAcquire(&dict->lock, LW_SHARED);
+	for (index = dict->slots[hash % GSTORE_DICTIONARY_NSLOTS];
+		 index != UINT_MAX;
+		 index = dict->items[index].next)
+	{
+		GpuStoreDictionaryItem *item = &dict->items[index];
+
+		if (item->hash == hash &&
+			item->length == length &&
+			memcmp((char *)extra + __kds_unpack(item->offset),
+				   vl, length) == 0)
+		{
+			code = item->offset;
+			break;
+		}
+	}
+	LWLockRelease(&dict->lock);
+
+	return code;
+}
+
+/*
+ * __gstoreFdwDictionaryInsert
+ *
+ * It adds a new item, unless the dictionary is full or has an item with
+ * the same hash and length; likely, a concurrent session added the same
+ * value. Values are not compared here, because the item may locate out of
+ * the extra buffer mapped by the caller.
+ */
+static void
+__gstoreFdwDictionaryInsert(GpuStoreDictionary *dict,
+							cl_uint hash, cl_uint length, cl_uint offset)
+{
+	cl_uint	   *slot = &dict->slots[hash % GSTORE_DICTIONARY_NSLOTS];
+	cl_uint		index;
+
+	LWLockAcquire(&dict->lock, LW_EXCLUSIVE);
+	for (index = *slot; index != UINT_MAX; index = dict->items[index].next)
+	{
+		if (dict->items[index].hash == hash &&
+			dict->items[index].length == length)
+			break;
+	}
+	if (index == UINT_MAX && dict->nitems < GSTORE_DICTIONARY_MAX_NITEMS)
+	{
+		GpuStoreDictionaryItem *item = &dict->items[dict->nitems];
+
+		item->next = *slot;
+		item->hash = hash;
+		item->length = length;
+		item->offset = offset;
+		*slot = dict->nitems++;
+	}
+	LWLockRelease(&dict->lock);
+}
+
+/*
+ * gstoreFdwDictionaryProbe
+ *
+ * It makes the canonical form of the new values on the dictionary columns;
+ * inline, uncompressed and short-header if possible like heap_fill_tuple(),
+ * then looks up the dictionary for the identical values.
+ * Base file shall be mapped with the latest revision on return.
+ */
+static void
+gstoreFdwDictionaryProbe(GpuStoreDesc *gs_desc, TupleTableSlot *slot,
+						 Bitmapset *updatedCols,
+						 GpuStoreDictionaryProbe *probes)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	int			natts = slot->tts_tupleDescriptor->natts;
+	kern_data_store *kds;
+	kern_data_extra *extra;
+	int			j;
+
+	memset(probes, 0, sizeof(GpuStoreDictionaryProbe) * natts);
+	for (j=0; j < natts; j++)
+	{
+		GpuStoreDictionary *dict;
+		struct varlena *vl;
+
+		if (slot->tts_isnull[j] ||
+			(updatedCols && !bms_is_member(j+1, updatedCols)))
+			continue;
+		dict = gstoreFdwLookupDictionary(gs_sstate, j+1);
+		if (!dict)
+			continue;
+		vl = pg_detoast_datum_packed((struct varlena *)
+									 DatumGetPointer(slot->tts_values[j]));
+		if (!VARATT_IS_SHORT(vl) && VARATT_CAN_MAKE_SHORT(vl))
+		{
+			Size	len = VARATT_CONVERTED_SHORT_SIZE(vl);
+			char   *temp = palloc(len);
+
+			SET_VARSIZE_SHORT(temp, len);
+			memcpy(temp + 1, VARDATA(vl), len - 1);
+			vl = (struct varlena *)temp;
+		}
+		probes[j].dict = dict;
+		probes[j].value = PointerGetDatum(vl);
+		probes[j].hash = DatumGetUInt32(hash_any((unsigned char *)vl,
+												 VARSIZE_ANY(vl)));
+	}
+
+	LWLockAcquire(&gs_sstate->base_mmap_lock, LW_SHARED);
+	if (gs_desc->base_mmap_revision != gs_sstate->base_mmap_revision)
+		gstoreFdwRemapBaseFile(gs_desc, true);
+	kds = &gs_desc->base_mmap->schema;
+	extra = (kern_data_extra *)((char *)kds + kds->extra_hoffset);
+	for (j=0; j < natts; j++)
+	{
+		if (probes[j].dict)
+			probes[j].code = __gstoreFdwDictionaryLookup(probes[j].dict, extra,
+														 DatumGetPointer(probes[j].value),
+														 probes[j].hash);
+	}
+	LWLockRelease(&gs_sstate->base_mmap_lock);
+}
+
+/*
+ * gstoreFdwRebuildDictionaries
+ *
+ * It rebuilds the shared dictionaries from the values of live rows, and
+ * merges identical values stored individually (e.g, by REDO log replay)
+ * into a single copy. Caller must block concurrent writers.
+ */
+static void
+gstoreFdwRebuildDictionaries(GpuStoreSharedState *gs_sstate,
+							 kern_data_store *kds,
+							 GpuStoreRowIdMapHead *rowid_map)
+{
+	kern_data_extra *extra;
+	cl_uint		rowid;
+	int			k;
+
+	if (gs_sstate->num_dictionaries == 0)
+		return;
+	Assert(kds->has_varlena);
+	extra = (kern_data_extra *)((char *)kds + kds->extra_hoffset);
+	for (k=0; k < gs_sstate->num_dictionaries; k++)
+	{
+		GpuStoreDictionary *dict = gs_sstate->dict_buf[k];
+		kern_colmeta   *cmeta = &kds->colmeta[dict->attnum - 1];
+		bits8		   *nullmap = NULL;
+		cl_uint		   *values;
+		cl_uint			nmerged = 0;
+
+		dict->nitems = 0;
+		memset(dict->slots, 0xff, sizeof(dict->slots));
+		if (cmeta->nullmap_offset != 0)
+			nullmap = (bits8 *)((char *)kds + __kds_unpack(cmeta->nullmap_offset));
+		values = (cl_uint *)((char *)kds + __kds_unpack(cmeta->values_offset));
+		for (rowid=0; rowid < kds->nitems; rowid++)
+		{
+			char	   *vl;
+			cl_uint		hash;
+			cl_uint		code;
+
+			if (!gstoreFdwCheckRowId(gs_sstate, rowid_map, rowid) ||
+				(nullmap && att_isnull(rowid, nullmap)) ||
+				values[rowid] == 0)
+				continue;
+			vl = (char *)extra + __kds_unpack(values[rowid]);
+			hash = DatumGetUInt32(hash_any((unsigned char *)vl,
+										   VARSIZE_ANY(vl)));
+			code = __gstoreFdwDictionaryLookup(dict, extra, vl, hash);
+			if (code == 0)
+				__gstoreFdwDictionaryInsert(dict, hash, VARSIZE_ANY(vl),
+											values[rowid]);
+			else if (code != values[rowid])
+			{
+				values[rowid] = code;
+				gstoreFdwMarkDirty(gs_sstate, dict->attnum - 1, rowid);
+				nmerged++;
+			}
+		}
+		elog(DEBUG1, "gstore_fdw: dictionary of '%s' attnum=%d has %u items (%u values merged)",
+			 gs_sstate->base_file, dict->attnum, dict->nitems, nmerged);
 	}
-	return retval;
 }
 
 /* ----------------------------------------------------------------
@@ -2713,6 +5539,113 @@ gstoreFdwCheckRowId(GpuStoreSharedState *gs_sstate,
  *
  * ----------------------------------------------------------------
  */
+/*
+ * __gstoreFdwHashIndexInitGroups
+ */
+static void
+__gstoreFdwHashIndexInitGroups(GpuStoreHashGroup *hgroups, uint64 ngroups)
+{
+	uint64		k;
+
+	memset(hgroups, 0, sizeof(GpuStoreHashGroup) * ngroups);
+	for (k=0; k < ngroups; k++)
+		memset(hgroups[k].rowid, -1, sizeof(hgroups[k].rowid));
+}
+
+/*
+ * __gstoreFdwHashIndexAddEntry
+ *
+ * It puts (hash, rowid) on the first empty bucket from the home group.
+ * Caller must hold the lock of the home group, if 'with_lock'.
+ */
+static void
+__gstoreFdwHashIndexAddEntry(GpuStoreHashIndexHead *hash_index,
+							 cl_uint hash, cl_uint rowid, bool with_lock)
+{
+	GpuStoreHashGroup *hhome = gstoreFdwHashHomeGroup(hash_index, hash);
+	GpuStoreHashGroup *hgroup = hhome;
+	uint64		count;
+	int			i;
+
+	for (count=0; count < hash_index->ngroups; count++)
+	{
+		if (with_lock && hgroup != hhome)
+			gstoreFdwSpinLockHashGroup(hgroup);
+		for (i=0; i < GPUSTORE_HASHINDEX_NBUCKETS; i++)
+		{
+			if (hgroup->rowid[i] == UINT_MAX)
+			{
+				hgroup->hash[i] = hash;
+				hgroup->rowid[i] = rowid;
+				if (with_lock && hgroup != hhome)
+					gstoreFdwSpinUnlockHashGroup(hgroup);
+				return;
+			}
+		}
+		/* this group is full, so entry goes beyond */
+		hgroup->overflow++;
+		if (with_lock && hgroup != hhome)
+			gstoreFdwSpinUnlockHashGroup(hgroup);
+		hgroup = gstoreFdwHashNextGroup(hash_index, hgroup);
+	}
+	elog(ERROR, "Bug? gstore_fdw: PK hash-index has no empty buckets");
+}
+
+/*
+ * __gstoreFdwHashIndexRemoveEntry
+ *
+ * It removes (hash, rowid) from the hash-index, and decrements the overflow
+ * counter of the groups it probed beyond.
+ * Caller must hold the lock of the home group, if 'with_lock'.
+ */
+static bool
+__gstoreFdwHashIndexRemoveEntry(GpuStoreHashIndexHead *hash_index,
+								cl_uint hash, cl_uint rowid, bool with_lock)
+{
+	GpuStoreHashGroup *hhome = gstoreFdwHashHomeGroup(hash_index, hash);
+	GpuStoreHashGroup *hgroup = hhome;
+	uint64		count, nloops;
+	cl_uint		overflow;
+	int			i;
+
+	for (nloops=0; nloops < hash_index->ngroups; nloops++)
+	{
+		if (with_lock && hgroup != hhome)
+			gstoreFdwSpinLockHashGroup(hgroup);
+		for (i=0; i < GPUSTORE_HASHINDEX_NBUCKETS; i++)
+		{
+			if (hgroup->rowid[i] == rowid &&
+				hgroup->hash[i] == hash)
+			{
+				hgroup->rowid[i] = UINT_MAX;
+				hgroup->hash[i] = 0;
+				if (with_lock && hgroup != hhome)
+					gstoreFdwSpinUnlockHashGroup(hgroup);
+				/* fixup overflow counter of the groups probed */
+				hgroup = hhome;
+				for (count=0; count < nloops; count++)
+				{
+					if (with_lock && hgroup != hhome)
+						gstoreFdwSpinLockHashGroup(hgroup);
+					Assert(hgroup->overflow > 0);
+					hgroup->overflow--;
+					if (with_lock && hgroup != hhome)
+						gstoreFdwSpinUnlockHashGroup(hgroup);
+					hgroup = gstoreFdwHashNextGroup(hash_index, hgroup);
+				}
+				return true;
+			}
+		}
+		overflow = hgroup->overflow;
+		if (with_lock && hgroup != hhome)
+			gstoreFdwSpinUnlockHashGroup(hgroup);
+		if (overflow == 0)
+			break;
+		hgroup = gstoreFdwHashNextGroup(hash_index, hgroup);
+	}
+	return false;
+}
+
 static void
 gstoreFdwInsertIntoPrimaryKey(GpuStoreDesc *gs_desc,
 							  GpuStoreUndoLogs *gs_undo, cl_uint rowid)
@@ -2722,10 +5655,13 @@ gstoreFdwInsertIntoPrimaryKey(GpuStoreDesc *gs_desc,
 	kern_data_store	*kds = &gs_desc->base_mmap->schema;
 	kern_colmeta   *cmeta;
 	TypeCacheEntry *tcache;
+	GpuStoreHashGroup *hhome;
+	GpuStoreHashGroup *hgroup = NULL;
 	Datum			kdatum;
 	Datum			hash;
 	bool			isnull;
 	bool			is_locked;
+	bool			curr_locked = false;
 	char			temp[10];
 
 	if (!hash_index)
@@ -2748,58 +5684,80 @@ gstoreFdwInsertIntoPrimaryKey(GpuStoreDesc *gs_desc,
 		elog(ERROR, "primary key '%s' of foreign table '%s' is NULL",
 			 NameStr(cmeta->attname), get_rel_name(kds->table_oid));
 	hash = FunctionCall1(&tcache->hash_proc_finfo, kdatum);
-	is_locked = gstoreFdwSpinLockHashSlot(gs_desc, hash);
+	hhome = gstoreFdwHashHomeGroup(hash_index, hash);
+	/*
+	 * Lock of the home group is held during the duplication check and
+	 * insertion, so concurrent insertion of the same key is serialized.
+	 */
+	is_locked = gstoreFdwSpinLockHashGroup(hhome);
 	PG_TRY();
 	{
-		cl_uint	   *rowmap = &hash_index->slots[hash_index->nslots];
-		cl_uint		curr_id;
-		cl_uint		k = hash % hash_index->nslots;
+		uint64		count;
+		cl_uint		overflow;
+		int			i;
 
 		/* duplication check of the primary key */
 		ConditionVariablePrepareToSleep(&gstore_shared_head->row_lock_cond);
 	wakeup_retry:
-		for (curr_id = hash_index->slots[k];
-			 curr_id < hash_index->nrooms;
-			 curr_id = rowmap[curr_id])
+		hgroup = hhome;
+		for (count=0; count < hash_index->ngroups; count++)
 		{
-			int		visible;
-			Datum	cdatum;
-
-			visible = gstoreCheckVisibilityForIndex(gs_desc, curr_id);
-			if (visible == 0)
-				continue;
-			cdatum = KDS_fetch_datum_column(kds, cmeta, curr_id, &isnull);
-			if (isnull)
-			{
-				elog(WARNING, "Bug? primary key '%s' has NULL at rowid=%u",
-					 NameStr(cmeta->attname), curr_id);
-				continue;
-			}
-			if (DatumGetBool(FunctionCall2(&tcache->eq_opr_finfo,
-										   kdatum, cdatum)))
+			if (hgroup != hhome)
+				curr_locked = gstoreFdwSpinLockHashGroup(hgroup);
+			for (i=0; i < GPUSTORE_HASHINDEX_NBUCKETS; i++)
 			{
-				if (visible > 0)
+				cl_uint	curr_id = hgroup->rowid[i];
+				int		visible;
+				Datum	cdatum;
+
+				if (curr_id >= hash_index->nrooms ||
+					hgroup->hash[i] != (cl_uint)hash)
+					continue;
+				visible = gstoreCheckVisibilityForIndex(gs_desc, curr_id);
+				if (visible == 0)
+					continue;
+				cdatum = KDS_fetch_datum_column(kds, cmeta, curr_id, &isnull);
+				if (isnull)
 				{
-					Oid		typoutput;
-					bool	typisvarlena;
-
-					getTypeOutputInfo(cmeta->atttypid,
-									  &typoutput,
-									  &typisvarlena);
-					elog(ERROR,"duplicate primary key violation; %s = %s already exists",
-						 NameStr(cmeta->attname),
-						 OidOutputFunctionCall(typoutput, kdatum));
+					elog(WARNING, "Bug? primary key '%s' has NULL at rowid=%u",
+						 NameStr(cmeta->attname), curr_id);
+					continue;
+				}
+				if (DatumGetBool(FunctionCall2(&tcache->eq_opr_finfo,
+											   kdatum, cdatum)))
+				{
+					if (visible > 0)
+					{
+						Oid		typoutput;
+						bool	typisvarlena;
+
+						getTypeOutputInfo(cmeta->atttypid,
+										  &typoutput,
+										  &typisvarlena);
+						elog(ERROR,"duplicate primary key violation; %s = %s already exists",
+							 NameStr(cmeta->attname),
+							 OidOutputFunctionCall(typoutput, kdatum));
+					}
+					/*
+					 * NOTE: This row has duplicated value, however, not
+					 * committed yet, thus, this session must be blocked by
+					 * the row-level lock.
+					 */
+					if (curr_locked)
+						curr_locked = gstoreFdwSpinUnlockHashGroup(hgroup);
+					is_locked = gstoreFdwSpinUnlockHashGroup(hhome);
+					ConditionVariableSleep(&gstore_shared_head->row_lock_cond,
+										   PG_WAIT_LOCK);
+					is_locked = gstoreFdwSpinLockHashGroup(hhome);
+					goto wakeup_retry;
 				}
-				/*
-				 * NOTE: This row has duplicated value, however, not committed
-				 * yet, thus, this session must be blocked by the row-level lock.
-				 */
-				is_locked = gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
-				ConditionVariableSleep(&gstore_shared_head->row_lock_cond,
-									   PG_WAIT_LOCK);
-				is_locked = gstoreFdwSpinLockHashSlot(gs_desc, hash);
-				goto wakeup_retry;
 			}
+			overflow = hgroup->overflow;
+			if (curr_locked)
+				curr_locked = gstoreFdwSpinUnlockHashGroup(hgroup);
+			if (overflow == 0)
+				break;
+			hgroup = gstoreFdwHashNextGroup(hash_index, hgroup);
 		}
 		/* Undo Log - Add PK with hash(u32) + rowid(u32) */
 		temp[0] = 'A';
@@ -2810,21 +5768,21 @@ gstoreFdwInsertIntoPrimaryKey(GpuStoreDesc *gs_desc,
 		gs_undo->nitems++;
 		
 		/* Ok, no primary key violation */
-		rowmap[rowid] = hash_index->slots[k];
-		hash_index->slots[k] = rowid;
+		__gstoreFdwHashIndexAddEntry(hash_index, hash, rowid, true);
 	}
 	PG_CATCH();
 	{
+		if (curr_locked)
+			gstoreFdwSpinUnlockHashGroup(hgroup);
 		if (is_locked)
-			gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
+			gstoreFdwSpinUnlockHashGroup(hhome);
 		ConditionVariableCancelSleep();
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
 	Assert(is_locked);
-	gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
+	gstoreFdwSpinUnlockHashGroup(hhome);
 	ConditionVariableCancelSleep();
-//	elog(INFO, "Insert PK of rowid=%u, hash=%08lx", rowid, hash);
 }
 
 static void
@@ -2836,6 +5794,8 @@ gstoreFdwRemoveFromPrimaryKey(GpuStoreDesc    *gs_desc,
 	kern_data_store	*kds = &gs_desc->base_mmap->schema;
 	kern_colmeta   *cmeta = &kds->colmeta[gs_sstate->primary_key - 1];
 	TypeCacheEntry *tcache;
+	GpuStoreHashGroup *hhome;
+	GpuStoreHashGroup *hgroup;
 	Datum			datum;
 	Datum			hash;
 	bool			isnull;
@@ -2858,54 +5818,449 @@ gstoreFdwRemoveFromPrimaryKey(GpuStoreDesc    *gs_desc,
 	hash = FunctionCall1(&tcache->hash_proc_finfo, datum);
 
 	enlargeStringInfo(&gs_undo->buf, sizeof(char) + 2*sizeof(cl_uint));
-	gstoreFdwSpinLockHashSlot(gs_desc, hash);
+	hhome = gstoreFdwHashHomeGroup(hash_index, hash);
+	gstoreFdwSpinLockHashGroup(hhome);
 	/*
 	 * Ensure rowid exists on the hash-index.
 	 */
 	{
-		cl_uint	   *rowmap = &hash_index->slots[hash_index->nslots];
-		cl_uint		curr_id;
-		char		temp[10];
-		bool		found = false;
+		uint64		count;
+		cl_uint		overflow;
+		char		temp[10];
+		bool		found = false;
+		int			i;
+
+		hgroup = hhome;
+		for (count=0; !found && count < hash_index->ngroups; count++)
+		{
+			if (hgroup != hhome)
+				gstoreFdwSpinLockHashGroup(hgroup);
+			for (i=0; i < GPUSTORE_HASHINDEX_NBUCKETS; i++)
+			{
+				if (hgroup->rowid[i] == rowid &&
+					hgroup->hash[i] == (cl_uint)hash)
+				{
+					found = true;
+					break;
+				}
+			}
+			overflow = hgroup->overflow;
+			if (hgroup != hhome)
+				gstoreFdwSpinUnlockHashGroup(hgroup);
+			if (overflow == 0)
+				break;
+			hgroup = gstoreFdwHashNextGroup(hash_index, hgroup);
+		}
+
+		if (found)
+		{
+			/* Remove from PK with hash(u32) + rowid(u32) */
+			temp[0] = 'R';
+			*((cl_uint *)(temp + 1)) = hash;
+			*((cl_uint *)(temp + 5)) = rowid;
+			appendBinaryStringInfo(&gs_undo->buf, temp,
+								   sizeof(char) + 2 * sizeof(cl_uint));
+			gs_undo->nitems++;
+		}
+		else
+		{
+			elog(WARNING, "primary key '%s' for rowid='%u' not found",
+				 NameStr(cmeta->attname), rowid);
+		}
+	}
+	gstoreFdwSpinUnlockHashGroup(hhome);
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Routines for ordered secondary index
+ *
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * gstoreFdwOrderedIndexCmpFunc
+ *
+ * It returns the btree comparison function of the k-th ordered-index.
+ * Because it is cached on the first call, the transaction callbacks can
+ * use the comparison function without catalog access.
+ */
+static FmgrInfo *
+gstoreFdwOrderedIndexCmpFunc(GpuStoreDesc *gs_desc, int k)
+{
+	if (!gs_desc->ordered_index_cmp[k])
+	{
+		GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+		kern_data_store *kds = &gs_desc->base_mmap->schema;
+		kern_colmeta   *cmeta = &kds->colmeta[gs_sstate->ordered_index[k] - 1];
+		TypeCacheEntry *tcache;
+
+		tcache = lookup_type_cache(cmeta->atttypid,
+								   TYPECACHE_CMP_PROC_FINFO);
+		if (!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+			elog(ERROR, "type %s has no btree comparison function",
+				 format_type_be(cmeta->atttypid));
+		gs_desc->ordered_index_cmp[k] = &tcache->cmp_proc_finfo;
+	}
+	return gs_desc->ordered_index_cmp[k];
+}
+
+/*
+ * __gstoreFdwOrderedIndexCompare - comparator for qsort_arg
+ */
+static int
+__gstoreFdwOrderedIndexCompare(const void *__a, const void *__b, void *arg)
+{
+	const GpuStoreOrderedIndexItem *a = __a;
+	const GpuStoreOrderedIndexItem *b = __b;
+	FmgrInfo   *cmp_finfo = arg;
+	int			cmp;
+
+	cmp = DatumGetInt32(FunctionCall2(cmp_finfo,
+									  (Datum)a->key,
+									  (Datum)b->key));
+	if (cmp != 0)
+		return cmp;
+	if (a->rowid < b->rowid)
+		return -1;
+	if (a->rowid > b->rowid)
+		return 1;
+	return 0;
+}
+
+/*
+ * __gstoreFdwOrderedIndexLowerBound
+ *
+ * It returns the first position in the sorted array whose key is equal to
+ * or larger than (if inclusive), or larger than (if exclusive) the 'key'.
+ */
+static uint64
+__gstoreFdwOrderedIndexLowerBound(GpuStoreOrderedIndexHead *oindex,
+								  FmgrInfo *cmp_finfo,
+								  Datum key, bool inclusive)
+{
+	uint64		head = 0;
+	uint64		tail = oindex->nitems;
+
+	while (head < tail)
+	{
+		uint64	curr = head + (tail - head) / 2;
+		int		cmp;
+
+		cmp = DatumGetInt32(FunctionCall2(cmp_finfo,
+										  (Datum)oindex->items[curr].key,
+										  key));
+		if (cmp < 0 || (cmp == 0 && !inclusive))
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	return head;
+}
+
+/*
+ * __gstoreFdwOrderedIndexMerge
+ *
+ * It sweeps tombstones in the sorted array, then merges the delta area
+ * from the tail. Caller must hold the exclusive lock of the index.
+ */
+static void
+__gstoreFdwOrderedIndexMerge(GpuStoreOrderedIndexHead *oindex,
+							 FmgrInfo *cmp_finfo)
+{
+	GpuStoreOrderedIndexItem *items = oindex->items;
+	GpuStoreOrderedIndexItem *delta = oindex->items + oindex->nrooms;
+	uint64		i, j, k;
+
+	/* sweep the tombstones */
+	if (oindex->ndead > 0)
+	{
+		for (i=0, j=0; i < oindex->nitems; i++)
+		{
+			if (items[i].rowid == UINT_MAX)
+				continue;
+			if (j < i)
+				items[j] = items[i];
+			j++;
+		}
+		oindex->nitems = j;
+		oindex->ndead = 0;
+	}
+	if (oindex->nitems + oindex->delta_nitems > oindex->nrooms)
+		elog(ERROR, "ordered index has no room to merge (nitems=%lu, delta=%lu, nrooms=%lu)",
+			 oindex->nitems, oindex->delta_nitems, oindex->nrooms);
+
+	/* sort the delta area, then merge from the tail */
+	qsort_arg(delta, oindex->delta_nitems,
+			  sizeof(GpuStoreOrderedIndexItem),
+			  __gstoreFdwOrderedIndexCompare, cmp_finfo);
+	i = oindex->nitems;
+	j = oindex->delta_nitems;
+	k = i + j;
+	while (j > 0)
+	{
+		if (i > 0 && __gstoreFdwOrderedIndexCompare(&items[i-1],
+													&delta[j-1],
+													cmp_finfo) > 0)
+			items[--k] = items[--i];
+		else
+			items[--k] = delta[--j];
+	}
+	oindex->nitems += oindex->delta_nitems;
+	oindex->delta_nitems = 0;
+}
+
+/*
+ * __gstoreFdwOrderedIndexAddEntry
+ *
+ * Caller must hold the exclusive lock of the index.
+ */
+static void
+__gstoreFdwOrderedIndexAddEntry(GpuStoreOrderedIndexHead *oindex,
+								FmgrInfo *cmp_finfo,
+								Datum key, cl_uint rowid)
+{
+	GpuStoreOrderedIndexItem *item;
+
+	if (oindex->delta_nitems >= oindex->delta_nrooms)
+		__gstoreFdwOrderedIndexMerge(oindex, cmp_finfo);
+	Assert(oindex->delta_nitems < oindex->delta_nrooms);
+	item = &oindex->items[oindex->nrooms + oindex->delta_nitems];
+	item->key = key;
+	item->rowid = rowid;
+	item->__padding__ = 0;
+	oindex->delta_nitems++;
+}
+
+/*
+ * __gstoreFdwOrderedIndexRemoveEntry
+ *
+ * Caller must hold the exclusive lock of the index.
+ */
+static bool
+__gstoreFdwOrderedIndexRemoveEntry(GpuStoreOrderedIndexHead *oindex,
+								   FmgrInfo *cmp_finfo,
+								   Datum key, cl_uint rowid)
+{
+	GpuStoreOrderedIndexItem *delta = oindex->items + oindex->nrooms;
+	uint64		i;
+
+	/* delta area; the last entry fills up the hole */
+	for (i=0; i < oindex->delta_nitems; i++)
+	{
+		if (delta[i].rowid == rowid && delta[i].key == key)
+		{
+			delta[i] = delta[--oindex->delta_nitems];
+			return true;
+		}
+	}
+	/* sorted array; mark it as tombstone */
+	for (i = __gstoreFdwOrderedIndexLowerBound(oindex, cmp_finfo, key, true);
+		 i < oindex->nitems;
+		 i++)
+	{
+		GpuStoreOrderedIndexItem *item = &oindex->items[i];
+
+		if (DatumGetInt32(FunctionCall2(cmp_finfo,
+										(Datum)item->key, key)) != 0)
+			break;
+		if (item->rowid == rowid && item->key == key)
+		{
+			item->rowid = UINT_MAX;
+			oindex->ndead++;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * __gstoreFdwAppendOrderedIndexUndoLog
+ *
+ * Undo Log - tag + rowid(u32) + index(u32) + key(u64)
+ */
+static inline void
+__gstoreFdwAppendOrderedIndexUndoLog(GpuStoreUndoLogs *gs_undo, char tag,
+									 cl_uint rowid, int k, Datum key)
+{
+	char		temp[20];
+
+	temp[0] = tag;
+	*((cl_uint *)(temp + 1)) = rowid;
+	*((cl_uint *)(temp + 5)) = k;
+	*((cl_ulong *)(temp + 9)) = key;
+	appendBinaryStringInfo(&gs_undo->buf, temp,
+						   sizeof(char) + 2 * sizeof(cl_uint) + sizeof(cl_ulong));
+	gs_undo->nitems++;
+}
+
+static void
+gstoreFdwInsertIntoOrderedIndexes(GpuStoreDesc *gs_desc,
+								  GpuStoreUndoLogs *gs_undo, cl_uint rowid)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	int			k;
+
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		GpuStoreOrderedIndexHead *oindex = gs_desc->ordered_index[k];
+		kern_colmeta   *cmeta = &kds->colmeta[gs_sstate->ordered_index[k] - 1];
+		FmgrInfo	   *cmp_finfo = gstoreFdwOrderedIndexCmpFunc(gs_desc, k);
+		Datum			key;
+		bool			isnull;
+
+		Assert(oindex != NULL);
+		if (rowid >= kds->nrooms)
+			elog(ERROR, "Bug? rowid=%u is larger than nrooms=%u",
+				 rowid, kds->nrooms);
+		key = KDS_fetch_datum_column(kds, cmeta, rowid, &isnull);
+		if (isnull)
+			continue;		/* NULL is not indexed */
+		/* Undo Log must not fail after the index update */
+		enlargeStringInfo(&gs_undo->buf, sizeof(char) +
+						  2 * sizeof(cl_uint) + sizeof(cl_ulong));
+		LWLockAcquire(&gs_sstate->ordered_index_lock[k], LW_EXCLUSIVE);
+		__gstoreFdwOrderedIndexAddEntry(oindex, cmp_finfo, key, rowid);
+		LWLockRelease(&gs_sstate->ordered_index_lock[k]);
+		/* Undo Log - Add ordered-index entry */
+		__gstoreFdwAppendOrderedIndexUndoLog(gs_undo, 'a', rowid, k, key);
+	}
+}
+
+static void
+gstoreFdwRemoveFromOrderedIndexes(GpuStoreDesc *gs_desc,
+								  GpuStoreUndoLogs *gs_undo, cl_uint rowid)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	int			k;
+
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		kern_colmeta   *cmeta = &kds->colmeta[gs_sstate->ordered_index[k] - 1];
+		Datum			key;
+		bool			isnull;
 
-		for (curr_id = hash_index->slots[hash % hash_index->nslots];
-			 curr_id < hash_index->nrooms;
-			 curr_id = rowmap[curr_id])
-		{
-			if (curr_id == rowid)
-			{
-				found = true;
+		if (rowid >= kds->nrooms)
+			elog(ERROR, "Bug? rowid=%u is larger than nrooms=%u",
+				 rowid, kds->nrooms);
+		key = KDS_fetch_datum_column(kds, cmeta, rowid, &isnull);
+		if (isnull)
+			continue;		/* NULL is not indexed */
+		/* ensure the comparison function is cached for the xact callback */
+		gstoreFdwOrderedIndexCmpFunc(gs_desc, k);
+		/*
+		 * Undo Log - Remove ordered-index entry; it shall be removed on
+		 * commit, because the older version is still visible to others.
+		 */
+		__gstoreFdwAppendOrderedIndexUndoLog(gs_undo, 'r', rowid, k, key);
+	}
+}
+
+/*
+ * gstoreFdwOrderedIndexLookup
+ *
+ * It appends the rowids whose key is in the range onto the buffer, in
+ * ascending order without duplication. NULL of 'lower' or 'upper' means
+ * no boundary.
+ */
+static void
+gstoreFdwOrderedIndexLookup(GpuStoreDesc *gs_desc, int k,
+							Datum *lower, bool lower_incl,
+							Datum *upper, bool upper_incl,
+							cl_uint **p_rowids,
+							cl_uint *p_nrooms,
+							cl_uint *p_nrowids)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	GpuStoreOrderedIndexHead *oindex = gs_desc->ordered_index[k];
+	GpuStoreOrderedIndexItem *delta;
+	FmgrInfo   *cmp_finfo = gstoreFdwOrderedIndexCmpFunc(gs_desc, k);
+	cl_uint		nbase = *p_nrowids;
+	cl_uint	   *rowids;
+	cl_uint		nrowids;
+	uint64		i;
+	int			cmp;
+
+	LWLockAcquire(&gs_sstate->ordered_index_lock[k], LW_SHARED);
+	/* walk on the sorted array from the lower bound */
+	i = (lower ? __gstoreFdwOrderedIndexLowerBound(oindex, cmp_finfo,
+												   *lower, lower_incl) : 0);
+	for (; i < oindex->nitems; i++)
+	{
+		GpuStoreOrderedIndexItem *item = &oindex->items[i];
+
+		if (upper)
+		{
+			cmp = DatumGetInt32(FunctionCall2(cmp_finfo,
+											  (Datum)item->key, *upper));
+			if (cmp > 0 || (cmp == 0 && !upper_incl))
 				break;
-			}
 		}
+		if (item->rowid == UINT_MAX)
+			continue;	/* tombstone */
+		__gstoreFdwAppendIndexRowId(p_rowids, p_nrooms, p_nrowids,
+									item->rowid);
+	}
+	/* walk on the delta area */
+	delta = oindex->items + oindex->nrooms;
+	for (i=0; i < oindex->delta_nitems; i++)
+	{
+		GpuStoreOrderedIndexItem *item = &delta[i];
 
-		if (found)
+		if (lower)
 		{
-			/* Remove from PK with hash(u32) + rowid(u32) */
-			temp[0] = 'R';
-			*((cl_uint *)(temp + 1)) = hash;
-			*((cl_uint *)(temp + 5)) = rowid;
-			appendBinaryStringInfo(&gs_undo->buf, temp,
-								   sizeof(char) + 2 * sizeof(cl_uint));
-			gs_undo->nitems++;
+			cmp = DatumGetInt32(FunctionCall2(cmp_finfo,
+											  (Datum)item->key, *lower));
+			if (cmp < 0 || (cmp == 0 && !lower_incl))
+				continue;
 		}
-		else
+		if (upper)
 		{
-			elog(WARNING, "primary key '%s' for rowid='%u' not found",
-				 NameStr(cmeta->attname), rowid);
+			cmp = DatumGetInt32(FunctionCall2(cmp_finfo,
+											  (Datum)item->key, *upper));
+			if (cmp > 0 || (cmp == 0 && !upper_incl))
+				continue;
+		}
+		__gstoreFdwAppendIndexRowId(p_rowids, p_nrooms, p_nrowids,
+									item->rowid);
+	}
+	LWLockRelease(&gs_sstate->ordered_index_lock[k]);
+
+	/*
+	 * rowid order is friendly to the columnar layout; also, it removes
+	 * duplicated rowids that may appear if rowid is reused prior to the
+	 * removal of the older entry.
+	 */
+	rowids = *p_rowids + nbase;
+	nrowids = *p_nrowids - nbase;
+	if (nrowids > 1)
+	{
+		cl_uint		j = 0;
+
+		qsort(rowids, nrowids, sizeof(cl_uint), __gstoreFdwCompareRowId);
+		for (i=1; i < nrowids; i++)
+		{
+			if (rowids[i] != rowids[j])
+				rowids[++j] = rowids[i];
 		}
+		*p_nrowids = nbase + j + 1;
 	}
-	gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
-//	elog(INFO, "Remove PK of rowid=%u, hash=%08lx", rowid, hash);
 }
 
 /*
  * gstoreFdwCreateBaseFile
+ *
+ * It writes out an empty base file with 'nrooms' capacity. The extra buffer
+ * (if any) is at least 'min_extra_sz' bytes.
  */
 static void
 gstoreFdwCreateBaseFile(Relation frel,
 						GpuStoreSharedState *gs_sstate,
-						File fdesc)
+						File fdesc,
+						size_t nrooms,
+						size_t min_extra_sz)
 {
 	TupleDesc	__tupdesc = gstoreFdwDeviceTupleDesc(frel);
 	GpuStoreBaseFileHead *hbuf;
@@ -2915,12 +6270,14 @@ gstoreFdwCreateBaseFile(Relation frel,
 	size_t		hbuf_sz, main_sz, sz;
 	size_t		rowmap_sz = 0;
 	size_t		hash_sz = 0;
+	size_t		oindex_sz = 0;
 	size_t		extra_sz = 0;
 	size_t		file_sz;
-	size_t		nrooms = gs_sstate->max_num_rows;
-	size_t		nslots = gs_sstate->num_hash_slots;
-	int			j, unitsz;
+	size_t		ngroups = 0;
+	int			j, k, unitsz;
 
+	if (gs_sstate->primary_key >= 0)
+		ngroups = gstoreFdwHashIndexNumGroups(nrooms);
 	/*
 	 * Setup GpuStoreBaseFileHead
 	 */
@@ -2988,14 +6345,21 @@ gstoreFdwCreateBaseFile(Relation frel,
 	if (gs_sstate->primary_key >= 0)
 	{
 		hbuf->hash_index_offset = file_sz;
-		hash_sz = offsetof(GpuStoreHashIndexHead, slots[nslots + nrooms]);
+		hash_sz = offsetof(GpuStoreHashIndexHead, groups[ngroups]);
 		file_sz += PAGE_ALIGN(hash_sz);
 	}
+	oindex_sz = gstoreFdwOrderedIndexSize(nrooms);
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		hbuf->ordered_index_offset[k] = file_sz;
+		file_sz += PAGE_ALIGN(oindex_sz);
+	}
 	if (schema->has_varlena)
 	{
 		hbuf->schema.extra_hoffset
 			= file_sz - offsetof(GpuStoreBaseFileHead, schema);
-		file_sz += PAGE_ALIGN(extra_sz);
+		extra_sz = PAGE_ALIGN(Max(extra_sz, min_extra_sz));
+		file_sz += extra_sz;
 	}
 	/* Write out GpuStoreBaseFileHead section */
 	if (__writeFile(rawfd, hbuf, hbuf_sz) != hbuf_sz)
@@ -3011,11 +6375,12 @@ gstoreFdwCreateBaseFile(Relation frel,
 
 		memcpy(rowid_map->signature, GPUSTORE_ROWIDMAP_SIGNATURE, 8);
 		rowid_map->length = rowmap_sz;
-		rowid_map->nrooms = gs_sstate->max_num_rows;
-		rowid_map->first_free_rowid = 0;
-		for (i=0; i < gs_sstate->max_num_rows; i++)
+		rowid_map->nrooms = nrooms;
+		rowid_map->__padding__ = 0;
+		rowid_map->free_head = GPUSTORE_ROWID_FREE_HEAD(0, 0);
+		for (i=0; i < nrooms; i++)
 			rowid_map->rowid_chain[i] = i+1;
-		rowid_map->rowid_chain[gs_sstate->max_num_rows - 1] = UINT_MAX;
+		rowid_map->rowid_chain[nrooms - 1] = UINT_MAX;
 
 		if (lseek(rawfd, hbuf->rowid_map_offset, SEEK_SET) < 0)
 			elog(ERROR, "failed on lseek('%s',%zu): %m",
@@ -3028,32 +6393,53 @@ gstoreFdwCreateBaseFile(Relation frel,
 	if (gs_sstate->primary_key >= 0)
 	{
 		GpuStoreHashIndexHead hindex_buf;
-		uint32		rowid_buf[4096];
+		GpuStoreHashGroup hgroup_buf[256];
 		size_t		nbytes;
 
 		memset(&hindex_buf, 0, sizeof(GpuStoreHashIndexHead));
 		memcpy(hindex_buf.signature, GPUSTORE_HASHINDEX_SIGNATURE, 8);
-		hindex_buf.nrooms = gs_sstate->max_num_rows;
-		hindex_buf.nslots = gs_sstate->num_hash_slots;
+		hindex_buf.nrooms = nrooms;
+		hindex_buf.ngroups = ngroups;
 
 		if (lseek(rawfd, hbuf->hash_index_offset, SEEK_SET) < 0)
 			elog(ERROR, "failed on lseek('%s',%zu): %m",
 				 base_file, hbuf->hash_index_offset);
-		sz = offsetof(GpuStoreHashIndexHead, slots);
+		sz = offsetof(GpuStoreHashIndexHead, groups);
 		if (__writeFile(rawfd, &hindex_buf, sz) != sz)
 			elog(ERROR, "failed on __writeFile('%s'): %m", base_file);
 
-		/* '-1' initialization for all the hash-slots/rowid-array */
-		memset(rowid_buf, -1, sizeof(rowid_buf));
-		nbytes = sizeof(uint32) * (hindex_buf.nrooms + hindex_buf.nslots);
+		/* initialization of all the bucket groups */
+		__gstoreFdwHashIndexInitGroups(hgroup_buf, lengthof(hgroup_buf));
+		nbytes = sizeof(GpuStoreHashGroup) * hindex_buf.ngroups;
 		while (nbytes > 0)
 		{
-			sz = Min(nbytes, sizeof(rowid_buf));
-			if (__writeFile(rawfd, rowid_buf, sz) != sz)
+			sz = Min(nbytes, sizeof(hgroup_buf));
+			if (__writeFile(rawfd, hgroup_buf, sz) != sz)
 				elog(ERROR, "failed on __writeFile('%s'): %m", base_file);
 			nbytes -= sz;
 		}
 	}
+	/*
+	 * Write out GpuStoreOrderedIndexHead sections (if any); items[] are
+	 * already zero-cleared by posix_fallocate().
+	 */
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		GpuStoreOrderedIndexHead oindex_buf;
+
+		memset(&oindex_buf, 0, sizeof(GpuStoreOrderedIndexHead));
+		memcpy(oindex_buf.signature, GPUSTORE_ORDINDEX_SIGNATURE, 8);
+		oindex_buf.delta_nrooms = gstoreFdwOrderedIndexDeltaNRooms(nrooms);
+		oindex_buf.nrooms = nrooms + oindex_buf.delta_nrooms;
+		oindex_buf.attnum = gs_sstate->ordered_index[k];
+
+		if (lseek(rawfd, hbuf->ordered_index_offset[k], SEEK_SET) < 0)
+			elog(ERROR, "failed on lseek('%s',%zu): %m",
+				 base_file, hbuf->ordered_index_offset[k]);
+		sz = offsetof(GpuStoreOrderedIndexHead, items);
+		if (__writeFile(rawfd, &oindex_buf, sz) != sz)
+			elog(ERROR, "failed on __writeFile('%s'): %m", base_file);
+	}
 
 	/* write out kern_data_extra section (if any varlena) */
 	if (schema->has_varlena)
@@ -3087,13 +6473,13 @@ gstoreFdwValidateBaseFile(Relation frel,
 {
 	TupleDesc	__tupdesc = gstoreFdwDeviceTupleDesc(frel);
 	size_t		nrooms = gs_sstate->max_num_rows;
-	size_t		nslots = gs_sstate->num_hash_slots;
+	size_t		ngroups = gs_sstate->num_hash_groups;
 	size_t		mmap_sz;
 	int			mmap_is_pmem;
 	size_t		main_sz, sz;
 	size_t		file_pos;
 	cl_uint		rowid;
-	int			j, unitsz;
+	int			j, k, unitsz;
 	bool		retval = false;
 	GpuStoreBaseFileHead *base_mmap;
 	GpuStoreRowIdMapHead *rowid_map = NULL;
@@ -3128,7 +6514,7 @@ gstoreFdwValidateBaseFile(Relation frel,
 
 		schema = &base_mmap->schema;
 		if (schema->ncols != __tupdesc->natts ||
-			schema->nrooms != nrooms ||
+			schema->nrooms < nrooms ||
 			schema->format != KDS_FORMAT_COLUMN ||
 			schema->tdtypeid != __tupdesc->tdtypeid ||
 			schema->tdtypmod != __tupdesc->tdtypmod)
@@ -3136,6 +6522,19 @@ gstoreFdwValidateBaseFile(Relation frel,
 			elog(ERROR, "Base file '%s' has incompatible schema definition",
 				 gs_sstate->base_file);
 		}
+		/*
+		 * The base file may be larger than 'max_num_rows', if the transaction
+		 * of gstore_fdw_grow() aborted after the switch of base file.
+		 * In this case, we adopt the capacity of the base file.
+		 */
+		if (schema->nrooms > nrooms)
+		{
+			elog(LOG, "Base file '%s' has larger nrooms (%u) than max_num_rows (%zu), so adopted",
+				 gs_sstate->base_file, schema->nrooms, nrooms);
+			nrooms = schema->nrooms;
+			if (gs_sstate->primary_key >= 0)
+				ngroups = gstoreFdwHashIndexNumGroups(nrooms);
+		}
 
 		if (schema->nitems > schema->nrooms)
 		{
@@ -3295,7 +6694,7 @@ gstoreFdwValidateBaseFile(Relation frel,
 				elog(ERROR, "Base file '%s' has no PK Index, but foreign-table '%s' has primary key definition",
 					 gs_sstate->base_file,
 					 RelationGetRelationName(frel));
-			sz = offsetof(GpuStoreHashIndexHead, slots[nslots + nrooms]);
+			sz = offsetof(GpuStoreHashIndexHead, groups[ngroups]);
 			if (base_mmap->hash_index_offset + sz > mmap_sz)
 				elog(ERROR, "Base file '%s' is smaller then the estimation",
 					 gs_sstate->base_file);
@@ -3305,12 +6704,50 @@ gstoreFdwValidateBaseFile(Relation frel,
 				memcmp(hash_index->signature,
 					   GPUSTORE_HASHINDEX_SIGNATURE, 8) != 0 ||
 				hash_index->nrooms != nrooms ||
-				hash_index->nslots != nslots)
+				hash_index->ngroups != ngroups)
 				elog(ERROR, "Base file '%s' has corrupted Hash-index",
 					 gs_sstate->base_file);
 			file_pos += PAGE_ALIGN(sz);
 		}
 
+		/*
+		 * validate GpuStoreOrderedIndexHead sections, if any
+		 */
+		for (k=0; k < GPUSTORE_MAX_ORDERED_INDEXES; k++)
+		{
+			GpuStoreOrderedIndexHead *oindex;
+			uint64		delta_nrooms;
+
+			if (k >= gs_sstate->num_ordered_indexes)
+			{
+				if (base_mmap->ordered_index_offset[k] != 0)
+					elog(ERROR, "Base file '%s' has ordered-index, but foreign-table '%s' has no 'ordered_index' definition",
+						 gs_sstate->base_file, RelationGetRelationName(frel));
+				continue;
+			}
+			if (base_mmap->ordered_index_offset[k] == 0)
+				elog(ERROR, "Base file '%s' has no ordered-index, but foreign-table '%s' has 'ordered_index' definition",
+					 gs_sstate->base_file, RelationGetRelationName(frel));
+			sz = gstoreFdwOrderedIndexSize(nrooms);
+			if (base_mmap->ordered_index_offset[k] + sz > mmap_sz)
+				elog(ERROR, "Base file '%s' is smaller then the estimation",
+					 gs_sstate->base_file);
+			oindex = (GpuStoreOrderedIndexHead *)
+				((char *)base_mmap + base_mmap->ordered_index_offset[k]);
+			delta_nrooms = gstoreFdwOrderedIndexDeltaNRooms(nrooms);
+			if (base_mmap->ordered_index_offset[k] != file_pos ||
+				memcmp(oindex->signature,
+					   GPUSTORE_ORDINDEX_SIGNATURE, 8) != 0 ||
+				oindex->nrooms != nrooms + delta_nrooms ||
+				oindex->delta_nrooms != delta_nrooms ||
+				oindex->attnum != gs_sstate->ordered_index[k] ||
+				oindex->nitems > oindex->nrooms ||
+				oindex->delta_nitems > oindex->delta_nrooms)
+				elog(ERROR, "Base file '%s' has corrupted ordered-index",
+					 gs_sstate->base_file);
+			file_pos += PAGE_ALIGN(sz);
+		}
+
 		/*
 		 * validate Extra Buffer of varlena, if any
 		 */
@@ -3345,6 +6782,12 @@ gstoreFdwValidateBaseFile(Relation frel,
 				elog(ERROR, "Extra buffer of base file '%s' has larger usage (%lu) than length (%lu)", gs_sstate->base_file, extra->usage, extra->length);
 		}
 		/* Ok, base-file is sanity */
+		if (gs_sstate->max_num_rows != nrooms)
+		{
+			gs_sstate->max_num_rows = nrooms;
+			gs_sstate->num_hash_groups = ngroups;
+			gstoreFdwResetDirtyShift(gs_sstate);
+		}
 		retval = true;
 	}
 	PG_CATCH();
@@ -3363,18 +6806,51 @@ gstoreFdwValidateBaseFile(Relation frel,
 	return retval;
 }
 
+/*
+ * __ApplyRedoStoreDatum
+ *
+ * A variation of KDS_store_datum_column for REDO replay. It may be called by
+ * multiple threads concurrently, so the extra buffer is allocated by atomic
+ * operation, and it returns false instead of elog().
+ */
+static bool
+__ApplyRedoStoreDatum(kern_data_store *kds, kern_colmeta *cmeta,
+					  cl_uint rowid, Datum datum, bool isnull,
+					  bool copy_varlena)
+{
+	if (isnull)
+	{
+		if (cmeta->nullmap_offset == 0)
+			return false;	/* NOT NULL constraint */
+	}
+	else if (cmeta->attlen == -1 && copy_varlena)
+	{
+		kern_data_extra *extra;
+		size_t		sz = VARSIZE_ANY(datum);
+		size_t		off;
+
+		if (kds->extra_hoffset == 0)
+			return false;
+		extra = (kern_data_extra *)((char *)kds + kds->extra_hoffset);
+		off = __atomic_fetch_add(&extra->usage, MAXALIGN(sz), __ATOMIC_SEQ_CST);
+		if (off + sz > extra->length)
+			return false;	/* no space on the extra buffer */
+		memcpy((char *)extra + off, DatumGetPointer(datum), sz);
+		datum = PointerGetDatum((char *)extra + off);
+	}
+	__KDS_store_datum_column(kds, cmeta, rowid, datum, isnull);
+	return true;
+}
+
 /*
  * GSTORE_TX_LOG__INSERT
  */
-static void
-__ApplyRedoLogInsert(Relation frel,
-					 GpuStoreBaseFileHead *base_mmap, size_t base_mmap_sz,
+static bool
+__ApplyRedoLogInsert(TupleDesc tupdesc, kern_data_store *kds,
 					 GstoreTxLogInsert *i_log)
 {
-	TupleDesc		tupdesc = RelationGetDescr(frel);
 	Datum		   *values = alloca(sizeof(Datum) * tupdesc->natts);
 	bool		   *isnull = alloca(sizeof(bool) * tupdesc->natts);
-	kern_data_store *kds = &base_mmap->schema;
 	HeapTupleData	tuple;
 	GstoreFdwSysattr sysattr;
 	int				j;
@@ -3385,39 +6861,435 @@ __ApplyRedoLogInsert(Relation frel,
 	Assert(kds->ncols == tupdesc->natts + 1);	/* + sysattr */
 	for (j=0; j < tupdesc->natts; j++)
 	{
-		KDS_store_datum_column(kds, &kds->colmeta[j],
-							   i_log->rowid,
-							   values[j], isnull[j]);
+		if (!__ApplyRedoStoreDatum(kds, &kds->colmeta[j],
+								   i_log->rowid,
+								   values[j], isnull[j], true))
+			return false;
 	}
 	memset(&sysattr, 0, sizeof(GstoreFdwSysattr));
 	sysattr.xmin = HeapTupleHeaderGetRawXmin(&i_log->htup);
 	sysattr.xmax = HeapTupleHeaderGetRawXmax(&i_log->htup);
 	sysattr.cid  = HeapTupleHeaderGetRawCommandId(&i_log->htup);
-	KDS_store_datum_column(kds, &kds->colmeta[kds->ncols-1],
-						   i_log->rowid,
-						   PointerGetDatum(&sysattr), false);
+	return __ApplyRedoStoreDatum(kds, &kds->colmeta[kds->ncols-1],
+								 i_log->rowid,
+								 PointerGetDatum(&sysattr), false, false);
+}
+
+/*
+ * GSTORE_TX_LOG__UPDATE
+ */
+static bool
+__ApplyRedoLogUpdate(TupleDesc tupdesc, kern_data_store *kds,
+					 GstoreTxLogUpdate *u_log)
+{
+	char		   *pos = GSTORE_TX_LOG_UPDATE_VALUES(u_log);
+	GstoreFdwSysattr sysattr;
+	Datum			datum;
+	bool			isnull;
+	int				j, k = 0;
+
+	Assert(kds->ncols == tupdesc->natts + 1);	/* + sysattr */
+	if (u_log->oldid >= kds->nrooms)
+		return false;
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		kern_colmeta   *cmeta = &kds->colmeta[j];
+		cl_ushort		attr = (k < u_log->nattrs ? u_log->attrs[k] : 0);
+
+		if (k >= u_log->nattrs ||
+			(attr & GSTORE_TX_LOG_UPDATE__COLMASK) != j)
+		{
+			/* unchanged column; shares the older version */
+			datum = KDS_fetch_datum_column(kds, cmeta, u_log->oldid, &isnull);
+			if (!__ApplyRedoStoreDatum(kds, cmeta, u_log->rowid,
+									   datum, isnull, false))
+				return false;
+			continue;
+		}
+		k++;
+		if ((attr & GSTORE_TX_LOG_UPDATE__ISNULL) != 0)
+		{
+			if (!__ApplyRedoStoreDatum(kds, cmeta, u_log->rowid,
+									   0, true, false))
+				return false;
+			continue;
+		}
+		if (cmeta->attlen > 0)
+		{
+			pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+			datum = fetch_att(pos, cmeta->attbyval, cmeta->attlen);
+			pos += cmeta->attlen;
+		}
+		else
+		{
+			Assert(cmeta->attlen == -1);
+			if (!VARATT_NOT_PAD_BYTE(pos))
+				pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+			datum = PointerGetDatum(pos);
+			pos += VARSIZE_ANY(pos);
+		}
+		if (!__ApplyRedoStoreDatum(kds, cmeta, u_log->rowid,
+								   datum, false, true))
+			return false;
+	}
+	memset(&sysattr, 0, sizeof(GstoreFdwSysattr));
+	sysattr.xmin = u_log->xmin;
+	sysattr.xmax = InvalidTransactionId;
+	sysattr.cid  = InvalidCommandId;
+	return __ApplyRedoStoreDatum(kds, &kds->colmeta[kds->ncols-1],
+								 u_log->rowid,
+								 PointerGetDatum(&sysattr), false, false);
 }
 
 /*
  * GSTORE_TX_LOG__DELETE
  */
-static void
-__ApplyRedoLogDelete(Relation frel,
-					 GpuStoreBaseFileHead *base_mmap, size_t base_mmap_sz,
+static bool
+__ApplyRedoLogDelete(TupleDesc tupdesc, kern_data_store *kds,
 					 GstoreTxLogDelete *d_log)
 {
-	kern_data_store *kds = &base_mmap->schema;
 	GstoreFdwSysattr *sysattr;
 	bool			isnull;
 
 	sysattr = (GstoreFdwSysattr *)
 		KDS_fetch_datum_column(kds, &kds->colmeta[kds->ncols-1],
 							   d_log->rowid, &isnull);
-	Assert(!isnull);
+	if (isnull)
+		return false;
 	/* xmax & cid */
 	sysattr->xmin = d_log->xmin;
 	sysattr->xmax = d_log->xmax;
 	sysattr->cid  = InvalidCommandId;
+	return true;
+}
+
+static bool
+__ApplyRedoLog(TupleDesc tupdesc, kern_data_store *kds,
+			   GstoreTxLogCommon *tx_log)
+{
+	switch (tx_log->type)
+	{
+		case GSTORE_TX_LOG__INSERT:
+			return __ApplyRedoLogInsert(tupdesc, kds,
+										(GstoreTxLogInsert *)tx_log);
+		case GSTORE_TX_LOG__DELETE:
+			return __ApplyRedoLogDelete(tupdesc, kds,
+										(GstoreTxLogDelete *)tx_log);
+		case GSTORE_TX_LOG__UPDATE:
+			return __ApplyRedoLogUpdate(tupdesc, kds,
+										(GstoreTxLogUpdate *)tx_log);
+		default:
+			/* skip GSTORE_TX_LOG__COMMIT - to be fixed up later */
+			break;
+	}
+	return true;
+}
+
+/*
+ * __ApplyRedoLogRowId
+ *
+ * It returns rowid to be modified by the REDO log, or UINT_MAX if none.
+ */
+static cl_uint
+__ApplyRedoLogRowId(GstoreTxLogCommon *tx_log)
+{
+	switch (tx_log->type)
+	{
+		case GSTORE_TX_LOG__INSERT:
+			return ((GstoreTxLogInsert *)tx_log)->rowid;
+		case GSTORE_TX_LOG__DELETE:
+			return ((GstoreTxLogDelete *)tx_log)->rowid;
+		case GSTORE_TX_LOG__UPDATE:
+			return ((GstoreTxLogUpdate *)tx_log)->rowid;
+		default:
+			break;
+	}
+	return UINT_MAX;
+}
+
+/*
+ * GpuStoreRedoReplayState - shared state of the parallel REDO replay
+ *
+ * REDO logs are partitioned by the rowid range, and each worker thread
+ * applies the logs of its partition in the log order. UPDATE logs read
+ * the unchanged columns of the older version (oldid), which may belong to
+ * another partition, so the logs are split into segments by barriers if
+ * the older version is written in the current segment, or is overwritten
+ * after the cross-partition read.
+ */
+typedef struct
+{
+	TupleDesc		tupdesc;
+	kern_data_store *kds;
+	GstoreTxLogCommon **tx_logs;
+	cl_uint			nitems;
+	int				nparts;
+	cl_uint			part_unitsz;	/* number of rowids per partition */
+	cl_uint		  **part_items;		/* log indexes for each partition */
+	cl_uint		   *part_nitems;
+	cl_uint		   *seg_ends;		/* log index of segment boundaries */
+	int				nsegments;
+	/* start-up and synchronization */
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	bool			ready;
+	bool			abort;
+	pthread_barrier_t barrier;
+	/* error status */
+	volatile cl_uint error_index;
+} GpuStoreRedoReplayState;
+
+typedef struct
+{
+	GpuStoreRedoReplayState *rstate;
+	int				part_id;
+} GpuStoreRedoReplayWorker;
+
+static void
+__gstoreFdwRedoReplayPartition(GpuStoreRedoReplayState *rstate, int part_id)
+{
+	cl_uint	   *items = rstate->part_items[part_id];
+	cl_uint		nitems = rstate->part_nitems[part_id];
+	cl_uint		i = 0;
+	int			seg;
+
+	for (seg=0; seg < rstate->nsegments; seg++)
+	{
+		cl_uint		end = rstate->seg_ends[seg];
+
+		for (; i < nitems && items[i] < end; i++)
+		{
+			GstoreTxLogCommon *tx_log = rstate->tx_logs[items[i]];
+
+			if (!__ApplyRedoLog(rstate->tupdesc, rstate->kds, tx_log))
+			{
+				cl_uint		expected = UINT_MAX;
+
+				__atomic_compare_exchange_n(&rstate->error_index,
+											&expected, items[i],
+											false,
+											__ATOMIC_SEQ_CST,
+											__ATOMIC_SEQ_CST);
+			}
+		}
+		pthread_barrier_wait(&rstate->barrier);
+	}
+}
+
+static void *
+__gstoreFdwRedoReplayWorkerMain(void *__arg)
+{
+	GpuStoreRedoReplayWorker *rworker = __arg;
+	GpuStoreRedoReplayState *rstate = rworker->rstate;
+
+	pthread_mutex_lock(&rstate->mutex);
+	while (!rstate->ready && !rstate->abort)
+		pthread_cond_wait(&rstate->cond, &rstate->mutex);
+	pthread_mutex_unlock(&rstate->mutex);
+	if (!rstate->abort)
+		__gstoreFdwRedoReplayPartition(rstate, rworker->part_id);
+	return NULL;
+}
+
+/*
+ * __gstoreFdwRedoReplaySetup
+ *
+ * It partitions the REDO logs, and makes the segment boundaries.
+ */
+static void
+__gstoreFdwRedoReplaySetup(GpuStoreRedoReplayState *rstate)
+{
+	kern_data_store *kds = rstate->kds;
+	size_t		nwords = (kds->nrooms + BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
+	bitmapword *written = palloc0(sizeof(bitmapword) * nwords);
+	bitmapword *cross_read = palloc0(sizeof(bitmapword) * nwords);
+	StringInfoData	dirty;		/* rowids to be cleared at the barrier */
+	cl_uint	   *part_nrooms;
+	cl_uint		i;
+	int			k;
+
+#define __BITMAP_TEST(map,x)	(((map)[(x) / BITS_PER_BITMAPWORD] &	\
+								  ((bitmapword)1 << ((x) % BITS_PER_BITMAPWORD))) != 0)
+#define __BITMAP_SET(map,x)		((map)[(x) / BITS_PER_BITMAPWORD] |=	\
+								 ((bitmapword)1 << ((x) % BITS_PER_BITMAPWORD)))
+
+	initStringInfo(&dirty);
+	rstate->part_unitsz = (kds->nrooms + rstate->nparts - 1) / rstate->nparts;
+	rstate->part_items = palloc0(sizeof(cl_uint *) * rstate->nparts);
+	rstate->part_nitems = palloc0(sizeof(cl_uint) * rstate->nparts);
+	part_nrooms = palloc0(sizeof(cl_uint) * rstate->nparts);
+	rstate->seg_ends = palloc(sizeof(cl_uint) * (rstate->nitems + 1));
+	rstate->nsegments = 0;
+
+	for (i=0; i < rstate->nitems; i++)
+	{
+		GstoreTxLogCommon *tx_log = rstate->tx_logs[i];
+		cl_uint		rowid = __ApplyRedoLogRowId(tx_log);
+		cl_uint		oldid = UINT_MAX;
+		bool		barrier = false;
+		int			part;
+
+		if (rowid == UINT_MAX)
+			continue;
+		if (rowid >= kds->nrooms)
+			elog(ERROR, "gstore_fdw: REDO log has out of range rowid=%u", rowid);
+		part = rowid / rstate->part_unitsz;
+		if (tx_log->type == GSTORE_TX_LOG__UPDATE)
+		{
+			oldid = ((GstoreTxLogUpdate *)tx_log)->oldid;
+			if (oldid >= kds->nrooms)
+				elog(ERROR, "gstore_fdw: UPDATE log has out of range oldid=%u",
+					 oldid);
+			if (oldid / rstate->part_unitsz == part)
+				oldid = UINT_MAX;	/* same partition; log order is kept */
+			else if (__BITMAP_TEST(written, oldid))
+				barrier = true;		/* older version is not written yet */
+		}
+		if (tx_log->type != GSTORE_TX_LOG__DELETE &&
+			__BITMAP_TEST(cross_read, rowid))
+			barrier = true;			/* overwrite of the older version */
+		if (barrier)
+		{
+			cl_uint	   *dirty_ids = (cl_uint *)dirty.data;
+			cl_uint		j, ndirty = dirty.len / sizeof(cl_uint);
+
+			rstate->seg_ends[rstate->nsegments++] = i;
+			for (j=0; j < ndirty; j++)
+			{
+				written[dirty_ids[j] / BITS_PER_BITMAPWORD] = 0;
+				cross_read[dirty_ids[j] / BITS_PER_BITMAPWORD] = 0;
+			}
+			resetStringInfo(&dirty);
+		}
+		if (tx_log->type != GSTORE_TX_LOG__DELETE)
+		{
+			__BITMAP_SET(written, rowid);
+			appendBinaryStringInfo(&dirty, (char *)&rowid, sizeof(cl_uint));
+		}
+		if (oldid != UINT_MAX)
+		{
+			__BITMAP_SET(cross_read, oldid);
+			appendBinaryStringInfo(&dirty, (char *)&oldid, sizeof(cl_uint));
+		}
+		/* add this log to the partition */
+		if (rstate->part_nitems[part] >= part_nrooms[part])
+		{
+			part_nrooms[part] = Max(2 * part_nrooms[part], 1024);
+			if (!rstate->part_items[part])
+				rstate->part_items[part] = palloc_huge(sizeof(cl_uint) *
+													   part_nrooms[part]);
+			else
+				rstate->part_items[part] = repalloc_huge(rstate->part_items[part],
+														 sizeof(cl_uint) * part_nrooms[part]);
+		}
+		rstate->part_items[part][rstate->part_nitems[part]++] = i;
+	}
+	rstate->seg_ends[rstate->nsegments++] = rstate->nitems;
+	for (k=0; k < rstate->nparts; k++)
+	{
+		if (!rstate->part_items[k])
+			rstate->part_items[k] = palloc(sizeof(cl_uint));
+	}
+#undef __BITMAP_TEST
+#undef __BITMAP_SET
+	pfree(written);
+	pfree(cross_read);
+	pfree(part_nrooms);
+	pfree(dirty.data);
+}
+
+/*
+ * gstoreFdwRedoReplay
+ *
+ * It applies the REDO logs onto the base file, using multiple threads
+ * according to the gstore_fdw.recovery_workers.
+ */
+static void
+gstoreFdwRedoReplay(Relation frel, kern_data_store *kds,
+					GstoreTxLogCommon **tx_logs, cl_uint nitems)
+{
+	GpuStoreRedoReplayState rstate;
+	GpuStoreRedoReplayWorker *rworkers;
+	pthread_t  *threads;
+	int			nthreads = 0;
+	int			nworkers;
+	int			i;
+
+	memset(&rstate, 0, sizeof(GpuStoreRedoReplayState));
+	rstate.tupdesc = RelationGetDescr(frel);
+	rstate.kds = kds;
+	rstate.tx_logs = tx_logs;
+	rstate.nitems = nitems;
+	rstate.error_index = UINT_MAX;
+
+	nworkers = gstore_fdw_recovery_workers;
+	if (nitems < 10000)
+		nworkers = 1;		/* not worth to launch threads */
+	threads = palloc0(sizeof(pthread_t) * nworkers);
+	rworkers = palloc0(sizeof(GpuStoreRedoReplayWorker) * nworkers);
+	pthread_mutex_init(&rstate.mutex, NULL);
+	pthread_cond_init(&rstate.cond, NULL);
+
+	/* launch worker threads; the current thread works as part_id = 0 */
+	for (i=1; i < nworkers; i++)
+	{
+		rworkers[nthreads].rstate = &rstate;
+		rworkers[nthreads].part_id = nthreads + 1;
+		if ((errno = pthread_create(&threads[nthreads], NULL,
+									__gstoreFdwRedoReplayWorkerMain,
+									&rworkers[nthreads])) != 0)
+		{
+			elog(LOG, "failed on pthread_create: %m, REDO replay continues with %d workers", nthreads + 1);
+			break;
+		}
+		nthreads++;
+	}
+	rstate.nparts = nthreads + 1;
+
+	PG_TRY();
+	{
+		__gstoreFdwRedoReplaySetup(&rstate);
+	}
+	PG_CATCH();
+	{
+		pthread_mutex_lock(&rstate.mutex);
+		rstate.abort = true;
+		pthread_cond_broadcast(&rstate.cond);
+		pthread_mutex_unlock(&rstate.mutex);
+		for (i=0; i < nthreads; i++)
+			pthread_join(threads[i], NULL);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	/* Go! */
+	pthread_barrier_init(&rstate.barrier, NULL, rstate.nparts);
+	pthread_mutex_lock(&rstate.mutex);
+	rstate.ready = true;
+	pthread_cond_broadcast(&rstate.cond);
+	pthread_mutex_unlock(&rstate.mutex);
+
+	__gstoreFdwRedoReplayPartition(&rstate, 0);
+	for (i=0; i < nthreads; i++)
+	{
+		if ((errno = pthread_join(threads[i], NULL)) != 0)
+			elog(PANIC, "failed on pthread_join: %m");
+	}
+	pthread_barrier_destroy(&rstate.barrier);
+	pthread_cond_destroy(&rstate.cond);
+	pthread_mutex_destroy(&rstate.mutex);
+
+	if (rstate.error_index != UINT_MAX)
+	{
+		GstoreTxLogCommon *tx_log = tx_logs[rstate.error_index];
+
+		elog(ERROR, "gstore_fdw: failed to apply REDO log (type=%c, rowid=%u) on '%s'",
+			 (char)(tx_log->type & 0xff),
+			 __ApplyRedoLogRowId(tx_log),
+			 RelationGetRelationName(frel));
+	}
+	elog(LOG, "gstore_fdw: %u REDO logs were applied by %d workers in %d segments",
+		 nitems, rstate.nparts, rstate.nsegments);
 }
 
 /*
@@ -3435,8 +7307,9 @@ __rebuildHashIndexEntry(GpuStoreSharedState *gs_sstate,
 	Datum			kdatum;
 	Datum			cdatum;
 	bool			isnull;
-	cl_uint		   *rowmap = &hash_index->slots[hash_index->nslots];
-	cl_uint			curr_id, k;
+	GpuStoreHashGroup *hgroup;
+	uint64			count;
+	int				i;
 
 	Assert(gs_sstate->primary_key > 0 &&
 		   gs_sstate->primary_key <= kds->ncols);
@@ -3453,38 +7326,69 @@ __rebuildHashIndexEntry(GpuStoreSharedState *gs_sstate,
 		elog(ERROR, "primary key '%s' of foreign table '%s' is NULL",
 			 NameStr(cmeta->attname), get_rel_name(kds->table_oid));
 	hash = FunctionCall1(&tcache->hash_proc_finfo, kdatum);
-	k = hash % hash_index->nslots;
-	for (curr_id = hash_index->slots[k];
-		 curr_id < hash_index->nrooms;
-		 curr_id = rowmap[curr_id])
+	hgroup = gstoreFdwHashHomeGroup(hash_index, hash);
+	for (count=0; count < hash_index->ngroups; count++)
 	{
-		cdatum = KDS_fetch_datum_column(kds, cmeta, curr_id, &isnull);
-		if (isnull)
+		for (i=0; i < GPUSTORE_HASHINDEX_NBUCKETS; i++)
 		{
-			elog(WARNING, "Bug? primary key '%s' has NULL at rowid=%u, ignored",
-				 NameStr(cmeta->attname), curr_id);
-			continue;
+			cl_uint		curr_id = hgroup->rowid[i];
+
+			if (curr_id >= hash_index->nrooms ||
+				hgroup->hash[i] != (cl_uint)hash)
+				continue;
+			cdatum = KDS_fetch_datum_column(kds, cmeta, curr_id, &isnull);
+			if (isnull)
+			{
+				elog(WARNING, "Bug? primary key '%s' has NULL at rowid=%u, ignored",
+					 NameStr(cmeta->attname), curr_id);
+				continue;
+			}
+			if (DatumGetBool(FunctionCall2(&tcache->eq_opr_finfo,
+										   kdatum, cdatum)))
+			{
+				Oid		typoutput;
+				bool	typisvarlena;
+
+				getTypeOutputInfo(cmeta->atttypid,
+								  &typoutput,
+								  &typisvarlena);
+				elog(WARNING, "duplicate PK violation; %s = %s already exists, ignored",
+					 NameStr(cmeta->attname),
+					 OidOutputFunctionCall(typoutput, kdatum));
+			}
 		}
-		if (DatumGetBool(FunctionCall2(&tcache->eq_opr_finfo,
-									   kdatum, cdatum)))
-		{
-			Oid		typoutput;
-			bool	typisvarlena;
+		if (hgroup->overflow == 0)
+			break;
+		hgroup = gstoreFdwHashNextGroup(hash_index, hgroup);
+	}
+	__gstoreFdwHashIndexAddEntry(hash_index, hash, rowid, false);
+}
+
+/*
+ * __rebuildOrderedIndexSortMain
+ */
+typedef struct
+{
+	GpuStoreOrderedIndexHead *oindex;
+	FmgrInfo   *cmp_finfo;
+	pthread_t	thread;
+	bool		is_threaded;
+} GpuStoreOrderedIndexSort;
 
-			getTypeOutputInfo(cmeta->atttypid,
-							  &typoutput,
-							  &typisvarlena);
-			elog(WARNING, "duplicate PK violation; %s = %s already exists, ignored",
-				 NameStr(cmeta->attname),
-				 OidOutputFunctionCall(typoutput, kdatum));
-		}
-	}
-	rowmap[rowid] = hash_index->slots[k];
-	hash_index->slots[k] = rowid;
+static void *
+__rebuildOrderedIndexSortMain(void *__priv)
+{
+	GpuStoreOrderedIndexSort *sort = __priv;
+
+	qsort_arg(sort->oindex->items, sort->oindex->nitems,
+			  sizeof(GpuStoreOrderedIndexItem),
+			  __gstoreFdwOrderedIndexCompare,
+			  sort->cmp_finfo);
+	return NULL;
 }
 
 static void
-__rebuildRowIdMapAndHashIndex(Relation frel,
+__rebuildRowIdMapAndIndexes(Relation frel,
 							  GpuStoreSharedState *gs_sstate,
 							  GpuStoreBaseFileHead *base_mmap,
 							  size_t base_mmap_sz)
@@ -3493,10 +7397,14 @@ __rebuildRowIdMapAndHashIndex(Relation frel,
 	kern_colmeta *smeta = &kds->colmeta[kds->ncols - 1];	/* sysattr */
 	GpuStoreRowIdMapHead *rowid_map = NULL;
 	GpuStoreHashIndexHead *hash_index = NULL;
-	size_t		nrooms = gs_sstate->max_num_rows;
-	size_t		nslots = gs_sstate->num_hash_slots;
+	GpuStoreOrderedIndexHead *oindex[GPUSTORE_MAX_ORDERED_INDEXES];
+	kern_colmeta *ometa[GPUSTORE_MAX_ORDERED_INDEXES];
+	size_t		nrooms = kds->nrooms;
 	size_t		rowid_map_sz;
+	GpuStoreOrderedIndexSort sorts[GPUSTORE_MAX_ORDERED_INDEXES];
+	cl_uint		first_free_rowid = UINT_MAX;
 	cl_uint		i, rowid;
+	int			k;
 
 	/* clean-up rowid-map */
 	rowid_map_sz = gstoreFdwRowIdMapSize(kds->nrooms);
@@ -3506,17 +7414,33 @@ __rebuildRowIdMapAndHashIndex(Relation frel,
 	memcpy(rowid_map->signature, GPUSTORE_ROWIDMAP_SIGNATURE, 8);
 	rowid_map->length = rowid_map_sz;
 	rowid_map->nrooms = kds->nrooms;
-	rowid_map->first_free_rowid = UINT_MAX;
 
 	/* clean-up hash-index */
 	if (base_mmap->hash_index_offset != 0)
 	{
+		size_t		ngroups = gstoreFdwHashIndexNumGroups(nrooms);
+
 		hash_index = (GpuStoreHashIndexHead *)
 			((char *)base_mmap + base_mmap->hash_index_offset);
 		memcpy(hash_index->signature, GPUSTORE_HASHINDEX_SIGNATURE, 8);
 		hash_index->nrooms = nrooms;
-		hash_index->nslots = nslots;
-		memset(hash_index->slots, -1, sizeof(cl_uint) * (nslots + nrooms));
+		hash_index->ngroups = ngroups;
+		__gstoreFdwHashIndexInitGroups(hash_index->groups, ngroups);
+	}
+
+	/* clean-up ordered-indexes */
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		oindex[k] = (GpuStoreOrderedIndexHead *)
+			((char *)base_mmap + base_mmap->ordered_index_offset[k]);
+		ometa[k] = &kds->colmeta[gs_sstate->ordered_index[k] - 1];
+		memcpy(oindex[k]->signature, GPUSTORE_ORDINDEX_SIGNATURE, 8);
+		oindex[k]->delta_nrooms = gstoreFdwOrderedIndexDeltaNRooms(nrooms);
+		oindex[k]->nrooms = nrooms + oindex[k]->delta_nrooms;
+		oindex[k]->nitems = 0;
+		oindex[k]->ndead = 0;
+		oindex[k]->delta_nitems = 0;
+		oindex[k]->attnum = gs_sstate->ordered_index[k];
 	}
 
 	for (rowid=0; rowid < kds->nitems; rowid++)
@@ -3540,18 +7464,65 @@ __rebuildRowIdMapAndHashIndex(Relation frel,
 			rowid_map->rowid_chain[rowid] = UINT_MAX;
 			if (hash_index)
 				__rebuildHashIndexEntry(gs_sstate, kds, hash_index, rowid);
+			for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+			{
+				GpuStoreOrderedIndexItem *item;
+				Datum		key;
+
+				key = KDS_fetch_datum_column(kds, ometa[k], rowid, &isnull);
+				if (isnull)
+					continue;
+				item = &oindex[k]->items[oindex[k]->nitems++];
+				item->key = key;
+				item->rowid = rowid;
+				item->__padding__ = 0;
+			}
 		}
 	}
 
+	/*
+	 * sort the ordered-indexes
+	 *
+	 * Indexes on pass-by-value types are sorted by worker threads
+	 * concurrently, because their comparison functions never touch palloc
+	 * or elog. Others are sorted by the main thread.
+	 */
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		TypeCacheEntry *tcache;
+
+		tcache = lookup_type_cache(ometa[k]->atttypid,
+								   TYPECACHE_CMP_PROC_FINFO);
+		sorts[k].oindex = oindex[k];
+		sorts[k].cmp_finfo = &tcache->cmp_proc_finfo;
+		sorts[k].is_threaded = false;
+		if (ometa[k]->attbyval &&
+			pthread_create(&sorts[k].thread, NULL,
+						   __rebuildOrderedIndexSortMain,
+						   &sorts[k]) == 0)
+			sorts[k].is_threaded = true;
+	}
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		if (!sorts[k].is_threaded)
+			__rebuildOrderedIndexSortMain(&sorts[k]);
+	}
+	for (k=0; k < gs_sstate->num_ordered_indexes; k++)
+	{
+		if (sorts[k].is_threaded)
+			pthread_join(sorts[k].thread, NULL);
+	}
+
 	for (i=rowid_map->nrooms; i > 0; i--)
 	{
 		rowid = i - 1;
 
 		if (rowid_map->rowid_chain[rowid] == UINT_MAX)
 			continue;
-		rowid_map->rowid_chain[rowid] = rowid_map->first_free_rowid;
-		rowid_map->first_free_rowid = rowid;
+		rowid_map->rowid_chain[rowid] = first_free_rowid;
+		first_free_rowid = rowid;
 	}
+	rowid_map->free_head = GPUSTORE_ROWID_FREE_HEAD(first_free_rowid, 0);
 }
 
 static void
@@ -3567,8 +7538,9 @@ gstoreFdwApplyRedoHostBuffer(Relation frel, GpuStoreSharedState *gs_sstate,
 
 	PG_TRY();
 	{
-		cl_uint		i, nitems = 0;
-		char	   *pos, *end;
+		cl_uint		nitems = 0;
+		char	   *pos, *end, *start;
+		bool		wrapped = false;
 		uint64		start_pos;
 		StringInfoData buf;
 
@@ -3587,20 +7559,42 @@ gstoreFdwApplyRedoHostBuffer(Relation frel, GpuStoreSharedState *gs_sstate,
 			elog(ERROR, "failed on pmem_map_file('%s'): %m",
 				 gs_sstate->redo_log_file);
 		/*
-		 * Seek to the position where last written
+		 * Seek to the position where last written, from the position
+		 * recorded by the last checkpoint. It may wrap around the REDO
+		 * log buffer once.
+		 * The last log is followed by the terminator, because the area
+		 * beyond still contains the logs of the previous lap. Once wrapped
+		 * around, the scan never goes beyond the start position also.
 		 */
 		initStringInfo(&buf);
 		pos = redo_mmap;
 		end = redo_mmap + gs_sstate->redo_log_limit;
-		while (pos + offsetof(GstoreTxLogCommon, data) <= end)
+		if (base_mmap->redo_replay_pos < gs_sstate->redo_log_limit &&
+			base_mmap->redo_replay_pos == MAXALIGN(base_mmap->redo_replay_pos))
+			pos += base_mmap->redo_replay_pos;
+		start = pos;
+		for (;;)
 		{
 			GstoreTxLogCommon *curr = (GstoreTxLogCommon *)pos;
 
+			if (wrapped && pos >= start)
+				break;
+			if (!wrapped && pos > redo_mmap &&
+				pos + sizeof(cl_uint) <= end &&
+				curr->type == GSTORE_TX_LOG__WRAPAROUND)
+			{
+				pos = redo_mmap;
+				wrapped = true;
+				continue;
+			}
+			if (pos + offsetof(GstoreTxLogCommon, data) > end)
+				break;
 			if (((curr->type == GSTORE_TX_LOG__INSERT) ||
 				 (curr->type == GSTORE_TX_LOG__DELETE) ||
+				 (curr->type == GSTORE_TX_LOG__UPDATE) ||
 				 (curr->type == GSTORE_TX_LOG__COMMIT)) &&
 				curr->length == MAXALIGN(curr->length) &&
-				(char *)curr + curr->length <= end)
+				(char *)curr + curr->length <= (wrapped ? start : end))
 			{
 				enlargeStringInfo(&buf, sizeof(GstoreTxLogCommon *));
 				((GstoreTxLogCommon **)buf.data)[nitems++] = curr;
@@ -3617,38 +7611,35 @@ gstoreFdwApplyRedoHostBuffer(Relation frel, GpuStoreSharedState *gs_sstate,
 				 RelationGetRelationName(frel),
 				 gs_sstate->redo_log_file,
 				 gs_sstate->base_file);
-			for (i=0; i < nitems; i++)
-			{
-				GstoreTxLogCommon *tx_log = ((GstoreTxLogCommon **)buf.data)[i];
-
-				switch (tx_log->type)
-				{
-					case GSTORE_TX_LOG__INSERT:
-						__ApplyRedoLogInsert(frel, base_mmap, base_mmap_sz,
-											 (GstoreTxLogInsert *)tx_log);
-						break;
-					case GSTORE_TX_LOG__DELETE:
-						__ApplyRedoLogDelete(frel, base_mmap, base_mmap_sz,
-											 (GstoreTxLogDelete *)tx_log);
-						break;
-					default:
-						/* skip GSTORE_TX_LOG__COMMIT - to be fixed up later */
-						break;
-				}
-			}
-			/* rebuild row-id map and PK hash-index */
-			__rebuildRowIdMapAndHashIndex(frel, gs_sstate, base_mmap, base_mmap_sz);
+			gstoreFdwRedoReplay(frel, &base_mmap->schema,
+								(GstoreTxLogCommon **)buf.data, nitems);
+			/* rebuild row-id map, PK hash-index and ordered-indexes */
+			__rebuildRowIdMapAndIndexes(frel, gs_sstate, base_mmap, base_mmap_sz);
 			if (base_is_pmem)
 				pmem_persist(base_mmap, base_mmap_sz);
 			else
 				pmem_msync(base_mmap, base_mmap_sz);
+			/* next recovery needs to replay the logs written after here */
+			base_mmap->redo_replay_pos = (pos - (char *)redo_mmap);
+			if (base_is_pmem)
+				pmem_persist(&base_mmap->redo_replay_pos, sizeof(uint64));
+			else
+				pmem_msync(&base_mmap->redo_replay_pos, sizeof(uint64));
 			elog(LOG, "foreign table '%s' recovery done %u logs were applied",
 				RelationGetRelationName(frel), nitems);
 		}
+		/* shared dictionaries of varlena columns */
+		gstoreFdwRebuildDictionaries(gs_sstate, &base_mmap->schema,
+									 (GpuStoreRowIdMapHead *)
+									 ((char *)base_mmap +
+									  base_mmap->rowid_map_offset));
 		start_pos = (pos - (char *)redo_mmap);
 		gs_sstate->redo_write_pos = start_pos;
 		gs_sstate->redo_read_pos  = start_pos;
 		gs_sstate->redo_sync_pos  = start_pos;
+		gs_sstate->redo_checkpoint_pos = start_pos;
+		/* rowid-map is rebuilt, so no rowids are pinned */
+		gs_sstate->unpinned_pos = start_pos;
 		gs_sstate->redo_repl_pos[0] = ULONG_MAX;
 		gs_sstate->redo_repl_pos[1] = ULONG_MAX;
 		gs_sstate->redo_repl_pos[2] = ULONG_MAX;
@@ -3702,7 +7693,8 @@ gstoreFdwCreateSharedState(Relation frel, bool may_create_files)
 			else
 			{
 				base_create = true;
-				gstoreFdwCreateBaseFile(frel, gs_sstate, fdesc);
+				gstoreFdwCreateBaseFile(frel, gs_sstate, fdesc,
+										gs_sstate->max_num_rows, 0);
 				FileClose(fdesc);
 			}
 		}
@@ -3754,6 +7746,7 @@ gstoreFdwRemapBaseFile(GpuStoreDesc *gs_desc, bool abort_on_error)
 {
 	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
 	GpuStoreBaseFileHead   *base_mmap;
+	int			k;
 
 	if (gs_desc->base_mmap != NULL)
 	{
@@ -3770,6 +7763,7 @@ gstoreFdwRemapBaseFile(GpuStoreDesc *gs_desc, bool abort_on_error)
 	{
 		gs_desc->rowid_map = NULL;
 		gs_desc->hash_index = NULL;
+		memset(gs_desc->ordered_index, 0, sizeof(gs_desc->ordered_index));
 		gs_desc->base_mmap_revision = UINT_MAX;
 		elog(abort_on_error ? ERROR : LOG,
 			 "failed on pmem_map_file('%s'): %m",
@@ -3784,6 +7778,14 @@ gstoreFdwRemapBaseFile(GpuStoreDesc *gs_desc, bool abort_on_error)
 	else
 		gs_desc->hash_index = (GpuStoreHashIndexHead *)
 			((char *)base_mmap + base_mmap->hash_index_offset);
+	for (k=0; k < GPUSTORE_MAX_ORDERED_INDEXES; k++)
+	{
+		if (base_mmap->ordered_index_offset[k] == 0)
+			gs_desc->ordered_index[k] = NULL;
+		else
+			gs_desc->ordered_index[k] = (GpuStoreOrderedIndexHead *)
+				((char *)base_mmap + base_mmap->ordered_index_offset[k]);
+	}
 	gs_desc->base_mmap_revision = gs_sstate->base_mmap_revision;
 
 	return true;
@@ -3854,6 +7856,10 @@ gstoreFdwInitGpuStoreDesc(GpuStoreDesc *gs_desc, GpuStoreSharedState *gs_sstate)
 	gs_desc->base_mmap_is_pmem = 0;
 	gs_desc->rowid_map = NULL;
 	gs_desc->hash_index = NULL;
+	memset(gs_desc->ordered_index, 0, sizeof(gs_desc->ordered_index));
+	memset(gs_desc->ordered_index_cmp, 0, sizeof(gs_desc->ordered_index_cmp));
+	gs_desc->rowid_cache_batch = GPUSTORE_ROWID_CACHE_MINSZ;
+	gs_desc->rowid_cache_nitems = 0;
 	/* redo-log file mapping */
 	gs_desc->redo_mmap = NULL;
 	gs_desc->redo_mmap_sz = 0;
@@ -3952,6 +7958,9 @@ __gstoreFdwXactOnPreCommit(GpuStoreDesc *gs_desc, GpuStoreUndoLogs *gs_undo,
 {
 	GstoreTxLogCommit *c_log = alloca(GSTORE_TX_LOG_COMMIT_ALLOCSZ);
 	char		   *pos = gs_undo->buf.data;
+	char		   *bulk_item = NULL;
+	cl_uint			bulk_head = 0;
+	cl_uint			bulk_nitems = 0;
 	cl_uint			count = 1;
 	uint64			written_pos = 0;
 
@@ -3982,12 +7991,51 @@ __gstoreFdwXactOnPreCommit(GpuStoreDesc *gs_desc, GpuStoreUndoLogs *gs_undo,
 				count++;
 				break;
 
+			case 'B':	/* INSERT by bulk-load with rowid(u32) */
+				{
+					cl_uint		rowid = *((uint32 *)(pos + 1));
+
+					/* extends the current range, if consecutive */
+					if (bulk_item &&
+						bulk_head + bulk_nitems == rowid &&
+						bulk_nitems < GSTORE_TX_LOG_COMMIT_BULK_MAXSZ)
+					{
+						bulk_nitems++;
+						memcpy(bulk_item + 5, &bulk_nitems, sizeof(cl_uint));
+					}
+					else if (c_log->length + 9 > GSTORE_TX_LOG_COMMIT_ALLOCSZ)
+					{
+						flush_commit_log = true;
+						break;
+					}
+					else
+					{
+						bulk_item = (char *)c_log + c_log->length;
+						bulk_head = rowid;
+						bulk_nitems = 1;
+						bulk_item[0] = 'B';
+						memcpy(bulk_item + 1, &bulk_head, sizeof(cl_uint));
+						memcpy(bulk_item + 5, &bulk_nitems, sizeof(cl_uint));
+						c_log->length += 9;
+						c_log->nitems++;
+					}
+					pos += 5;
+					count++;
+				}
+				break;
+
 			case 'A':	/* Add PK Index with hash(u32) + rowid(u32) */
 			case 'R':	/* Remove PK Index + hash(u32) + rowid(u32) */
 				/* skip in the pre-commit phase */
 				pos += sizeof(char) + 2 * sizeof(cl_uint);
 				count++;
 				break;
+			case 'a':	/* Add ordered-index with rowid(u32) + index(u32) + key(u64) */
+			case 'r':	/* Remove ordered-index with rowid(u32) + index(u32) + key(u64) */
+				/* skip in the pre-commit phase */
+				pos += sizeof(char) + 2 * sizeof(cl_uint) + sizeof(cl_ulong);
+				count++;
+				break;
 			default:
 				elog(FATAL, "Broken internal Undo log: tag='%c'", *pos);
 				break;
@@ -4006,6 +8054,7 @@ __gstoreFdwXactOnPreCommit(GpuStoreDesc *gs_desc, GpuStoreUndoLogs *gs_undo,
 			/* rewind */
 			c_log->length = offsetof(GstoreTxLogCommit, data);
 			c_log->nitems = 0;
+			bulk_item = NULL;
 		}
 	}
 	Assert(pos <= gs_undo->buf.data + gs_undo->buf.len);
@@ -4014,13 +8063,68 @@ __gstoreFdwXactOnPreCommit(GpuStoreDesc *gs_desc, GpuStoreUndoLogs *gs_undo,
 }
 
 /*
- * __gstoreFdwXactSyncRedoLog
+ * __gstoreFdwXactOnPreCommitBulkLoad
+ *
+ * Rows inserted by the bulk-load have no REDO logs, so they must be
+ * persisted by the checkpoint prior to the commit log. It also advances the
+ * REDO position to start replay, thus, the recovery never overwrites these
+ * rows by the older REDO logs at the same rowids.
+ * The device buffer is loaded again once the REDO logs written so far are
+ * applied, then the commit log makes these rows visible on the GPU side.
+ * It also changes redo_revision of the base file, to invalidate the REDO
+ * consumers that follow the base file by REDO logs only.
  */
 static void
-__gstoreFdwXactSyncRedoLog(GpuStoreDesc *gs_desc, uint64 written_pos)
+__gstoreFdwXactOnPreCommitBulkLoad(GpuStoreDesc *gs_desc)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	GpuStoreBaseFileHead *base_mmap;
+	uint64		end_pos;
+	CUresult	rc;
+
+	rc = gstoreFdwInvokeCheckpoint(gs_desc->ftable_oid, false);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "gstore_fdw: failed on checkpoint of '%s' after bulk-load: %s",
+			 gs_sstate->base_file, errorText(rc));
+
+	/*
+	 * The replica and the REDO catch-up of base backup never see these rows,
+	 * so the REDO revision is changed prior to the commit log; they refuse
+	 * to apply the REDO logs since then, rather than lose the rows silently.
+	 */
+	LWLockAcquire(&gs_sstate->base_mmap_lock, LW_EXCLUSIVE);
+	if (gs_desc->base_mmap_revision != gs_sstate->base_mmap_revision)
+		gstoreFdwRemapBaseFile(gs_desc, true);
+	base_mmap = gs_desc->base_mmap;
+	base_mmap->redo_revision++;
+	if (!__gstoreFdwPersistBaseRange(gs_desc, &base_mmap->redo_revision,
+									 sizeof(uint64)))
+		elog(ERROR, "gstore_fdw: failed to persist the REDO revision of '%s'",
+			 gs_sstate->base_file);
+	LWLockRelease(&gs_sstate->base_mmap_lock);
+
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	end_pos = gs_sstate->redo_write_pos;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+	rc = gstoreFdwInvokeApplyRedo(gs_desc->ftable_oid, false, end_pos);
+	if (rc == CUDA_SUCCESS)
+		rc = gstoreFdwInvokeReload(gs_desc->ftable_oid, false);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "gstore_fdw: failed on reload of the device buffer after bulk-load: %s",
+			 errorText(rc));
+}
+
+/*
+ * __gstoreFdwPersistRedoLog
+ *
+ * It persists the range of REDO log buffer between sync_pos and written_pos,
+ * and the terminator at the written_pos.
+ */
+static void
+__gstoreFdwPersistRedoLog(GpuStoreDesc *gs_desc,
+						  uint64 sync_pos, uint64 written_pos)
 {
 	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
-	uint64		sync_pos = gs_sstate->redo_sync_pos;
 	uint64		__sync_pos = sync_pos % gs_sstate->redo_log_limit;
 	uint64		__written_pos = written_pos % gs_sstate->redo_log_limit;
 
@@ -4040,7 +8144,7 @@ __gstoreFdwXactSyncRedoLog(GpuStoreDesc *gs_desc, uint64 written_pos)
 	else if (__written_pos > __sync_pos)
 	{
 		char   *ptr = gs_desc->redo_mmap + __sync_pos;
-		size_t	sz = __written_pos - __sync_pos;
+		size_t	sz = __written_pos - __sync_pos + sizeof(cl_uint);
 
 		if (gs_desc->redo_mmap_is_pmem)
 			pmem_persist(ptr, sz);
@@ -4056,19 +8160,107 @@ __gstoreFdwXactSyncRedoLog(GpuStoreDesc *gs_desc, uint64 written_pos)
 		if (gs_desc->redo_mmap_is_pmem)
 		{
 			pmem_persist(ptr, sz);
-			pmem_persist(gs_desc->redo_mmap, __written_pos);
+			pmem_persist(gs_desc->redo_mmap, __written_pos + sizeof(cl_uint));
 		}
 		else
 		{
 			if (pmem_msync(ptr, sz) != 0)
 				elog(WARNING, "failed on pmem_msync('%s'): %m",
 					 gs_sstate->redo_log_file);
-			if (pmem_msync(gs_desc->redo_mmap, __written_pos) != 0)
+			if (pmem_msync(gs_desc->redo_mmap, __written_pos + sizeof(cl_uint)) != 0)
 				elog(WARNING, "failed on pmem_msync('%s'): %m",
 					 gs_sstate->redo_log_file);
 		}
 	}
-	atomicMax64(&gs_sstate->redo_sync_pos, written_pos);
+}
+
+/*
+ * __gstoreFdwXactSyncRedoLog
+ *
+ * It ensures the REDO log up to the written_pos is persistent, using
+ * leader/follower group commit. The first committer becomes the leader,
+ * then persists all the REDO log written by the concurrent committers
+ * at once. Other committers sleep on the redo_sync_cond until the leader
+ * makes their commit logs persistent, or take the leader role when nobody
+ * is running.
+ */
+static void
+__gstoreFdwXactSyncRedoLog(GpuStoreDesc *gs_desc, uint64 written_pos)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	uint64		sync_pos;
+	uint64		end_pos;
+	uint32		group_sz;
+
+	if (written_pos <= gs_sstate->redo_sync_pos)
+		return;
+
+	ConditionVariablePrepareToSleep(&gs_sstate->redo_sync_cond);
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	gs_sstate->redo_sync_nrequests++;
+	while (gs_sstate->redo_sync_in_progress)
+	{
+		if (written_pos <= gs_sstate->redo_sync_pos)
+			break;
+		/* follower waits for the leader */
+		SpinLockRelease(&gs_sstate->redo_pos_lock);
+		ConditionVariableSleep(&gs_sstate->redo_sync_cond,
+							   PG_WAIT_EXTENSION);
+		SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	}
+	if (written_pos <= gs_sstate->redo_sync_pos)
+	{
+		/* concurrent leader already persisted our commit log */
+		SpinLockRelease(&gs_sstate->redo_pos_lock);
+		ConditionVariableCancelSleep();
+		return;
+	}
+	/* Ok, this backend becomes the leader */
+	gs_sstate->redo_sync_in_progress = true;
+	group_sz = gs_sstate->redo_sync_last_group;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+	ConditionVariableCancelSleep();
+
+	PG_TRY();
+	{
+		/*
+		 * If the last group contained multiple committers, it is likely
+		 * the concurrent sessions are going to commit; so, leader waits
+		 * for a moment to collect more commit logs.
+		 */
+		if (gstore_fdw_commit_delay > 0 && group_sz > 1)
+			pg_usleep(gstore_fdw_commit_delay);
+
+		SpinLockAcquire(&gs_sstate->redo_pos_lock);
+		sync_pos = gs_sstate->redo_sync_pos;
+		end_pos = gs_sstate->redo_write_pos;
+		group_sz = (gs_sstate->redo_sync_nrequests -
+					gs_sstate->redo_sync_grouped);
+		gs_sstate->redo_sync_grouped = gs_sstate->redo_sync_nrequests;
+		SpinLockRelease(&gs_sstate->redo_pos_lock);
+
+		__gstoreFdwPersistRedoLog(gs_desc, sync_pos, end_pos);
+	}
+	PG_CATCH();
+	{
+		SpinLockAcquire(&gs_sstate->redo_pos_lock);
+		gs_sstate->redo_sync_in_progress = false;
+		SpinLockRelease(&gs_sstate->redo_pos_lock);
+		ConditionVariableBroadcast(&gs_sstate->redo_sync_cond);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	atomicMax64(&gs_sstate->redo_sync_pos, end_pos);
+	gs_sstate->redo_sync_in_progress = false;
+	gs_sstate->redo_sync_last_group = group_sz;
+	gs_sstate->redo_sync_ngroups++;
+	if (gs_sstate->redo_sync_max_group < group_sz)
+		gs_sstate->redo_sync_max_group = group_sz;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+	/* wake up the followers */
+	ConditionVariableBroadcast(&gs_sstate->redo_sync_cond);
 }
 
 /*
@@ -4080,6 +8272,9 @@ __gstoreFdwXactFinalize(GpuStoreDesc *gs_desc,
 {
 	GpuStoreHashIndexHead *hash_index = gs_desc->hash_index;
 	char	   *pos = gs_undo->buf.data;
+	cl_uint	   *pinned = (cl_uint *)gs_undo->pinned.data;
+	cl_uint		npinned = gs_undo->pinned.len / sizeof(cl_uint);
+	cl_uint		ipinned = 0;
     cl_uint		count;
 	
 	for (count=0; count < gs_undo->nitems; count++)
@@ -4089,6 +8284,7 @@ __gstoreFdwXactFinalize(GpuStoreDesc *gs_desc,
 		switch (*pos)
 		{
 			case 'I':	/* INSERT */
+			case 'B':	/* INSERT by bulk-load */
 				if (!normal_commit)
 				{
 					rowid = *((uint32 *)(pos + 1));
@@ -4098,36 +8294,27 @@ __gstoreFdwXactFinalize(GpuStoreDesc *gs_desc,
 				pos += sizeof(char) + sizeof(uint32);
 				break;
 			case 'D':	/* DELETE */
-				if (normal_commit)
-				{
-					rowid = *((uint32 *)(pos + 1));
+				rowid = *((uint32 *)(pos + 1));
+				/* 'pinned' is a subset of 'D' in the same order */
+				if (ipinned < npinned && pinned[ipinned] == rowid)
+					ipinned++;
+				else if (normal_commit)
 					gstoreFdwReleaseRowId(gs_desc->gs_sstate,
 										  gs_desc->rowid_map, rowid);
-				}
 				pos += sizeof(char) + sizeof(uint32);
 				break;
 			case 'A':	/* Add PK */
 				if (!normal_commit)
 				{
 					/* remove rowid from the index on abort  */
-					uint32	   *rowmap = &hash_index->slots[hash_index->nslots];
 					uint32		hash  = *((uint32 *)(pos + 1));
 					uint32		rowid = *((uint32 *)(pos + 5));
-					uint32	   *next;
+					GpuStoreHashGroup *hhome
+						= gstoreFdwHashHomeGroup(hash_index, hash);
 
-					gstoreFdwSpinLockHashSlot(gs_desc, hash);
-                    next = &hash_index->slots[hash % hash_index->nslots];
-					while (*next < hash_index->nrooms)
-					{
-						if (*next == rowid)
-						{
-							*next = rowmap[rowid];
-							rowmap[rowid] = UINT_MAX;
-							break;
-						}
-						next = rowmap + *next;
-					}
-					gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
+					gstoreFdwSpinLockHashGroup(hhome);
+					__gstoreFdwHashIndexRemoveEntry(hash_index, hash, rowid, true);
+					gstoreFdwSpinUnlockHashGroup(hhome);
 				}
 				pos += sizeof(char) + 2 * sizeof(uint32);
 				break;
@@ -4136,32 +8323,52 @@ __gstoreFdwXactFinalize(GpuStoreDesc *gs_desc,
 				if (normal_commit)
 				{
 					/* remove rowid from the index on commit */
-					uint32	   *rowmap = &hash_index->slots[hash_index->nslots];
 					uint32		hash  = *((uint32 *)(pos + 1));
 					uint32		rowid = *((uint32 *)(pos + 5));
-					uint32	   *next;
+					GpuStoreHashGroup *hhome
+						= gstoreFdwHashHomeGroup(hash_index, hash);
 
-					gstoreFdwSpinLockHashSlot(gs_desc, hash);
-					next = &hash_index->slots[hash % hash_index->nslots];
-					while (*next < hash_index->nrooms)
-					{
-						if (*next == rowid)
-						{
-							*next = rowmap[rowid];
-							rowmap[rowid] = UINT_MAX;
-							break;
-						}
-						next = rowmap + *next;
-					}
-					gstoreFdwSpinUnlockHashSlot(gs_desc, hash);
+					gstoreFdwSpinLockHashGroup(hhome);
+					__gstoreFdwHashIndexRemoveEntry(hash_index, hash, rowid, true);
+					gstoreFdwSpinUnlockHashGroup(hhome);
 				}
 				pos += sizeof(char) + 2 * sizeof(uint32);
 				break;
+			case 'a':	/* Add ordered-index */
+			case 'r':	/* Remove ordered-index */
+				/*
+				 * remove the entry from the index on abort of 'a', or
+				 * commit of 'r'.
+				 */
+				if ((*pos == 'a') != normal_commit)
+				{
+					GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+					uint32		rowid = *((uint32 *)(pos + 1));
+					uint32		k     = *((uint32 *)(pos + 5));
+					Datum		key   = *((uint64 *)(pos + 9));
+					bool		found;
+
+					Assert(k < gs_sstate->num_ordered_indexes &&
+						   gs_desc->ordered_index_cmp[k] != NULL);
+					LWLockAcquire(&gs_sstate->ordered_index_lock[k], LW_EXCLUSIVE);
+					found = __gstoreFdwOrderedIndexRemoveEntry(gs_desc->ordered_index[k],
+															   gs_desc->ordered_index_cmp[k],
+															   key, rowid);
+					LWLockRelease(&gs_sstate->ordered_index_lock[k]);
+					if (!found)
+						elog(WARNING, "ordered index entry for rowid=%u not found", rowid);
+				}
+				pos += sizeof(char) + 2 * sizeof(uint32) + sizeof(uint64);
+				break;
 			default:
 				elog(FATAL, "wrong undo log entry tag '%c'", *pos);
 		}
 	}
 	Assert(pos <= gs_undo->buf.data + gs_undo->buf.len);
+	Assert(ipinned == npinned);
+	if (normal_commit)
+		gstoreFdwPinRowIds(gs_desc->gs_sstate, gs_desc->rowid_map,
+						   pinned, npinned);
 }
 
 /*
@@ -4240,6 +8447,18 @@ gstoreFdwXactCallback(XactEvent event, void *arg)
 		while ((gs_desc = hash_seq_search(&hseq)) != NULL)
 		{
 			uint64	written_pos = 0;
+			bool	has_bulk_load = false;
+
+			dlist_foreach (iter, &gs_desc->gs_undo_logs)
+			{
+				gs_undo = dlist_container(GpuStoreUndoLogs,
+										  chain, iter.cur);
+				if (gs_undo->curr_xid == curr_xid &&
+					gs_undo->bulk_nitems > 0)
+					has_bulk_load = true;
+			}
+			if (has_bulk_load)
+				__gstoreFdwXactOnPreCommitBulkLoad(gs_desc);
 
 			dlist_foreach (iter, &gs_desc->gs_undo_logs)
 			{
@@ -4271,6 +8490,7 @@ gstoreFdwXactCallback(XactEvent event, void *arg)
 					__gstoreFdwXactFinalize(gs_desc, gs_undo,
 											event == XACT_EVENT_COMMIT);
 					pfree(gs_undo->buf.data);
+					pfree(gs_undo->pinned.data);
 					pfree(gs_undo);
 				}
 			}
@@ -4292,6 +8512,9 @@ gstoreFdwXactCallback(XactEvent event, void *arg)
 					gs_desc->xmax_ftable = InvalidTransactionId;
 			}
 
+			/* return the rowids reserved but not used */
+			gstoreFdwReleaseRowIdCache(gs_desc);
+
 			if (drop_this)
 				__gstoreFdwXactDropResources(gs_desc);
 		}
@@ -4338,6 +8561,7 @@ gstoreFdwSubXactCallback(SubXactEvent event,
 					dlist_delete(&gs_undo->chain);
 					__gstoreFdwXactFinalize(gs_desc, gs_undo, false);
 					pfree(gs_undo->buf.data);
+					pfree(gs_undo->pinned.data);
 					pfree(gs_undo);
 				}
 			}
@@ -4540,6 +8764,7 @@ __gstoreFdwHostBufferCompaction(Relation frel)
 		kern_colmeta   *cmeta = &kds->colmeta[j];
 		bits8		   *nullmap = NULL;
 		cl_uint		   *values;
+		HTAB		   *dict_htab = NULL;
 
 		if (cmeta->attlen != -1)
 			continue;
@@ -4548,10 +8773,25 @@ __gstoreFdwHostBufferCompaction(Relation frel)
 		if (cmeta->nullmap_offset != 0)
 			nullmap = (bits8 *)((char *)kds + __kds_unpack(cmeta->nullmap_offset));
 		values = (cl_uint *)((char *)kds + __kds_unpack(cmeta->values_offset));
+		if (gstoreFdwLookupDictionary(gs_sstate, cmeta->attnum))
+		{
+			HASHCTL		hctl;
+
+			/* rows sharing a value must share the new copy also */
+			memset(&hctl, 0, sizeof(HASHCTL));
+			hctl.keysize = sizeof(cl_uint);
+			hctl.entrysize = 2 * sizeof(cl_uint);
+			hctl.hcxt = CurrentMemoryContext;
+			dict_htab = hash_create("gstore_fdw dictionary compaction",
+									GSTORE_DICTIONARY_MAX_NITEMS, &hctl,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		}
 		for (i=0; i < kds->nitems; i++)
 		{
 			char	   *vl;
 			cl_uint		sz;
+			cl_uint	   *dentry = NULL;
+			bool		found;
 
 			if (!gstoreFdwCheckRowId(gs_desc->gs_sstate,
 									 gs_desc->rowid_map, i) ||
@@ -4560,6 +8800,15 @@ __gstoreFdwHostBufferCompaction(Relation frel)
 				values[i] = 0;
 				continue;
 			}
+			if (dict_htab)
+			{
+				dentry = hash_search(dict_htab, &values[i], HASH_ENTER, &found);
+				if (found)
+				{
+					values[i] = dentry[1];
+					continue;
+				}
+			}
 			vl = (char *)old_extra + __kds_unpack(values[i]);
 			if (vl < old_extra->data || vl >= (char *)old_extra + old_extra->usage)
 				elog(ERROR, "gstore_fdw: varlena datum row=%u column=%u looks corrupted. varlena %p points out of the extra buffer %p-%p",
@@ -4569,8 +8818,12 @@ __gstoreFdwHostBufferCompaction(Relation frel)
 			sz = VARSIZE_ANY(vl);
 			memcpy((char *)new_extra + new_extra->usage, vl, sz);
 			values[i] = __kds_packed(new_extra->usage);
+			if (dentry)
+				dentry[1] = values[i];
 			new_extra->usage += MAXALIGN(sz);
 		}
+		if (dict_htab)
+			hash_destroy(dict_htab);
 	}
 	new_length = Max3(new_extra->usage + (128UL << 20),		/* 128MB margin */
 					  (double)new_extra->usage  * 1.15,		/* 15% margin */
@@ -4612,6 +8865,10 @@ __gstoreFdwHostBufferCompaction(Relation frel)
 		 old_extra->length, new_extra->length);
 	new_extra->length = new_length;
 	memcpy(old_extra, new_extra, new_extra->usage);
+	/* offsets in the dictionaries are also moved */
+	gstoreFdwRebuildDictionaries(gs_sstate, kds, gs_desc->rowid_map);
+	/* varlena offsets of all the rows are moved */
+	gs_sstate->dirty_full = true;
 
 	/* refresh base-file mapping */
 	do {
@@ -4644,6 +8901,227 @@ pgstrom_gstore_fdw_compaction(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_compaction);
 
+/*
+ * __gstoreFdwHostBufferGrow
+ *
+ * It builds a new base file with the larger 'max_num_rows' aside of the
+ * current one, then replaces the current one under the exclusive
+ * base_mmap_lock. The rowid-map, PK hash-index and ordered-indexes are
+ * rebuilt on the new layout, and the extra buffer is copied as is because
+ * varlena offsets are relative to its header.
+ * Other backends remap the new base file by the revision, and the ones
+ * in-progress keep the old mapping until the end of scan.
+ *
+ * note; caller must have ExclusiveLock to block concurrent writers.
+ */
+static void
+__gstoreFdwHostBufferGrow(Relation frel, int64 new_num_rows)
+{
+	GpuStoreDesc   *gs_desc = gstoreFdwLookupGpuStoreDesc(frel);
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	GpuStoreBaseFileHead *old_mmap = gs_desc->base_mmap;
+	GpuStoreBaseFileHead *new_mmap = NULL;
+	kern_data_store *old_kds = &old_mmap->schema;
+	kern_data_store *new_kds;
+	ForeignTable   *ft;
+	List		   *ftoptions = NIL;
+	ListCell	   *lc;
+	size_t			new_mmap_sz;
+	int				new_is_pmem;
+	size_t			min_extra_sz = 0;
+	char		   *temp_file;
+	char		   *dir_name;
+	File			fdesc;
+	uint32			old_revision = gs_sstate->base_mmap_revision;
+	uint32			new_revision;
+	bool			replay_pos_persisted = true;
+	int				j;
+
+	if (new_num_rows <= gs_sstate->max_num_rows)
+		elog(ERROR, "gstore_fdw: new max_num_rows (%ld) must be larger than the current one (%zd)",
+			 new_num_rows, gs_sstate->max_num_rows);
+	if (new_num_rows >= GPUSTORE_ROWID_RESERVED)
+		elog(ERROR, "gstore_fdw: max_num_rows (%ld) is too large",
+			 new_num_rows);
+	if (!dlist_is_empty(&gs_desc->gs_undo_logs))
+		elog(ERROR, "gstore_fdw: cannot grow '%s' modified in the current transaction",
+			 RelationGetRelationName(frel));
+	gstoreFdwReleaseRowIdCache(gs_desc);
+	/*
+	 * The new base file rebuilds the rowid map, and starts replay at the
+	 * current checkpoint position, so the rowids pinned by UPDATE logs
+	 * must be released by the checkpoint beforehand.
+	 */
+	gstoreFdwUnpinRowIdsForce(gs_desc);
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	if (gs_sstate->pinned_head[0] != UINT_MAX ||
+		gs_sstate->pinned_head[1] != UINT_MAX)
+	{
+		SpinLockRelease(&gs_sstate->redo_pos_lock);
+		elog(ERROR, "gstore_fdw: cannot grow '%s' with rowids pinned by UPDATE",
+			 RelationGetRelationName(frel));
+	}
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+
+	/* update pg_foreign_table.ftoptions first; it is transactional */
+	ft = GetForeignTable(RelationGetRelid(frel));
+	foreach (lc, ft->options)
+	{
+		DefElem	   *def = lfirst(lc);
+
+		if (strcmp(def->defname, "max_num_rows") == 0)
+			def = makeDefElem("max_num_rows",
+							  (Node *)makeString(psprintf("%ld", new_num_rows)),
+							  -1);
+		ftoptions = lappend(ftoptions, def);
+	}
+	gstoreFdwUpdateTableOptions(frel, ftoptions);
+
+	/* build a new base file */
+	temp_file = psprintf("%s.grow", gs_sstate->base_file);
+	if (old_kds->has_varlena)
+		min_extra_sz = ((kern_data_extra *)
+						((char *)old_kds + old_kds->extra_hoffset))->length;
+	fdesc = PathNameOpenFile(temp_file, O_RDWR | O_CREAT | O_TRUNC);
+	if (fdesc < 0)
+		elog(ERROR, "failed on open('%s'): %m", temp_file);
+	PG_TRY();
+	{
+		gstoreFdwCreateBaseFile(frel, gs_sstate, fdesc,
+								new_num_rows, min_extra_sz);
+		FileClose(fdesc);
+
+		new_mmap = pmem_map_file(temp_file, 0,
+								 0, 0600,
+								 &new_mmap_sz,
+								 &new_is_pmem);
+		if (!new_mmap)
+			elog(ERROR, "failed on pmem_map_file('%s'): %m", temp_file);
+		new_kds = &new_mmap->schema;
+
+		/* copy the fixed-length arrays of each column */
+		Assert(old_kds->ncols == new_kds->ncols);
+		for (j=0; j < old_kds->ncols; j++)
+		{
+			kern_colmeta   *ocmeta = &old_kds->colmeta[j];
+			kern_colmeta   *ncmeta = &new_kds->colmeta[j];
+
+			if (ocmeta->nullmap_offset != 0)
+				memcpy((char *)new_kds + __kds_unpack(ncmeta->nullmap_offset),
+					   (char *)old_kds + __kds_unpack(ocmeta->nullmap_offset),
+					   __kds_unpack(ocmeta->nullmap_length));
+			memcpy((char *)new_kds + __kds_unpack(ncmeta->values_offset),
+				   (char *)old_kds + __kds_unpack(ocmeta->values_offset),
+				   __kds_unpack(ocmeta->values_length));
+		}
+		new_kds->nitems = old_kds->nitems;
+
+		/* copy the extra buffer as is */
+		if (old_kds->has_varlena)
+		{
+			kern_data_extra *old_extra = (kern_data_extra *)
+				((char *)old_kds + old_kds->extra_hoffset);
+			kern_data_extra *new_extra = (kern_data_extra *)
+				((char *)new_kds + new_kds->extra_hoffset);
+
+			Assert(new_extra->length >= old_extra->usage);
+			memcpy(new_extra->data, old_extra->data,
+				   old_extra->usage - offsetof(kern_data_extra, data));
+			new_extra->usage = old_extra->usage;
+		}
+		/* rebuild row-id map, PK hash-index and ordered-indexes */
+		__rebuildRowIdMapAndIndexes(frel, gs_sstate, new_mmap, new_mmap_sz);
+
+		/* redo_replay_pos shall be set at the switch point */
+		if (new_is_pmem)
+			pmem_persist(new_mmap, new_mmap_sz);
+		else if (pmem_msync(new_mmap, new_mmap_sz) != 0)
+			elog(ERROR, "failed on pmem_msync('%s'): %m", temp_file);
+	}
+	PG_CATCH();
+	{
+		if (new_mmap)
+			pmem_unmap(new_mmap, new_mmap_sz);
+		unlink(temp_file);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	/*
+	 * Switch the base file. Readers are blocked only during this step.
+	 *
+	 * Checkpoint may advance the REDO position during the build of the new
+	 * base file, and REDO logs prior to the position may be overwritten
+	 * later, so the new base file must start replay at the current
+	 * checkpoint position, not the one copied from the old base file.
+	 * It is safe because concurrent writers are blocked, so the new base
+	 * file already has the modification of all the REDO logs written so far.
+	 * The checkpoint position never advances until the base file is
+	 * switched, because checkpoint also needs base_mmap_lock.
+	 */
+	LWLockAcquire(&gs_sstate->base_mmap_lock, LW_EXCLUSIVE);
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	new_mmap->redo_replay_pos = (gs_sstate->redo_checkpoint_pos %
+								 gs_sstate->redo_log_limit);
+	/* REDO logs since here are not applicable to the older layout */
+	new_mmap->redo_revision = old_mmap->redo_revision + 1;
+	if (new_is_pmem)
+		pmem_persist(&new_mmap->redo_replay_pos, 2 * sizeof(uint64));
+	else if (pmem_msync(&new_mmap->redo_replay_pos, 2 * sizeof(uint64)) != 0)
+		replay_pos_persisted = false;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+	if (!replay_pos_persisted ||
+		rename(temp_file, gs_sstate->base_file) != 0)
+	{
+		int		errno_saved = errno;
+
+		LWLockRelease(&gs_sstate->base_mmap_lock);
+		pmem_unmap(new_mmap, new_mmap_sz);
+		unlink(temp_file);
+		errno = errno_saved;
+		elog(ERROR, "failed to switch the base file '%s' to '%s': %m",
+			 temp_file, gs_sstate->base_file);
+	}
+	gs_sstate->max_num_rows = new_num_rows;
+	if (gs_sstate->primary_key >= 0)
+		gs_sstate->num_hash_groups = gstoreFdwHashIndexNumGroups(new_num_rows);
+	gstoreFdwResetDirtyShift(gs_sstate);
+	do {
+		new_revision = random();
+	} while (new_revision == UINT_MAX || new_revision == old_revision);
+	gs_sstate->base_mmap_revision = new_revision;
+	LWLockRelease(&gs_sstate->base_mmap_lock);
+	if (pmem_unmap(new_mmap, new_mmap_sz) != 0)
+		elog(WARNING, "failed on pmem_unmap('%s'): %m", gs_sstate->base_file);
+
+	dir_name = pstrdup(gs_sstate->base_file);
+	get_parent_directory(dir_name);
+	fsync_fname(dir_name, true);
+
+	elog(NOTICE, "gstore_fdw: max_num_rows of '%s' was grown to %ld",
+		 RelationGetRelationName(frel), new_num_rows);
+	/* refresh base-file mapping */
+	gstoreFdwSetupGpuStoreDesc(gs_desc, true);
+}
+
+Datum
+pgstrom_gstore_fdw_grow(PG_FUNCTION_ARGS)
+{
+	Oid			ftable_oid = PG_GETARG_OID(0);
+	int64		new_num_rows = PG_GETARG_INT64(1);
+	Relation	frel;
+	CUresult	rc;
+
+	frel = table_open(ftable_oid, ExclusiveLock);
+	__gstoreFdwHostBufferGrow(frel, new_num_rows);
+	/* device buffer has the older layout, so load it again */
+	rc = gstoreFdwInvokeReload(RelationGetRelid(frel), false);
+	table_close(frel, ExclusiveLock);
+
+	PG_RETURN_INT32((int)rc);
+}
+PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_grow);
+
 Datum
 pgstrom_gstore_fdw_sysattr_in(PG_FUNCTION_ARGS)
 {
@@ -4782,7 +9260,36 @@ __gstoreFdwInvokeBackgroundCommand(GpuStoreBackgroundCommand *__lcmd, bool is_as
 }
 
 static CUresult
-gstoreFdwInvokeInitialLoad(Relation frel, bool is_async)
+gstoreFdwInvokeInitialLoad(Relation frel, bool is_async)
+{
+	GpuStoreBackgroundCommand lcmd;
+
+	memset(&lcmd, 0, sizeof(GpuStoreBackgroundCommand));
+	lcmd.database_oid = MyDatabaseId;
+	lcmd.ftable_oid = RelationGetRelid(frel);
+	lcmd.backend = (is_async ? NULL : MyLatch);
+	lcmd.command = GSTORE_BACKGROUND_CMD__INITIAL_LOAD;
+
+	return __gstoreFdwInvokeBackgroundCommand(&lcmd, is_async);
+}
+
+static CUresult
+gstoreFdwInvokeApplyRedo(Oid ftable_oid, bool is_async, uint64 end_pos)
+{
+	GpuStoreBackgroundCommand lcmd;
+
+	memset(&lcmd, 0, sizeof(GpuStoreBackgroundCommand));
+	lcmd.database_oid = MyDatabaseId;
+	lcmd.ftable_oid = ftable_oid;
+	lcmd.backend = (is_async ? NULL : MyLatch);
+	lcmd.command = GSTORE_BACKGROUND_CMD__APPLY_REDO;
+	lcmd.end_pos = end_pos;
+
+	return __gstoreFdwInvokeBackgroundCommand(&lcmd, is_async);
+}
+
+static CUresult
+gstoreFdwInvokeCompaction(Relation frel, bool is_async)
 {
 	GpuStoreBackgroundCommand lcmd;
 
@@ -4790,13 +9297,13 @@ gstoreFdwInvokeInitialLoad(Relation frel, bool is_async)
 	lcmd.database_oid = MyDatabaseId;
 	lcmd.ftable_oid = RelationGetRelid(frel);
 	lcmd.backend = (is_async ? NULL : MyLatch);
-	lcmd.command = GSTORE_BACKGROUND_CMD__INITIAL_LOAD;
+	lcmd.command = GSTORE_BACKGROUND_CMD__COMPACTION;
 
 	return __gstoreFdwInvokeBackgroundCommand(&lcmd, is_async);
 }
 
 static CUresult
-gstoreFdwInvokeApplyRedo(Oid ftable_oid, bool is_async, uint64 end_pos)
+gstoreFdwInvokeReload(Oid ftable_oid, bool is_async)
 {
 	GpuStoreBackgroundCommand lcmd;
 
@@ -4804,22 +9311,21 @@ gstoreFdwInvokeApplyRedo(Oid ftable_oid, bool is_async, uint64 end_pos)
 	lcmd.database_oid = MyDatabaseId;
 	lcmd.ftable_oid = ftable_oid;
 	lcmd.backend = (is_async ? NULL : MyLatch);
-	lcmd.command = GSTORE_BACKGROUND_CMD__APPLY_REDO;
-	lcmd.end_pos = end_pos;
+	lcmd.command = GSTORE_BACKGROUND_CMD__RELOAD;
 
 	return __gstoreFdwInvokeBackgroundCommand(&lcmd, is_async);
 }
 
 static CUresult
-gstoreFdwInvokeCompaction(Relation frel, bool is_async)
+gstoreFdwInvokeCheckpoint(Oid ftable_oid, bool is_async)
 {
 	GpuStoreBackgroundCommand lcmd;
 
 	memset(&lcmd, 0, sizeof(GpuStoreBackgroundCommand));
 	lcmd.database_oid = MyDatabaseId;
-	lcmd.ftable_oid = RelationGetRelid(frel);
+	lcmd.ftable_oid = ftable_oid;
 	lcmd.backend = (is_async ? NULL : MyLatch);
-	lcmd.command = GSTORE_BACKGROUND_CMD__COMPACTION;
+	lcmd.command = GSTORE_BACKGROUND_CMD__CHECKPOINT;
 
 	return __gstoreFdwInvokeBackgroundCommand(&lcmd, is_async);
 }
@@ -4996,6 +9502,43 @@ GstoreFdwBackgroundInitialLoad(GpuStoreDesc *gs_desc)
 	return rc;
 }
 
+/*
+ * GSTORE_BACKGROUND_CMD__RELOAD command
+ *
+ * It releases the device buffer, then loads the base file again; e.g, when
+ * gstore_fdw_grow() changed the layout of the base file.
+ */
+static CUresult
+GstoreFdwBackgroundReload(GpuStoreDesc *gs_desc)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	CUresult	rc;
+
+	pthreadRWLockWriteLock(&gs_sstate->gpu_bufer_lock);
+	if (gs_desc->gpu_main_devptr != 0UL)
+	{
+		rc = cuMemFree(gs_desc->gpu_main_devptr);
+		if (rc != CUDA_SUCCESS)
+			elog(LOG, "gstore_fdw reload: failed on cuMemFree: %s",
+				 errorText(rc));
+		gs_desc->gpu_main_devptr = 0UL;
+	}
+	if (gs_desc->gpu_extra_devptr != 0UL)
+	{
+		rc = cuMemFree(gs_desc->gpu_extra_devptr);
+		if (rc != CUDA_SUCCESS)
+			elog(LOG, "gstore_fdw reload: failed on cuMemFree: %s",
+				 errorText(rc));
+		gs_desc->gpu_extra_devptr = 0UL;
+	}
+	gs_sstate->gpu_main_size = 0;
+	gs_sstate->gpu_extra_size = 0;
+	rc = __gstoreFdwBackgroundInitialLoadNoLock(gs_desc);
+	pthreadRWLockUnlock(&gs_sstate->gpu_bufer_lock);
+
+	return rc;
+}
+
 /*
  * GSTORE_BACKGROUND_CMD__COMPACTION command
  */
@@ -5328,6 +9871,64 @@ out_error:
 	return rc;
 }
 
+/*
+ * __gstoreFdwRedoBatchConflict
+ *
+ * Column-delta UPDATE log copies the unchanged columns from the older row
+ * on the device buffer. Because REDO logs in a batch are applied in
+ * parallel, a batch must not contain both of the UPDATE log that reads
+ * 'oldid' and any INSERT/UPDATE log that writes 'oldid'.
+ * It returns true if the supplied log conflicts to the current batch.
+ */
+#define GSTORE_REDO_BATCH__WRITTEN		0x0001
+#define GSTORE_REDO_BATCH__READ			0x0002
+typedef struct
+{
+	cl_uint		rowid;
+	cl_uint		flags;
+} GstoreRedoBatchEntry;
+
+static bool
+__gstoreFdwRedoBatchConflict(HTAB *batch_htab, GstoreTxLogCommon *tx_log)
+{
+	GstoreRedoBatchEntry *entry;
+	cl_uint		rowid;
+	bool		found;
+
+	if (tx_log->type == GSTORE_TX_LOG__UPDATE)
+	{
+		GstoreTxLogUpdate *u_log = (GstoreTxLogUpdate *)tx_log;
+
+		entry = hash_search(batch_htab, &u_log->oldid, HASH_FIND, NULL);
+		if (entry && (entry->flags & GSTORE_REDO_BATCH__WRITTEN) != 0)
+			return true;
+		entry = hash_search(batch_htab, &u_log->rowid, HASH_FIND, NULL);
+		if (entry && (entry->flags & GSTORE_REDO_BATCH__READ) != 0)
+			return true;
+		entry = hash_search(batch_htab, &u_log->oldid, HASH_ENTER, &found);
+		if (!found)
+			entry->flags = 0;
+		entry->flags |= GSTORE_REDO_BATCH__READ;
+		rowid = u_log->rowid;
+	}
+	else if (tx_log->type == GSTORE_TX_LOG__INSERT)
+	{
+		rowid = ((GstoreTxLogInsert *)tx_log)->rowid;
+		entry = hash_search(batch_htab, &rowid, HASH_FIND, NULL);
+		if (entry && (entry->flags & GSTORE_REDO_BATCH__READ) != 0)
+			return true;
+	}
+	else
+		return false;	/* DELETE/COMMIT never touch user columns */
+
+	entry = hash_search(batch_htab, &rowid, HASH_ENTER, &found);
+	if (!found)
+		entry->flags = 0;
+	entry->flags |= GSTORE_REDO_BATCH__WRITTEN;
+
+	return false;
+}
+
 /*
  * GSTORE_BACKGROUND_CMD__APPLY_REDO command
  */
@@ -5344,6 +9945,9 @@ GstoreFdwBackgroundApplyRedoLog(GpuStoreDesc *gs_desc, uint64 end_pos)
 	uint64		curr_pos;
 	kern_gpustore_redolog *h_redo;
 	CUdeviceptr	m_redo = 0UL;
+	HTAB	   *batch_htab = NULL;
+	HASHCTL		hctl;
+	bool		batch_cut = false;
 	CUresult	rc;
 
 	/* device memory must be allocated */
@@ -5354,6 +9958,7 @@ GstoreFdwBackgroundApplyRedoLog(GpuStoreDesc *gs_desc, uint64 end_pos)
 			return rc;
 	}
 
+next_batch:
 	SpinLockAcquire(&gs_sstate->redo_pos_lock);
 	if (end_pos <= gs_sstate->redo_read_pos)
 	{
@@ -5387,6 +9992,13 @@ GstoreFdwBackgroundApplyRedoLog(GpuStoreDesc *gs_desc, uint64 end_pos)
 	h_redo->length = length;
 	offset = MAXALIGN(offsetof(kern_gpustore_redolog,
 							   log_index[nitems]));
+	memset(&hctl, 0, sizeof(HASHCTL));
+	hctl.keysize = sizeof(cl_uint);
+	hctl.entrysize = sizeof(GstoreRedoBatchEntry);
+	hctl.hcxt = CurrentMemoryContext;
+	batch_htab = hash_create("GpuStore REDO batch", 1024, &hctl,
+							 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	batch_cut = false;
 	index = 0;
 	curr_pos = head_pos;
 	while (curr_pos < tail_pos && index < nitems)
@@ -5406,6 +10018,12 @@ GstoreFdwBackgroundApplyRedoLog(GpuStoreDesc *gs_desc, uint64 end_pos)
 			continue;
 		}
 		Assert(tx_log->length == MAXALIGN(tx_log->length));
+		if (__gstoreFdwRedoBatchConflict(batch_htab, tx_log))
+		{
+			/* the remaining logs shall be applied on the next batch */
+			batch_cut = true;
+			break;
+		}
 		memcpy((char *)h_redo + offset, tx_log, tx_log->length);
 		h_redo->log_index[index++] = __kds_packed(offset);
 		offset += tx_log->length;
@@ -5413,6 +10031,7 @@ GstoreFdwBackgroundApplyRedoLog(GpuStoreDesc *gs_desc, uint64 end_pos)
 	}
 	h_redo->nitems = index;
 	h_redo->length = offset;
+	hash_destroy(batch_htab);
 	
 	/*
 	 * Kick the kernel to apply REDO log
@@ -5449,11 +10068,234 @@ GstoreFdwBackgroundApplyRedoLog(GpuStoreDesc *gs_desc, uint64 end_pos)
 			 head_pos, curr_pos);
 	}
 	pthreadRWLockUnlock(&gs_sstate->gpu_bufer_lock);
+	if (rc != CUDA_SUCCESS)
+		batch_cut = false;
 
 	rc = cuMemFree(m_redo);
 	if (rc != CUDA_SUCCESS)
 		elog(WARNING, "failed on cuMemFree: %s", errorText(rc));
+	m_redo = 0UL;
+
+	/* apply the remaining logs, if batch was cut by UPDATE log */
+	if (batch_cut && curr_pos < end_pos)
+		goto next_batch;
+
+	return CUDA_SUCCESS;
+}
+
+/*
+ * __gstoreFdwCheckpointWaitForWriters
+ *
+ * INSERT/UPDATE writes REDO log then modifies the base file under the
+ * row-lock, and marks the columns dirty prior to unlock. So, once we
+ * observed every row-lock released after the REDO position is fixed, all
+ * the modifications for the REDO logs prior to the position are already
+ * marked on the dirty bitmap.
+ */
+static void
+__gstoreFdwCheckpointWaitForWriters(GpuStoreSharedState *gs_sstate)
+{
+	int			i;
+
+	for (i=0; i < GSTORE_NUM_BASE_ROW_LOCKS; i++)
+	{
+		uint32		seqno = pg_atomic_read_u32(&gs_sstate->base_row_seqno[i]);
+
+		if ((seqno & 1) == 0)
+			continue;
+		while (pg_atomic_read_u32(&gs_sstate->base_row_seqno[i]) == seqno)
+			pg_usleep(100L);
+	}
+}
+
+/*
+ * __gstoreFdwCheckpointColumn
+ *
+ * It persists the values and null-bitmap of the column in the range of
+ * the dirty blocks [block_head, block_tail).
+ */
+static bool
+__gstoreFdwCheckpointColumn(GpuStoreDesc *gs_desc, kern_colmeta *cmeta,
+							cl_uint block_head, cl_uint block_tail,
+							size_t *p_nbytes)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	kern_data_store *kds = &gs_desc->base_mmap->schema;
+	size_t		rowid_head = ((size_t)block_head << gs_sstate->dirty_shift);
+	size_t		rowid_tail = ((size_t)block_tail << gs_sstate->dirty_shift);
+	size_t		unitsz;
+	size_t		len;
+	char	   *addr;
+
+	rowid_tail = Min(rowid_tail, kds->nrooms);
+	if (rowid_head >= rowid_tail)
+		return true;
+	if (cmeta->nullmap_offset != 0)
+	{
+		addr = (char *)kds + __kds_unpack(cmeta->nullmap_offset);
+		len = sizeof(cl_uint) * (((rowid_tail + 31) >> 5) - (rowid_head >> 5));
+		addr += sizeof(cl_uint) * (rowid_head >> 5);
+		if (!__gstoreFdwPersistBaseRange(gs_desc, addr, len))
+			return false;
+		*p_nbytes += len;
+	}
+	if (cmeta->attlen > 0)
+		unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+	else
+		unitsz = sizeof(cl_uint);		/* offset to the extra buffer */
+	addr = (char *)kds + __kds_unpack(cmeta->values_offset) + unitsz * rowid_head;
+	len = unitsz * (rowid_tail - rowid_head);
+	if (!__gstoreFdwPersistBaseRange(gs_desc, addr, len))
+		return false;
+	*p_nbytes += len;
+
+	return true;
+}
+
+/*
+ * GSTORE_BACKGROUND_CMD__CHECKPOINT command
+ *
+ * It persists only the dirty ranges of the base file, then advances the
+ * REDO position to start replay. It is kicked according to the fill level
+ * of the REDO log, ahead of the wrap-around.
+ */
+static CUresult
+GstoreFdwBackgroundCheckpoint(GpuStoreDesc *gs_desc)
+{
+	GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+	GpuStoreBaseFileHead *base_mmap;
+	kern_data_store *kds;
+	uint64		checkpoint_pos;
+	uint64		extra_usage = 0;
+	size_t		nbytes = 0;
+	bool		dirty_full;
+	bool		success = true;
+	struct timeval tv1, tv2;
+	int			j;
+
+	gettimeofday(&tv1, NULL);
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	checkpoint_pos = gs_sstate->redo_write_pos;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+
+	/* must not hold base_mmap_lock; writers may expand the extra buffer */
+	__gstoreFdwCheckpointWaitForWriters(gs_sstate);
 
+	LWLockAcquire(&gs_sstate->base_mmap_lock, LW_SHARED);
+	if (gs_desc->base_mmap_revision != gs_sstate->base_mmap_revision &&
+		!gstoreFdwRemapBaseFile(gs_desc, false))
+	{
+		LWLockRelease(&gs_sstate->base_mmap_lock);
+		success = false;
+		goto out;
+	}
+	base_mmap = gs_desc->base_mmap;
+	kds = &base_mmap->schema;
+	dirty_full = gs_sstate->dirty_full;
+	gs_sstate->dirty_full = false;
+	pg_memory_barrier();
+
+	for (j=0; j < gs_sstate->dirty_ncols && j < kds->ncols; j++)
+	{
+		pg_atomic_uint32 *bitmap = gs_sstate->dirty_bitmap + j * gs_sstate->dirty_nwords;
+		cl_uint		nblocks = 32 * gs_sstate->dirty_nwords;
+		cl_uint		block_head = UINT_MAX;
+		cl_uint		block;
+		uint32		bits = 0;
+
+		for (block=0; block < nblocks; block++)
+		{
+			bool	is_dirty;
+
+			if ((block & 0x1f) == 0)
+			{
+				bits = pg_atomic_read_u32(&bitmap[block >> 5]);
+				if (bits != 0)
+					bits = pg_atomic_exchange_u32(&bitmap[block >> 5], 0);
+			}
+			is_dirty = ((bits & (1U << (block & 0x1f))) != 0);
+			if (is_dirty && block_head == UINT_MAX)
+				block_head = block;
+			else if (!is_dirty && block_head != UINT_MAX)
+			{
+				if (!dirty_full &&
+					!__gstoreFdwCheckpointColumn(gs_desc, &kds->colmeta[j],
+												 block_head, block, &nbytes))
+					success = false;
+				block_head = UINT_MAX;
+			}
+		}
+		if (block_head != UINT_MAX && !dirty_full &&
+			!__gstoreFdwCheckpointColumn(gs_desc, &kds->colmeta[j],
+										 block_head, nblocks, &nbytes))
+			success = false;
+	}
+
+	if (dirty_full)
+	{
+		/* entire base file; e.g, the first checkpoint, or after compaction */
+		if (!__gstoreFdwPersistBaseRange(gs_desc, base_mmap, gs_desc->base_mmap_sz))
+			success = false;
+		nbytes = gs_desc->base_mmap_sz;
+		if (kds->has_varlena)
+			extra_usage = ((kern_data_extra *)
+						   ((char *)kds + kds->extra_hoffset))->usage;
+	}
+	else
+	{
+		/* base file header and schema definition, including nitems */
+		if (!__gstoreFdwPersistBaseRange(gs_desc, base_mmap,
+										 (char *)&kds->colmeta[kds->ncols] -
+										 (char *)base_mmap))
+			success = false;
+		/* extra buffer is append-only */
+		if (kds->has_varlena)
+		{
+			kern_data_extra *extra = (kern_data_extra *)
+				((char *)kds + kds->extra_hoffset);
+			uint64		head = Max(gs_sstate->dirty_extra_usage,
+								   offsetof(kern_data_extra, data));
+
+			extra_usage = atomicRead64(&extra->usage);
+			if (!__gstoreFdwPersistBaseRange(gs_desc, extra,
+											 offsetof(kern_data_extra, data)))
+				success = false;
+			if (head < extra_usage)
+			{
+				if (!__gstoreFdwPersistBaseRange(gs_desc, (char *)extra + head,
+												 extra_usage - head))
+					success = false;
+				nbytes += (extra_usage - head);
+			}
+		}
+	}
+	if (success)
+	{
+		gs_sstate->dirty_extra_usage = extra_usage;
+		SpinLockAcquire(&gs_sstate->redo_pos_lock);
+		__gstoreFdwSetReplayPos(gs_desc, checkpoint_pos);
+		SpinLockRelease(&gs_sstate->redo_pos_lock);
+	}
+	else
+	{
+		/* dirty bits are already cleared, so next one should be full */
+		gs_sstate->dirty_full = true;
+	}
+	LWLockRelease(&gs_sstate->base_mmap_lock);
+out:
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	gs_sstate->redo_checkpoint_requested = false;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+	gettimeofday(&tv2, NULL);
+
+	if (!success)
+	{
+		elog(LOG, "gstore_fdw: incremental checkpoint failed on '%s'",
+			 gs_sstate->base_file);
+		return CUDA_ERROR_UNKNOWN;
+	}
+	elog(LOG, "gstore_fdw: incremental checkpoint applied on '%s' (%zu bytes) [%.2fms]",
+		 gs_sstate->base_file, nbytes, TV_DIFF(tv2,tv1));
 	return CUDA_SUCCESS;
 }
 
@@ -5564,7 +10406,20 @@ __gstoreFdwBgWorkerDispatchCommand(GpuStoreBackgroundCommand *cmd,
 		gstoreFdwInitGpuStoreDesc(gs_desc, gs_sstate);
 	}
 	if (!gstoreFdwSetupGpuStoreDesc(gs_desc, false))
+	{
+		if (cmd->command == GSTORE_BACKGROUND_CMD__CHECKPOINT)
+		{
+			GpuStoreSharedState *gs_sstate = gs_desc->gs_sstate;
+
+			SpinLockAcquire(&gs_sstate->redo_pos_lock);
+			gs_sstate->redo_checkpoint_requested = false;
+			SpinLockRelease(&gs_sstate->redo_pos_lock);
+		}
 		return CUDA_ERROR_MAP_FAILED;
+	}
+	/* checkpoint works on the host side only */
+	if (cmd->command == GSTORE_BACKGROUND_CMD__CHECKPOINT)
+		return GstoreFdwBackgroundCheckpoint(gs_desc);
 
 	/* Switch CUDA Context to the target device */
 	cuda_dindex = gs_desc->gs_sstate->cuda_dindex;
@@ -5591,6 +10446,9 @@ __gstoreFdwBgWorkerDispatchCommand(GpuStoreBackgroundCommand *cmd,
 		case GSTORE_BACKGROUND_CMD__DROP_UNLOAD:
 			rc = GstoreFdwBackgroundDropUnload(gs_desc);
 			break;
+		case GSTORE_BACKGROUND_CMD__RELOAD:
+			rc = GstoreFdwBackgroundReload(gs_desc);
+			break;
 		default:
 			elog(LOG, "Unsupported Gstore maintainer command: %d", cmd->command);
 			rc = CUDA_ERROR_INVALID_VALUE;
@@ -5644,6 +10502,41 @@ gstoreFdwBgWorkerDispatch(CUcontext *cuda_context_array)
 	return false;
 }
 
+/*
+ * __gstoreFdwBgWorkerEnqueueCommand
+ *
+ * It enqueues an asynchronous command for the background worker itself.
+ * Caller must hold redo_pos_lock.
+ */
+static bool
+__gstoreFdwBgWorkerEnqueueCommand(GpuStoreSharedState *gs_sstate, int command)
+{
+	dlist_head *cmd_flist = &gstore_shared_head->background_free_cmds;
+	slock_t	   *cmd_lock  = &gstore_shared_head->background_cmd_lock;
+	bool		retval = false;
+
+	SpinLockAcquire(cmd_lock);
+	if (!dlist_is_empty(cmd_flist))
+	{
+		GpuStoreBackgroundCommand *cmd;
+
+		cmd = dlist_container(GpuStoreBackgroundCommand, chain,
+							  dlist_pop_head_node(cmd_flist));
+		memset(cmd, 0, sizeof(GpuStoreBackgroundCommand));
+		cmd->database_oid = gs_sstate->database_oid;
+		cmd->ftable_oid   = gs_sstate->ftable_oid;
+		cmd->command      = command;
+		cmd->end_pos      = gs_sstate->redo_write_pos;
+		cmd->retval = (CUresult) UINT_MAX;
+		dlist_push_tail(&gstore_shared_head->background_cmd_queue,
+						&cmd->chain);
+		retval = true;
+	}
+	SpinLockRelease(cmd_lock);
+
+	return retval;
+}
+
 bool
 gstoreFdwBgWorkerIdleTask(CUcontext *cuda_context_array)
 {
@@ -5670,28 +10563,26 @@ gstoreFdwBgWorkerIdleTask(CUcontext *cuda_context_array)
 			if (GetCurrentTimestamp () > threshold &&
 				gs_sstate->redo_write_nitems > gs_sstate->redo_read_nitems)
 			{
-				dlist_head *cmd_flist = &gstore_shared_head->background_free_cmds;
-				slock_t	   *cmd_lock  = &gstore_shared_head->background_cmd_lock;
-
-				SpinLockAcquire(cmd_lock);
-				if (!dlist_is_empty(cmd_flist))
+				if (__gstoreFdwBgWorkerEnqueueCommand(gs_sstate,
+										GSTORE_BACKGROUND_CMD__APPLY_REDO))
+					retval = true;
+				gs_sstate->redo_last_timestamp = GetCurrentTimestamp();
+			}
+			/*
+			 * Incremental checkpoint, if REDO logs since the last
+			 * checkpoint exceeds the threshold of the REDO log buffer.
+			 */
+			if (!gs_sstate->redo_checkpoint_requested &&
+				(gs_sstate->redo_write_pos -
+				 gs_sstate->redo_checkpoint_pos) * 100 >
+				gs_sstate->redo_log_limit * gstore_fdw_checkpoint_threshold)
+			{
+				if (__gstoreFdwBgWorkerEnqueueCommand(gs_sstate,
+										GSTORE_BACKGROUND_CMD__CHECKPOINT))
 				{
-					GpuStoreBackgroundCommand *cmd;
-
-					cmd = dlist_container(GpuStoreBackgroundCommand, chain,
-										  dlist_pop_head_node(cmd_flist));
-					memset(cmd, 0, sizeof(GpuStoreBackgroundCommand));
-					cmd->database_oid = gs_sstate->database_oid;
-					cmd->ftable_oid   = gs_sstate->ftable_oid;
-					cmd->command      = GSTORE_BACKGROUND_CMD__APPLY_REDO;
-					cmd->end_pos      = gs_sstate->redo_write_pos;
-					cmd->retval = (CUresult) UINT_MAX;
-					dlist_push_tail(&gstore_shared_head->background_cmd_queue,
-									&cmd->chain);
+					gs_sstate->redo_checkpoint_requested = true;
 					retval = true;
 				}
-				SpinLockRelease(cmd_lock);
-				gs_sstate->redo_last_timestamp = GetCurrentTimestamp();
 			}
 			SpinLockRelease(&gs_sstate->redo_pos_lock);
 		}
@@ -5896,6 +10787,8 @@ pgstrom_init_gstore_fdw(void)
     r->ExecForeignUpdate			= GstoreExecForeignUpdate;
     r->ExecForeignDelete			= GstoreExecForeignDelete;
     r->EndForeignModify				= GstoreEndForeignModify;
+	r->BeginForeignInsert			= GstoreBeginForeignInsert;
+	r->EndForeignInsert				= GstoreEndForeignInsert;
 
 	/* EXPLAIN/ANALYZE */
 	r->ExplainForeignScan			= GstoreExplainForeignScan;
@@ -5922,6 +10815,16 @@ pgstrom_init_gstore_fdw(void)
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
 	
+	/* GUC: gstore_fdw.enable_column_scan */
+	DefineCustomBoolVariable("gstore_fdw.enable_column_scan",
+							 "Enables evaluation of simple quals over the column arrays",
+							 NULL,
+							 &gstore_fdw_enabled_column_scan,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
 	/* GUC: gstore_fdw.auto_preload  */
 	DefineCustomBoolVariable("gstore_fdw.auto_preload",
 							 "Enables auto preload of GstoreFdw GPU buffers",
@@ -5951,6 +10854,51 @@ pgstrom_init_gstore_fdw(void)
 							   PGC_SUSET,
 							   GUC_NOT_IN_SAMPLE,
 							   NULL, NULL, NULL);
+
+	/* GUC: gstore_fdw.commit_delay */
+	DefineCustomIntVariable("gstore_fdw.commit_delay",
+							"Sets the delay in microseconds between REDO log commit and persist",
+							NULL,
+							&gstore_fdw_commit_delay,
+							0,
+							0,
+							100000,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* GUC: gstore_fdw.recovery_workers */
+	DefineCustomIntVariable("gstore_fdw.recovery_workers",
+							"Sets the number of threads to apply REDO logs on recovery",
+							NULL,
+							&gstore_fdw_recovery_workers,
+							4,
+							1,
+							64,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* GUC: gstore_fdw.checkpoint_threshold */
+	DefineCustomIntVariable("gstore_fdw.checkpoint_threshold",
+							"Sets the fill level of REDO log buffer (percent) to kick incremental checkpoint",
+							NULL,
+							&gstore_fdw_checkpoint_threshold,
+							50,
+							10,
+							90,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* GUC: gstore_fdw.bulk_load_threshold */
+	DefineCustomIntVariable("gstore_fdw.bulk_load_threshold",
+							"Sets the number of rows per INSERT/COPY to switch the bulk-load without REDO logs (-1 disables)",
+							NULL,
+							&gstore_fdw_bulk_load_threshold,
+							-1,
+							-1,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 	/*
 	 * Background worker to load GPU store on startup
 	 */
@@ -5987,7 +10935,10 @@ pgstrom_init_gstore_fdw(void)
 /*
  * pgstrom.gstore_fdw_replication_base(regclass,int)
  *
- * Get base backup under ShareRowExclusiveLock; to prevent any writes.
+ * Get a chunk of base backup under ShareLock; to prevent any writes during
+ * the copy, but multiple sessions can fetch the chunks concurrently.
+ * Chunks may be fetched at different moments, so caller has to apply the
+ * REDO logs since the 'rep_lpos' of the first chunk.
  */
 Datum
 pgstrom_gstore_fdw_replication_base(PG_FUNCTION_ARGS)
@@ -6001,8 +10952,12 @@ pgstrom_gstore_fdw_replication_base(PG_FUNCTION_ARGS)
 	kern_data_extra *extra;
 	size_t		length;
 	size_t		offset;
-	size_t		chunk_sz = (64UL << 20);	/* up to 64MB */
+	size_t		chunk_sz = GSTORE_REPLICATION_CHUNK_SIZE;
 	uint64		rep_lpos;
+	uint64		rep_unpin_pos;
+	uint64		rep_redo_revision;
+	uint32		rep_revision;
+	TimestampTz	curr_ts;
 	bytea	   *retval = NULL;
 
 	if (pg_class_aclcheck(ftable_oid, GetUserId(),
@@ -6011,17 +10966,32 @@ pgstrom_gstore_fdw_replication_base(PG_FUNCTION_ARGS)
 					   OBJECT_FOREIGN_TABLE,
 					   get_rel_name(ftable_oid));
 
-	frel = table_open(ftable_oid, ShareRowExclusiveLock);
+	frel = table_open(ftable_oid, ShareLock);
 	if (!RelationIsGstoreFdw(frel))
 		elog(ERROR, "relation '%s' is not a foreign table with gstore_fdw",
 			 RelationGetRelationName(frel));
 	gs_desc = gstoreFdwLookupGpuStoreDesc(frel);
 
-	/* redo_write_pos shall not be updated under the ShareRowExclusiveLock */
+	/*
+	 * redo_write_pos shall not be updated under the ShareLock.
+	 * The REDO catch-up replays the UPDATE logs since the first chunk, so
+	 * the older versions they refer must not be reused until all the chunks
+	 * are fetched. It is a lease renewed by every chunk, because the client
+	 * does not tell the end of the base backup.
+	 */
 	gs_sstate = gs_desc->gs_sstate;
 	SpinLockAcquire(&gs_sstate->redo_pos_lock);
 	rep_lpos = gs_sstate->redo_write_pos;
+	rep_unpin_pos = gs_sstate->unpinned_pos;
+	curr_ts = GetCurrentTimestamp();
+	if (curr_ts >= gs_sstate->backup_expire ||
+		gs_sstate->backup_pos > rep_lpos)
+		gs_sstate->backup_pos = rep_lpos;
+	gs_sstate->backup_expire =
+		TimestampTzPlusMilliseconds(curr_ts, GSTORE_BACKUP_LEASE_TIMEOUT);
 	SpinLockRelease(&gs_sstate->redo_pos_lock);
+	rep_revision = gs_desc->base_mmap_revision;
+	rep_redo_revision = gs_desc->base_mmap->redo_revision;
 
 	/* try to fetch base chunk */
 	kds = &gs_desc->base_mmap->schema;
@@ -6040,6 +11010,9 @@ pgstrom_gstore_fdw_replication_base(PG_FUNCTION_ARGS)
 		repl->rep_dindex = 1234;	/* now multi-device is not supported */
 		repl->rep_nitems = -1;
 		repl->rep_lpos = rep_lpos;
+		repl->rep_revision = rep_revision;
+		repl->rep_unpin_pos = rep_unpin_pos;
+		repl->rep_redo_revision = rep_redo_revision;
 		memcpy(repl->data, (char *)gs_desc->base_mmap + offset, chunk_sz);
 		SET_VARSIZE(retval, VARHDRSZ + offsetof(GpuStoreReplicationChunk,
 												data) + chunk_sz);
@@ -6063,6 +11036,9 @@ pgstrom_gstore_fdw_replication_base(PG_FUNCTION_ARGS)
 			repl->rep_dindex = 0;	/* now multi-device is not supported */
 			repl->rep_nitems = -1;
 			repl->rep_lpos = rep_lpos;
+			repl->rep_revision = rep_revision;
+			repl->rep_unpin_pos = rep_unpin_pos;
+			repl->rep_redo_revision = rep_redo_revision;
 			memcpy(repl->data, (char *)extra + offset, chunk_sz);
 			SET_VARSIZE(retval, VARHDRSZ + offsetof(GpuStoreReplicationChunk,
 													data) + chunk_sz);
@@ -6081,9 +11057,9 @@ pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS)
 {
 	Oid				ftable_oid = PG_GETARG_OID(0);
 	uint64			base_pos = PG_GETARG_INT64(1);
-	float8			duration = PG_GETARG_FLOAT8(2);
-	int64			min_length = PG_GETARG_INT64(3);
-	int64			max_length = PG_GETARG_INT64(4);
+	float8			duration = PG_GETARG_FLOAT8(2);		/* sec */
+	int64			min_length = PG_GETARG_INT64(3) << 10;	/* kB */
+	int64			max_length = PG_GETARG_INT64(4) << 10;	/* kB */
 	Relation		frel;
 	GpuStoreDesc   *gs_desc;
 	GpuStoreSharedState *gs_sstate;
@@ -6091,6 +11067,7 @@ pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS)
 	StringInfoData	buf;
 	cl_uint			nitems = 0;
 	uint64			tail_pos;
+	uint64			rep_redo_revision;
 	struct timeval	tv1, tv2;
 
 	if (base_pos != MAXALIGN(base_pos))
@@ -6108,8 +11085,8 @@ pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS)
 
 	/* result buffer */
 	initStringInfo(&buf);
-	enlargeStringInfo(&buf, offsetof(GpuStoreReplicationChunk, data));
-	buf.len = offsetof(GpuStoreReplicationChunk, data);
+	enlargeStringInfo(&buf, VARHDRSZ + offsetof(GpuStoreReplicationChunk, data));
+	buf.len = VARHDRSZ + offsetof(GpuStoreReplicationChunk, data);
 
 	gettimeofday(&tv1, NULL);
 	for (;;)
@@ -6140,7 +11117,7 @@ pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS)
 		tail_pos = gs_sstate->redo_write_pos;
 		SpinLockRelease(&gs_sstate->redo_pos_lock);
 
-		/* copy Insert/Delete/Commit log */
+		/* copy Insert/Delete/Update/Commit log */
 		while (base_pos < tail_pos && buf.len < max_length)
 		{
 			GstoreTxLogCommon  *tx_log;
@@ -6149,6 +11126,7 @@ pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS)
 			tx_log = (GstoreTxLogCommon *)(gs_desc->redo_mmap + offset);
 			if (tx_log->type == GSTORE_TX_LOG__INSERT ||
 				tx_log->type == GSTORE_TX_LOG__DELETE ||
+				tx_log->type == GSTORE_TX_LOG__UPDATE ||
 				tx_log->type == GSTORE_TX_LOG__COMMIT)
 			{
 				Assert(tx_log->length == MAXALIGN(tx_log->length));
@@ -6156,7 +11134,8 @@ pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS)
 				base_pos += tx_log->length;
 				nitems++;
 			}
-			else if (tx_log->type == 0)
+			else if (tx_log->type == 0 ||
+					 tx_log->type == GSTORE_TX_LOG__WRAPAROUND)
 			{
 				/* round to the redo buffer head */
 				base_pos += (gs_sstate->redo_log_limit - offset);
@@ -6171,33 +11150,111 @@ pgstrom_gstore_fdw_replication_redo(PG_FUNCTION_ARGS)
 					 offset);
 			}
 		}
+		/* REDO buffer can be overwritten once copied */
+		SpinLockAcquire(&gs_sstate->redo_pos_lock);
+		gs_sstate->redo_repl_pos[slot_index] = ULONG_MAX;
+		SpinLockRelease(&gs_sstate->redo_pos_lock);
+
 		/* length exceeds the minimum chunk size */
 		if (buf.len >= min_length)
 			break;
 		gettimeofday(&tv2, NULL);
 		/* even though the length is not enough, function call spent too much */
-		if (TV_DIFF(tv2, tv1) >= (double)duration)
+		if (TV_DIFF(tv2, tv1) >= 1000.0 * duration)
 			break;
 		/* wait for 50ms, then retry again */
-		SpinLockAcquire(&gs_sstate->redo_pos_lock);
-		gs_sstate->redo_repl_pos[slot_index] = ULONG_MAX;
-		SpinLockRelease(&gs_sstate->redo_pos_lock);
-
+		CHECK_FOR_INTERRUPTS();
 		pg_usleep(50000L);
 	}
-	repl = (GpuStoreReplicationChunk *)buf.data;
+	/*
+	 * redo_revision is changed prior to the commit log of bulk-load, so it
+	 * shall be checked after the copy of REDO logs.
+	 */
+	LWLockAcquire(&gs_sstate->base_mmap_lock, LW_SHARED);
+	if (gs_desc->base_mmap_revision != gs_sstate->base_mmap_revision)
+		gstoreFdwRemapBaseFile(gs_desc, true);
+	rep_redo_revision = gs_desc->base_mmap->redo_revision;
+	LWLockRelease(&gs_sstate->base_mmap_lock);
+
+	repl = (GpuStoreReplicationChunk *)(buf.data + VARHDRSZ);
 	repl->rep_kind = 'r';
 	repl->rep_dindex = 0;
 	repl->rep_nitems = nitems;
 	repl->rep_lpos = base_pos;
-	SET_VARSIZE(repl, buf.len);
+	repl->rep_revision = 0;
+	repl->__padding = 0;
+	repl->rep_unpin_pos = 0;
+	repl->rep_redo_revision = rep_redo_revision;
+	SET_VARSIZE(buf.data, buf.len);
 
 	table_close(frel, AccessShareLock);
 
-	PG_RETURN_BYTEA_P(repl);
+	PG_RETURN_BYTEA_P(buf.data);
 }
 PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_replication_redo);
 
+/*
+ * pgstrom.gstore_fdw_redo_sync_info(regclass)
+ *
+ * It returns statistics of the REDO log group commit.
+ */
+Datum
+pgstrom_gstore_fdw_redo_sync_info(PG_FUNCTION_ARGS)
+{
+	Oid			ftable_oid = PG_GETARG_OID(0);
+	Relation	frel;
+	GpuStoreDesc *gs_desc;
+	GpuStoreSharedState *gs_sstate;
+	TupleDesc	tupdesc;
+	Datum		values[5];
+	bool		isnull[5];
+	uint64		nrequests;
+	uint64		ngroups;
+	uint32		last_group;
+	uint32		max_group;
+
+	frel = table_open(ftable_oid, AccessShareLock);
+	gs_desc = gstoreFdwLookupGpuStoreDesc(frel);
+	gs_sstate = gs_desc->gs_sstate;
+
+	SpinLockAcquire(&gs_sstate->redo_pos_lock);
+	nrequests  = gs_sstate->redo_sync_nrequests;
+	ngroups    = gs_sstate->redo_sync_ngroups;
+	last_group = gs_sstate->redo_sync_last_group;
+	max_group  = gs_sstate->redo_sync_max_group;
+	SpinLockRelease(&gs_sstate->redo_pos_lock);
+
+	table_close(frel, AccessShareLock);
+
+	tupdesc = CreateTemplateTupleDesc(5);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "num_requests",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "num_groups",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "avg_group_size",
+					   FLOAT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "last_group_size",
+					   INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "max_group_size",
+					   INT4OID, -1, 0);
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int64GetDatum(nrequests);
+	values[1] = Int64GetDatum(ngroups);
+	if (ngroups > 0)
+		values[2] = Float8GetDatum((double)nrequests / (double)ngroups);
+	else
+		isnull[2] = true;
+	values[3] = Int32GetDatum(last_group);
+	values[4] = Int32GetDatum(max_group);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc,
+													  values,
+													  isnull)));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_redo_sync_info);
+
 Datum
 pgstrom_gstore_fdw_read_debug(PG_FUNCTION_ARGS)
 {
@@ -24,22 +24,27 @@
  *
  * +------------------------+
  * | GpuStoreBaseFileHead   |
- * |  * rowid_map_offset   --------+
- * |  * hash_index_offset  ------+ |
- * | +----------------------+    | |
- * | | schema definition    |    | |
- * | | (kern_data_store)    |    | |
- * | | * extra_hoffset   ------------+
- * | =                      =    | | |
- * | | fixed length portion |    | | |
- * | | (nullmap + values)   |    | | |
- * +-+----------------------+ <--+ | |
- * | GpuStoreRowIdMap       |      | |
- * |                        |      | |
- * +------------------------+ <----+ |
- * | GpuStoreHashHead       |        |
- * | (optional, if PK)      |        |
- * +------------------------+ <------+
+ * |  * rowid_map_offset   ----------+
+ * |  * hash_index_offset  --------+ |
+ * |  * ordered_index_offset[] --+ | |
+ * | +----------------------+    | | |
+ * | | schema definition    |    | | |
+ * | | (kern_data_store)    |    | | |
+ * | | * extra_hoffset   --------------+
+ * | =                      =    | | | |
+ * | | fixed length portion |    | | | |
+ * | | (nullmap + values)   |    | | | |
+ * +-+----------------------+ <--|-|-+ |
+ * | GpuStoreRowIdMap       |    | |   |
+ * |                        |    | |   |
+ * +------------------------+ <--|-+   |
+ * | GpuStoreHashHead       |    |     |
+ * | (optional, if PK)      |    |     |
+ * +------------------------+ <--+     |
+ * | GpuStoreOrderedIndex   |          |
+ * | (optional, for each    |          |
+ * |  ordered_index column) |          |
+ * +------------------------+ <--------+
  * | Extra Buffer           |
  * | (optional, if varlena) |
  * =                        =
@@ -47,27 +52,41 @@
  * | expanded on demand     |
  * +------------------------+
  *
- * The base file contains four sections internally.
+ * The base file contains five sections internally.
  * The 1st section contains schema definition in device side (thus, it
  * additionally has xmin,xmax,cid columns after the user defined columns).
  * The 2nd section contains row-id map for fast row-id allocation.
  * The 3rd section is hash-based PK index.
- * The above three sections are all fixed-length, thus, its size shall not
- * be changed unless 'max_num_rows' is not reconfigured.
- * The 4th section (extra buffer) is used to store the variable length
+ * The 4th section is a series of ordered secondary indexes; one for each
+ * column specified by the 'ordered_index' option.
+ * The above four sections are all fixed-length according to 'max_num_rows'.
+ * gstore_fdw_grow() enlarges them by building a new base file with
+ * the larger layout, then switches the file and base_mmap_revision at once.
+ * The 5th section (extra buffer) is used to store the variable length
  * values, and can be expanded on the demand.
  */
-#define GPUSTORE_BASEFILE_SIGNATURE		"@BASE-1@"
-#define GPUSTORE_BASEFILE_MAPPED_SIGNATURE "%Base-1%"
-#define GPUSTORE_ROWIDMAP_SIGNATURE		"@ROW-ID@"
-#define GPUSTORE_HASHINDEX_SIGNATURE	"@HINDEX@"
+#define GPUSTORE_BASEFILE_SIGNATURE		"@BASE-3@"
+#define GPUSTORE_BASEFILE_MAPPED_SIGNATURE "%Base-3%"
+#define GPUSTORE_ROWIDMAP_SIGNATURE		"@ROWID2@"
+#define GPUSTORE_HASHINDEX_SIGNATURE	"@HINDX2@"
+#define GPUSTORE_ORDINDEX_SIGNATURE		"@OINDX1@"
 #define GPUSTORE_EXTRABUF_SIGNATURE		"@EXTRA1@"
 
+#define GPUSTORE_MAX_ORDERED_INDEXES	4
+
 typedef struct
 {
 	char		signature[8];
 	uint64		rowid_map_offset;
 	uint64		hash_index_offset;	/* optional (if primary key exist)  */
+	uint64		ordered_index_offset[GPUSTORE_MAX_ORDERED_INDEXES];
+									/* optional (if ordered_index exist) */
+	uint64		redo_replay_pos;	/* offset of the REDO log file to start
+									 * replay on recovery; updated on the
+									 * checkpoint */
+	uint64		redo_revision;		/* incremented when rows are written
+									 * without REDO logs (bulk-load), or the
+									 * base file is rebuilt (grow) */
 	char		ftable_name[NAMEDATALEN];
 	kern_data_store schema;
 } GpuStoreBaseFileHead;
@@ -75,36 +94,146 @@ typedef struct
 /*
  * RowID map - it shall locate next to the base area (schema + fixed-length
  * array of base file), and prior to the extra buffer.
+ *
+ * free_head is a tagged head of the free rowid list; the lower 32bits are
+ * the first free rowid (or UINT_MAX if nothing), and the upper 32bits are
+ * a counter incremented on every update to avoid ABA problem, so it can be
+ * updated by compare-and-swap without locks.
+ * rowid_chain[] is the next free rowid for free rowids, UINT_MAX for rowids
+ * in-use, or GPUSTORE_ROWID_RESERVED for rowids reserved by a backend.
+ * Rowids pinned by column-delta UPDATE logs are chained in the same way,
+ * and GPUSTORE_ROWID_RESERVED terminates the pinned list.
  */
+#define GPUSTORE_ROWID_RESERVED		(UINT_MAX - 1)
+#define GPUSTORE_ROWID_FREE_HEAD(rowid,tag)				\
+	(((cl_ulong)(tag) << 32) | (cl_ulong)(rowid))
 typedef struct
 {
 	char		signature[8];
 	size_t		length;
 	cl_uint		nrooms;
-	cl_uint	 	first_free_rowid;	/* first free rowid, or UINT_MAX if nothing */
+	cl_uint		__padding__;
+	cl_ulong	free_head;		/* tagged head of the free rowid list */
 	cl_uint		rowid_chain[FLEXIBLE_ARRAY_MEMBER];
 } GpuStoreRowIdMapHead;
 
 /*
  * GpuStoreHashIndexHead - section for optional hash-based PK index
+ *
+ * It is an open-addressing hash table that consists of bucket groups.
+ * Each bucket group has 7 buckets of 32bit hash-value (fingerprint) and
+ * rowid, thus fits one cache line. Key is probed from the home group
+ * (hash % ngroups) to the following groups as long as 'overflow' (number
+ * of entries that probed beyond this group) is not zero. 'lock' is
+ * a spinlock of the bucket group; it must be acquired prior to the row
+ * lock, and the home group's lock must be acquired prior to the others.
+ * Empty bucket has UINT_MAX on the rowid.
+ *
+ * Because each rowid has at most one entry, ngroups is determined by
+ * max_num_rows to keep the load factor at most 75%.
  */
+#define GPUSTORE_HASHINDEX_NBUCKETS		7
+typedef struct
+{
+	cl_uint		lock;
+	cl_uint		overflow;
+	cl_uint		hash[GPUSTORE_HASHINDEX_NBUCKETS];
+	cl_uint		rowid[GPUSTORE_HASHINDEX_NBUCKETS];
+} GpuStoreHashGroup;
+
 typedef struct
 {
 	char		signature[8];
 	uint64		nrooms;
-	uint64		nslots;
-	uint32		slots[FLEXIBLE_ARRAY_MEMBER];
+	uint64		ngroups;
+	char		__padding__[40];	/* groups[] shall be 64bytes aligned */
+	GpuStoreHashGroup groups[FLEXIBLE_ARRAY_MEMBER];
 } GpuStoreHashIndexHead;
 
+static inline uint64
+gstoreFdwHashIndexNumGroups(uint64 nrooms)
+{
+	return (4 * nrooms) / (3 * GPUSTORE_HASHINDEX_NBUCKETS) + 1;
+}
+
+/*
+ * GpuStoreOrderedIndexHead - section for optional ordered secondary index
+ *
+ * It is a sorted array of (key, rowid) pairs on a fixed-length and
+ * pass-by-value column, followed by the delta area of unsorted pairs.
+ * A new entry is appended to the delta area, then the delta area is sorted
+ * and merged to the sorted array once it gets full.
+ * Entry of the sorted array is removed by UINT_MAX on the rowid, but the
+ * key is kept as is (tombstone), so binary search works as usual. These
+ * tombstones shall be swept at the next merge.
+ * NULL values are not indexed.
+ *
+ * items[0 ... nrooms-1] is the sorted array, and items[nrooms ...
+ * nrooms + delta_nrooms - 1] is the delta area. nrooms has margin of
+ * delta_nrooms on max_num_rows, so merge never overflows even if both
+ * of the sorted array and delta area are fully occupied.
+ */
+typedef struct
+{
+	cl_ulong	key;			/* Datum of the indexed column */
+	cl_uint		rowid;
+	cl_uint		__padding__;
+} GpuStoreOrderedIndexItem;
+
+typedef struct
+{
+	char		signature[8];
+	uint64		nrooms;			/* capacity of the sorted array */
+	uint64		nitems;			/* number of items in the sorted array */
+	uint64		ndead;			/* number of tombstones */
+	uint64		delta_nrooms;	/* capacity of the delta area */
+	uint64		delta_nitems;	/* number of items in the delta area */
+	cl_int		attnum;			/* attribute number of the indexed column */
+	cl_int		__padding__;
+	GpuStoreOrderedIndexItem items[FLEXIBLE_ARRAY_MEMBER];
+} GpuStoreOrderedIndexHead;
+
+static inline uint64
+gstoreFdwOrderedIndexDeltaNRooms(uint64 max_num_rows)
+{
+	uint64		delta_nrooms = max_num_rows / 256;
+
+	return (delta_nrooms < 1024 ? 1024 : delta_nrooms);
+}
+
+static inline size_t
+gstoreFdwOrderedIndexSize(uint64 max_num_rows)
+{
+	uint64		delta_nrooms = gstoreFdwOrderedIndexDeltaNRooms(max_num_rows);
+
+	return offsetof(GpuStoreOrderedIndexHead,
+					items[max_num_rows + 2 * delta_nrooms]);
+}
+
 /*
  * GpuStoreReplicationChunk
+ *
+ * base ('b') and extra ('e') chunks are up to GSTORE_REPLICATION_CHUNK_SIZE,
+ * so the chunk index determines the location in the base file.
+ * rep_unpin_pos is the largest REDO position where the rowids referred by
+ * column-delta UPDATE logs were released to reuse; the REDO catch-up of the
+ * base backup is valid only if it is not beyond the starting position.
+ * rep_redo_revision is redo_revision of the base file when the chunk is
+ * built; REDO logs are applicable only onto the base file of the same
+ * revision, so the replica needs a new base backup once it is changed.
  */
+#define GSTORE_REPLICATION_CHUNK_SIZE	(64UL << 20)	/* 64MB */
+
 typedef struct
 {
 	char			rep_kind;
 	uint16			rep_dindex;
 	uint32			rep_nitems;		/* valid only if rep_kind == 'r' */
 	uint64			rep_lpos;
+	uint32			rep_revision;	/* valid only if rep_kind == 'b' or 'e' */
+	uint32			__padding;
+	uint64			rep_unpin_pos;	/* valid only if rep_kind == 'b' or 'e' */
+	uint64			rep_redo_revision;
 	char			data[FLEXIBLE_ARRAY_MEMBER];
 } GpuStoreReplicationChunk;
 
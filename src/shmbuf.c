@@ -17,6 +17,8 @@
  */
 #include "pg_strom.h"
 #include "nodes/memnodes.h"
+#include <mntent.h>
+#include <sys/syscall.h>
 
 #define SHMBUF_CHUNK_MAGIC_CODE		0xdeadbeaf
 #define SHMBUF_CHUNKSZ_MIN_BIT		7		/* 128B */
@@ -24,6 +26,56 @@
 #define SHMBUF_CHUNKSZ_MIN			(1U << SHMBUF_CHUNKSZ_MIN_BIT)
 #define SHMBUF_CHUNKSZ_MAX			(1U << SHMBUF_CHUNKSZ_MAX_BIT)
 
+/*
+ * Small chunks (128B-64KB) are not merged with their buddy on release.
+ * They are kept in the per-backend magazine first, then moved to the
+ * lock-free stack of the memory context for each size class, so that
+ * allocation/release of small chunks don't need context->lock in most
+ * cases. Buddy split/merge is only applied on the larger chunks, or on
+ * the small ones that overflow the stack.
+ */
+#define SHMBUF_SMALL_CHUNKSZ_MAX_BIT	16		/* 64KB */
+#define SHMBUF_NUM_SMALL_CLASSES		(SHMBUF_SMALL_CHUNKSZ_MAX_BIT - \
+										 SHMBUF_CHUNKSZ_MIN_BIT + 1)
+#define SHMBUF_FREESTACK_MAXBYTES		(8UL << 20)	/* 8MB per class */
+#define SHMBUF_FREESTACK_MAXDEPTH(mclass)	\
+	((uint32)(SHMBUF_FREESTACK_MAXBYTES >> (mclass)))
+#define SHMBUF_MAGAZINE_NROOMS			16
+#define SHMBUF_MAGAZINE_NSLOTS			4
+
+/*
+ * Head of the lock-free stack. The lower 40bits are the offset of the chunk
+ * from shmbuf_segment_vaddr_head in SHMBUF_CHUNKSZ_MIN unit, plus 1 (zero
+ * means empty stack). The upper 24bits are ABA counter, incremented on push.
+ */
+#define SHMBUF_FREESTACK_PTR_BITS		40
+#define SHMBUF_FREESTACK_PTR_MASK		((1UL << SHMBUF_FREESTACK_PTR_BITS) - 1)
+
+/* shmbuf.huge_pages */
+#define SHMBUF_HUGE_PAGES__OFF		0
+#define SHMBUF_HUGE_PAGES__TRY		1
+#define SHMBUF_HUGE_PAGES__ON		2
+
+/* placement of the segment pages */
+#define SHMBUF_PAGES__NORMAL		0	/* default page size */
+#define SHMBUF_PAGES__THP			1	/* madvise(MADV_HUGEPAGE) on tmpfs */
+#define SHMBUF_PAGES__HUGETLB		2	/* explicit huge pages on hugetlbfs */
+
+/* shmbuf.numa_policy */
+#define SHMBUF_NUMA_POLICY__DEFAULT		0
+#define SHMBUF_NUMA_POLICY__INTERLEAVE	1	/* interleave pages over the nodes */
+#define SHMBUF_NUMA_POLICY__BIND		2	/* bind each segment to a node
+											 * in round-robin */
+#define SHMBUF_NUMA_MAX_NODES		1024
+
+/* see linux/mempolicy.h; we don't depend on libnuma */
+#ifndef MPOL_BIND
+#define MPOL_BIND					2
+#endif
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE				3
+#endif
+
 typedef struct
 {
 	dlist_node	chain;		/* link to free chunks, or zero if active */
@@ -42,6 +94,9 @@ typedef struct
 	 SHMBUF_CHUNK_MAGIC_TAIL(chunk) == SHMBUF_CHUNK_MAGIC_CODE)
 #define SHMBUF_POINTER_GET_CHUNK(pointer)							\
 	((shmBufferChunk *)((char *)pointer - offsetof(shmBufferChunk, data)))
+/* link to the next chunk on the lock-free stack */
+#define SHMBUF_CHUNK_FREESTACK_NEXT(chunk)		\
+	*((uint64 *)((chunk)->data))
 
 typedef struct
 {
@@ -54,6 +109,11 @@ typedef struct
 								 * we don't use lock to update the field.
 								 */
 	uint32			num_actives;/* number of active chunks */
+	Size			active_space;/* total size of the active chunks */
+	TimestampTz		empty_since;/* time when the segment became empty */
+	int				page_kind;	/* one of SHMBUF_PAGES__* */
+	int				numa_policy;/* one of SHMBUF_NUMA_POLICY__* */
+	int				numa_node;	/* bound NUMA node, if POLICY__BIND */
 	dlist_head		free_chunks[SHMBUF_CHUNKSZ_MAX_BIT -
 								SHMBUF_CHUNKSZ_MIN_BIT + 1];
 } shmBufferSegment;
@@ -63,6 +123,7 @@ typedef struct
 typedef struct
 {
 	slock_t			lock;		/* protection of the list below */
+	pg_atomic_uint32 generation;/* source of shmBufferContext->generation */
 	dlist_head		shmem_context_list;
 	dlist_head		free_segment_list;
 	shmBufferSegment segments[FLEXIBLE_ARRAY_MEMBER];
@@ -82,9 +143,33 @@ typedef struct
 	dlist_node		chain;		/* link to shmem_context_list */
 	slock_t			lock;		/* Lock for shared memory allocation */
 	dlist_head		active_segment_list;
+	pg_atomic_uint32 generation;/* updated on reset; per-backend magazines
+								 * with different generation are stale */
+	pg_atomic_uint32 num_poppers;/* number of backends in the middle of
+								  * lock-free pop; no segment shall be
+								  * dropped during the pop */
+	pg_atomic_uint64 free_stack[SHMBUF_NUM_SMALL_CLASSES];
+	pg_atomic_uint32 free_count[SHMBUF_NUM_SMALL_CLASSES];
+	/* statistics and reclaim; protected by the lock */
+	TimestampTz		last_reclaim;	/* last time of shmBufferReclaimSegments */
+	uint64			num_frag_failures;/* number of allocations that could not
+									   * find a large enough free chunk, even
+									   * though total free space is enough */
+	uint64			num_reclaimed;	/* number of dropped empty segments */
 	char			namebuf[FLEXIBLE_ARRAY_MEMBER];
 } shmBufferContext;
 
+/*
+ * shmBufferMagazine - per-backend cache of the free small chunks
+ */
+typedef struct
+{
+	shmBufferContext *context;	/* owner of the cached chunks, or NULL */
+	uint32			generation;	/* context->generation when cached */
+	int				nitems[SHMBUF_NUM_SMALL_CLASSES];
+	shmBufferChunk *chunks[SHMBUF_NUM_SMALL_CLASSES][SHMBUF_MAGAZINE_NROOMS];
+} shmBufferMagazine;
+
 /* -------- static variables -------- */
 static shmem_startup_hook_type shmem_startup_next = NULL;
 static struct sigaction sigaction_orig_sigsegv;
@@ -92,13 +177,44 @@ static struct sigaction sigaction_orig_sigbus;
 static size_t	shmbuf_segment_size;
 static int		shmbuf_segment_size_kb;		/* GUC */
 static int		shmbuf_num_logical_segment;	/* GUC */
+static int		shmbuf_segment_reclaim_delay;	/* GUC */
+static int		shmbuf_huge_pages;			/* GUC */
+static int		shmbuf_huge_page_size_kb;	/* GUC */
+static int		shmbuf_numa_policy;			/* GUC */
+static char	   *shmbuf_numa_nodes;			/* GUC */
+static char	   *shmbuf_hugetlbfs_dir = NULL;
+static int		shmbuf_numa_num_nodes = 0;
+static int		shmbuf_numa_node_ids[SHMBUF_NUMA_MAX_NODES];
 static shmBufferSegmentHead *shmBufSegHead = NULL;	/* shared memory */
 static shmBufferLocalMap *shmBufLocalMaps = NULL;
 static char	   *shmbuf_segment_vaddr_head = NULL;
 static char	   *shmbuf_segment_vaddr_tail = NULL;
 static MemoryContextMethods sharedMemoryContextMethods;
+static shmBufferMagazine shmBufMagazines[SHMBUF_MAGAZINE_NSLOTS];
+static bool		shmBufMagazineOnExitRegistered = false;
 MemoryContext	TopSharedMemoryContext = NULL;
 
+/* -------- GUC options -------- */
+static const struct config_enum_entry shmbuf_huge_pages_options[] = {
+	{"off",		SHMBUF_HUGE_PAGES__OFF,	false},
+	{"try",		SHMBUF_HUGE_PAGES__TRY,	false},
+	{"on",		SHMBUF_HUGE_PAGES__ON,	false},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry shmbuf_huge_page_size_options[] = {
+	{"2MB",		2 << 10,	false},
+	{"1GB",		1 << 20,	false},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry shmbuf_numa_policy_options[] = {
+	{"default",		SHMBUF_NUMA_POLICY__DEFAULT,	false},
+	{"interleave",	SHMBUF_NUMA_POLICY__INTERLEAVE,	false},
+	{"bind",		SHMBUF_NUMA_POLICY__BIND,		false},
+	{NULL, 0, false}
+};
+
 /* -------- SQL functions -------- */
 Datum pgstrom_shmbuf_info(PG_FUNCTION_ARGS);
 
@@ -119,6 +235,27 @@ shmBufferSegmentMmapPtr(shmBufferSegment *seg)
 	return shmbuf_segment_vaddr_head + segment_id * shmbuf_segment_size;
 }
 
+static inline int
+shmBufferChunkClass(Size required)
+{
+	Size		chunk_sz;
+	int			mclass;
+
+	chunk_sz = (offsetof(shmBufferChunk, data) +	/* header */
+				required +							/* payload */
+				sizeof(uint32));					/* magic */
+	mclass = get_next_log2(chunk_sz);
+	if (mclass < SHMBUF_CHUNKSZ_MIN_BIT)
+		mclass = SHMBUF_CHUNKSZ_MIN_BIT;
+	else if (mclass > SHMBUF_CHUNKSZ_MAX_BIT)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("too large shared memory allocation required: %zu",
+						required),
+				 errhint("try to enlarge shmbuf.segment_size")));
+	return mclass;
+}
+
 static inline shmBufferSegment *
 shmBufferSegmentFromChunk(shmBufferChunk *chunk)
 {
@@ -138,6 +275,38 @@ shmBufferSegmentFromChunk(shmBufferChunk *chunk)
 	snprintf((namebuf),NAMEDATALEN,"/.pg_shmbuf_%u.%u:%u",	\
 			 PostPortNumber,(segment_id),(revision)>>1)
 
+/*
+ * shmBufferOpenSegmentFile / shmBufferUnlinkSegmentFile
+ *
+ * Segments on explicit huge pages are regular files on the hugetlbfs mount,
+ * elsewhere POSIX shared memory objects on /dev/shm.
+ */
+static int
+shmBufferOpenSegmentFile(const char *namebuf, int page_kind, int flags)
+{
+	if (page_kind == SHMBUF_PAGES__HUGETLB)
+	{
+		char	path[MAXPGPATH];
+
+		snprintf(path, sizeof(path), "%s%s", shmbuf_hugetlbfs_dir, namebuf);
+		return open(path, flags, 0600);
+	}
+	return shm_open(namebuf, flags, 0600);
+}
+
+static int
+shmBufferUnlinkSegmentFile(const char *namebuf, int page_kind)
+{
+	if (page_kind == SHMBUF_PAGES__HUGETLB)
+	{
+		char	path[MAXPGPATH];
+
+		snprintf(path, sizeof(path), "%s%s", shmbuf_hugetlbfs_dir, namebuf);
+		return unlink(path);
+	}
+	return shm_unlink(namebuf);
+}
+
 /*
  * shmBufferAttachSegmentOnDemand
  *
@@ -222,12 +391,12 @@ shmBufferAttachSegmentOnDemand(int signum, siginfo_t *siginfo, void *unused)
 		 * Open an "existing" shared memory segment
 		 */
 		SHMBUF_SEGMENT_FILENAME(namebuf, segment_id, revision);
-		fdesc = shm_open(namebuf, O_RDWR, 0600);
+		fdesc = shmBufferOpenSegmentFile(namebuf, seg->page_kind, O_RDWR);
 		if (fdesc < 0)
 		{
 			SpinLockRelease(&lmap->mutex);
 			fprintf(stderr, "pid=%u: %s on %p (seg_id=%u,rev=%u) - "
-					"failed on shm_open('%s'): %m\n",
+					"failed on open('%s'): %m\n",
 					MyProcPid, strsignal(signum), fault_addr,
 					segment_id, revision,
 					namebuf);
@@ -240,7 +409,7 @@ shmBufferAttachSegmentOnDemand(int signum, siginfo_t *siginfo, void *unused)
 				 fdesc, 0) != mmap_ptr)
 		{
 			close(fdesc);
-			shm_unlink(namebuf);
+			shmBufferUnlinkSegmentFile(namebuf, seg->page_kind);
 			SpinLockRelease(&lmap->mutex);
 			fprintf(stderr, "pid=%u: %s on %p (seg_id=%u,rev=%u) - "
 					"failed on mmap('%s'): %m",
@@ -250,6 +419,9 @@ shmBufferAttachSegmentOnDemand(int signum, siginfo_t *siginfo, void *unused)
 			goto normal_crash;
 		}
 		close(fdesc);
+		/* allows khugepaged to collapse the pages in this mapping also */
+		if (seg->page_kind == SHMBUF_PAGES__THP)
+			madvise(mmap_ptr, shmbuf_segment_size, MADV_HUGEPAGE);
 		SpinLockRelease(&lmap->mutex);
 
 		/* problem solved */
@@ -282,6 +454,58 @@ shmBufferAttachSegmentOnDemand(int signum, siginfo_t *siginfo, void *unused)
 	abort();
 }
 
+/*
+ * shmBufferApplyNumaPolicy
+ *
+ * It attaches the NUMA memory policy on the shared mapping of the segment.
+ * The policy of shared memory mapping is kept by the file (shared policy),
+ * so it also affects the pages assigned on the fault of other processes.
+ * We invoke mbind(2) directly to avoid dependency to libnuma.
+ */
+static void
+shmBufferApplyNumaPolicy(shmBufferSegment *seg, char *mmap_ptr)
+{
+	unsigned long nodemask[SHMBUF_NUMA_MAX_NODES / (8 * sizeof(long))];
+	int			mode;
+	int			i;
+
+	seg->numa_policy = SHMBUF_NUMA_POLICY__DEFAULT;
+	seg->numa_node = -1;
+	if (shmbuf_numa_policy == SHMBUF_NUMA_POLICY__DEFAULT ||
+		shmbuf_numa_num_nodes == 0)
+		return;
+
+	memset(nodemask, 0, sizeof(nodemask));
+	if (shmbuf_numa_policy == SHMBUF_NUMA_POLICY__INTERLEAVE)
+	{
+		mode = MPOL_INTERLEAVE;
+		for (i=0; i < shmbuf_numa_num_nodes; i++)
+		{
+			int		node = shmbuf_numa_node_ids[i];
+
+			nodemask[node / (8 * sizeof(long))] |= (1UL << (node % (8 * sizeof(long))));
+		}
+	}
+	else
+	{
+		int		node = shmbuf_numa_node_ids[shmBufferSegmentId(seg) %
+											shmbuf_numa_num_nodes];
+		mode = MPOL_BIND;
+		nodemask[node / (8 * sizeof(long))] |= (1UL << (node % (8 * sizeof(long))));
+		seg->numa_node = node;
+	}
+
+	if (syscall(SYS_mbind, mmap_ptr, shmbuf_segment_size, mode,
+				nodemask, SHMBUF_NUMA_MAX_NODES + 1, 0) != 0)
+	{
+		elog(LOG, "shmbuf: failed on mbind(2) for seg_id=%u, so NUMA policy is not applied: %m",
+			 shmBufferSegmentId(seg));
+		seg->numa_node = -1;
+		return;
+	}
+	seg->numa_policy = shmbuf_numa_policy;
+}
+
 /*
  * shmBufferCreateSegment - create a new shared memory segment
  */
@@ -294,6 +518,7 @@ shmBufferCreateSegment(void)
 	uint32		segment_id;
 	uint32		revision;
 	int			mclass;
+	int			page_kind;
 	char	   *mmap_ptr;
 	char	   *head_ptr;
 	char	   *tail_ptr;
@@ -344,18 +569,23 @@ shmBufferCreateSegment(void)
 
 	/*
 	 * Create a new shared memory segment
+	 *
+	 * NOTE: NUMA policy must be attached on the mapping prior to fallocate(),
+	 * because the physical pages are assigned at that time.
 	 */
-	fdesc = shm_open(namebuf, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	page_kind = (shmbuf_hugetlbfs_dir ? SHMBUF_PAGES__HUGETLB :
+				 shmbuf_huge_pages != SHMBUF_HUGE_PAGES__OFF ? SHMBUF_PAGES__THP :
+				 SHMBUF_PAGES__NORMAL);
+retry:
+	fdesc = shmBufferOpenSegmentFile(namebuf, page_kind,
+									 O_RDWR | O_CREAT | O_TRUNC);
 	if (fdesc < 0)
-		elog(ERROR, "failed on shm_open('%s'): %m", namebuf);
-
-	while (fallocate(fdesc, 0, 0, shmbuf_segment_size) != 0)
+		elog(ERROR, "failed on open('%s'): %m", namebuf);
+	if (ftruncate(fdesc, shmbuf_segment_size) != 0)
 	{
-		if (errno == EINTR)
-			continue;
 		close(fdesc);
-		shm_unlink(namebuf);
-		elog(ERROR, "failed on fallocate('%s'): %m", namebuf);
+		shmBufferUnlinkSegmentFile(namebuf, page_kind);
+		elog(ERROR, "failed on ftruncate('%s'): %m", namebuf);
 	}
 
 	if (mmap(mmap_ptr, shmbuf_segment_size,
@@ -364,10 +594,42 @@ shmBufferCreateSegment(void)
 			 fdesc, 0) != mmap_ptr)
 	{
 		close(fdesc);
-		shm_unlink(namebuf);
+		shmBufferUnlinkSegmentFile(namebuf, page_kind);
 		elog(ERROR, "failed on mmap('%s'): %m", namebuf);
 	}
+	if (page_kind == SHMBUF_PAGES__THP)
+		madvise(mmap_ptr, shmbuf_segment_size, MADV_HUGEPAGE);
+	shmBufferApplyNumaPolicy(seg, mmap_ptr);
+
+	while (fallocate(fdesc, 0, 0, shmbuf_segment_size) != 0)
+	{
+		int		errno_saved = errno;
+
+		if (errno == EINTR)
+			continue;
+		close(fdesc);
+		shmBufferUnlinkSegmentFile(namebuf, page_kind);
+		if (mmap(mmap_ptr, shmbuf_segment_size,
+				 PROT_NONE,
+				 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+				 -1, 0) != mmap_ptr)
+			elog(FATAL, "failed on mmap(PROT_NONE) for seg_id=%u at %p: %m",
+				 segment_id, mmap_ptr);
+		errno = errno_saved;
+		/* run out of huge pages? fallback to the normal pages */
+		if (page_kind == SHMBUF_PAGES__HUGETLB &&
+			shmbuf_huge_pages == SHMBUF_HUGE_PAGES__TRY &&
+			(errno == ENOSPC || errno == ENOMEM))
+		{
+			elog(LOG, "shmbuf: no huge pages available for seg_id=%u, fallback to normal pages: %m",
+				 segment_id);
+			page_kind = SHMBUF_PAGES__THP;
+			goto retry;
+		}
+		elog(ERROR, "failed on fallocate('%s'): %m", namebuf);
+	}
 	close(fdesc);
+	seg->page_kind = page_kind;
 
 	/*
 	 * Ok, successfully mapped.
@@ -396,6 +658,8 @@ shmBufferCreateSegment(void)
 		head_ptr += (1UL << mclass);
 	}
 	seg->num_actives = 0;
+	seg->active_space = 0;
+	seg->empty_since = 0;
 
 	/* also, update the local mapping */
 	lmap->is_attached = true;
@@ -446,13 +710,14 @@ shmBufferDropSegment(shmBufferSegment *seg)
 	 * exception, and signal handler unmap the segment at other processes also.
 	 */
 	SHMBUF_SEGMENT_FILENAME(namebuf, segment_id, revision);
-	fdesc = shm_open(namebuf, O_RDWR | O_TRUNC, 0600);
+	fdesc = shmBufferOpenSegmentFile(namebuf, seg->page_kind,
+									 O_RDWR | O_TRUNC);
 	if (fdesc < 0)
-		elog(FATAL, "failed on shm_opem('%s') with O_TRUNC: %m", namebuf);
+		elog(FATAL, "failed on open('%s') with O_TRUNC: %m", namebuf);
 	close(fdesc);
 
-	if (shm_unlink(namebuf) < 0)
-		elog(FATAL, "failed on shm_unlink('%s'): %m", namebuf);
+	if (shmBufferUnlinkSegmentFile(namebuf, seg->page_kind) < 0)
+		elog(FATAL, "failed on unlink('%s'): %m", namebuf);
 }
 
 /*
@@ -511,22 +776,8 @@ __shmBufferAllocChunkFromSegment(shmBufferSegment *seg, Size required)
 {
 	shmBufferChunk *chunk;
 	dlist_node	   *dnode;
-	Size			chunk_sz;
-	int				mclass, mindex;
-
-	chunk_sz = (offsetof(shmBufferChunk, data) +	/* header */
-				required +							/* payload */
-				sizeof(uint32));					/* magic */
-	mclass = get_next_log2(chunk_sz);
-	if (mclass < SHMBUF_CHUNKSZ_MIN_BIT)
-		mclass = SHMBUF_CHUNKSZ_MIN_BIT;
-	else if (mclass > SHMBUF_CHUNKSZ_MAX_BIT)
-		ereport(ERROR,
-				(errcode(ERRCODE_OUT_OF_MEMORY),
-				 errmsg("too large shared memory allocation required: %zu",
-						required),
-				 errhint("try to enlarge shmbuf.segment_size")));
-	mindex = mclass - SHMBUF_CHUNKSZ_MIN_BIT;
+	int				mclass = shmBufferChunkClass(required);
+	int				mindex = mclass - SHMBUF_CHUNKSZ_MIN_BIT;
 
 	if (dlist_is_empty(&seg->free_chunks[mindex]))
 	{
@@ -542,18 +793,28 @@ __shmBufferAllocChunkFromSegment(shmBufferSegment *seg, Size required)
 	chunk->required = required;
 	SHMBUF_CHUNK_MAGIC_TAIL(chunk) = SHMBUF_CHUNK_MAGIC_CODE;
 
-	seg->num_actives++;
+	if (seg->num_actives++ == 0)
+		seg->empty_since = 0;
+	seg->active_space += (1UL << mclass);
 
 	return chunk;
 }
 
+static int	shmBufferDrainFreeStack(shmBufferContext *context);
+static void	shmBufferReclaimSegments(shmBufferContext *context);
+
 static shmBufferChunk *
 shmBufferAllocChunk(shmBufferContext *context, Size required)
 {
 	shmBufferSegment *seg;
 	shmBufferChunk *chunk;
 	dlist_iter		iter;
+	Size			chunk_sz = (1UL << shmBufferChunkClass(required));
+	Size			free_space;
+	bool			drained = false;
 
+retry:
+	free_space = 0;
 	dlist_foreach (iter, &context->active_segment_list)
 	{
 		shmBufferSegment   *seg = dlist_container(shmBufferSegment,
@@ -564,6 +825,25 @@ shmBufferAllocChunk(shmBufferContext *context, Size required)
 			chunk->memcxt = (MemoryContext) context;
 			return chunk;
 		}
+		free_space += shmbuf_segment_size - seg->active_space;
+	}
+
+	/*
+	 * The segments have enough free space in total, but no free chunk is
+	 * large enough. Small chunks cached in the lock-free stack may prevent
+	 * merge of buddies, so we release them to the buddy allocator once,
+	 * prior to creation of a new segment.
+	 */
+	if (free_space >= chunk_sz)
+	{
+		context->num_frag_failures++;
+		elog(DEBUG1, "%s: no free chunk for %zu bytes due to fragmentation (free space: %zu bytes)",
+			 context->header.name, chunk_sz, free_space);
+		if (!drained && shmBufferDrainFreeStack(context) > 0)
+		{
+			drained = true;
+			goto retry;
+		}
 	}
 	/* create a new segment */
 	seg = shmBufferCreateSegment();
@@ -592,6 +872,8 @@ shmBufferFreeChunk(shmBufferSegment *seg, shmBufferChunk *chunk)
 	Assert(chunk->mclass >= SHMBUF_CHUNKSZ_MIN_BIT &&
 		   chunk->mclass <= SHMBUF_CHUNKSZ_MAX_BIT &&
 		   SHMBUF_CHUNK_CHECK_MAGIC(chunk));
+	Assert(seg->active_space >= (1UL << chunk->mclass));
+	seg->active_space -= (1UL << chunk->mclass);
 	while (chunk->mclass <= SHMBUF_CHUNKSZ_MAX_BIT)
 	{
 		Size	offset = (uintptr_t)chunk - (uintptr_t)mmap_ptr;
@@ -643,37 +925,427 @@ shmBufferFreeChunk(shmBufferSegment *seg, shmBufferChunk *chunk)
 }
 
 /*
- * shmBufferCleanupOnPostmasterExit
+ * shmemPointerValidation
+ */
+#ifdef USE_ASSERT_CHECKING
+static bool
+shmemPointerValidation(shmBufferContext *context,
+					   shmBufferSegment *seg,
+					   shmBufferChunk *chunk)
+{
+	dlist_iter	iter;
+
+	dlist_foreach (iter, &context->active_segment_list)
+	{
+		shmBufferSegment *__seg = dlist_container(shmBufferSegment,
+												  chain, iter.cur);
+		if (seg == __seg)
+			return true;
+	}
+	return false;	/* not found */
+}
+#endif	/* USE_ASSERT_CHECKING */
+
+/*
+ * __shmBufferDropEmptySegment
+ *
+ * NOTE: caller must hold the shmBufferContext->lock of the memory context
  */
 static void
-shmBufferCleanupOnPostmasterExit(int code, Datum arg)
+__shmBufferDropEmptySegment(shmBufferContext *context, shmBufferSegment *seg)
 {
-	if (MyProcPid == PostmasterPid)
+	Assert(seg->num_actives == 0);
+	/*
+	 * We detach the segment from the MemoryContext (so, nobody allocates
+	 * a new chunk concurrently), then drop the shared memory file on behalf
+	 * of the segment. It shall be backed to the free_segment_list for reuse,
+	 * but it shall have different revision number when someone maps the
+	 * segment again.
+	 */
+	dlist_delete(&seg->chain);
+	shmBufferDropSegment(seg);
+	context->num_reclaimed++;
+
+	SpinLockAcquire(&shmBufSegHead->lock);
+	dlist_push_head(&shmBufSegHead->free_segment_list, &seg->chain);
+	SpinLockRelease(&shmBufSegHead->lock);
+}
+
+/*
+ * __shmBufferReleaseChunk
+ *
+ * It returns the chunk to the buddy allocator. If the segment becomes empty,
+ * it is kept for shmbuf.segment_reclaim_delay, then dropped by
+ * shmBufferReclaimSegments(). Also, if somebody is in the middle of
+ * lock-free pop, it may still reference the segment, so we cannot drop
+ * the segment immediately.
+ *
+ * NOTE: caller must hold the shmBufferContext->lock of the memory context
+ */
+static void
+__shmBufferReleaseChunk(shmBufferContext *context, shmBufferChunk *chunk)
+{
+	shmBufferSegment   *seg = shmBufferSegmentFromChunk(chunk);
+
+	Assert(shmemPointerValidation(context, seg, chunk));
+	if (shmBufferFreeChunk(seg, chunk))
+	{
+		if (shmbuf_segment_reclaim_delay == 0 &&
+			pg_atomic_read_u32(&context->num_poppers) == 0)
+			__shmBufferDropEmptySegment(context, seg);
+		else
+			seg->empty_since = GetCurrentTimestamp();
+	}
+}
+
+/*
+ * shmBufferFreeStackPush
+ *
+ * It pushes a free small chunk onto the lock-free stack of the context.
+ * It returns false if the stack already has enough chunks; caller has to
+ * release the chunk to the buddy allocator instead.
+ */
+static bool
+shmBufferFreeStackPush(shmBufferContext *context, shmBufferChunk *chunk)
+{
+	int			mindex = chunk->mclass - SHMBUF_CHUNKSZ_MIN_BIT;
+	pg_atomic_uint64 *stack = &context->free_stack[mindex];
+	uint64		sptr;
+	uint64		oldval;
+	uint64		newval;
+
+	Assert(chunk->mclass >= SHMBUF_CHUNKSZ_MIN_BIT &&
+		   chunk->mclass <= SHMBUF_SMALL_CHUNKSZ_MAX_BIT);
+	if (pg_atomic_read_u32(&context->free_count[mindex]) >=
+		SHMBUF_FREESTACK_MAXDEPTH(chunk->mclass))
+		return false;
+
+	sptr = (((uintptr_t)chunk -
+			 (uintptr_t)shmbuf_segment_vaddr_head) >> SHMBUF_CHUNKSZ_MIN_BIT) + 1;
+	Assert((sptr & ~SHMBUF_FREESTACK_PTR_MASK) == 0);
+	chunk->required = 0;
+	oldval = pg_atomic_read_u64(stack);
+	do {
+		SHMBUF_CHUNK_FREESTACK_NEXT(chunk) = (oldval & SHMBUF_FREESTACK_PTR_MASK);
+		newval = (((oldval & ~SHMBUF_FREESTACK_PTR_MASK) +
+				   (1UL << SHMBUF_FREESTACK_PTR_BITS)) | sptr);
+	} while (!pg_atomic_compare_exchange_u64(stack, &oldval, newval));
+	pg_atomic_fetch_add_u32(&context->free_count[mindex], 1);
+
+	return true;
+}
+
+/*
+ * shmBufferFreeStackPop
+ *
+ * It pops a free small chunk from the lock-free stack of the context.
+ * The next link of the top chunk may be overwritten by the concurrent
+ * backend that has popped the same chunk, but ABA counter makes our CAS
+ * fail in this case. num_poppers prevents the segment to be dropped
+ * during the reference to the chunk.
+ */
+static shmBufferChunk *
+shmBufferFreeStackPop(shmBufferContext *context, int mclass)
+{
+	int			mindex = mclass - SHMBUF_CHUNKSZ_MIN_BIT;
+	pg_atomic_uint64 *stack = &context->free_stack[mindex];
+	shmBufferChunk *chunk;
+	uint64		oldval;
+	uint64		newval;
+
+	Assert(mclass >= SHMBUF_CHUNKSZ_MIN_BIT &&
+		   mclass <= SHMBUF_SMALL_CHUNKSZ_MAX_BIT);
+	pg_atomic_fetch_add_u32(&context->num_poppers, 1);
+	oldval = pg_atomic_read_u64(stack);
+	do {
+		uint64		sptr = (oldval & SHMBUF_FREESTACK_PTR_MASK);
+
+		if (sptr == 0)
+		{
+			chunk = NULL;
+			break;
+		}
+		chunk = (shmBufferChunk *)(shmbuf_segment_vaddr_head +
+								   ((sptr - 1) << SHMBUF_CHUNKSZ_MIN_BIT));
+		newval = ((oldval & ~SHMBUF_FREESTACK_PTR_MASK) |
+				  (SHMBUF_CHUNK_FREESTACK_NEXT(chunk) & SHMBUF_FREESTACK_PTR_MASK));
+	} while (!pg_atomic_compare_exchange_u64(stack, &oldval, newval));
+	pg_atomic_fetch_sub_u32(&context->num_poppers, 1);
+
+	if (chunk)
+	{
+		pg_atomic_fetch_sub_u32(&context->free_count[mindex], 1);
+		Assert(chunk->mclass == mclass &&
+			   SHMBUF_CHUNK_MAGIC_HEAD(chunk) == SHMBUF_CHUNK_MAGIC_CODE &&
+			   chunk->memcxt == (MemoryContext) context);
+	}
+	return chunk;
+}
+
+/*
+ * shmBufferReleaseSmallChunks
+ *
+ * It moves the free small chunks to the lock-free stack, or to the buddy
+ * allocator if stack is already full.
+ */
+static void
+shmBufferReleaseSmallChunks(shmBufferContext *context,
+							shmBufferChunk **chunks, int nchunks)
+{
+	shmBufferChunk *overflow[SHMBUF_MAGAZINE_NROOMS];
+	int			i, noverflow = 0;
+
+	Assert(nchunks <= SHMBUF_MAGAZINE_NROOMS);
+	for (i=0; i < nchunks; i++)
+	{
+		if (!shmBufferFreeStackPush(context, chunks[i]))
+			overflow[noverflow++] = chunks[i];
+	}
+
+	if (noverflow > 0)
+	{
+		SpinLockAcquire(&context->lock);
+		for (i=0; i < noverflow; i++)
+			__shmBufferReleaseChunk(context, overflow[i]);
+		shmBufferReclaimSegments(context);
+		SpinLockRelease(&context->lock);
+	}
+}
+
+/*
+ * shmBufferDrainFreeStack
+ *
+ * It releases all the small chunks in the lock-free stacks to the buddy
+ * allocator, to merge buddies and to make empty segments.
+ *
+ * NOTE: caller must hold the shmBufferContext->lock of the memory context
+ */
+static int
+shmBufferDrainFreeStack(shmBufferContext *context)
+{
+	shmBufferChunk *chunk;
+	int			mclass;
+	int			count = 0;
+
+	for (mclass = SHMBUF_CHUNKSZ_MIN_BIT;
+		 mclass <= SHMBUF_SMALL_CHUNKSZ_MAX_BIT;
+		 mclass++)
+	{
+		while ((chunk = shmBufferFreeStackPop(context, mclass)) != NULL)
+		{
+			__shmBufferReleaseChunk(context, chunk);
+			count++;
+		}
+	}
+	return count;
+}
+
+/*
+ * shmBufferReclaimSegments
+ *
+ * It drops the segments that have been empty longer than
+ * shmbuf.segment_reclaim_delay. It runs at most once per the delay
+ * (or per second, if zero), from the slow path under the context->lock.
+ * The small chunks in the lock-free stacks are drained at the same time,
+ * because they pin the segments that are otherwise empty.
+ *
+ * NOTE: caller must hold the shmBufferContext->lock of the memory context
+ */
+static void
+shmBufferReclaimSegments(shmBufferContext *context)
+{
+	long		delay_ms = Max(shmbuf_segment_reclaim_delay, 1) * 1000L;
+	TimestampTz	now = GetCurrentTimestamp();
+	dlist_mutable_iter iter;
+
+	if (!TimestampDifferenceExceeds(context->last_reclaim, now, delay_ms))
+		return;
+	context->last_reclaim = now;
+
+	shmBufferDrainFreeStack(context);
+	if (pg_atomic_read_u32(&context->num_poppers) > 0)
+		return;
+	delay_ms = shmbuf_segment_reclaim_delay * 1000L;
+	dlist_foreach_modify(iter, &context->active_segment_list)
+	{
+		shmBufferSegment *seg = dlist_container(shmBufferSegment,
+												chain, iter.cur);
+		if (seg->num_actives == 0 &&
+			TimestampDifferenceExceeds(seg->empty_since, now, delay_ms))
+			__shmBufferDropEmptySegment(context, seg);
+	}
+}
+
+/*
+ * shmBufferMagazineFlushOnExit
+ *
+ * It returns the chunks in the per-backend magazines to the shared stack
+ * on exit of the backend, unless the owner context has already gone.
+ */
+static void
+shmBufferMagazineFlushOnExit(int code, Datum arg)
+{
+	int			i, j;
+
+	for (i=0; i < SHMBUF_MAGAZINE_NSLOTS; i++)
 	{
-		DIR			   *dir = opendir("/dev/shm");
-		struct dirent  *dentry;
-		char			namebuf[NAMEDATALEN];
-		size_t			namelen;
+		shmBufferMagazine *mag = &shmBufMagazines[i];
+		bool		found = false;
+		dlist_iter	iter;
+
+		if (!mag->context)
+			continue;
+		SpinLockAcquire(&shmBufSegHead->lock);
+		dlist_foreach(iter, &shmBufSegHead->shmem_context_list)
+		{
+			if (mag->context == dlist_container(shmBufferContext,
+												chain, iter.cur))
+			{
+				found = true;
+				break;
+			}
+		}
+		SpinLockRelease(&shmBufSegHead->lock);
+
+		if (found &&
+			mag->generation == pg_atomic_read_u32(&mag->context->generation))
+		{
+			for (j=0; j < SHMBUF_NUM_SMALL_CLASSES; j++)
+				shmBufferReleaseSmallChunks(mag->context,
+											mag->chunks[j],
+											mag->nitems[j]);
+		}
+		memset(mag, 0, sizeof(shmBufferMagazine));
+	}
+}
+
+/*
+ * shmBufferLookupMagazine
+ */
+static shmBufferMagazine *
+shmBufferLookupMagazine(shmBufferContext *context, bool create_if_missing)
+{
+	shmBufferMagazine *mag = NULL;
+	uint32		generation = pg_atomic_read_u32(&context->generation);
+	int			i;
 
-		namelen = snprintf(namebuf, sizeof(namebuf),
-						   ".pg_shmbuf_%u.", PostPortNumber);
-		if (!dir)
-			return;
-		while ((dentry = readdir(dir)) != NULL)
+	for (i=0; i < SHMBUF_MAGAZINE_NSLOTS; i++)
+	{
+		if (shmBufMagazines[i].context == context)
 		{
-			if (dentry->d_type != DT_REG)
-				continue;
-			if (strncmp(dentry->d_name, namebuf, namelen) == 0)
+			mag = &shmBufMagazines[i];
+			if (mag->generation != generation)
 			{
-				if (shm_unlink(dentry->d_name) != 0)
-					elog(LOG, "failed on shm_unlink('%s'): %m",
-						 dentry->d_name);
-				else
-					elog(LOG, "shared memory segment [%s] is removed.",
-						 dentry->d_name);
+				/* the context was reset, so cached chunks are gone */
+				memset(mag->nitems, 0, sizeof(mag->nitems));
+				mag->generation = generation;
 			}
+			return mag;
+		}
+		if (!mag && !shmBufMagazines[i].context)
+			mag = &shmBufMagazines[i];
+	}
+	if (!create_if_missing || !mag)
+		return NULL;
+
+	if (!shmBufMagazineOnExitRegistered)
+	{
+		before_shmem_exit(shmBufferMagazineFlushOnExit, 0);
+		shmBufMagazineOnExitRegistered = true;
+	}
+	memset(mag, 0, sizeof(shmBufferMagazine));
+	mag->context = context;
+	mag->generation = generation;
+
+	return mag;
+}
+
+/*
+ * shmBufferAllocSmallChunk - allocation without context->lock
+ */
+static shmBufferChunk *
+shmBufferAllocSmallChunk(shmBufferContext *context, int mclass)
+{
+	shmBufferMagazine *mag = shmBufferLookupMagazine(context, false);
+	int			mindex = mclass - SHMBUF_CHUNKSZ_MIN_BIT;
+
+	if (mag && mag->nitems[mindex] > 0)
+		return mag->chunks[mindex][--mag->nitems[mindex]];
+	return shmBufferFreeStackPop(context, mclass);
+}
+
+/*
+ * shmBufferFreeSmallChunk - release without context->lock in most cases
+ */
+static void
+shmBufferFreeSmallChunk(shmBufferContext *context, shmBufferChunk *chunk)
+{
+	shmBufferMagazine *mag = shmBufferLookupMagazine(context, true);
+	int			mindex = chunk->mclass - SHMBUF_CHUNKSZ_MIN_BIT;
+
+	if (!mag)
+	{
+		shmBufferReleaseSmallChunks(context, &chunk, 1);
+		return;
+	}
+	if (mag->nitems[mindex] >= SHMBUF_MAGAZINE_NROOMS)
+	{
+		/* move the older half of the magazine to the shared stack */
+		int			nflush = SHMBUF_MAGAZINE_NROOMS / 2;
+
+		shmBufferReleaseSmallChunks(context, mag->chunks[mindex], nflush);
+		memmove(mag->chunks[mindex],
+				mag->chunks[mindex] + nflush,
+				sizeof(shmBufferChunk *) * (mag->nitems[mindex] - nflush));
+		mag->nitems[mindex] -= nflush;
+	}
+	chunk->required = 0;
+	mag->chunks[mindex][mag->nitems[mindex]++] = chunk;
+}
+
+/*
+ * shmBufferCleanupOnPostmasterExit
+ */
+static void
+__shmBufferCleanupSegmentFiles(const char *dirname, int page_kind)
+{
+	DIR			   *dir = opendir(dirname);
+	struct dirent  *dentry;
+	char			prefix[NAMEDATALEN];
+	char			namebuf[MAXPGPATH];
+	size_t			prefixlen;
+
+	prefixlen = snprintf(prefix, sizeof(prefix),
+						 ".pg_shmbuf_%u.", PostPortNumber);
+	if (!dir)
+		return;
+	while ((dentry = readdir(dir)) != NULL)
+	{
+		if (dentry->d_type != DT_REG)
+			continue;
+		if (strncmp(dentry->d_name, prefix, prefixlen) == 0)
+		{
+			snprintf(namebuf, sizeof(namebuf), "/%s", dentry->d_name);
+			if (shmBufferUnlinkSegmentFile(namebuf, page_kind) != 0)
+				elog(LOG, "failed on unlink('%s'): %m",
+					 dentry->d_name);
+			else
+				elog(LOG, "shared memory segment [%s] is removed.",
+					 dentry->d_name);
 		}
-		closedir(dir);
+	}
+	closedir(dir);
+}
+
+static void
+shmBufferCleanupOnPostmasterExit(int code, Datum arg)
+{
+	if (MyProcPid == PostmasterPid)
+	{
+		__shmBufferCleanupSegmentFiles("/dev/shm", SHMBUF_PAGES__NORMAL);
+		if (shmbuf_hugetlbfs_dir)
+			__shmBufferCleanupSegmentFiles(shmbuf_hugetlbfs_dir,
+										   SHMBUF_PAGES__HUGETLB);
 	}
 }
 
@@ -685,11 +1357,25 @@ shmemContextAlloc(MemoryContext __context, Size required)
 {
 	shmBufferContext *context = (shmBufferContext *) __context;
 	shmBufferChunk *chunk;
+	int				mclass = shmBufferChunkClass(required);
+
+	if (mclass <= SHMBUF_SMALL_CHUNKSZ_MAX_BIT)
+	{
+		chunk = shmBufferAllocSmallChunk(context, mclass);
+		if (chunk)
+		{
+			Assert(chunk->memcxt == __context);
+			chunk->required = required;
+			SHMBUF_CHUNK_MAGIC_TAIL(chunk) = SHMBUF_CHUNK_MAGIC_CODE;
+			return chunk->data;
+		}
+	}
 
 	SpinLockAcquire(&context->lock);
 	PG_TRY();
 	{
 		chunk = shmBufferAllocChunk(context, required);
+		shmBufferReclaimSegments(context);
 	}
 	PG_CATCH();
 	{
@@ -705,28 +1391,6 @@ shmemContextAlloc(MemoryContext __context, Size required)
 	return chunk->data;
 }
 
-/*
- * shmemPointerValidation
- */
-#ifdef USE_ASSERT_CHECKING
-static bool
-shmemPointerValidation(shmBufferContext *context,
-					   shmBufferSegment *seg,
-					   shmBufferChunk *chunk)
-{
-	dlist_iter	iter;
-
-	dlist_foreach (iter, &context->active_segment_list)
-	{
-		shmBufferSegment *__seg = dlist_container(shmBufferSegment,
-												  chain, iter.cur);
-		if (seg == __seg)
-			return true;
-	}
-	return false;	/* not found */
-}
-#endif	/* USE_ASSERT_CHECKING */
-
 /*
  * shmemContextFree
  */
@@ -735,28 +1399,17 @@ shmemContextFree(MemoryContext __context, void *pointer)
 {
 	shmBufferContext   *context = (shmBufferContext *) __context;
 	shmBufferChunk	   *chunk = SHMBUF_POINTER_GET_CHUNK(pointer);
-	shmBufferSegment   *seg = shmBufferSegmentFromChunk(chunk);
 
-	SpinLockAcquire(&context->lock);
-	Assert(shmemPointerValidation(context, seg, chunk));
-
-	/* release chunk, and drop segment if it becomes empty */
-	if (shmBufferFreeChunk(seg, chunk))
+	Assert(SHMBUF_CHUNK_CHECK_MAGIC(chunk) && chunk->memcxt == __context);
+	if (chunk->mclass <= SHMBUF_SMALL_CHUNKSZ_MAX_BIT)
 	{
-		/*
-		 * If this chunk is the last one in the segment, we detach it from
-		 * the MemoryContext (so, nobody allocates a new chunk concurrently),
-		 * then drop the shared memory file on behalf of the segment.
-		 * It shall be backed to the free_segment_list for reuse, but it shall
-		 * have different revision number when someone maps the segment again.
-		 */
-		dlist_delete(&seg->chain);
-		shmBufferDropSegment(seg);
-
-		SpinLockAcquire(&shmBufSegHead->lock);
-		dlist_push_head(&shmBufSegHead->free_segment_list, &seg->chain);
-		SpinLockRelease(&shmBufSegHead->lock);
+		shmBufferFreeSmallChunk(context, chunk);
+		return;
 	}
+	/* release chunk, and reclaim segments if empty for a while */
+	SpinLockAcquire(&context->lock);
+	__shmBufferReleaseChunk(context, chunk);
+	shmBufferReclaimSegments(context);
 	SpinLockRelease(&context->lock);
 }
 
@@ -770,23 +1423,10 @@ shmemContextRealloc(MemoryContext __context, void *pointer, Size required)
 	shmBufferChunk	   *chunk = SHMBUF_POINTER_GET_CHUNK(pointer);
 	shmBufferSegment   *seg = shmBufferSegmentFromChunk(chunk);
 	char			   *mmap_ptr = shmBufferSegmentMmapPtr(seg);
-	Size				chunk_sz;
 	Size				offset, shift;
-	int					mclass;
+	int					mclass = shmBufferChunkClass(required);
 
 	Assert(shmemPointerValidation(context, seg, chunk));
-	chunk_sz = (offsetof(shmBufferChunk, data) +	/* header */
-				required +							/* payload */
-				sizeof(uint32));					/* magic */
-	mclass = get_next_log2(chunk_sz);
-	if (mclass < SHMBUF_CHUNKSZ_MIN_BIT)
-		mclass = SHMBUF_CHUNKSZ_MIN_BIT;
-	else if (mclass > SHMBUF_CHUNKSZ_MAX_BIT)
-		ereport(ERROR,
-				(errcode(ERRCODE_OUT_OF_MEMORY),
-				 errmsg("too large shared memory allocation required: %zu",
-						required),
-				 errhint("try to enlarge shmbuf.segment_size")));
 
 	SpinLockAcquire(&context->lock);
 	PG_TRY();
@@ -811,6 +1451,7 @@ shmemContextRealloc(MemoryContext __context, void *pointer, Size required)
 			dlist_delete(&buddy->chain);
 			memset(buddy, 0, offsetof(shmBufferChunk, data));
 			chunk->mclass++;
+			seg->active_space += shift;
 		}
 
 		if (chunk->mclass >= mclass)
@@ -822,7 +1463,6 @@ shmemContextRealloc(MemoryContext __context, void *pointer, Size required)
 		else
 		{
 			/* slow realloc */
-			shmBufferSegment *seg = shmBufferSegmentFromChunk(chunk);
 			shmBufferChunk *temp;
 
 			Assert(required >= chunk->required);
@@ -830,17 +1470,7 @@ shmemContextRealloc(MemoryContext __context, void *pointer, Size required)
 			memcpy(temp->data, chunk->data, chunk->required);
 
 			/* release the original chunk */
-			if (shmBufferFreeChunk(seg, chunk))
-			{
-				/* see comments in shmemContextFree() */
-				dlist_delete(&seg->chain);
-				shmBufferDropSegment(seg);
-
-				SpinLockAcquire(&shmBufSegHead->lock);
-				dlist_push_head(&shmBufSegHead->free_segment_list,
-								&seg->chain);
-				SpinLockRelease(&shmBufSegHead->lock);
-			}
+			__shmBufferReleaseChunk(context, chunk);
 			/* replace the original chunk by the new one */
 			chunk = temp;
 		}
@@ -868,8 +1498,17 @@ shmemContextReset(MemoryContext __context)
 	shmBufferContext   *context = (shmBufferContext *) __context;
 	shmBufferSegment   *seg;
 	dlist_node		   *dnode;
+	int					i;
 
 	SpinLockAcquire(&context->lock);
+	/* cached small chunks and per-backend magazines become invalid */
+	for (i=0; i < SHMBUF_NUM_SMALL_CLASSES; i++)
+	{
+		pg_atomic_write_u64(&context->free_stack[i], 0);
+		pg_atomic_write_u32(&context->free_count[i], 0);
+	}
+	pg_atomic_write_u32(&context->generation,
+						pg_atomic_add_fetch_u32(&shmBufSegHead->generation, 1));
 	while (!dlist_is_empty(&context->active_segment_list))
 	{
 		dnode = dlist_pop_head_node(&context->active_segment_list);
@@ -1125,6 +1764,78 @@ pgstrom_shmbuf_realloc(PG_FUNCTION_ARGS)
 	PG_RETURN_INT64(new_ptr);
 }
 PG_FUNCTION_INFO_V1(pgstrom_shmbuf_realloc);
+
+/*
+ * pgstrom_shmbuf_bench
+ *
+ * It repeats alloc/free of the random sized chunks in [min_sz, max_sz] on
+ * TopSharedMemoryContext, with keeping 'nkeeps' chunks alive, then returns
+ * the average time of alloc+free pair in nanoseconds. Run it on multiple
+ * concurrent sessions to see the contention.
+ */
+Datum pgstrom_shmbuf_bench(PG_FUNCTION_ARGS);
+
+Datum
+pgstrom_shmbuf_bench(PG_FUNCTION_ARGS)
+{
+	int32		nloops = PG_GETARG_INT32(0);
+	int64		min_sz = PG_GETARG_INT64(1);
+	int64		max_sz = PG_GETARG_INT64(2);
+	int32		nkeeps = PG_GETARG_INT32(3);
+	void	  **keeps;
+	uint64		seed = (uint64)MyProcPid * 0x9e3779b97f4a7c15UL + 1;
+	instr_time	tv1, tv2;
+	int			i;
+
+	if (nloops <= 0 || nkeeps <= 0)
+		elog(ERROR, "shmbuf_bench: nloops and nkeeps must be positive");
+	if (min_sz <= 0 || min_sz > max_sz)
+		elog(ERROR, "shmbuf_bench: invalid chunk size range [%ld, %ld]",
+			 min_sz, max_sz);
+	keeps = palloc0(sizeof(void *) * nkeeps);
+
+	INSTR_TIME_SET_CURRENT(tv1);
+	PG_TRY();
+	{
+		for (i=0; i < nloops; i++)
+		{
+			int		k = i % nkeeps;
+			Size	sz;
+
+			/* xorshift64 */
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			sz = min_sz + seed % (max_sz - min_sz + 1);
+
+			if (keeps[k])
+				pfree(keeps[k]);
+			keeps[k] = MemoryContextAlloc(TopSharedMemoryContext, sz);
+		}
+	}
+	PG_CATCH();
+	{
+		for (i=0; i < nkeeps; i++)
+		{
+			if (keeps[i])
+				pfree(keeps[i]);
+		}
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	for (i=0; i < nkeeps; i++)
+	{
+		if (keeps[i])
+			pfree(keeps[i]);
+	}
+	INSTR_TIME_SET_CURRENT(tv2);
+	INSTR_TIME_SUBTRACT(tv2, tv1);
+
+	PG_RETURN_FLOAT8((double)INSTR_TIME_GET_MICROSEC(tv2) * 1000.0 /
+					 (double)nloops);
+}
+PG_FUNCTION_INFO_V1(pgstrom_shmbuf_bench);
 #endif
 
 static void
@@ -1140,10 +1851,43 @@ __pgstrom_shmbuf_segment_info(StringInfo str, shmBufferSegment *seg)
 	Size		required_space = 0;
 	Size		alloc_space = 0;
 	Size		free_space = 0;
+	Size		largest_free = 0;
 	int			i, count = 0;
 
 	appendStringInfo(str, "{ \"segment-id\" : %u, \"revision\" : %u",
 					 segment_id, revision);
+	appendStringInfo(str, ", \"num-actives\" : %u", seg->num_actives);
+	if (seg->num_actives == 0 && seg->empty_since != 0)
+		appendStringInfo(str, ", \"empty-since\" : \"%s\"",
+						 timestamptz_to_str(seg->empty_since));
+	switch (seg->page_kind)
+	{
+		case SHMBUF_PAGES__HUGETLB:
+			appendStringInfo(str, ", \"huge-pages\" : \"hugetlbfs\", \"page-size\" : %zu",
+							 ((Size)shmbuf_huge_page_size_kb) << 10);
+			break;
+		case SHMBUF_PAGES__THP:
+			appendStringInfo(str, ", \"huge-pages\" : \"thp\", \"page-size\" : %zu",
+							 (Size)PAGE_SIZE);
+			break;
+		default:
+			appendStringInfo(str, ", \"huge-pages\" : \"off\", \"page-size\" : %zu",
+							 (Size)PAGE_SIZE);
+			break;
+	}
+	if (seg->numa_policy == SHMBUF_NUMA_POLICY__BIND)
+		appendStringInfo(str, ", \"numa-policy\" : \"bind\", \"numa-node\" : %d",
+						 seg->numa_node);
+	else if (seg->numa_policy == SHMBUF_NUMA_POLICY__INTERLEAVE)
+	{
+		appendStringInfo(str, ", \"numa-policy\" : \"interleave\", \"numa-nodes\" : [");
+		for (i=0; i < shmbuf_numa_num_nodes; i++)
+			appendStringInfo(str, "%s%d", i > 0 ? ", " : "",
+							 shmbuf_numa_node_ids[i]);
+		appendStringInfo(str, "]");
+	}
+	else
+		appendStringInfo(str, ", \"numa-policy\" : \"default\"");
 	
 	curr = head = shmbuf_segment_vaddr_head + shmbuf_segment_size * segment_id;
 	tail = head + shmbuf_segment_size;
@@ -1166,6 +1910,7 @@ __pgstrom_shmbuf_segment_info(StringInfo str, shmBufferSegment *seg)
 		{
 			free_chunks[chunk->mclass - SHMBUF_CHUNKSZ_MIN_BIT]++;
 			free_space += (1UL << chunk->mclass);
+			largest_free = Max(largest_free, (1UL << chunk->mclass));
 		}
 		else
 		{
@@ -1197,13 +1942,19 @@ __pgstrom_shmbuf_segment_info(StringInfo str, shmBufferSegment *seg)
 		
 		if (count++ > 0)
 			appendStringInfo(str, ", ");
-		appendStringInfo(str, "{\"chunk-sz\" : \"%s\", \"active\" : %d, \"free\" : %d }",
-						 label, active_chunks[mindex], free_chunks[mindex]);
+		appendStringInfo(str, "{\"chunk-sz\" : \"%s\", \"active\" : %d, \"free\" : %d, \"free-space\" : %zu }",
+						 label, active_chunks[mindex], free_chunks[mindex],
+						 (Size)free_chunks[mindex] << i);
 	}
 	appendStringInfo(str, "]");
 	appendStringInfo(str, ", \"required-space\" : %zu", required_space);
 	appendStringInfo(str, ", \"alloc-space\" : %zu", alloc_space);
 	appendStringInfo(str, ", \"free-space\" : %zu", free_space);
+	appendStringInfo(str, ", \"largest-free-chunk\" : %zu", largest_free);
+	/* ratio of free space that is not usable for the largest request */
+	appendStringInfo(str, ", \"fragmentation\" : %.3f",
+					 free_space == 0 ? 0.0 :
+					 1.0 - (double)largest_free / (double)free_space);
 out:
 	appendStringInfo(str, "}");
 }
@@ -1212,7 +1963,7 @@ static void
 __pgstrom_shmbuf_context_info(StringInfo str, shmBufferContext *context)
 {
 	dlist_iter		iter;
-	int				count = 0;
+	int				i, count = 0;
 
 	appendStringInfo(str,"{ \"name\" : \"%s\", \"segments\" : [",
 					 context->header.name);
@@ -1224,7 +1975,24 @@ __pgstrom_shmbuf_context_info(StringInfo str, shmBufferContext *context)
 			appendStringInfo(str, ", ");
 		__pgstrom_shmbuf_segment_info(str, seg);
 	}
-	appendStringInfo(str, "]}");
+	appendStringInfo(str, "], \"cached-chunks\" : [");
+	for (i=0, count=0; i < SHMBUF_NUM_SMALL_CLASSES; i++)
+	{
+		uint32		nitems = pg_atomic_read_u32(&context->free_count[i]);
+
+		if (nitems == 0)
+			continue;
+		if (count++ > 0)
+			appendStringInfo(str, ", ");
+		appendStringInfo(str, "{\"chunk-sz\" : %lu, \"count\" : %u }",
+						 (1UL << (i + SHMBUF_CHUNKSZ_MIN_BIT)), nitems);
+	}
+	appendStringInfo(str, "]");
+	appendStringInfo(str, ", \"num-frag-failures\" : %lu",
+					 context->num_frag_failures);
+	appendStringInfo(str, ", \"num-reclaimed-segments\" : %lu",
+					 context->num_reclaimed);
+	appendStringInfo(str, "}");
 }
 
 Datum
@@ -1276,6 +2044,27 @@ pgstrom_shmbuf_info(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_shmbuf_info);
 
+/*
+ * shmBufferContextInit
+ */
+static void
+shmBufferContextInit(shmBufferContext *scxt)
+{
+	int			i;
+
+	pg_atomic_init_u32(&scxt->generation,
+					   pg_atomic_add_fetch_u32(&shmBufSegHead->generation, 1));
+	pg_atomic_init_u32(&scxt->num_poppers, 0);
+	for (i=0; i < SHMBUF_NUM_SMALL_CLASSES; i++)
+	{
+		pg_atomic_init_u64(&scxt->free_stack[i], 0);
+		pg_atomic_init_u32(&scxt->free_count[i], 0);
+	}
+	scxt->last_reclaim = 0;
+	scxt->num_frag_failures = 0;
+	scxt->num_reclaimed = 0;
+}
+
 /*
  * SharedMemoryContextCreate
  */
@@ -1296,6 +2085,7 @@ SharedMemoryContextCreate(const char *name)
 	mcxt->name = scxt->namebuf;
 	SpinLockInit(&scxt->lock);
 	dlist_init(&scxt->active_segment_list);
+	shmBufferContextInit(scxt);
 
 	SpinLockAcquire(&shmBufSegHead->lock);
 	dlist_push_tail(&shmBufSegHead->shmem_context_list, &scxt->chain);
@@ -1335,6 +2125,7 @@ pgstrom_startup_shmbuf(void)
 		Assert(found);
 
 	SpinLockInit(&shmBufSegHead->lock);
+	pg_atomic_init_u32(&shmBufSegHead->generation, 0);
 	dlist_init(&shmBufSegHead->shmem_context_list);
 	dlist_init(&shmBufSegHead->free_segment_list);
 	for (i=0; i < shmbuf_num_logical_segment; i++)
@@ -1368,6 +2159,7 @@ pgstrom_startup_shmbuf(void)
 	SpinLockInit(&scxt->lock);
 	dlist_init(&scxt->active_segment_list);
 	dlist_push_tail(&scxt->active_segment_list, &seg->chain);
+	shmBufferContextInit(scxt);
 	chunk->memcxt = (MemoryContext) scxt;
 	
 	TopSharedMemoryContext = &scxt->header;
@@ -1388,6 +2180,108 @@ pgstrom_startup_shmbuf(void)
 		(*shmem_startup_next)();
 }
 
+/*
+ * shmBufferLookupHugetlbfs
+ *
+ * It looks up a writable hugetlbfs mount point with the required page size.
+ */
+static char *
+shmBufferLookupHugetlbfs(Size page_sz)
+{
+	FILE	   *filp;
+	struct mntent *mnt;
+	char		linebuf[256];
+	Size		default_sz = 0;
+	char	   *result = NULL;
+
+	/* default huge page size, for hugetlbfs without 'pagesize' option */
+	filp = fopen("/proc/meminfo", "r");
+	if (filp)
+	{
+		unsigned long	kb;
+
+		while (fgets(linebuf, sizeof(linebuf), filp) != NULL)
+		{
+			if (sscanf(linebuf, "Hugepagesize: %lu kB", &kb) == 1)
+			{
+				default_sz = ((Size)kb) << 10;
+				break;
+			}
+		}
+		fclose(filp);
+	}
+
+	filp = setmntent("/proc/mounts", "r");
+	if (!filp)
+		return NULL;
+	while ((mnt = getmntent(filp)) != NULL)
+	{
+		char	   *opt;
+		Size		sz = default_sz;
+
+		if (strcmp(mnt->mnt_type, "hugetlbfs") != 0)
+			continue;
+		opt = hasmntopt(mnt, "pagesize");
+		if (opt)
+		{
+			char	   *end;
+
+			sz = strtoul(opt + 9, &end, 10);	/* "pagesize=" */
+			if (*end == 'K' || *end == 'k')
+				sz <<= 10;
+			else if (*end == 'M' || *end == 'm')
+				sz <<= 20;
+			else if (*end == 'G' || *end == 'g')
+				sz <<= 30;
+		}
+		if (sz == page_sz && access(mnt->mnt_dir, R_OK | W_OK | X_OK) == 0)
+		{
+			result = MemoryContextStrdup(TopMemoryContext, mnt->mnt_dir);
+			break;
+		}
+	}
+	endmntent(filp);
+
+	return result;
+}
+
+/*
+ * shmBufferParseNumaNodes
+ *
+ * It parses the list of NUMA nodes, like "0-3,6", in the format of
+ * shmbuf.numa_nodes and /sys/devices/system/node/online.
+ */
+static void
+shmBufferParseNumaNodes(const char *node_list)
+{
+	char	   *temp = pstrdup(node_list);
+	char	   *tok, *pos;
+
+	shmbuf_numa_num_nodes = 0;
+	for (tok = strtok_r(temp, ", \n", &pos);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ", \n", &pos))
+	{
+		char	   *end;
+		long		head, tail;
+
+		head = tail = strtol(tok, &end, 10);
+		if (*end == '-')
+			tail = strtol(end + 1, &end, 10);
+		if (*end != '\0' || head < 0 || head > tail ||
+			tail >= SHMBUF_NUMA_MAX_NODES)
+			elog(ERROR, "shmbuf.numa_nodes: invalid node list '%s'", node_list);
+		while (head <= tail)
+		{
+			if (shmbuf_numa_num_nodes >= SHMBUF_NUMA_MAX_NODES)
+				elog(ERROR, "shmbuf.numa_nodes: too many nodes in '%s'",
+					 node_list);
+			shmbuf_numa_node_ids[shmbuf_numa_num_nodes++] = head++;
+		}
+	}
+	pfree(temp);
+}
+
 /*
  * pgstrom_init_shmbuf
  */
@@ -1396,6 +2290,8 @@ pgstrom_init_shmbuf(void)
 {
 	struct sigaction sigact;
 	size_t		length;
+	size_t		align;
+	void	   *vaddr;
 
 	if (!process_shared_preload_libraries_in_progress)
 		ereport(ERROR,
@@ -1428,14 +2324,120 @@ pgstrom_init_shmbuf(void)
 							PGC_POSTMASTER,
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
-	/* preserver private address space but no physical memory assignment */
+
+	DefineCustomIntVariable("shmbuf.segment_reclaim_delay",
+							"Delay to drop empty shared memory segments",
+							"0 means immediate drop",
+							&shmbuf_segment_reclaim_delay,
+							30,			/* default: 30sec */
+							0,
+							INT_MAX / 1000,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_S,
+							NULL, NULL, NULL);
+
+	DefineCustomEnumVariable("shmbuf.huge_pages",
+							 "Use of huge pages for shared memory segments",
+							 "'try' falls back to transparent huge pages if no hugetlbfs or huge pages are available",
+							 &shmbuf_huge_pages,
+							 SHMBUF_HUGE_PAGES__OFF,
+							 shmbuf_huge_pages_options,
+							 PGC_POSTMASTER,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomEnumVariable("shmbuf.huge_page_size",
+							 "Size of huge pages for shared memory segments",
+							 "hugetlbfs must be mounted with this pagesize",
+							 &shmbuf_huge_page_size_kb,
+							 2 << 10,		/* default: 2MB */
+							 shmbuf_huge_page_size_options,
+							 PGC_POSTMASTER,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomEnumVariable("shmbuf.numa_policy",
+							 "NUMA policy of shared memory segments",
+							 "'interleave' spreads pages of each segment over the nodes, 'bind' assigns each segment to a node in round-robin",
+							 &shmbuf_numa_policy,
+							 SHMBUF_NUMA_POLICY__DEFAULT,
+							 shmbuf_numa_policy_options,
+							 PGC_POSTMASTER,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomStringVariable("shmbuf.numa_nodes",
+							   "List of NUMA nodes for shmbuf.numa_policy",
+							   "all the online nodes, if not given",
+							   &shmbuf_numa_nodes,
+							   NULL,
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE,
+							   NULL, NULL, NULL);
+
+	/* lookup hugetlbfs mount point */
+	if (shmbuf_huge_pages != SHMBUF_HUGE_PAGES__OFF)
+	{
+		Size	huge_page_size = ((Size)shmbuf_huge_page_size_kb) << 10;
+
+		if (huge_page_size > shmbuf_segment_size)
+		{
+			if (shmbuf_huge_pages == SHMBUF_HUGE_PAGES__ON)
+				elog(ERROR, "shmbuf.segment_size (%dkB) is smaller than shmbuf.huge_page_size (%dkB)",
+					 shmbuf_segment_size_kb, shmbuf_huge_page_size_kb);
+			elog(LOG, "shmbuf.segment_size (%dkB) is smaller than shmbuf.huge_page_size (%dkB), so no explicit huge pages are used",
+				 shmbuf_segment_size_kb, shmbuf_huge_page_size_kb);
+		}
+		else
+		{
+			shmbuf_hugetlbfs_dir = shmBufferLookupHugetlbfs(huge_page_size);
+			if (!shmbuf_hugetlbfs_dir)
+			{
+				if (shmbuf_huge_pages == SHMBUF_HUGE_PAGES__ON)
+					elog(ERROR, "no writable hugetlbfs is mounted with pagesize=%dkB",
+						 shmbuf_huge_page_size_kb);
+				elog(LOG, "no writable hugetlbfs is mounted with pagesize=%dkB, so transparent huge pages are used instead",
+					 shmbuf_huge_page_size_kb);
+			}
+		}
+	}
+
+	/* list of NUMA nodes */
+	if (shmbuf_numa_policy != SHMBUF_NUMA_POLICY__DEFAULT)
+	{
+		if (shmbuf_numa_nodes)
+			shmBufferParseNumaNodes(shmbuf_numa_nodes);
+		else
+		{
+			FILE   *filp = fopen("/sys/devices/system/node/online", "r");
+			char	linebuf[1024];
+
+			if (filp && fgets(linebuf, sizeof(linebuf), filp) != NULL)
+				shmBufferParseNumaNodes(linebuf);
+			else
+				elog(LOG, "shmbuf: unable to read the online NUMA nodes, so shmbuf.numa_policy is ignored");
+			if (filp)
+				fclose(filp);
+		}
+	}
+
+	/*
+	 * preserve private address space but no physical memory assignment.
+	 * MAP_FIXED of hugetlbfs files requires the address aligned to the
+	 * huge page size.
+	 */
 	length = shmbuf_segment_size * shmbuf_num_logical_segment;
-	shmbuf_segment_vaddr_head = mmap(NULL, length,
-									 PROT_NONE,
-									 MAP_PRIVATE | MAP_ANONYMOUS,
-									 -1, 0);
-	if (shmbuf_segment_vaddr_head == MAP_FAILED)
+	if (shmbuf_huge_pages != SHMBUF_HUGE_PAGES__OFF)
+		align = ((Size)shmbuf_huge_page_size_kb) << 10;
+	else
+		align = PAGE_SIZE;
+	vaddr = mmap(NULL, length + align,
+				 PROT_NONE,
+				 MAP_PRIVATE | MAP_ANONYMOUS,
+				 -1, 0);
+	if (vaddr == MAP_FAILED)
 		elog(ERROR, "failed on mmap(2): %m");
+	shmbuf_segment_vaddr_head = (char *)TYPEALIGN(align, vaddr);
 	shmbuf_segment_vaddr_tail = shmbuf_segment_vaddr_head + length;
 
 	/* allocation of static shared memory */
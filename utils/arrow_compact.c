@@ -0,0 +1,1754 @@
+/*
+ * arrow_compact.c - merge, re-batch and re-sort Apache Arrow files
+ *
+ * Copyright 2020 (C) KaiGai Kohei <kaigai@heterodb.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the PostgreSQL License. See the LICENSE file.
+ */
+#include "postgres.h"
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include "arrow_ipc.h"
+
+/* command options */
+static char	  **input_filenames = NULL;
+static int		num_input_files = 0;
+static char	   *output_filename = NULL;
+static size_t	batch_segment_sz = 0;
+static size_t	max_file_size = 0;
+static char	   *sort_key_names = NULL;
+static size_t	sort_memory_sz = 0;
+static char	   *temp_dirname = NULL;
+static int		remove_input_files = 0;
+static int		shows_progress = 0;
+
+/*
+ * arrowInputDict - dictionary of the input file (incl. delta batches)
+ */
+typedef struct arrowInputDict
+{
+	struct arrowInputDict *next;
+	int64		dict_id;
+	int			nitems;
+	const char **labels;
+	uint32	   *label_sz;
+} arrowInputDict;
+
+/*
+ * arrowDictRemap - mapping from the index of input dictionary to
+ * the index of the merged (output) dictionary.
+ */
+typedef struct arrowDictRemap
+{
+	struct arrowDictRemap *next;
+	arrowInputDict *src;
+	SQLdictionary  *dest;
+	uint32		   *remap;
+} arrowDictRemap;
+
+/*
+ * arrowColumnSrc - location of a column (or sub-field) on a particular
+ * RecordBatch of the input file.
+ */
+typedef struct arrowColumnSrc
+{
+	ArrowField *field;
+	int64		length;
+	int64		null_count;
+	const uint8 *nullmap;		/* NULL, if no null values */
+	const char *values;
+	const char *extra;
+	arrowInputDict *dict;		/* valid, if dictionary column */
+	uint32	   *dict_remap;		/* valid, if dictionary column */
+	int			nchildren;
+	struct arrowColumnSrc *children;
+} arrowColumnSrc;
+
+/*
+ * arrowInputFile - state of the input file; it is kept mapped during
+ * the whole job, to gather rows in the sorted order.
+ */
+typedef struct
+{
+	const char *filename;
+	int			fdesc;
+	struct stat	stat_buf;
+	char	   *mmap_head;
+	size_t		mmap_sz;
+	ArrowFileInfo af_info;
+	arrowInputDict *dict_list;
+	arrowDictRemap *remap_list;
+	int			num_batches;
+	arrowColumnSrc **batches;	/* [num_batches][nfields] */
+} arrowInputFile;
+
+static arrowInputFile *input_files = NULL;
+
+/*
+ * arrowOutputFile - output files are built on the temporary files at
+ * the same directory, then renamed to the final name at once when
+ * all the jobs are successfully done.
+ */
+typedef struct arrowOutputFile
+{
+	struct arrowOutputFile *next;
+	char	   *temp_name;
+	char	   *final_name;
+	bool		committed;
+} arrowOutputFile;
+
+static arrowOutputFile *output_files_head = NULL;
+static arrowOutputFile *output_files_tail = NULL;
+static int				output_file_seqno = 0;
+
+/*
+ * __hash_label - FNV-1a hash of dictionary labels
+ */
+static uint32
+__hash_label(const char *label, size_t len)
+{
+	uint32		hash = 2166136261U;
+	size_t		i;
+
+	for (i=0; i < len; i++)
+	{
+		hash ^= (uint8)label[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/*
+ * lookupOutputDictionary
+ */
+static SQLdictionary *
+lookupOutputDictionary(SQLtable *table, int64 dict_id)
+{
+	SQLdictionary *dict;
+
+	for (dict = table->sql_dict_list; dict != NULL; dict = dict->next)
+	{
+		if (dict->dict_id == dict_id)
+			return dict;
+	}
+	dict = palloc0(offsetof(SQLdictionary, hslots[1024]));
+	dict->dict_id = dict_id;
+	sql_buffer_init(&dict->values);
+	sql_buffer_init(&dict->extra);
+	dict->nslots = 1024;
+
+	dict->next = table->sql_dict_list;
+	table->sql_dict_list = dict;
+
+	return dict;
+}
+
+static uint32
+__insertOutputDictionary(SQLdictionary *dict, const char *label, uint32 sz)
+{
+	hashItem   *hitem;
+	uint32		hash = __hash_label(label, sz);
+	uint32		hindex = hash % dict->nslots;
+
+	for (hitem = dict->hslots[hindex]; hitem != NULL; hitem = hitem->next)
+	{
+		if (hitem->hash == hash &&
+			hitem->label_sz == sz &&
+			memcmp(hitem->label, label, sz) == 0)
+			return hitem->index;
+	}
+	hitem = palloc0(offsetof(hashItem, label[sz+1]));
+	hitem->hash = hash;
+	hitem->index = dict->nitems++;
+	hitem->label_sz = sz;
+	memcpy(hitem->label, label, sz);
+	hitem->label[sz] = '\0';
+
+	hitem->next = dict->hslots[hindex];
+	dict->hslots[hindex] = hitem;
+
+	sql_buffer_append(&dict->extra, label, sz);
+	if (dict->values.usage == 0)
+		sql_buffer_append_zero(&dict->values, sizeof(uint32));
+	sql_buffer_append(&dict->values, &dict->extra.usage, sizeof(uint32));
+
+	return hitem->index;
+}
+
+/*
+ * loadInputDictionaries
+ *
+ * It loads DictionaryBatches of the input file. Delta batches are appended
+ * to the dictionary with same id.
+ */
+static void
+loadInputDictionaries(arrowInputFile *input)
+{
+	ArrowFileInfo *af_info = &input->af_info;
+	int			i, j;
+
+	for (i=0; i < af_info->footer._num_dictionaries; i++)
+	{
+		ArrowBlock *block = &af_info->footer.dictionaries[i];
+		ArrowDictionaryBatch *dbatch;
+		arrowInputDict *dict;
+		const char *body;
+		const uint32 *offsets;
+		const char *extra;
+		int			base;
+
+		dbatch = &af_info->dictionaries[i].body.dictionaryBatch;
+		if (dbatch->node.tag != ArrowNodeTag__DictionaryBatch ||
+			dbatch->data._num_nodes != 1 ||
+			dbatch->data._num_buffers != 3)
+			Elog("DictionaryBatch (dictionary_id=%ld) of '%s' has unexpected format",
+				 dbatch->id, input->filename);
+		body = input->mmap_head + block->offset + block->metaDataLength;
+		offsets = (const uint32 *)(body + dbatch->data.buffers[1].offset);
+		extra = body + dbatch->data.buffers[2].offset;
+
+		for (dict = input->dict_list; dict != NULL; dict = dict->next)
+		{
+			if (dict->dict_id == dbatch->id)
+				break;
+		}
+		if (!dict)
+		{
+			dict = palloc0(sizeof(arrowInputDict));
+			dict->dict_id = dbatch->id;
+			dict->next = input->dict_list;
+			input->dict_list = dict;
+		}
+		else if (!dbatch->isDelta)
+			dict->nitems = 0;	/* replacement of the dictionary */
+
+		base = dict->nitems;
+		dict->nitems += dbatch->data.length;
+		if (!dict->labels)
+		{
+			dict->labels = palloc(sizeof(char *) * Max(dict->nitems, 1));
+			dict->label_sz = palloc(sizeof(uint32) * Max(dict->nitems, 1));
+		}
+		else
+		{
+			dict->labels = repalloc(dict->labels,
+									sizeof(char *) * Max(dict->nitems, 1));
+			dict->label_sz = repalloc(dict->label_sz,
+									  sizeof(uint32) * Max(dict->nitems, 1));
+		}
+		for (j=0; j < dbatch->data.length; j++)
+		{
+			dict->labels[base + j] = extra + offsets[j];
+			dict->label_sz[base + j] = offsets[j+1] - offsets[j];
+		}
+	}
+}
+
+/*
+ * lookupDictionaryRemap
+ */
+static arrowDictRemap *
+lookupDictionaryRemap(arrowInputFile *input,
+					  ArrowField *field, SQLdictionary *dest)
+{
+	arrowInputDict *src;
+	arrowDictRemap *remap;
+	int64		dict_id = field->dictionary->id;
+	int			i;
+
+	for (remap = input->remap_list; remap != NULL; remap = remap->next)
+	{
+		if (remap->src->dict_id == dict_id && remap->dest == dest)
+			return remap;
+	}
+	for (src = input->dict_list; src != NULL; src = src->next)
+	{
+		if (src->dict_id == dict_id)
+			break;
+	}
+	if (!src)
+		Elog("'%s' has no DictionaryBatch for field '%s' (dictionary_id=%ld)",
+			 input->filename, field->name, dict_id);
+
+	remap = palloc0(sizeof(arrowDictRemap));
+	remap->src = src;
+	remap->dest = dest;
+	remap->remap = palloc(sizeof(uint32) * Max(src->nitems, 1));
+	for (i=0; i < src->nitems; i++)
+		remap->remap[i] = __insertOutputDictionary(dest,
+												   src->labels[i],
+												   src->label_sz[i]);
+	remap->next = input->remap_list;
+	input->remap_list = remap;
+
+	return remap;
+}
+
+/*
+ * openInputFile
+ */
+static void
+openInputFile(arrowInputFile *input, const char *filename)
+{
+	input->filename = filename;
+	input->fdesc = open(filename, O_RDONLY);
+	if (input->fdesc < 0)
+		Elog("failed on open('%s'): %m", filename);
+	if (fstat(input->fdesc, &input->stat_buf) != 0)
+		Elog("failed on fstat('%s'): %m", filename);
+	readArrowFileDesc(input->fdesc, &input->af_info);
+
+	input->mmap_sz = TYPEALIGN(sysconf(_SC_PAGESIZE),
+							   input->stat_buf.st_size);
+	input->mmap_head = mmap(NULL, input->mmap_sz,
+							PROT_READ, MAP_SHARED,
+							input->fdesc, 0);
+	if (input->mmap_head == MAP_FAILED)
+		Elog("failed on mmap('%s'): %m", filename);
+	loadInputDictionaries(input);
+}
+
+/*
+ * checkSchemaCompatibility
+ */
+static void
+__checkFieldCompatibility(arrowInputFile *input,
+						  ArrowField *field, ArrowField *base)
+{
+	char	   *type_name = arrowTypeName(field);
+	char	   *base_name = arrowTypeName(base);
+	int			j;
+
+	if (strcmp(field->name, base->name) != 0 ||
+		strcmp(type_name, base_name) != 0 ||
+		(field->dictionary != NULL) != (base->dictionary != NULL) ||
+		field->_num_children != base->_num_children)
+		Elog("schema of '%s' is not compatible to '%s': field '%s' (%s%s) is not '%s' (%s%s)",
+			 input->filename,
+			 input_files[0].filename,
+			 field->name, type_name, field->dictionary ? ", dictionary" : "",
+			 base->name,  base_name,  base->dictionary  ? ", dictionary" : "");
+	for (j=0; j < field->_num_children; j++)
+		__checkFieldCompatibility(input,
+								  &field->children[j],
+								  &base->children[j]);
+	pfree(type_name);
+	pfree(base_name);
+}
+
+static void
+checkSchemaCompatibility(arrowInputFile *input, arrowInputFile *base)
+{
+	ArrowSchema *schema = &input->af_info.footer.schema;
+	ArrowSchema *bschema = &base->af_info.footer.schema;
+	int			j;
+
+	if (schema->_num_fields != bschema->_num_fields)
+		Elog("schema of '%s' is not compatible to '%s': number of fields mismatch (%d, %d)",
+			 input->filename, base->filename,
+			 schema->_num_fields, bschema->_num_fields);
+	for (j=0; j < schema->_num_fields; j++)
+		__checkFieldCompatibility(input,
+								  &schema->fields[j],
+								  &bschema->fields[j]);
+}
+
+/*
+ * setupOutputTable
+ *
+ * It builds SQLtable for the output files according to the schema of
+ * the first input file. Field- and schema-level custom-metadata are
+ * carried to the output files as is.
+ */
+static void
+__setupOutputField(SQLtable *table, SQLfield *column, ArrowField *field)
+{
+	int			j;
+
+	column->field_name = pstrdup(field->name);
+	column->arrow_type = field->type;
+	column->arrow_typename = arrowTypeName(field);
+	column->customMetadata = field->custom_metadata;
+	column->numCustomMetadata = field->_num_custom_metadata;
+	table->numFieldNodes++;
+
+	if (field->dictionary)
+	{
+		if (field->type.node.tag != ArrowNodeTag__Utf8)
+			Elog("dictionary of %s (field '%s') is not supported",
+				 column->arrow_typename, field->name);
+		column->enumdict = lookupOutputDictionary(table,
+												  field->dictionary->id);
+		table->numBuffers += 2;
+		return;
+	}
+
+	switch (field->type.node.tag)
+	{
+		case ArrowNodeTag__Int:
+		case ArrowNodeTag__FloatingPoint:
+		case ArrowNodeTag__Bool:
+		case ArrowNodeTag__Decimal:
+		case ArrowNodeTag__Date:
+		case ArrowNodeTag__Time:
+		case ArrowNodeTag__Timestamp:
+		case ArrowNodeTag__Interval:
+		case ArrowNodeTag__FixedSizeBinary:
+			table->numBuffers += 2;
+			break;
+
+		case ArrowNodeTag__Utf8:
+		case ArrowNodeTag__Binary:
+		case ArrowNodeTag__LargeUtf8:
+		case ArrowNodeTag__LargeBinary:
+			table->numBuffers += 3;
+			break;
+
+		case ArrowNodeTag__List:
+		case ArrowNodeTag__LargeList:
+			if (field->_num_children != 1)
+				Elog("corrupted List data type (field '%s')", field->name);
+			table->numBuffers += 2;
+			column->element = palloc0(sizeof(SQLfield));
+			__setupOutputField(table, column->element, &field->children[0]);
+			break;
+
+		case ArrowNodeTag__Struct:
+			table->numBuffers += 1;
+			column->nfields = field->_num_children;
+			column->subfields = palloc0(sizeof(SQLfield) *
+										Max(field->_num_children, 1));
+			for (j=0; j < field->_num_children; j++)
+				__setupOutputField(table, &column->subfields[j],
+								   &field->children[j]);
+			break;
+
+		default:
+			Elog("Arrow Type %s (field '%s') is not supported right now",
+				 column->arrow_typename, field->name);
+	}
+}
+
+static SQLtable *
+setupOutputTable(arrowInputFile *base)
+{
+	ArrowSchema *schema = &base->af_info.footer.schema;
+	SQLtable   *table;
+	int			j;
+
+	table = palloc0(offsetof(SQLtable, columns[schema->_num_fields]));
+	table->fdesc = -1;
+	table->nfields = schema->_num_fields;
+	table->customMetadata = schema->custom_metadata;
+	table->numCustomMetadata = schema->_num_custom_metadata;
+	table->segment_sz = batch_segment_sz;
+	for (j=0; j < schema->_num_fields; j++)
+		__setupOutputField(table, &table->columns[j], &schema->fields[j]);
+
+	return table;
+}
+
+/*
+ * setupInputBatches
+ *
+ * It resolves the location of the buffers for each RecordBatch.
+ */
+static void
+__setupColumnSrc(arrowInputFile *input,
+				 arrowColumnSrc *src,
+				 ArrowField *field,
+				 SQLfield *column,
+				 ArrowRecordBatch *rbatch,
+				 const char *body,
+				 int *p_node, int *p_buffer)
+{
+	ArrowFieldNode *fnode;
+	ArrowBuffer	   *buffers;
+	int				nbuffers = 2;
+	int				j;
+
+	if (*p_node >= rbatch->_num_nodes)
+		Elog("RecordBatch of '%s' has too few FieldNodes", input->filename);
+	fnode = &rbatch->nodes[(*p_node)++];
+	buffers = &rbatch->buffers[*p_buffer];
+
+	src->field = field;
+	src->length = fnode->length;
+	src->null_count = fnode->null_count;
+	if (field->type.node.tag == ArrowNodeTag__Struct && !field->dictionary)
+		nbuffers = 1;
+	else if (!field->dictionary &&
+			 (field->type.node.tag == ArrowNodeTag__Utf8 ||
+			  field->type.node.tag == ArrowNodeTag__Binary ||
+			  field->type.node.tag == ArrowNodeTag__LargeUtf8 ||
+			  field->type.node.tag == ArrowNodeTag__LargeBinary))
+		nbuffers = 3;
+	if (*p_buffer + nbuffers > rbatch->_num_buffers)
+		Elog("RecordBatch of '%s' has too few Buffers", input->filename);
+	*p_buffer += nbuffers;
+
+	if (src->null_count > 0 && buffers[0].length > 0)
+		src->nullmap = (const uint8 *)(body + buffers[0].offset);
+	if (nbuffers > 1)
+		src->values = body + buffers[1].offset;
+	if (nbuffers > 2)
+		src->extra = body + buffers[2].offset;
+
+	if (field->dictionary)
+	{
+		arrowDictRemap *remap = lookupDictionaryRemap(input, field,
+													  column->enumdict);
+		src->dict = remap->src;
+		src->dict_remap = remap->remap;
+	}
+	else if (column->element)
+	{
+		src->nchildren = 1;
+		src->children = palloc0(sizeof(arrowColumnSrc));
+		__setupColumnSrc(input, src->children,
+						 &field->children[0],
+						 column->element,
+						 rbatch, body, p_node, p_buffer);
+	}
+	else if (column->subfields)
+	{
+		src->nchildren = column->nfields;
+		src->children = palloc0(sizeof(arrowColumnSrc) *
+								Max(column->nfields, 1));
+		for (j=0; j < column->nfields; j++)
+			__setupColumnSrc(input, &src->children[j],
+							 &field->children[j],
+							 &column->subfields[j],
+							 rbatch, body, p_node, p_buffer);
+	}
+}
+
+static void
+setupInputBatches(arrowInputFile *input, SQLtable *table)
+{
+	ArrowFileInfo *af_info = &input->af_info;
+	ArrowSchema *schema = &af_info->footer.schema;
+	int			i, j;
+
+	input->num_batches = af_info->footer._num_recordBatches;
+	input->batches = palloc0(sizeof(arrowColumnSrc *) *
+							 Max(input->num_batches, 1));
+	for (i=0; i < input->num_batches; i++)
+	{
+		ArrowBlock *block = &af_info->footer.recordBatches[i];
+		ArrowRecordBatch *rbatch = &af_info->recordBatches[i].body.recordBatch;
+		const char *body = input->mmap_head + block->offset + block->metaDataLength;
+		arrowColumnSrc *srcs;
+		int			node_index = 0;
+		int			buffer_index = 0;
+
+		if (rbatch->node.tag != ArrowNodeTag__RecordBatch)
+			Elog("RecordBatch[%d] of '%s' has unexpected format",
+				 i, input->filename);
+		srcs = palloc0(sizeof(arrowColumnSrc) * Max(table->nfields, 1));
+		for (j=0; j < table->nfields; j++)
+			__setupColumnSrc(input, &srcs[j],
+							 &schema->fields[j],
+							 &table->columns[j],
+							 rbatch, body,
+							 &node_index, &buffer_index);
+		if (node_index != rbatch->_num_nodes ||
+			buffer_index != rbatch->_num_buffers)
+			Elog("RecordBatch[%d] of '%s' has unexpected number of FieldNodes/Buffers",
+				 i, input->filename);
+		input->batches[i] = srcs;
+	}
+}
+
+/*
+ * Routines to move a row from the input RecordBatch to the output buffer
+ */
+static inline bool
+__src_isnull(arrowColumnSrc *src, int64 row)
+{
+	return (src->nullmap != NULL &&
+			(src->nullmap[row >> 3] & (1 << (row & 7))) == 0);
+}
+
+static int64
+__fetch_dict_index(arrowColumnSrc *src, int64 row)
+{
+	ArrowTypeInt *itype = &src->field->dictionary->indexType;
+	int64		index;
+
+	switch (itype->bitWidth)
+	{
+		case 8:
+			index = (itype->is_signed
+					 ? ((const int8  *)src->values)[row]
+					 : ((const uint8 *)src->values)[row]);
+			break;
+		case 16:
+			index = (itype->is_signed
+					 ? ((const int16  *)src->values)[row]
+					 : ((const uint16 *)src->values)[row]);
+			break;
+		case 32:
+			index = (itype->is_signed
+					 ? ((const int32  *)src->values)[row]
+					 : ((const uint32 *)src->values)[row]);
+			break;
+		case 64:
+			index = ((const int64 *)src->values)[row];
+			break;
+		default:
+			Elog("unexpected index type of dictionary (bitWidth=%d)",
+				 itype->bitWidth);
+	}
+	if (index < 0 || index >= src->dict->nitems)
+		Elog("index of dictionary (%ld) is out of range", index);
+	return index;
+}
+
+static int
+__fixed_width(ArrowField *field)
+{
+	ArrowType  *t = &field->type;
+
+	switch (t->node.tag)
+	{
+		case ArrowNodeTag__Int:
+			return t->Int.bitWidth / 8;
+		case ArrowNodeTag__FloatingPoint:
+			switch (t->FloatingPoint.precision)
+			{
+				case ArrowPrecision__Half:
+					return sizeof(uint16);
+				case ArrowPrecision__Single:
+					return sizeof(float);
+				case ArrowPrecision__Double:
+					return sizeof(double);
+			}
+			break;
+		case ArrowNodeTag__Decimal:
+			return sizeof(int128);
+		case ArrowNodeTag__Date:
+			return (t->Date.unit == ArrowDateUnit__Day
+					? sizeof(int32) : sizeof(int64));
+		case ArrowNodeTag__Time:
+			return t->Time.bitWidth / 8;
+		case ArrowNodeTag__Timestamp:
+			return sizeof(int64);
+		case ArrowNodeTag__Interval:
+			return (t->Interval.unit == ArrowIntervalUnit__Year_Month
+					? sizeof(int32) : 2 * sizeof(int32));
+		case ArrowNodeTag__FixedSizeBinary:
+			return t->FixedSizeBinary.byteWidth;
+		default:
+			break;
+	}
+	Elog("Bug? %s is not a fixed-length data type", arrowTypeName(field));
+}
+
+static void
+appendColumnValue(SQLfield *column, arrowColumnSrc *src, int64 row)
+{
+	size_t		index = column->nitems++;
+	bool		isnull = __src_isnull(src, row);
+	int			j;
+
+	if (row >= src->length)
+		Elog("Bug? row index (%ld) is out of range (%ld)",
+			 row, src->length);
+	if (isnull)
+	{
+		column->nullcount++;
+		sql_buffer_clrbit(&column->nullmap, index);
+	}
+	else
+		sql_buffer_setbit(&column->nullmap, index);
+
+	if (column->enumdict)
+	{
+		uint32		code = 0;
+
+		if (!isnull)
+			code = src->dict_remap[__fetch_dict_index(src, row)];
+		sql_buffer_append(&column->values, &code, sizeof(uint32));
+		return;
+	}
+
+	switch (column->arrow_type.node.tag)
+	{
+		case ArrowNodeTag__Bool:
+			if (!isnull && (((const uint8 *)src->values)[row >> 3] &
+							(1 << (row & 7))) != 0)
+				sql_buffer_setbit(&column->values, index);
+			else
+				sql_buffer_clrbit(&column->values, index);
+			break;
+
+		case ArrowNodeTag__Int:
+		case ArrowNodeTag__FloatingPoint:
+		case ArrowNodeTag__Decimal:
+		case ArrowNodeTag__Date:
+		case ArrowNodeTag__Time:
+		case ArrowNodeTag__Timestamp:
+		case ArrowNodeTag__Interval:
+		case ArrowNodeTag__FixedSizeBinary:
+			{
+				int		width = __fixed_width(src->field);
+
+				if (isnull)
+					sql_buffer_append_zero(&column->values, width);
+				else
+					sql_buffer_append(&column->values,
+									  src->values + width * row, width);
+			}
+			break;
+
+		case ArrowNodeTag__Utf8:
+		case ArrowNodeTag__Binary:
+			{
+				const uint32 *offsets = (const uint32 *)src->values;
+				uint32		tail;
+
+				if (index == 0)
+					sql_buffer_append_zero(&column->values, sizeof(uint32));
+				if (!isnull)
+					sql_buffer_append(&column->extra,
+									  src->extra + offsets[row],
+									  offsets[row+1] - offsets[row]);
+				tail = column->extra.usage;
+				sql_buffer_append(&column->values, &tail, sizeof(uint32));
+			}
+			break;
+
+		case ArrowNodeTag__LargeUtf8:
+		case ArrowNodeTag__LargeBinary:
+			{
+				const uint64 *offsets = (const uint64 *)src->values;
+				uint64		tail;
+
+				if (index == 0)
+					sql_buffer_append_zero(&column->values, sizeof(uint64));
+				if (!isnull)
+					sql_buffer_append(&column->extra,
+									  src->extra + offsets[row],
+									  offsets[row+1] - offsets[row]);
+				tail = column->extra.usage;
+				sql_buffer_append(&column->values, &tail, sizeof(uint64));
+			}
+			break;
+
+		case ArrowNodeTag__List:
+			{
+				const int32 *offsets = (const int32 *)src->values;
+				int32		tail;
+
+				if (index == 0)
+					sql_buffer_append_zero(&column->values, sizeof(int32));
+				if (!isnull)
+				{
+					int64	k;
+
+					for (k = offsets[row]; k < offsets[row+1]; k++)
+						appendColumnValue(column->element,
+										  &src->children[0], k);
+				}
+				tail = column->element->nitems;
+				sql_buffer_append(&column->values, &tail, sizeof(int32));
+			}
+			break;
+
+		case ArrowNodeTag__LargeList:
+			{
+				const int64 *offsets = (const int64 *)src->values;
+				int64		tail;
+
+				if (index == 0)
+					sql_buffer_append_zero(&column->values, sizeof(int64));
+				if (!isnull)
+				{
+					int64	k;
+
+					for (k = offsets[row]; k < offsets[row+1]; k++)
+						appendColumnValue(column->element,
+										  &src->children[0], k);
+				}
+				tail = column->element->nitems;
+				sql_buffer_append(&column->values, &tail, sizeof(int64));
+			}
+			break;
+
+		case ArrowNodeTag__Struct:
+			/* sub-fields have the same length with the parent */
+			for (j=0; j < column->nfields; j++)
+				appendColumnValue(&column->subfields[j],
+								  &src->children[j], row);
+			break;
+
+		default:
+			Elog("Bug? Arrow Type %s is not supported right now",
+				 column->arrow_typename);
+	}
+}
+
+static size_t
+__estimateColumnLength(SQLfield *column)
+{
+	size_t		len = 0;
+	int			j;
+
+	if (column->nullcount > 0)
+		len += ARROWALIGN(column->nullmap.usage);
+	len += ARROWALIGN(column->values.usage);
+	len += ARROWALIGN(column->extra.usage);
+	if (column->element)
+		len += __estimateColumnLength(column->element);
+	for (j=0; j < column->nfields; j++)
+		len += __estimateColumnLength(&column->subfields[j]);
+	return len;
+}
+
+/*
+ * Routines to manage the output files
+ */
+static void
+cleanup_output_files_on_exit(int status, void *p)
+{
+	arrowOutputFile *ofile;
+
+	if (status == 0)
+		return;
+	for (ofile = output_files_head; ofile != NULL; ofile = ofile->next)
+	{
+		if (!ofile->committed)
+			unlink(ofile->temp_name);
+	}
+}
+
+static char *
+next_output_filename(void)
+{
+	char	   *fname;
+	size_t		len;
+
+	if (max_file_size == 0)
+		return pstrdup(output_filename);
+
+	/* FILENAME.NNNN.arrow */
+	len = strlen(output_filename);
+	fname = palloc(len + 40);
+	if (len > 6 && strcasecmp(output_filename + len - 6, ".arrow") == 0)
+		sprintf(fname, "%.*s.%04d.arrow",
+				(int)(len - 6), output_filename, output_file_seqno);
+	else
+		sprintf(fname, "%s.%04d.arrow", output_filename, output_file_seqno);
+	output_file_seqno++;
+
+	return fname;
+}
+
+static void
+setup_output_file(SQLtable *table)
+{
+	arrowOutputFile *ofile = palloc0(sizeof(arrowOutputFile));
+	char	   *final_name = next_output_filename();
+	char	   *temp_name;
+	char	   *pos;
+	int			fdesc;
+	ssize_t		nbytes;
+
+	/* temporary file on the same directory, for atomic rename(2) */
+	temp_name = palloc(strlen(final_name) + 20);
+	pos = strrchr(final_name, '/');
+	if (!pos)
+		sprintf(temp_name, ".%s.XXXXXX", final_name);
+	else
+		sprintf(temp_name, "%.*s/.%s.XXXXXX",
+				(int)(pos - final_name), final_name, pos + 1);
+	fdesc = mkstemp(temp_name);
+	if (fdesc < 0)
+		Elog("failed on mkstemp('%s'): %m", temp_name);
+	if (fchmod(fdesc, 0644) != 0)
+		Elog("failed on fchmod('%s'): %m", temp_name);
+
+	ofile->temp_name = temp_name;
+	ofile->final_name = final_name;
+	if (!output_files_head)
+		output_files_head = ofile;
+	else
+		output_files_tail->next = ofile;
+	output_files_tail = ofile;
+
+	table->fdesc = fdesc;
+	table->filename = final_name;
+	/* write out header stuff */
+	nbytes = write(table->fdesc, "ARROW1\0\0", 8);
+	if (nbytes != 8)
+		Elog("failed on write(2): %m");
+	writeArrowSchema(table);
+	/* write out dictionary batch, if any */
+	writeArrowDictionaryBatches(table);
+}
+
+static void
+close_output_file(SQLtable *table)
+{
+	assert(table->fdesc >= 0);
+	writeArrowFooter(table);
+	if (fsync(table->fdesc) != 0)
+		Elog("failed on fsync('%s'): %m", output_files_tail->temp_name);
+	if (close(table->fdesc) != 0)
+		Elog("failed on close('%s'): %m", output_files_tail->temp_name);
+	table->fdesc = -1;
+
+	if (table->recordBatches)
+		pfree(table->recordBatches);
+	table->recordBatches = NULL;
+	table->numRecordBatches = 0;
+	if (table->dictionaries)
+		pfree(table->dictionaries);
+	table->dictionaries = NULL;
+	table->numDictionaries = 0;
+}
+
+static void
+write_record_batch(SQLtable *table)
+{
+	size_t		nitems = table->nitems;
+	int			j;
+
+	if (table->fdesc >= 0 && max_file_size > 0)
+	{
+		off_t		curr_pos = lseek(table->fdesc, 0, SEEK_CUR);
+		size_t		usage = 0;
+
+		if (curr_pos < 0)
+			Elog("failed on lseek('%s'): %m", table->filename);
+		for (j=0; j < table->nfields; j++)
+			usage += __estimateColumnLength(&table->columns[j]);
+		if (table->numRecordBatches > 0 &&
+			curr_pos + usage > max_file_size)
+			close_output_file(table);
+	}
+	if (table->fdesc < 0)
+		setup_output_file(table);
+	writeArrowRecordBatch(table);
+
+	if (shows_progress)
+	{
+		int			index = table->numRecordBatches - 1;
+		ArrowBlock *block = &table->recordBatches[index];
+
+		if (max_file_size > 0)
+			printf("%s: ", table->filename);
+		printf("RecordBatch[%d]: "
+			   "offset=%lu length=%lu (meta=%u, body=%lu) nitems=%zu\n",
+			   index,
+			   block->offset,
+			   block->metaDataLength + block->bodyLength,
+			   block->metaDataLength,
+			   block->bodyLength,
+			   nitems);
+	}
+}
+
+static void
+append_one_row(SQLtable *table, uint32 file_id, uint32 batch_id, int64 row)
+{
+	arrowColumnSrc *srcs = input_files[file_id].batches[batch_id];
+	size_t		usage = 0;
+	int			j;
+
+	for (j=0; j < table->nfields; j++)
+	{
+		appendColumnValue(&table->columns[j], &srcs[j], row);
+		usage += __estimateColumnLength(&table->columns[j]);
+	}
+	table->nitems++;
+
+	if (usage > batch_segment_sz)
+		write_record_batch(table);
+}
+
+/*
+ * commit_output_files
+ *
+ * All the output files are renamed to the final names once the whole
+ * job is successfully done, then the input files are removed if
+ * --remove-inputs is given.
+ */
+static void
+commit_output_files(void)
+{
+	arrowOutputFile *ofile;
+	char	   *dname;
+	int			dfdesc;
+	int			i;
+
+	for (ofile = output_files_head; ofile != NULL; ofile = ofile->next)
+	{
+		if (rename(ofile->temp_name, ofile->final_name) != 0)
+			Elog("failed on rename('%s' -> '%s'): %m",
+				 ofile->temp_name, ofile->final_name);
+		ofile->committed = true;
+	}
+	/* make the renames durable */
+	dname = dirname(pstrdup(output_filename));
+	dfdesc = open(dname, O_RDONLY);
+	if (dfdesc >= 0)
+	{
+		fsync(dfdesc);
+		close(dfdesc);
+	}
+
+	if (!remove_input_files)
+		return;
+	for (i=0; i < num_input_files; i++)
+	{
+		arrowInputFile *input = &input_files[i];
+		struct stat	stat_buf;
+
+		/* input file is already replaced by the output file */
+		if (stat(input->filename, &stat_buf) != 0 ||
+			stat_buf.st_dev != input->stat_buf.st_dev ||
+			stat_buf.st_ino != input->stat_buf.st_ino)
+			continue;
+		if (unlink(input->filename) != 0)
+			fprintf(stderr, "failed on unlink('%s'): %m\n",
+					input->filename);
+	}
+}
+
+/*
+ * Routines for external merge sort
+ *
+ * Rows are sorted by the normalized sort-key; a byte sequence that is
+ * comparable with memcmp(). Each sortItem references the source row by
+ * (file, batch, row), then rows are gathered from the mapped input files
+ * in the sorted order. Once sortItems consume --sort-memory, they are
+ * sorted and spilled to a temporary run file, then merged at the end.
+ */
+typedef struct
+{
+	uint32		key_len;
+	uint32		file_id;
+	uint32		batch_id;
+	uint32		row_id;
+	char		key[FLEXIBLE_ARRAY_MEMBER];
+} sortItem;
+
+typedef struct
+{
+	FILE	   *filp;
+	sortItem   *item;		/* current item, or NULL if end of run */
+	size_t		item_sz;	/* allocated size of the item */
+} sortRun;
+
+static int		   *sort_key_attnums = NULL;
+static int			num_sort_keys = 0;
+static char		   *sort_arena = NULL;
+static size_t		sort_arena_usage = 0;
+static size_t	   *sort_items = NULL;	/* offset in the sort_arena */
+static size_t		sort_nitems = 0;
+static size_t		sort_nitems_max = 0;
+static sortRun	   *sort_runs = NULL;
+static int			sort_nruns = 0;
+
+static int
+__compareSortItems(const sortItem *a, const sortItem *b)
+{
+	int		rv;
+
+	rv = memcmp(a->key, b->key, Min(a->key_len, b->key_len));
+	if (rv != 0)
+		return rv;
+	if (a->key_len != b->key_len)
+		return (a->key_len < b->key_len ? -1 : 1);
+	/* tie-break by the original order, for stable sorting */
+	if (a->file_id != b->file_id)
+		return (a->file_id < b->file_id ? -1 : 1);
+	if (a->batch_id != b->batch_id)
+		return (a->batch_id < b->batch_id ? -1 : 1);
+	if (a->row_id != b->row_id)
+		return (a->row_id < b->row_id ? -1 : 1);
+	return 0;
+}
+
+static int
+compareSortItemsInArena(const void *__a, const void *__b)
+{
+	const sortItem *a = (const sortItem *)(sort_arena + *((size_t *)__a));
+	const sortItem *b = (const sortItem *)(sort_arena + *((size_t *)__b));
+
+	return __compareSortItems(a, b);
+}
+
+static inline void
+__put_key_uint(SQLbuffer *buf, uint64 ival, int width)
+{
+	char	temp[sizeof(uint64)];
+	int		i;
+
+	/* big-endian, to be comparable with memcmp */
+	for (i=0; i < width; i++)
+		temp[i] = (ival >> (8 * (width - 1 - i))) & 0xff;
+	sql_buffer_append(buf, temp, width);
+}
+
+static inline void
+__put_key_int(SQLbuffer *buf, int64 ival)
+{
+	__put_key_uint(buf, (uint64)ival ^ (1UL << 63), sizeof(int64));
+}
+
+static void
+__put_key_bytes(SQLbuffer *buf, const char *addr, size_t len)
+{
+	static const char escape[2] = { 0x00, 0xff };
+	static const char terminator[2] = { 0x00, 0x00 };
+	size_t		i;
+
+	/* 0x00 is escaped to 0x00 0xff; 0x00 0x00 terminates the bytes */
+	for (i=0; i < len; i++)
+	{
+		if (addr[i] == 0)
+			sql_buffer_append(buf, escape, 2);
+		else
+			sql_buffer_append(buf, addr + i, 1);
+	}
+	sql_buffer_append(buf, terminator, 2);
+}
+
+static void
+__put_sort_key(SQLbuffer *buf, arrowColumnSrc *src, int64 row)
+{
+	ArrowType  *t = &src->field->type;
+	char		flag;
+
+	/* NULLs are sorted last */
+	if (__src_isnull(src, row))
+	{
+		flag = 0x02;
+		sql_buffer_append(buf, &flag, 1);
+		return;
+	}
+	flag = 0x01;
+	sql_buffer_append(buf, &flag, 1);
+
+	if (src->dict)
+	{
+		int64	index = __fetch_dict_index(src, row);
+
+		__put_key_bytes(buf, src->dict->labels[index],
+						src->dict->label_sz[index]);
+		return;
+	}
+
+	switch (t->node.tag)
+	{
+		case ArrowNodeTag__Bool:
+			flag = ((((const uint8 *)src->values)[row >> 3] &
+					 (1 << (row & 7))) != 0);
+			sql_buffer_append(buf, &flag, 1);
+			break;
+
+		case ArrowNodeTag__Int:
+			switch (t->Int.bitWidth)
+			{
+				case 8:
+					if (t->Int.is_signed)
+						__put_key_int(buf, ((const int8 *)src->values)[row]);
+					else
+						__put_key_uint(buf, ((const uint8 *)src->values)[row], 8);
+					break;
+				case 16:
+					if (t->Int.is_signed)
+						__put_key_int(buf, ((const int16 *)src->values)[row]);
+					else
+						__put_key_uint(buf, ((const uint16 *)src->values)[row], 8);
+					break;
+				case 32:
+					if (t->Int.is_signed)
+						__put_key_int(buf, ((const int32 *)src->values)[row]);
+					else
+						__put_key_uint(buf, ((const uint32 *)src->values)[row], 8);
+					break;
+				case 64:
+					if (t->Int.is_signed)
+						__put_key_int(buf, ((const int64 *)src->values)[row]);
+					else
+						__put_key_uint(buf, ((const uint64 *)src->values)[row], 8);
+					break;
+				default:
+					Elog("unexpected Int bitWidth (%d)", t->Int.bitWidth);
+			}
+			break;
+
+		case ArrowNodeTag__FloatingPoint:
+			{
+				union {
+					double	fval;
+					uint64	ival;
+				} u;
+
+				if (t->FloatingPoint.precision == ArrowPrecision__Single)
+					u.fval = ((const float *)src->values)[row];
+				else if (t->FloatingPoint.precision == ArrowPrecision__Double)
+					u.fval = ((const double *)src->values)[row];
+				else
+					Elog("half-precision float is not supported as sort key");
+				if ((u.ival & (1UL << 63)) != 0)
+					u.ival = ~u.ival;
+				else
+					u.ival ^= (1UL << 63);
+				__put_key_uint(buf, u.ival, sizeof(uint64));
+			}
+			break;
+
+		case ArrowNodeTag__Decimal:
+			{
+				int128		ival = ((const int128 *)src->values)[row];
+				uint64		hi = (uint64)(ival >> 64) ^ (1UL << 63);
+				uint64		lo = (uint64)ival;
+
+				__put_key_uint(buf, hi, sizeof(uint64));
+				__put_key_uint(buf, lo, sizeof(uint64));
+			}
+			break;
+
+		case ArrowNodeTag__Date:
+			if (t->Date.unit == ArrowDateUnit__Day)
+				__put_key_int(buf, ((const int32 *)src->values)[row]);
+			else
+				__put_key_int(buf, ((const int64 *)src->values)[row]);
+			break;
+
+		case ArrowNodeTag__Time:
+			if (t->Time.bitWidth == 32)
+				__put_key_int(buf, ((const int32 *)src->values)[row]);
+			else
+				__put_key_int(buf, ((const int64 *)src->values)[row]);
+			break;
+
+		case ArrowNodeTag__Timestamp:
+			__put_key_int(buf, ((const int64 *)src->values)[row]);
+			break;
+
+		case ArrowNodeTag__FixedSizeBinary:
+			{
+				int		width = t->FixedSizeBinary.byteWidth;
+
+				sql_buffer_append(buf, src->values + width * row, width);
+			}
+			break;
+
+		case ArrowNodeTag__Utf8:
+		case ArrowNodeTag__Binary:
+			{
+				const uint32 *offsets = (const uint32 *)src->values;
+
+				__put_key_bytes(buf, src->extra + offsets[row],
+								offsets[row+1] - offsets[row]);
+			}
+			break;
+
+		case ArrowNodeTag__LargeUtf8:
+		case ArrowNodeTag__LargeBinary:
+			{
+				const uint64 *offsets = (const uint64 *)src->values;
+
+				__put_key_bytes(buf, src->extra + offsets[row],
+								offsets[row+1] - offsets[row]);
+			}
+			break;
+
+		default:
+			Elog("Arrow Type %s is not supported as sort key",
+				 arrowTypeName(src->field));
+	}
+}
+
+static void
+spill_sort_items(void)
+{
+	char		temp[PATH_MAX];
+	FILE	   *filp;
+	int			fdesc;
+	size_t		i;
+
+	if (sort_nitems == 0)
+		return;
+	qsort(sort_items, sort_nitems, sizeof(size_t),
+		  compareSortItemsInArena);
+
+	snprintf(temp, sizeof(temp), "%s/arrow_compact.XXXXXX",
+			 temp_dirname ? temp_dirname : "/tmp");
+	fdesc = mkstemp(temp);
+	if (fdesc < 0)
+		Elog("failed on mkstemp('%s'): %m", temp);
+	/* run file is removed automatically on close */
+	unlink(temp);
+	filp = fdopen(fdesc, "w+b");
+	if (!filp)
+		Elog("failed on fdopen('%s'): %m", temp);
+	for (i=0; i < sort_nitems; i++)
+	{
+		sortItem   *item = (sortItem *)(sort_arena + sort_items[i]);
+		size_t		sz = offsetof(sortItem, key[item->key_len]);
+
+		if (fwrite(item, sz, 1, filp) != 1)
+			Elog("failed on fwrite('%s'): %m", temp);
+	}
+	if (fflush(filp) != 0)
+		Elog("failed on fflush('%s'): %m", temp);
+
+	if (!sort_runs)
+		sort_runs = palloc0(sizeof(sortRun) * 32);
+	else if ((sort_nruns & 31) == 0)
+		sort_runs = repalloc(sort_runs, sizeof(sortRun) * (sort_nruns + 32));
+	memset(&sort_runs[sort_nruns], 0, sizeof(sortRun));
+	sort_runs[sort_nruns++].filp = filp;
+	if (shows_progress)
+		printf("sort: run[%d] spilled, nitems=%zu\n",
+			   sort_nruns - 1, sort_nitems);
+
+	sort_arena_usage = 0;
+	sort_nitems = 0;
+}
+
+static void
+put_sort_item(SQLbuffer *key, uint32 file_id, uint32 batch_id, uint32 row_id)
+{
+	sortItem   *item;
+	size_t		sz = MAXALIGN(offsetof(sortItem, key[key->usage]));
+
+	if (sort_arena_usage + sz +
+		sizeof(size_t) * (sort_nitems + 1) > sort_memory_sz)
+	{
+		spill_sort_items();
+		if (sz + sizeof(size_t) > sort_memory_sz)
+			Elog("--sort-memory is too small for the sort key");
+	}
+	if (!sort_arena)
+	{
+		sort_arena = malloc(sort_memory_sz);
+		if (!sort_arena)
+			Elog("out of memory");
+	}
+	if (sort_nitems >= sort_nitems_max)
+	{
+		sort_nitems_max = Max(2 * sort_nitems_max, 1UL << 16);
+		sort_items = realloc(sort_items, sizeof(size_t) * sort_nitems_max);
+		if (!sort_items)
+			Elog("out of memory");
+	}
+	item = (sortItem *)(sort_arena + sort_arena_usage);
+	item->key_len = key->usage;
+	item->file_id = file_id;
+	item->batch_id = batch_id;
+	item->row_id = row_id;
+	memcpy(item->key, key->data, key->usage);
+
+	sort_items[sort_nitems++] = sort_arena_usage;
+	sort_arena_usage += sz;
+}
+
+static bool
+read_sort_run(sortRun *run)
+{
+	sortItem	head;
+	size_t		sz;
+
+	if (fread(&head, offsetof(sortItem, key), 1, run->filp) != 1)
+	{
+		if (ferror(run->filp))
+			Elog("failed on fread of the sort run: %m");
+		run->item = NULL;
+		return false;
+	}
+	sz = offsetof(sortItem, key[head.key_len]);
+	if (!run->item || run->item_sz < sz)
+	{
+		run->item_sz = Max(sz, 256);
+		run->item = (run->item ? repalloc(run->item, run->item_sz)
+							   : palloc(run->item_sz));
+	}
+	memcpy(run->item, &head, offsetof(sortItem, key));
+	if (head.key_len > 0 &&
+		fread(run->item->key, head.key_len, 1, run->filp) != 1)
+		Elog("failed on fread of the sort run: %m");
+	return true;
+}
+
+static inline bool
+__heap_less(int *heap, int i, int j)
+{
+	return __compareSortItems(sort_runs[heap[i]].item,
+							  sort_runs[heap[j]].item) < 0;
+}
+
+static void
+__heap_sift_down(int *heap, int nheap, int i)
+{
+	for (;;)
+	{
+		int		l = 2 * i + 1;
+		int		r = l + 1;
+		int		m = i;
+		int		temp;
+
+		if (l < nheap && __heap_less(heap, l, m))
+			m = l;
+		if (r < nheap && __heap_less(heap, r, m))
+			m = r;
+		if (m == i)
+			break;
+		temp = heap[i];
+		heap[i] = heap[m];
+		heap[m] = temp;
+		i = m;
+	}
+}
+
+static void
+merge_sort_runs(SQLtable *table)
+{
+	int		   *heap = alloca(sizeof(int) * sort_nruns);
+	int			nheap = 0;
+	int			i;
+
+	for (i=0; i < sort_nruns; i++)
+	{
+		if (fseek(sort_runs[i].filp, 0, SEEK_SET) != 0)
+			Elog("failed on fseek of the sort run: %m");
+		if (read_sort_run(&sort_runs[i]))
+			heap[nheap++] = i;
+	}
+	for (i = nheap / 2 - 1; i >= 0; i--)
+		__heap_sift_down(heap, nheap, i);
+
+	while (nheap > 0)
+	{
+		sortRun	   *run = &sort_runs[heap[0]];
+
+		append_one_row(table,
+					   run->item->file_id,
+					   run->item->batch_id,
+					   run->item->row_id);
+		if (!read_sort_run(run))
+			heap[0] = heap[--nheap];
+		__heap_sift_down(heap, nheap, 0);
+	}
+	for (i=0; i < sort_nruns; i++)
+		fclose(sort_runs[i].filp);
+}
+
+static void
+setup_sort_keys(SQLtable *table)
+{
+	char	   *namebuf = pstrdup(sort_key_names);
+	char	   *tok, *saveptr;
+	int			j;
+
+	sort_key_attnums = palloc0(sizeof(int) * (strlen(namebuf) + 1));
+	for (tok = strtok_r(namebuf, ",", &saveptr);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ",", &saveptr))
+	{
+		char   *end;
+
+		while (isspace(*tok))
+			tok++;
+		end = tok + strlen(tok) - 1;
+		while (end >= tok && isspace(*end))
+			*end-- = '\0';
+
+		for (j=0; j < table->nfields; j++)
+		{
+			if (strcmp(table->columns[j].field_name, tok) == 0)
+				break;
+		}
+		if (j == table->nfields)
+			Elog("sort key '%s' was not found", tok);
+		if (table->columns[j].element || table->columns[j].subfields ||
+			table->columns[j].arrow_type.node.tag == ArrowNodeTag__Interval)
+			Elog("sort key '%s' has unsupported data type (%s)",
+				 tok, table->columns[j].arrow_typename);
+		sort_key_attnums[num_sort_keys++] = j;
+	}
+	if (num_sort_keys == 0)
+		Elog("no valid sort keys in '%s'", sort_key_names);
+}
+
+static void
+compact_sorted(SQLtable *table)
+{
+	SQLbuffer	key;
+	uint32		file_id, batch_id;
+	int64		row;
+	int			k;
+
+	setup_sort_keys(table);
+	sql_buffer_init(&key);
+	for (file_id=0; file_id < num_input_files; file_id++)
+	{
+		arrowInputFile *input = &input_files[file_id];
+
+		for (batch_id=0; batch_id < input->num_batches; batch_id++)
+		{
+			arrowColumnSrc *srcs = input->batches[batch_id];
+			int64		nrows = input->af_info.recordBatches[batch_id].body.recordBatch.length;
+
+			for (row=0; row < nrows; row++)
+			{
+				sql_buffer_clear(&key);
+				for (k=0; k < num_sort_keys; k++)
+					__put_sort_key(&key, &srcs[sort_key_attnums[k]], row);
+				put_sort_item(&key, file_id, batch_id, row);
+			}
+		}
+	}
+
+	if (sort_nruns == 0)
+	{
+		/* all the items are sorted on memory */
+		size_t		i;
+
+		qsort(sort_items, sort_nitems, sizeof(size_t),
+			  compareSortItemsInArena);
+		for (i=0; i < sort_nitems; i++)
+		{
+			sortItem   *item = (sortItem *)(sort_arena + sort_items[i]);
+
+			append_one_row(table,
+						   item->file_id,
+						   item->batch_id,
+						   item->row_id);
+		}
+	}
+	else
+	{
+		spill_sort_items();
+		merge_sort_runs(table);
+	}
+}
+
+static void
+compact_sequential(SQLtable *table)
+{
+	uint32		file_id, batch_id;
+	int64		row;
+
+	for (file_id=0; file_id < num_input_files; file_id++)
+	{
+		arrowInputFile *input = &input_files[file_id];
+
+		for (batch_id=0; batch_id < input->num_batches; batch_id++)
+		{
+			int64		nrows = input->af_info.recordBatches[batch_id].body.recordBatch.length;
+
+			for (row=0; row < nrows; row++)
+				append_one_row(table, file_id, batch_id, row);
+		}
+	}
+}
+
+static void
+usage(void)
+{
+	fputs("Usage:\n"
+		  "  arrow_compact [OPTION] -o FILENAME INPUT_FILE [...]\n\n"
+		  "General options:\n"
+		  "  -o, --output=FILENAME result file in Apache Arrow format\n"
+		  "                       (it can be one of the input files; it is\n"
+		  "                       replaced atomically on success)\n"
+		  "      --remove-inputs  removes the input files on success\n"
+		  "\n"
+		  "Arrow format options:\n"
+		  "  -s, --segment-size=SIZE size of record batch for each\n"
+		  "      --max-file-size=SIZE switch the output file to the next\n"
+		  "                       numbered one (FILENAME.NNNN.arrow) if\n"
+		  "                       file size would exceed this limit\n"
+		  "\n"
+		  "Sort options:\n"
+		  "  -k, --sort-key=COLUMN[,COLUMN...]\n"
+		  "                       sorts the rows by the columns (NULLs last)\n"
+		  "      --sort-memory=SIZE memory size for sorting (default: 1GB);\n"
+		  "                       sort runs are spilled to temporary\n"
+		  "                       files beyond this size\n"
+		  "      --tmpdir=DIR     directory for the temporary files\n"
+		  "                       (default: /tmp)\n"
+		  "\n"
+		  "Other options:\n"
+		  "      --progress       shows progress of the job\n"
+		  "      --help           shows this message\n"
+		  "\n"
+		  "Report bugs to <pgstrom@heterodb.com>.\n",
+		  stderr);
+	exit(1);
+}
+
+static size_t
+parse_size_option(const char *value, const char *label)
+{
+	const char *pos = value;
+	size_t		sz = 0;
+
+	while (isdigit(*pos))
+		pos++;
+	if (pos == value)
+		sz = 0;
+	else if (*pos == '\0')
+		sz = atol(value);
+	else if (strcasecmp(pos, "k") == 0 ||
+			 strcasecmp(pos, "kb") == 0)
+		sz = atol(value) * (1UL << 10);
+	else if (strcasecmp(pos, "m") == 0 ||
+			 strcasecmp(pos, "mb") == 0)
+		sz = atol(value) * (1UL << 20);
+	else if (strcasecmp(pos, "g") == 0 ||
+			 strcasecmp(pos, "gb") == 0)
+		sz = atol(value) * (1UL << 30);
+	if (sz == 0)
+		Elog("%s is not valid: %s", label, value);
+	return sz;
+}
+
+static void
+parse_options(int argc, char * const argv[])
+{
+	static struct option long_options[] = {
+		{"output",        required_argument, NULL, 'o'},
+		{"segment-size",  required_argument, NULL, 's'},
+		{"sort-key",      required_argument, NULL, 'k'},
+		{"max-file-size", required_argument, NULL, 1000},
+		{"sort-memory",   required_argument, NULL, 1001},
+		{"tmpdir",        required_argument, NULL, 1002},
+		{"remove-inputs", no_argument,       NULL, 1003},
+		{"progress",      no_argument,       NULL, 1004},
+		{"help",          no_argument,       NULL, 9999},
+		{NULL, 0, NULL, 0},
+	};
+	int			c;
+
+	while ((c = getopt_long(argc, argv, "o:s:k:",
+							long_options, NULL)) >= 0)
+	{
+		switch (c)
+		{
+			case 'o':
+				if (output_filename)
+					Elog("-o option was supplied twice");
+				output_filename = optarg;
+				break;
+
+			case 's':
+				if (batch_segment_sz != 0)
+					Elog("-s option was supplied twice");
+				batch_segment_sz = parse_size_option(optarg, "segment size");
+				break;
+
+			case 'k':
+				if (sort_key_names)
+					Elog("-k option was supplied twice");
+				sort_key_names = optarg;
+				break;
+
+			case 1000:		/* --max-file-size */
+				if (max_file_size != 0)
+					Elog("--max-file-size option was supplied twice");
+				max_file_size = parse_size_option(optarg, "max file size");
+				break;
+
+			case 1001:		/* --sort-memory */
+				if (sort_memory_sz != 0)
+					Elog("--sort-memory option was supplied twice");
+				sort_memory_sz = parse_size_option(optarg, "sort memory");
+				break;
+
+			case 1002:		/* --tmpdir */
+				if (temp_dirname)
+					Elog("--tmpdir option was supplied twice");
+				temp_dirname = optarg;
+				break;
+
+			case 1003:		/* --remove-inputs */
+				remove_input_files = 1;
+				break;
+
+			case 1004:		/* --progress */
+				shows_progress = 1;
+				break;
+
+			default:	/* --help */
+				usage();
+		}
+	}
+	if (optind >= argc)
+		Elog("no input files were given");
+	if (!output_filename)
+		Elog("-o, --output=FILENAME must be given");
+	input_filenames = (char **)argv + optind;
+	num_input_files = argc - optind;
+
+	if (batch_segment_sz == 0)
+		batch_segment_sz = (1UL << 28);		/* 256MB in default */
+	if (max_file_size > 0)
+	{
+		/* record batch must fit into a file */
+		batch_segment_sz = Min(batch_segment_sz, max_file_size);
+	}
+	if (sort_memory_sz == 0)
+		sort_memory_sz = (1UL << 30);		/* 1GB in default */
+	if (!sort_key_names && temp_dirname)
+		Elog("--tmpdir is meaningless without -k, --sort-key");
+}
+
+int
+main(int argc, char * const argv[])
+{
+	SQLtable   *table;
+	int			i;
+
+	parse_options(argc, argv);
+	on_exit(cleanup_output_files_on_exit, NULL);
+
+	/* open the input files, and check the schema */
+	input_files = palloc0(sizeof(arrowInputFile) * num_input_files);
+	for (i=0; i < num_input_files; i++)
+	{
+		openInputFile(&input_files[i], input_filenames[i]);
+		if (i > 0)
+			checkSchemaCompatibility(&input_files[i], &input_files[0]);
+	}
+	/*
+	 * setup the output buffer; dictionaries are merged here, prior to
+	 * write out any files, because DictionaryBatches are located at the
+	 * head of the output files.
+	 */
+	table = setupOutputTable(&input_files[0]);
+	for (i=0; i < num_input_files; i++)
+		setupInputBatches(&input_files[i], table);
+
+	if (sort_key_names)
+		compact_sorted(table);
+	else
+		compact_sequential(table);
+
+	/* write out the remaining rows */
+	if (table->nitems > 0)
+		write_record_batch(table);
+	if (table->fdesc < 0 && !output_files_head)
+		setup_output_file(table);	/* empty file with schema only */
+	if (table->fdesc >= 0)
+		close_output_file(table);
+	commit_output_files();
+
+	return 0;
+}
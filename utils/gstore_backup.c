@@ -2,6 +2,8 @@
  * gstore_backup.c
  *
  * A utility to make real-time backup of Gstore_Fdw.
+ * If built with -D__GSTORE_REPLICA__, it works as gstore_replica that keeps
+ * the backup up-to-date by streaming of the REDO logs.
  * ----
  * Copyright 2011-2020 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
  * Copyright 2014-2020 (C) The PG-Strom Development Team
@@ -20,12 +22,18 @@
 #include <assert.h>
 #include <getopt.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <libpq-fe.h>
 #include "gstore_fdw.h"
+#include "cuda_gstore.h"
+#ifdef __GSTORE_REPLICA__
+#include <signal.h>
+#endif
 
 /* ---- static variables ---- */
 static char	   *pgsql_hostname = NULL;
@@ -36,8 +44,19 @@ static char	   *pgsql_database = NULL;
 static char	   *pgsql_tablename = NULL;
 static char	   *base_filename = NULL;
 static char	   *redo_filename = NULL;
+static char	   *manifest_filename = NULL;
+static int		num_workers = 4;
 static int		base_fdesc = -1;
+static char	   *base_mmap = NULL;
+static size_t	base_mmap_sz = 0;
 static long		PAGE_SIZE;
+#ifdef __GSTORE_REPLICA__
+static char	   *lpos_filename = NULL;
+static double	replica_interval = 5.0;			/* sec */
+static long		replica_min_length = 64;		/* kB */
+static long		replica_max_length = 131072;	/* kB */
+static volatile sig_atomic_t replica_shutdown = 0;
+#endif
 
 #define Elog(fmt, ...)                              \
 	do {                                            \
@@ -130,7 +149,11 @@ pgsql_server_connect(const char *pgsql_hostname,
 		index++;
 	}
 	keys[index] = "application_name";
+#ifdef __GSTORE_REPLICA__
+	values[index] = "gstore_replica";
+#else
 	values[index] = "gstore_backup";
+#endif
 	index++;
 
 	conn = PQconnectdbParams(keys, values, 0);
@@ -143,42 +166,724 @@ pgsql_server_connect(const char *pgsql_hostname,
 	return conn;
 }
 
-static uint64
-build_base_backup(PGconn *conn, int fdesc)
+/*
+ * ---- Routines to apply REDO logs ----
+ *
+ * It applies the REDO logs fetched by gstore_fdw_replication_redo() onto
+ * the base file, in the same manner as the recovery of gstore_fdw doing.
+ * Row-id map and indexes are not maintained here; the base file keeps the
+ * signature of mapped state, so gstore_fdw rebuilds them on startup.
+ */
+static void
+redo_map_base_file(void)
+{
+	struct stat	stat_buf;
+
+	if (base_mmap)
+	{
+		if (munmap(base_mmap, base_mmap_sz) != 0)
+			Elog("failed on munmap('%s'): %m", base_filename);
+		base_mmap = NULL;
+	}
+	if (fstat(base_fdesc, &stat_buf) != 0)
+		Elog("failed on fstat('%s'): %m", base_filename);
+	base_mmap_sz = stat_buf.st_size;
+	base_mmap = mmap(NULL, base_mmap_sz,
+					 PROT_READ | PROT_WRITE,
+					 MAP_SHARED,
+					 base_fdesc, 0);
+	if (base_mmap == MAP_FAILED)
+		Elog("failed on mmap('%s'): %m", base_filename);
+}
+
+static inline kern_data_store *
+redo_base_schema(void)
+{
+	return &((GpuStoreBaseFileHead *)base_mmap)->schema;
+}
+
+/*
+ * redo_alloc_extra - allocation of the extra buffer; it expands the
+ * base file on demand, so pointers to the base file must be reloaded.
+ */
+static cl_uint
+redo_alloc_extra(size_t sz)
+{
+	kern_data_store *kds = redo_base_schema();
+	kern_data_extra *extra;
+	size_t		off;
+
+	if (kds->extra_hoffset == 0)
+		Elog("base file '%s' has no extra buffer", base_filename);
+	extra = (kern_data_extra *)((char *)kds + kds->extra_hoffset);
+	if (extra->usage + MAXALIGN(sz) > extra->length)
+	{
+		size_t		new_length;
+		size_t		file_sz;
+
+		new_length = Max(extra->length + (64UL << 20),
+						 extra->usage + MAXALIGN(sz));
+		new_length = TYPEALIGN(PAGE_SIZE, new_length);
+		file_sz = (offsetof(GpuStoreBaseFileHead, schema) +
+				   kds->extra_hoffset + new_length);
+		if (ftruncate(base_fdesc, file_sz) != 0)
+			Elog("failed on ftruncate('%s',%zu): %m", base_filename, file_sz);
+		redo_map_base_file();
+		kds = redo_base_schema();
+		extra = (kern_data_extra *)((char *)kds + kds->extra_hoffset);
+		extra->length = new_length;
+	}
+	off = extra->usage;
+	extra->usage += MAXALIGN(sz);
+
+	return off;
+}
+
+/*
+ * redo_store_datum - 'addr' points the value, or NULL if null
+ */
+static void
+redo_store_datum(int colidx, cl_uint rowid, const char *addr)
+{
+	kern_data_store *kds = redo_base_schema();
+	kern_colmeta *cmeta = &kds->colmeta[colidx];
+	cl_uint		extra_off = 0;
+	char	   *values;
+
+	if (rowid >= kds->nrooms)
+		Elog("rowid %u is out of range (nrooms: %u)", rowid, kds->nrooms);
+	if (addr && cmeta->attlen == -1)
+	{
+		extra_off = redo_alloc_extra(VARSIZE_ANY(addr));
+		/* base file might be remapped */
+		kds = redo_base_schema();
+		cmeta = &kds->colmeta[colidx];
+		memcpy((char *)kds + kds->extra_hoffset + extra_off,
+			   addr, VARSIZE_ANY(addr));
+	}
+
+	if (cmeta->nullmap_offset != 0)
+	{
+		cl_uint	   *nullmap = (cl_uint *)
+			((char *)kds + __kds_unpack(cmeta->nullmap_offset));
+
+		if (addr)
+			nullmap[rowid >> 5] |=  (1U << (rowid & 0x1f));
+		else
+			nullmap[rowid >> 5] &= ~(1U << (rowid & 0x1f));
+	}
+	else if (!addr)
+		Elog("NULL value on '%s' column with NOT NULL constraint",
+			 NameStr(cmeta->attname));
+	if (!addr)
+		return;
+
+	values = (char *)kds + __kds_unpack(cmeta->values_offset);
+	if (cmeta->attlen > 0)
+	{
+		size_t	unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+
+		memcpy(values + unitsz * rowid, addr, cmeta->attlen);
+	}
+	else if (cmeta->attlen == -1)
+		((cl_uint *)values)[rowid] = __kds_packed(extra_off);
+	else
+		Elog("unsupported type definition");
+}
+
+/*
+ * redo_copy_datum - unchanged column by UPDATE shares the older version
+ */
+static void
+redo_copy_datum(int colidx, cl_uint oldid, cl_uint rowid)
+{
+	kern_data_store *kds = redo_base_schema();
+	kern_colmeta *cmeta = &kds->colmeta[colidx];
+	size_t		unitsz;
+	char	   *values;
+
+	if (oldid >= kds->nrooms || rowid >= kds->nrooms)
+		Elog("rowid %u/%u is out of range (nrooms: %u)",
+			 oldid, rowid, kds->nrooms);
+	if (cmeta->nullmap_offset != 0)
+	{
+		cl_uint	   *nullmap = (cl_uint *)
+			((char *)kds + __kds_unpack(cmeta->nullmap_offset));
+
+		if ((nullmap[oldid >> 5] & (1U << (oldid & 0x1f))) == 0)
+		{
+			nullmap[rowid >> 5] &= ~(1U << (rowid & 0x1f));
+			return;
+		}
+		nullmap[rowid >> 5] |= (1U << (rowid & 0x1f));
+	}
+	if (cmeta->attlen > 0)
+		unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+	else
+		unitsz = sizeof(cl_uint);
+	values = (char *)kds + __kds_unpack(cmeta->values_offset);
+	memcpy(values + unitsz * rowid, values + unitsz * oldid, unitsz);
+}
+
+static GstoreFdwSysattr *
+redo_fetch_sysattr(cl_uint rowid)
+{
+	kern_data_store *kds = redo_base_schema();
+	kern_colmeta *cmeta = &kds->colmeta[kds->ncols - 1];
+	char	   *values;
+
+	if (rowid >= kds->nrooms)
+		Elog("rowid %u is out of range (nrooms: %u)", rowid, kds->nrooms);
+	values = (char *)kds + __kds_unpack(cmeta->values_offset);
+	return (GstoreFdwSysattr *)
+		(values + TYPEALIGN(cmeta->attalign, cmeta->attlen) * rowid);
+}
+
+static void
+redo_store_sysattr(cl_uint rowid, TransactionId xmin,
+					  TransactionId xmax, CommandId cid)
+{
+	kern_data_store *kds = redo_base_schema();
+	GstoreFdwSysattr sysattr;
+
+	memset(&sysattr, 0, sizeof(GstoreFdwSysattr));
+	sysattr.xmin = xmin;
+	sysattr.xmax = xmax;
+	sysattr.cid  = cid;
+	redo_store_datum(kds->ncols - 1, rowid, (char *)&sysattr);
+	if (kds->nitems < rowid + 1)
+		kds->nitems = rowid + 1;
+}
+
+/*
+ * GSTORE_TX_LOG__INSERT
+ */
+static void
+redo_apply_insert(GstoreTxLogInsert *i_log)
+{
+	kern_data_store *kds = redo_base_schema();
+	HeapTupleHeaderData *htup = &i_log->htup;
+	bits8	   *bits = (htup->t_infomask & HEAP_HASNULL) ? htup->t_bits : NULL;
+	int			natts = HeapTupleHeaderGetNatts(htup);
+	char	   *pos = (char *)htup + htup->t_hoff;
+	int			j, ncols = kds->ncols - 1;		/* except for sysattr */
+
+	for (j=0; j < ncols; j++)
+	{
+		kern_colmeta *cmeta = &redo_base_schema()->colmeta[j];
+		char	   *addr;
+
+		if (j >= natts || (bits && att_isnull(j, bits)))
+		{
+			redo_store_datum(j, i_log->rowid, NULL);
+			continue;
+		}
+		if (cmeta->attlen > 0)
+		{
+			pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+			addr = pos;
+			pos += cmeta->attlen;
+		}
+		else
+		{
+			if (!VARATT_NOT_PAD_BYTE(pos))
+				pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+			addr = pos;
+			pos += VARSIZE_ANY(pos);
+		}
+		redo_store_datum(j, i_log->rowid, addr);
+	}
+	redo_store_sysattr(i_log->rowid,
+						  HeapTupleHeaderGetRawXmin(htup),
+						  HeapTupleHeaderGetRawXmax(htup),
+						  HeapTupleHeaderGetRawCommandId(htup));
+}
+
+/*
+ * GSTORE_TX_LOG__UPDATE
+ *
+ * Column-delta UPDATE log copies the unchanged columns from 'oldid'. The
+ * DELETE log of the same updater is applied prior to this log, so xmax of
+ * the older version must be the xmin of this log. Elsewhere, 'oldid' was
+ * already overwritten by the later logs applied before the replica restarts
+ * from the saved position. It is harmless if this log was also applied at
+ * that time (xmin of 'rowid' is already this log's one); the unchanged
+ * columns are kept. Otherwise, the values to be copied are lost.
+ */
+static void
+redo_apply_update(GstoreTxLogUpdate *u_log)
+{
+	char	   *pos = GSTORE_TX_LOG_UPDATE_VALUES(u_log);
+	int			j, k = 0;
+	int			ncols = redo_base_schema()->ncols - 1;
+	bool		copy_unchanged = true;
+
+	if (redo_fetch_sysattr(u_log->oldid)->xmax != u_log->xmin)
+	{
+		if (redo_fetch_sysattr(u_log->rowid)->xmin != u_log->xmin)
+			Elog("older version at rowid=%u was overwritten prior to the UPDATE log at rowid=%u (xid=%u); take a new base backup",
+				 u_log->oldid, u_log->rowid, u_log->xmin);
+		copy_unchanged = false;
+	}
+	for (j=0; j < ncols; j++)
+	{
+		kern_colmeta *cmeta = &redo_base_schema()->colmeta[j];
+		cl_ushort	attr = (k < u_log->nattrs ? u_log->attrs[k] : 0);
+
+		if (k >= u_log->nattrs ||
+			(attr & GSTORE_TX_LOG_UPDATE__COLMASK) != j)
+		{
+			if (copy_unchanged)
+				redo_copy_datum(j, u_log->oldid, u_log->rowid);
+			continue;
+		}
+		k++;
+		if ((attr & GSTORE_TX_LOG_UPDATE__ISNULL) != 0)
+		{
+			redo_store_datum(j, u_log->rowid, NULL);
+			continue;
+		}
+		if (cmeta->attlen > 0)
+		{
+			pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+			redo_store_datum(j, u_log->rowid, pos);
+			pos += cmeta->attlen;
+		}
+		else
+		{
+			if (!VARATT_NOT_PAD_BYTE(pos))
+				pos = (char *)TYPEALIGN(cmeta->attalign, pos);
+			redo_store_datum(j, u_log->rowid, pos);
+			pos += VARSIZE_ANY(pos);
+		}
+	}
+	redo_store_sysattr(u_log->rowid, u_log->xmin,
+						  InvalidTransactionId, InvalidCommandId);
+}
+
+/*
+ * GSTORE_TX_LOG__DELETE
+ */
+static void
+redo_apply_delete(GstoreTxLogDelete *d_log)
+{
+	redo_store_sysattr(d_log->rowid, d_log->xmin,
+						  d_log->xmax, InvalidCommandId);
+}
+
+/*
+ * redo_apply_chunk
+ */
+static void
+redo_apply_chunk(GpuStoreReplicationChunk *chunk, size_t chunk_sz)
 {
+	char	   *pos = chunk->data;
+	char	   *end = (char *)chunk + chunk_sz;
+	cl_uint		count;
+
+	if (chunk->rep_kind != 'r')
+		Elog("unexpected replication chunk kind '%c'", chunk->rep_kind);
+	/* rows bulk-loaded without REDO logs are never replicated */
+	if (chunk->rep_redo_revision !=
+		((GpuStoreBaseFileHead *)base_mmap)->redo_revision)
+	{
+#ifdef __GSTORE_REPLICA__
+		Elog("REDO logs of '%s' are not applicable to '%s' because of bulk-load or rebuild on the server\n"
+			 "HINT: remove '%s' to take a new base backup",
+			 pgsql_tablename, base_filename, lpos_filename);
+#else
+		Elog("REDO logs of '%s' are not applicable to '%s' because of bulk-load or rebuild on the server, retry again",
+			 pgsql_tablename, base_filename);
+#endif
+	}
+	for (count=0; count < chunk->rep_nitems; count++)
+	{
+		GstoreTxLogCommon *tx_log = (GstoreTxLogCommon *)pos;
+
+		if (pos + offsetof(GstoreTxLogCommon, data) > end ||
+			pos + tx_log->length > end ||
+			tx_log->length != MAXALIGN(tx_log->length))
+			Elog("REDO log chunk looks corrupted");
+		switch (tx_log->type)
+		{
+			case GSTORE_TX_LOG__INSERT:
+				redo_apply_insert((GstoreTxLogInsert *)tx_log);
+				break;
+			case GSTORE_TX_LOG__UPDATE:
+				redo_apply_update((GstoreTxLogUpdate *)tx_log);
+				break;
+			case GSTORE_TX_LOG__DELETE:
+				redo_apply_delete((GstoreTxLogDelete *)tx_log);
+				break;
+			case GSTORE_TX_LOG__COMMIT:
+				/*
+				 * Like the recovery, the visibility of rows relies on the
+				 * xmin/xmax, so rows written by aborted transactions hold
+				 * the same values as the primary, and are never visible.
+				 */
+				break;
+			default:
+				Elog("unknown REDO log type (%08x)", tx_log->type);
+		}
+		pos += tx_log->length;
+	}
+}
+
+/*
+ * ---- Routines of parallel base backup ----
+ *
+ * Multiple connections fetch disjoint chunks of the base file concurrently,
+ * then write them on the preallocated output file using pwrite(2).
+ * Each chunk is a consistent copy at the moment, but different chunks may be
+ * copied at different moments, so the REDO logs since the logical position
+ * of the first chunk are applied at the end of the base backup to bring the
+ * output file into a consistent state.
+ * Column-delta UPDATE log reads the unchanged columns from the older version
+ * at 'oldid', which may be copied by another chunk at a later moment. The
+ * server never reuses 'oldid' of the UPDATE logs since the first chunk while
+ * the chunks are fetched (it is a lease renewed by every chunk), so 'oldid'
+ * of any chunk still holds the older version or the one updated by the REDO
+ * logs prior to the UPDATE log. rep_unpin_pos of each chunk ensures it; if
+ * the lease expired (e.g, resume after a long interruption) and 'oldid' may
+ * be reused, the base backup fails rather than copies the wrong values.
+ * Completed chunks are recorded on the manifest file, so an interrupted base
+ * backup can resume from the remaining chunks, unless the base file on the
+ * server side is rebuilt (e.g, compaction) in the meantime.
+ * Rows bulk-loaded on the server side have no REDO logs, so the REDO catch-up
+ * fails if redo_revision of the REDO logs is not identical to the one of the
+ * first chunk, and the manifest is also invalidated.
+ */
+typedef struct
+{
+	pthread_t	thread;
+	int			worker_id;
+	PGconn	   *conn;
+} BackupWorker;
+
+static pthread_mutex_t backup_lock = PTHREAD_MUTEX_INITIALIZER;
+static int		backup_manifest_fdesc = -1;
+static uint32	backup_next_index = 0;		/* next chunk index to fetch */
+static bool		backup_end_of_chunks = false;
+static bool	   *backup_done_chunks = NULL;	/* completed at the last run */
+static uint32	backup_num_done_chunks = 0;
+static uint32	backup_revision;			/* base_mmap_revision of the server */
+static uint64	backup_redo_revision;		/* redo_revision of the first chunk */
+static uint64	backup_start_lpos;			/* start position of REDO catch-up */
+static size_t	backup_base_nchunks;		/* number of 'b' chunks */
+static size_t	backup_extra_offset;		/* offset of the extra buffer */
+static size_t	backup_extra_end = 0;		/* tail of the extra chunks */
+
+static ssize_t
+__PWrite(int fdesc, const void *buf, size_t nbytes, off_t f_pos)
+{
+	ssize_t		rv, offset = 0;
+
+	do {
+		rv = pwrite(fdesc, (char *)buf + offset, nbytes - offset, f_pos + offset);
+		if (rv > 0)
+			offset += rv;
+		else if (rv == 0)
+			break;
+		else if (errno != EINTR)
+			return -1;
+	} while (offset < nbytes);
+
+	return offset;
+}
+
+/*
+ * backup_fetch_chunk - it returns NULL if no more chunks. Elsewhere, caller
+ * must release the PGresult; chunk points the binary bytea as is.
+ */
+static GpuStoreReplicationChunk *
+backup_fetch_chunk(PGconn *conn, uint32 index,
+				   PGresult **p_res, size_t *p_chunk_sz)
+{
+	const char *command = "SELECT pgstrom.gstore_fdw_replication_base($1,$2)";
 	PGresult   *res;
-	const char *command;
-	GpuStoreBaseFileHead baseHead;
-	kern_data_extra extraHead;
-	size_t		base_sz = 0;
-	size_t		extra_sz = 0;
-	char		countBuf[20];
 	Oid			paramTypes[2];
 	const char *paramValues[2];
-	int32		count = 0;
-	char		phase = 'b';
-	uint64		next_lpos = 0;
-
-	/* begin transaction */
-	res = PQexec(conn, "BEGIN");
-	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-		Elog("SQL execution failed: %s", PQresultErrorMessage(res));
-	PQclear(res);
+	char		indexBuf[20];
+	size_t		chunk_sz;
 
-	/* fetch base & extra portion */
-	command = "SELECT pgstrom.gstore_fdw_replication_base($1,$2)";
 	paramTypes[0] = TEXTOID;
 	paramTypes[1] = INT4OID;
 	paramValues[0] = pgsql_tablename;
-	paramValues[1] = countBuf;
+	paramValues[1] = indexBuf;
+	sprintf(indexBuf, "%u", index);
+
+	res = PQexecParams(conn, command, 2,
+					   paramTypes,
+					   paramValues,
+					   NULL,
+					   NULL,
+					   1);		/* result should be binary format */
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		Elog("SQL execution failed [%s] $1='%s', $2='%u': %s",
+			 command, pgsql_tablename, index,
+			 PQresultErrorMessage(res));
+	if (PQnfields(res) != 1 || PQntuples(res) != 1)
+		Elog("unexpected number of columns/rows returned for [%s]",
+			 command);
+	if (PQgetisnull(res, 0, 0))
+	{
+		PQclear(res);
+		return NULL;
+	}
+	chunk_sz = PQgetlength(res, 0, 0);
+	if (chunk_sz <= offsetof(GpuStoreReplicationChunk, data))
+		Elog("replication chunk %u is too short (%zu)", index, chunk_sz);
+	*p_res = res;
+	*p_chunk_sz = chunk_sz;
 
-	for (count=0; ; count++)
+	return (GpuStoreReplicationChunk *)PQgetvalue(res, 0, 0);
+}
+
+/*
+ * backup_write_chunk
+ */
+static void
+backup_write_chunk(uint32 index, GpuStoreReplicationChunk *chunk, size_t chunk_sz)
+{
+	size_t		len = chunk_sz - offsetof(GpuStoreReplicationChunk, data);
+	size_t		offset;
+	char		buf[80];
+
+	if (chunk->rep_revision != backup_revision)
+		Elog("base file of '%s' was rebuilt during the base backup, retry again",
+			 pgsql_tablename);
+	if (chunk->rep_unpin_pos > backup_start_lpos)
+		Elog("rowids of '%s' referred by REDO logs since lpos = %lu were reused during the base backup\n"
+			 "HINT: remove '%s' to restart the base backup from scratch",
+			 pgsql_tablename, backup_start_lpos, manifest_filename);
+	if (chunk->rep_kind == 'b')
+	{
+		if (index >= backup_base_nchunks)
+			Elog("Bug? base chunk index %u is out of range", index);
+		offset = GSTORE_REPLICATION_CHUNK_SIZE * (size_t)index;
+	}
+	else if (chunk->rep_kind == 'e')
 	{
-		GpuStoreReplicationChunk *chunk = NULL;
-		size_t		chunk_sz = 0;
-		size_t		len;
+		if (index < backup_base_nchunks || backup_extra_offset == 0)
+			Elog("Bug? extra chunk index %u is out of range", index);
+		offset = (backup_extra_offset +
+				  GSTORE_REPLICATION_CHUNK_SIZE * (index - backup_base_nchunks));
+	}
+	else
+		Elog("unexpected replication chunk kind '%c'", chunk->rep_kind);
+
+	if (__PWrite(base_fdesc, chunk->data, len, offset) != len)
+		Elog("failed on pwrite('%s'): %m", base_filename);
 
-		sprintf(countBuf, "%d", count);
+	pthread_mutex_lock(&backup_lock);
+	if (chunk->rep_kind == 'e')
+		backup_extra_end = Max(backup_extra_end, offset + len);
+	/*
+	 * Only full-size chunks are recorded, because partial chunks at the
+	 * tail may be expanded by the time of resume.
+	 */
+	if (len == GSTORE_REPLICATION_CHUNK_SIZE)
+	{
+		if (fdatasync(base_fdesc) != 0)
+			Elog("failed on fdatasync('%s'): %m", base_filename);
+		len = sprintf(buf, "chunk %u\n", index);
+		if (__Write(backup_manifest_fdesc, buf, len) != len ||
+			fdatasync(backup_manifest_fdesc) != 0)
+			Elog("failed on write('%s'): %m", manifest_filename);
+	}
+	pthread_mutex_unlock(&backup_lock);
+}
+
+/*
+ * backup_worker_main
+ */
+static void *
+backup_worker_main(void *__priv)
+{
+	BackupWorker *worker = __priv;
+
+	if (!worker->conn)
+		worker->conn = pgsql_server_connect(pgsql_hostname,
+											pgsql_port_num,
+											pgsql_username,
+											pgsql_password,
+											pgsql_database);
+	for (;;)
+	{
+		GpuStoreReplicationChunk *chunk;
+		PGresult   *res;
+		size_t		chunk_sz;
+		uint32		index;
+
+		pthread_mutex_lock(&backup_lock);
+		if (backup_end_of_chunks)
+		{
+			pthread_mutex_unlock(&backup_lock);
+			break;
+		}
+		index = backup_next_index++;
+		pthread_mutex_unlock(&backup_lock);
+
+		if (index < backup_num_done_chunks && backup_done_chunks[index])
+			continue;
+		chunk = backup_fetch_chunk(worker->conn, index, &res, &chunk_sz);
+		if (!chunk)
+		{
+			pthread_mutex_lock(&backup_lock);
+			backup_end_of_chunks = true;
+			pthread_mutex_unlock(&backup_lock);
+			break;
+		}
+		backup_write_chunk(index, chunk, chunk_sz);
+		PQclear(res);
+	}
+	if (worker->worker_id > 0)
+		PQfinish(worker->conn);
+	return NULL;
+}
+
+/*
+ * backup_load_manifest - it returns the logical position to start REDO
+ * catch-up if the manifest of the last run is still valid.
+ */
+static bool
+backup_load_manifest(uint64 *p_lpos)
+{
+	FILE	   *filp;
+	char		line[1024];
+	char	   *tablename = NULL;
+	unsigned int revision = 0;
+	unsigned long redo_revision = ULONG_MAX;
+	unsigned long lpos = ULONG_MAX;
+	unsigned int index;
+	bool		retval = false;
+
+	filp = fopen(manifest_filename, "rb");
+	if (!filp)
+	{
+		if (errno == ENOENT)
+			return false;
+		Elog("failed on fopen('%s'): %m", manifest_filename);
+	}
+	while (fgets(line, sizeof(line), filp))
+	{
+		size_t	len = strlen(line);
+
+		if (len > 0 && line[len-1] == '\n')
+			line[--len] = '\0';
+		if (strncmp(line, "table ", 6) == 0)
+		{
+			tablename = strdup(line + 6);
+			if (!tablename)
+				Elog("out of memory");
+		}
+		else if (sscanf(line, "revision %u", &revision) == 1 ||
+				 sscanf(line, "redo_revision %lu", &redo_revision) == 1 ||
+				 sscanf(line, "lpos %lu", &lpos) == 1)
+			continue;
+		else if (sscanf(line, "chunk %u", &index) == 1)
+		{
+			if (index >= backup_num_done_chunks)
+			{
+				uint32	nchunks = Max(2 * backup_num_done_chunks, index + 1);
+
+				backup_done_chunks = realloc(backup_done_chunks,
+											 sizeof(bool) * nchunks);
+				if (!backup_done_chunks)
+					Elog("out of memory");
+				memset(backup_done_chunks + backup_num_done_chunks, 0,
+					   sizeof(bool) * (nchunks - backup_num_done_chunks));
+				backup_num_done_chunks = nchunks;
+			}
+			backup_done_chunks[index] = true;
+		}
+		else
+			Elog("manifest file '%s' is corrupted: %s", manifest_filename, line);
+	}
+	fclose(filp);
+
+	if (tablename && strcmp(tablename, pgsql_tablename) == 0 &&
+		revision == backup_revision &&
+		redo_revision == backup_redo_revision && lpos != ULONG_MAX)
+	{
+		*p_lpos = lpos;
+		retval = true;
+	}
+	else
+	{
+		/* manifest of the different base file */
+		free(backup_done_chunks);
+		backup_done_chunks = NULL;
+		backup_num_done_chunks = 0;
+	}
+	free(tablename);
+
+	return retval;
+}
+
+/*
+ * backup_open_manifest
+ */
+static void
+backup_open_manifest(bool is_resume, uint64 lpos)
+{
+	char		buf[NAMEDATALEN * 2 + 200];
+	size_t		len;
+
+	if (is_resume)
+	{
+		backup_manifest_fdesc = open(manifest_filename, O_WRONLY | O_APPEND);
+		if (backup_manifest_fdesc < 0)
+			Elog("failed on open('%s'): %m", manifest_filename);
+		return;
+	}
+	/* start a new base backup */
+	if (ftruncate(base_fdesc, 0) != 0)
+		Elog("failed on ftruncate('%s'): %m", base_filename);
+	backup_manifest_fdesc = open(manifest_filename,
+								 O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (backup_manifest_fdesc < 0)
+		Elog("failed on open('%s'): %m", manifest_filename);
+	len = snprintf(buf, sizeof(buf),
+				   "table %s\n"
+				   "revision %u\n"
+				   "redo_revision %lu\n"
+				   "lpos %lu\n",
+				   pgsql_tablename,
+				   backup_revision,
+				   backup_redo_revision,
+				   lpos);
+	if (__Write(backup_manifest_fdesc, buf, len) != len ||
+		fdatasync(backup_manifest_fdesc) != 0)
+		Elog("failed on write('%s'): %m", manifest_filename);
+}
+
+/*
+ * backup_redo_catchup - apply REDO logs since 'lpos' until the latest one
+ */
+static uint64
+backup_redo_catchup(PGconn *conn, uint64 lpos)
+{
+	const char *command = "SELECT pgstrom.gstore_fdw_replication_redo($1,$2,0.0,0)";
+	Oid			paramTypes[2];
+	const char *paramValues[2];
+	char		lposBuf[40];
+	void	   *chunk_buf = NULL;
+	size_t		chunk_bufsz = 0;
+
+	paramTypes[0] = TEXTOID;
+	paramTypes[1] = INT8OID;
+	paramValues[0] = pgsql_tablename;
+	paramValues[1] = lposBuf;
+
+	redo_map_base_file();
+	for (;;)
+	{
+		PGresult   *res;
+		GpuStoreReplicationChunk *chunk;
+		size_t		chunk_sz;
+
+		sprintf(lposBuf, "%lu", lpos);
 		res = PQexecParams(conn, command, 2,
 						   paramTypes,
 						   paramValues,
@@ -186,146 +891,356 @@ build_base_backup(PGconn *conn, int fdesc)
 						   NULL,
 						   1);		/* result should be binary format */
 		if (PQresultStatus(res) != PGRES_TUPLES_OK)
-			Elog("SQL execution failed [%s] $1='%s', $2='%d'",
-				 command, pgsql_tablename, count);
-		if (PQnfields(res) != 1 || PQntuples(res) != 1)
-			Elog("unexpected number of columns/rows returned for [%s]",
-				 command);
-	retry:
-		if (phase == 'b')
-		{
-			if (!PQgetisnull(res, 0, 0))
-			{
-				chunk = (GpuStoreReplicationChunk *)PQgetvalue(res, 0, 0);
-				chunk_sz = PQgetlength(res, 0, 0);
-				assert(chunk_sz > offsetof(GpuStoreReplicationChunk, data));
-				/* save the header portion */
-				if (base_sz < sizeof(GpuStoreBaseFileHead))
-				{
-					len = Min(chunk_sz - offsetof(GpuStoreReplicationChunk, data),
-							  sizeof(GpuStoreBaseFileHead) - base_sz);
-					memcpy(((char *)&baseHead) + base_sz, chunk->data, len);
-				}
-				next_lpos = chunk->rep_lpos;
-			}
+			Elog("SQL execution failed [%s]: %s"
+				 "HINT: remove '%s' to restart the base backup from scratch",
+				 command, PQresultErrorMessage(res), manifest_filename);
+		if (PQnfields(res) != 1 || PQntuples(res) != 1 || PQgetisnull(res, 0, 0))
+			Elog("unexpected result returned for [%s]", command);
 
-			if (chunk && chunk->rep_kind == 'b')
-			{
-				assert(chunk_sz > offsetof(GpuStoreReplicationChunk, data));
-				len = chunk_sz - offsetof(GpuStoreReplicationChunk, data);
-				if (__Write(fdesc, chunk->data, len) != len)
-					Elog("failed on __Write('%s'): %m", base_filename);
-				base_sz += len;
-			}
-			else
-			{
-				cl_uint		nrooms = baseHead.schema.nrooms;
-				cl_uint		nslots;
-				
-				/* end of the base chunk, switch to the extra chunk */
-				if (base_sz < sizeof(GpuStoreBaseFileHead))
-					Elog("Bug? base chunk of '%s' is incomplete", pgsql_tablename);
-
-				assert(baseHead.rowid_map_offset >= base_sz);
-				len = (baseHead.rowid_map_offset +
-					   MAXALIGN(offsetof(GpuStoreRowIdMapHead,
-										 rowid_chain[nrooms])));
-				len = TYPEALIGN(PAGE_SIZE, len);
-
-				if (baseHead.hash_index_offset > 0)
-				{
-					/* with primary key, thus hash-index exists */
-					if (baseHead.hash_index_offset != len)
-						Elog("Bug? location of hash-index is corrupted");
-					nslots = Min(1.2 * (double)nrooms + 1000.0, UINT_MAX);
-					len += offsetof(GpuStoreHashIndexHead,
-									slots[nslots + nrooms]);
-					len = TYPEALIGN(PAGE_SIZE, len);
-				}
-
-				if (ftruncate(fdesc, len) < 0)
-					Elog("failed on ftruncate('%s',%zu): %m", base_filename, len);
-				if (lseek(fdesc, 0, SEEK_END) < 0)
-					Elog("failed on lseek('%s', 0, SEEK_END): %m", base_filename);
-				base_sz = len;
-
-				phase = chunk->rep_kind;
-				if (chunk)
-					goto retry;
-			}
-		}
-		else if (phase == 'e')
+		/* chunk->data must be aligned for the REDO logs */
+		chunk_sz = PQgetlength(res, 0, 0);
+		if (chunk_sz < offsetof(GpuStoreReplicationChunk, data))
+			Elog("replication chunk is too short (%zu)", chunk_sz);
+		if (chunk_sz > chunk_bufsz)
 		{
-			if (!PQgetisnull(res, 0, 0))
-			{
-				chunk = (GpuStoreReplicationChunk *)PQgetvalue(res, 0, 0);
-				chunk_sz = PQgetlength(res, 0, 0);
-				assert(chunk_sz > offsetof(GpuStoreReplicationChunk, data));
-				/* save the header portion */
-				if (extra_sz < sizeof(kern_data_extra))
-				{
-					len = Min(chunk_sz - offsetof(GpuStoreReplicationChunk, data),
-							  sizeof(kern_data_extra) - extra_sz);
-					memcpy((char *)&extraHead + extra_sz, chunk->data, len);
-				}
-				next_lpos = chunk->rep_lpos;
-			}
-
-			if (chunk && chunk->rep_kind == 'e')
-			{
-				/* sanity checks */
-				if (base_sz != (offsetof(GpuStoreBaseFileHead,
-										 schema) + baseHead.schema.extra_hoffset))
-					Elog("Bug? Location of extra buffer is corrupted");
-				assert(chunk_sz > offsetof(GpuStoreReplicationChunk, data));
-				len = chunk_sz - offsetof(GpuStoreReplicationChunk, data);
-				if (__Write(fdesc, chunk->data, len) != len)
-					Elog("failed on __Write('%s'): %m", base_filename);
-				extra_sz += len;
-			}
-			else
-			{
-				/* end of the extra chunk, enlarge buffer to fit extra->length */
-				if (extra_sz < sizeof(kern_data_extra))
-					Elog("Bug? extra chunk of '%s' is incomplete", pgsql_tablename);
-				assert(extraHead.length >= extra_sz);
-				len = (base_sz + extraHead.length);
-				if (ftruncate(fdesc, len) < 0)
-					Elog("failed on ftruncate('%s',%zu): %m", base_filename, len);
-				if (chunk)
-					goto retry;		/* should not happen */
-			}
+			chunk_bufsz = TYPEALIGN(PAGE_SIZE, chunk_sz);
+			free(chunk_buf);
+			chunk_buf = malloc(chunk_bufsz);
+			if (!chunk_buf)
+				Elog("out of memory");
 		}
-		else
-			Elog("Bug? wrong internal phase '%c'", phase);
+		memcpy(chunk_buf, PQgetvalue(res, 0, 0), chunk_sz);
 		PQclear(res);
-		if (!chunk)
+		chunk = chunk_buf;
+
+		if (chunk->rep_nitems > 0)
+			redo_apply_chunk(chunk, chunk_sz);
+		if (chunk->rep_lpos == lpos)
+			break;		/* caught up the latest REDO log */
+		lpos = chunk->rep_lpos;
+	}
+	free(chunk_buf);
+	if (msync(base_mmap, base_mmap_sz, MS_SYNC) != 0)
+		Elog("failed on msync('%s'): %m", base_filename);
+
+	return lpos;
+}
+
+/*
+ * build_base_backup
+ */
+static uint64
+build_base_backup(PGconn *conn)
+{
+	GpuStoreReplicationChunk *chunk;
+	PGresult   *res;
+	size_t		chunk_sz;
+	GpuStoreBaseFileHead baseHead;
+	kern_data_extra extraHead;
+	BackupWorker *workers;
+	size_t		base_length;
+	size_t		len;
+	cl_uint		nrooms;
+	uint64		ngroups;
+	uint64		start_lpos;
+	bool		is_resume;
+	int			i, k;
+
+	/*
+	 * The first chunk shall be fetched prior to the others, to determine
+	 * the layout of the base file and the logical position to start
+	 * the REDO catch-up.
+	 */
+	chunk = backup_fetch_chunk(conn, 0, &res, &chunk_sz);
+	if (!chunk || chunk->rep_kind != 'b' ||
+		chunk_sz < offsetof(GpuStoreReplicationChunk,
+							data) + sizeof(GpuStoreBaseFileHead))
+		Elog("Bug? base chunk of '%s' is incomplete", pgsql_tablename);
+	memcpy(&baseHead, chunk->data, sizeof(GpuStoreBaseFileHead));
+	backup_revision = chunk->rep_revision;
+	backup_redo_revision = chunk->rep_redo_revision;
+	start_lpos = chunk->rep_lpos;
+
+	base_length = (offsetof(GpuStoreBaseFileHead, schema) +
+				   baseHead.schema.length);
+	backup_base_nchunks = ((base_length + GSTORE_REPLICATION_CHUNK_SIZE - 1) /
+						   GSTORE_REPLICATION_CHUNK_SIZE);
+	/* rowid-map, hash-index and ordered-index sections, if any */
+	nrooms = baseHead.schema.nrooms;
+	assert(baseHead.rowid_map_offset >= base_length);
+	len = (baseHead.rowid_map_offset +
+		   MAXALIGN(offsetof(GpuStoreRowIdMapHead,
+							 rowid_chain[nrooms])));
+	len = TYPEALIGN(PAGE_SIZE, len);
+	if (baseHead.hash_index_offset > 0)
+	{
+		/* with primary key, thus hash-index exists */
+		if (baseHead.hash_index_offset != len)
+			Elog("Bug? location of hash-index is corrupted");
+		ngroups = gstoreFdwHashIndexNumGroups(nrooms);
+		len += offsetof(GpuStoreHashIndexHead,
+						groups[ngroups]);
+		len = TYPEALIGN(PAGE_SIZE, len);
+	}
+	for (k=0; k < GPUSTORE_MAX_ORDERED_INDEXES; k++)
+	{
+		if (baseHead.ordered_index_offset[k] == 0)
 			break;
+		if (baseHead.ordered_index_offset[k] != len)
+			Elog("Bug? location of ordered-index is corrupted");
+		len += gstoreFdwOrderedIndexSize(nrooms);
+		len = TYPEALIGN(PAGE_SIZE, len);
 	}
-	/* end transaction - release exclusive lock */
-	res = PQexec(conn, "COMMIT");
-	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-		Elog("SQL execution failed: %s", PQresultErrorMessage(res));
+	if (baseHead.schema.extra_hoffset != 0)
+	{
+		backup_extra_offset = (offsetof(GpuStoreBaseFileHead, schema) +
+							   baseHead.schema.extra_hoffset);
+		if (backup_extra_offset != len)
+			Elog("Bug? Location of extra buffer is corrupted");
+	}
+
+	/* resume the last base backup, if manifest is valid */
+	is_resume = backup_load_manifest(&start_lpos);
+	backup_open_manifest(is_resume, start_lpos);
+	backup_start_lpos = start_lpos;
+	if (is_resume)
+		printf("resume base backup from lpos = %lu\n", start_lpos);
+
+	/* preallocation of the output file */
+	if (!is_resume && ftruncate(base_fdesc, len) != 0)
+		Elog("failed on ftruncate('%s',%zu): %m", base_filename, len);
+	if (posix_fallocate(base_fdesc, 0, base_length) != 0)
+		Elog("failed on posix_fallocate('%s',%zu): %m",
+			 base_filename, base_length);
+	backup_write_chunk(0, chunk, chunk_sz);
 	PQclear(res);
-	
-	return next_lpos;
+
+	/* fetch the remaining chunks by multiple connections */
+	backup_next_index = 1;
+	workers = alloca(sizeof(BackupWorker) * num_workers);
+	memset(workers, 0, sizeof(BackupWorker) * num_workers);
+	for (i=1; i < num_workers; i++)
+	{
+		workers[i].worker_id = i;
+		if (pthread_create(&workers[i].thread, NULL,
+						   backup_worker_main, &workers[i]) != 0)
+			Elog("failed on pthread_create: %m");
+	}
+	workers[0].worker_id = 0;
+	workers[0].conn = conn;
+	backup_worker_main(&workers[0]);
+	for (i=1; i < num_workers; i++)
+	{
+		if (pthread_join(workers[i].thread, NULL) != 0)
+			Elog("failed on pthread_join: %m");
+	}
+	close(backup_manifest_fdesc);
+
+	/*
+	 * Chunks of the extra buffer might be copied after the extra buffer
+	 * header, so 'usage' must cover all the fetched chunks not to overwrite
+	 * them by the REDO catch-up.
+	 */
+	if (backup_extra_offset != 0)
+	{
+		if (pread(base_fdesc, &extraHead, sizeof(kern_data_extra),
+				  backup_extra_offset) != sizeof(kern_data_extra))
+			Elog("failed on pread('%s'): %m", base_filename);
+		if (backup_extra_end < backup_extra_offset + sizeof(kern_data_extra))
+			Elog("Bug? extra chunk of '%s' is incomplete", pgsql_tablename);
+		len = backup_extra_end - backup_extra_offset;
+		if (extraHead.usage < len)
+			extraHead.usage = MAXALIGN(len);
+		if (extraHead.length < extraHead.usage)
+			extraHead.length = TYPEALIGN(PAGE_SIZE, extraHead.usage);
+		if (__PWrite(base_fdesc, &extraHead, sizeof(kern_data_extra),
+					 backup_extra_offset) != sizeof(kern_data_extra))
+			Elog("failed on pwrite('%s'): %m", base_filename);
+		len = backup_extra_offset + extraHead.length;
+		if (ftruncate(base_fdesc, len) != 0)
+			Elog("failed on ftruncate('%s',%zu): %m", base_filename, len);
+	}
+	return backup_redo_catchup(conn, start_lpos);
+}
+
+#ifdef __GSTORE_REPLICA__
+/*
+ * replica_save_lpos - logical position to be resumed; the base file must
+ * be persisted prior to the update of this position.
+ */
+static void
+replica_save_lpos(uint64 lpos)
+{
+	char	   *temp_filename = alloca(strlen(lpos_filename) + 10);
+	char		buf[40];
+	int			fdesc;
+	size_t		len;
+
+	if (base_mmap && msync(base_mmap, base_mmap_sz, MS_SYNC) != 0)
+		Elog("failed on msync('%s'): %m", base_filename);
+
+	sprintf(temp_filename, "%s.tmp", lpos_filename);
+	fdesc = open(temp_filename, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fdesc < 0)
+		Elog("failed on open('%s'): %m", temp_filename);
+	len = sprintf(buf, "%lu\n", lpos);
+	if (__Write(fdesc, buf, len) != len)
+		Elog("failed on __Write('%s'): %m", temp_filename);
+	if (fsync(fdesc) != 0)
+		Elog("failed on fsync('%s'): %m", temp_filename);
+	close(fdesc);
+	if (rename(temp_filename, lpos_filename) != 0)
+		Elog("failed on rename('%s','%s'): %m", temp_filename, lpos_filename);
+}
+
+static bool
+replica_load_lpos(uint64 *p_lpos)
+{
+	FILE	   *filp;
+	unsigned long lpos;
+	int			rv;
+
+	filp = fopen(lpos_filename, "rb");
+	if (!filp)
+	{
+		if (errno == ENOENT)
+			return false;
+		Elog("failed on fopen('%s'): %m", lpos_filename);
+	}
+	rv = fscanf(filp, "%lu", &lpos);
+	fclose(filp);
+	if (rv != 1)
+		Elog("file '%s' is corrupted", lpos_filename);
+	*p_lpos = lpos;
+	return true;
 }
 
+static void
+replica_signal_handler(int signum)
+{
+	replica_shutdown = 1;
+}
+
+/*
+ * replica_streaming_redo - main loop of gstore_replica
+ */
+static void
+replica_streaming_redo(PGconn *conn, uint64 lpos)
+{
+	const char *command = "SELECT pgstrom.gstore_fdw_replication_redo($1,$2,$3,$4,$5)";
+	Oid			paramTypes[5];
+	const char *paramValues[5];
+	char		lposBuf[40];
+	char		intervalBuf[40];
+	char		minLenBuf[40];
+	char		maxLenBuf[40];
+	void	   *chunk_buf = NULL;
+	size_t		chunk_bufsz = 0;
+
+	paramTypes[0] = TEXTOID;
+	paramTypes[1] = INT8OID;
+	paramTypes[2] = FLOAT8OID;
+	paramTypes[3] = INT8OID;
+	paramTypes[4] = INT8OID;
+	paramValues[0] = pgsql_tablename;
+	paramValues[1] = lposBuf;
+	paramValues[2] = intervalBuf;
+	paramValues[3] = minLenBuf;
+	paramValues[4] = maxLenBuf;
+	sprintf(intervalBuf, "%f", replica_interval);
+	sprintf(minLenBuf, "%ld", replica_min_length);
+	sprintf(maxLenBuf, "%ld", replica_max_length);
 
+	redo_map_base_file();
+	while (!replica_shutdown)
+	{
+		PGresult   *res;
+		GpuStoreReplicationChunk *chunk;
+		size_t		chunk_sz;
+
+		sprintf(lposBuf, "%lu", lpos);
+		res = PQexecParams(conn, command, 5,
+						   paramTypes,
+						   paramValues,
+						   NULL,
+						   NULL,
+						   1);		/* result should be binary format */
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		{
+			if (PQstatus(conn) == CONNECTION_OK)
+				Elog("SQL execution failed [%s]: %s",
+					 command, PQresultErrorMessage(res));
+			/* connection lost; retry to connect */
+			PQclear(res);
+			fprintf(stderr, "gstore_replica: connection lost, retry: %s",
+					PQerrorMessage(conn));
+			while (!replica_shutdown)
+			{
+				sleep(1);
+				PQreset(conn);
+				if (PQstatus(conn) == CONNECTION_OK)
+					break;
+			}
+			continue;
+		}
+		if (PQnfields(res) != 1 || PQntuples(res) != 1 || PQgetisnull(res, 0, 0))
+			Elog("unexpected result returned for [%s]", command);
 
+		/* chunk->data must be aligned for the REDO logs */
+		chunk_sz = PQgetlength(res, 0, 0);
+		if (chunk_sz < offsetof(GpuStoreReplicationChunk, data))
+			Elog("replication chunk is too short (%zu)", chunk_sz);
+		if (chunk_sz > chunk_bufsz)
+		{
+			chunk_bufsz = TYPEALIGN(PAGE_SIZE, chunk_sz);
+			free(chunk_buf);
+			chunk_buf = malloc(chunk_bufsz);
+			if (!chunk_buf)
+				Elog("out of memory");
+		}
+		memcpy(chunk_buf, PQgetvalue(res, 0, 0), chunk_sz);
+		PQclear(res);
+		chunk = chunk_buf;
 
+		if (chunk->rep_nitems > 0)
+			redo_apply_chunk(chunk, chunk_sz);
+		if (chunk->rep_lpos != lpos)
+		{
+			replica_save_lpos(chunk->rep_lpos);
+			lpos = chunk->rep_lpos;
+		}
+	}
+	free(chunk_buf);
+}
+#endif	/* __GSTORE_REPLICA__ */
 
 static void
 usage(int exitcode)
 {
+#ifdef __GSTORE_REPLICA__
+	fputs("gstore_replica [OPTIONS] BASE_FILE\n"
+		  "\n"
+		  "General options:\n"
+		  "  -d, --dbname=DBNAME    database name to connect\n"
+		  "  -t, --table=TABLENAME  table name for replication\n"
+		  "  -j, --jobs=NUM         number of connections for base backup (default: 4)\n"
+		  "  -i, --interval=SECONDS max interval to apply REDO logs (default: 5.0)\n"
+		  "      --min-length=SIZE  min length of REDO logs per fetch in kB (default: 64)\n"
+		  "      --max-length=SIZE  max length of REDO logs per fetch in kB (default: 131072)\n"
+		  "\n",
+		  stderr);
+#else
 	fputs("gstore_backup [OPTIONS] BASE_FILE\n"
 		  "\n"
 		  "General options:\n"
 		  "  -d, --dbname=DBNAME    database name to connect\n"
 		  "  -t, --table=TABLENAME  table name for backup\n"
+		  "  -j, --jobs=NUM         number of connections for base backup (default: 4)\n"
 		  "  -r, --redo-log=FILENAME filename to store redo-log (optional)\n"
-		  "\n"
-		  "Connection options:\n"
+		  "\n",
+		  stderr);
+#endif
+	fputs("Connection options:\n"
 		  "  -h, --host=HOSTNAME    database server host\n"
 		  "  -p, --port=PORT        database server port\n"
 		  "  -u, --user=USERNAME    database user name\n"
@@ -342,17 +1257,25 @@ parse_options(int argc, char * const argv[])
 		{"dbname",      required_argument, NULL,  'd' },
 		{"table",       required_argument, NULL,  't' },
 		{"redo-log",    required_argument, NULL,  'r' },
+		{"jobs",        required_argument, NULL,  'j' },
 		{"host",        required_argument, NULL,  'h' },
 		{"port",        required_argument, NULL,  'p' },
 		{"user",        required_argument, NULL,  'u' },
 		{"no-password", no_argument,       NULL,  'w' },
 		{"password",    no_argument,       NULL,  'W' },
+#ifdef __GSTORE_REPLICA__
+		{"interval",    required_argument, NULL,  'i' },
+		{"min-length",  required_argument, NULL, 1000 },
+		{"max-length",  required_argument, NULL, 1001 },
+#endif
 		{"help",        no_argument,       NULL, 9999 },
+		{NULL, 0, NULL, 0},
 	};
 	int		password_prompt = 0;
 	int		c;
+	char   *end;
 
-	while ((c = getopt_long(argc, argv, "d:t:r:h:p:u:wW",
+	while ((c = getopt_long(argc, argv, "d:t:r:j:h:p:u:wWi:",
 							long_options, NULL)) >= 0)
 	{
 		switch (c)
@@ -375,6 +1298,12 @@ parse_options(int argc, char * const argv[])
 				redo_filename = optarg;
 				break;
 
+			case 'j':
+				num_workers = strtol(optarg, &end, 10);
+				if (*end != '\0' || num_workers < 1 || num_workers > 64)
+					Elog("invalid -j|--jobs option: %s", optarg);
+				break;
+
 			case 'h':
 				if (pgsql_hostname)
 					Elog("-h option was supplied twice");
@@ -404,7 +1333,27 @@ parse_options(int argc, char * const argv[])
 					Elog("-w and -W option are exclusive");
 				password_prompt = 1;
 				break;
+#ifdef __GSTORE_REPLICA__
+			case 'i':
+				replica_interval = strtod(optarg, &end);
+				if (*end != '\0' || replica_interval <= 0.0)
+					Elog("invalid -i|--interval option: %s", optarg);
+				break;
 
+			case 1000:
+				replica_min_length = strtol(optarg, &end, 10);
+				if (*end != '\0' || replica_min_length <= 0)
+					Elog("invalid --min-length option: %s", optarg);
+				break;
+
+			case 1001:
+				replica_max_length = strtol(optarg, &end, 10);
+				if (*end != '\0' || replica_max_length <= 0)
+					Elog("invalid --max-length option: %s", optarg);
+				break;
+#endif
+			case 9999:
+				usage(0);
 			default:
 				usage(1);
 		}
@@ -416,6 +1365,18 @@ parse_options(int argc, char * const argv[])
 
 	if (redo_filename)
 		Elog("-r option is not implemented yet");
+	manifest_filename = malloc(strlen(base_filename) + 20);
+	if (!manifest_filename)
+		Elog("out of memory");
+	sprintf(manifest_filename, "%s.manifest", base_filename);
+#ifdef __GSTORE_REPLICA__
+	if (replica_min_length > replica_max_length)
+		Elog("--min-length must be less than or equal to --max-length");
+	lpos_filename = malloc(strlen(base_filename) + 10);
+	if (!lpos_filename)
+		Elog("out of memory");
+	sprintf(lpos_filename, "%s.lpos", base_filename);
+#endif
 
 	if (password_prompt > 0)
 	{
@@ -425,64 +1386,74 @@ parse_options(int argc, char * const argv[])
 	}
 }
 
-static void
-on_exit_cleanup(int status, void *arg)
-{
-	if (status == 0)
-		return;		/* exit successfully */
-	if (unlink(base_filename) != 0)
-		fprintf(stderr, "failed on unlink('%s'): %m", base_filename);
-}
-
 int
 main(int argc, char * const argv[])
 {
 	PGconn	   *conn;
-	const char *dest_filename = NULL;
+	char	   *dest_filename;
 	uint64		next_lpos;
 
 	/* system parameters */
 	PAGE_SIZE = sysconf(_SC_PAGESIZE);
 
 	parse_options(argc, argv);
-	/* open the base file */
-	base_fdesc = open(base_filename, O_RDWR | O_CREAT | O_EXCL, 0600);
-	if (base_fdesc < 0)
+#ifdef __GSTORE_REPLICA__
+	/* resume replication, if both of the base file and lpos exist */
+	if (replica_load_lpos(&next_lpos))
 	{
-		if (errno == EEXIST)
-		{
-			dest_filename = base_filename;
-			base_filename = malloc(strlen(dest_filename) + 10);
-			sprintf(base_filename, "%s.XXXXXX", dest_filename);
-			base_fdesc = mkstemp(base_filename);
-		}
+		base_fdesc = open(base_filename, O_RDWR);
 		if (base_fdesc < 0)
 			Elog("failed on open('%s'): %m", base_filename);
+		goto start_replication;
 	}
-	on_exit(on_exit_cleanup, NULL);
+#endif
+	/*
+	 * open the partial base file; it is kept on errors with the manifest
+	 * file, to resume the base backup later.
+	 */
+	dest_filename = base_filename;
+	base_filename = malloc(strlen(dest_filename) + 20);
+	if (!base_filename)
+		Elog("out of memory");
+	sprintf(base_filename, "%s.partial", dest_filename);
+	base_fdesc = open(base_filename, O_RDWR | O_CREAT, 0600);
+	if (base_fdesc < 0)
+		Elog("failed on open('%s'): %m", base_filename);
 
 	conn = pgsql_server_connect(pgsql_hostname,
 								pgsql_port_num,
 								pgsql_username,
 								pgsql_password,
 								pgsql_database);
-	next_lpos = build_base_backup(conn, base_fdesc);
+	next_lpos = build_base_backup(conn);
 
 	printf("next_lpos = %lu\n", next_lpos);
 
+	/* switch to the final file */
+	if (fsync(base_fdesc) != 0)
+		Elog("failed on fsync('%s'): %m", base_filename);
+	if (rename(base_filename, dest_filename) != 0)
+		Elog("failed on rename('%s','%s'): %m",
+			 base_filename,
+			 dest_filename);
+	base_filename = dest_filename;
+	if (unlink(manifest_filename) != 0)
+		Elog("failed on unlink('%s'): %m", manifest_filename);
+#ifdef __GSTORE_REPLICA__
+	replica_save_lpos(next_lpos);
+	goto start_streaming;
 
-
+start_replication:
+	conn = pgsql_server_connect(pgsql_hostname,
+								pgsql_port_num,
+								pgsql_username,
+								pgsql_password,
+								pgsql_database);
+start_streaming:
+	signal(SIGINT,  replica_signal_handler);
+	signal(SIGTERM, replica_signal_handler);
+	replica_streaming_redo(conn, next_lpos);
+#endif
 	PQfinish(conn);
-	/* switch file, if needed */
-	if (dest_filename)
-	{
-		if (rename(base_filename, dest_filename) != 0)
-		{
-			unlink(base_filename);
-			Elog("failed on rename('%s','%s'): %m",
-				 dest_filename,
-				 base_filename);
-		}
-	}
 	return 0;
 }
@@ -904,6 +904,9 @@ mysql_setup_attribute(MYSQL *conn,
 typedef struct {
 	MYSQL	   *conn;
 	MYSQL_RES  *res;
+	MYSQL_ROW	row;		/* current row */
+	unsigned long *row_sz;	/* length of the current row */
+	bool		in_snapshot; /* transaction is already started */
 } MYSTATE;
 
 /*
@@ -1009,10 +1012,13 @@ sqldb_begin_query(void *sqldb_state,
 	const char *query;
 
 	/* start transaction with read-only mode */
-	query = "START TRANSACTION READ ONLY";
-	if (mysql_query(conn, query) != 0)
-		Elog("failed on mysql_query('%s'): %s",
-			 query, mysql_error(conn));
+	if (!mystate->in_snapshot)
+	{
+		query = "START TRANSACTION READ ONLY";
+		if (mysql_query(conn, query) != 0)
+			Elog("failed on mysql_query('%s'): %s",
+				 query, mysql_error(conn));
+	}
 
 	/* exec SQL command  */
 	if (mysql_query(conn, sqldb_command) != 0)
@@ -1053,30 +1059,37 @@ sqldb_begin_query(void *sqldb_state,
 	return table;
 }
 
-ssize_t
-sqldb_fetch_results(void *sqldb_state, SQLtable *table)
+/*
+ * sqldb_fetch_row - move to the next row of the query result
+ */
+bool
+sqldb_fetch_row(void *sqldb_state)
 {
 	MYSTATE	   *mystate = (MYSTATE *)sqldb_state;
-	MYSQL_ROW	row;
 
-	if ((row = mysql_fetch_row(mystate->res)) != NULL)
-	{
-		unsigned long *row_sz = mysql_fetch_lengths(mystate->res);
-		ssize_t		usage = 0;
-		int			j;
+	mystate->row = mysql_fetch_row(mystate->res);
+	if (!mystate->row)
+		return false;
+	mystate->row_sz = mysql_fetch_lengths(mystate->res);
+	return true;
+}
 
-		table->nitems++;
-		for (j=0; j < table->nfields; j++)
-		{
-			SQLfield   *column = &table->columns[j];
-			size_t		sz = (row[j] != NULL ? row_sz[j] : 0);
+/*
+ * sqldb_fetch_value - returns a value of the current row
+ */
+const char *
+sqldb_fetch_value(void *sqldb_state, int fieldnum, int *p_sz)
+{
+	MYSTATE	   *mystate = (MYSTATE *)sqldb_state;
 
-			usage += sql_field_put_value(column, row[j], sz);
-			assert(table->nitems == column->nitems);
-		}
-		return usage;
+	assert(mystate->row != NULL);
+	if (!mystate->row[fieldnum])
+	{
+		*p_sz = 0;
+		return NULL;
 	}
-	return -1;
+	*p_sz = mystate->row_sz[fieldnum];
+	return mystate->row[fieldnum];
 }
 
 void
@@ -1088,6 +1101,246 @@ sqldb_close_connection(void *sqldb_state)
 	mysql_close(mystate->conn);
 }
 
+/*
+ * sqldb_quote_identifier
+ *
+ * It returns the identifier quoted by backticks; embedded backticks are
+ * doubled. If 'qualified', TABLENAME qualified by the database name is
+ * quoted for each part.
+ */
+static char *
+__quote_identifier(char *pos, const char *ident, size_t len)
+{
+	size_t		i;
+
+	*pos++ = '`';
+	for (i=0; i < len; i++)
+	{
+		if (ident[i] == '`')
+			*pos++ = '`';
+		*pos++ = ident[i];
+	}
+	*pos++ = '`';
+
+	return pos;
+}
+
+char *
+sqldb_quote_identifier(const char *ident, bool qualified)
+{
+	const char *dot = (qualified ? strchr(ident, '.') : NULL);
+	char	   *result = palloc(2 * strlen(ident) + 5);
+	char	   *pos = result;
+
+	if (dot)
+	{
+		pos = __quote_identifier(pos, ident, dot - ident);
+		*pos++ = '.';
+		ident = dot + 1;
+	}
+	pos = __quote_identifier(pos, ident, strlen(ident));
+	*pos = '\0';
+
+	return result;
+}
+
+/*
+ * sqldb_parallel_lookup_key
+ *
+ * It returns the name of single-column primary key of the table.
+ * TABLENAME may be qualified by the database name.
+ */
+char *
+sqldb_parallel_lookup_key(void *sqldb_state, const char *table_name)
+{
+	MYSTATE	   *mystate = (MYSTATE *)sqldb_state;
+	MYSQL	   *conn = mystate->conn;
+	MYSQL_RES  *res;
+	MYSQL_ROW	row;
+	char	   *schema;
+	char	   *relname;
+	char	   *query;
+	char	   *key_name;
+	char	   *pos;
+
+	schema = pstrdup(table_name);
+	pos = strchr(schema, '.');
+	if (pos)
+	{
+		*pos++ = '\0';
+		relname = pos;
+	}
+	else
+	{
+		relname = schema;
+		schema = NULL;
+	}
+	query = palloc(strlen(table_name) * 2 + 1024);
+	pos = query;
+	pos += sprintf(pos,
+				   "SELECT COLUMN_NAME"
+				   "  FROM information_schema.KEY_COLUMN_USAGE"
+				   " WHERE CONSTRAINT_NAME = 'PRIMARY'"
+				   "   AND TABLE_NAME = '");
+	pos += mysql_real_escape_string(conn, pos, relname, strlen(relname));
+	if (schema)
+	{
+		pos += sprintf(pos, "' AND TABLE_SCHEMA = '");
+		pos += mysql_real_escape_string(conn, pos, schema, strlen(schema));
+		pos += sprintf(pos, "'");
+	}
+	else
+		pos += sprintf(pos, "' AND TABLE_SCHEMA = DATABASE()");
+
+	if (mysql_query(conn, query) != 0)
+		Elog("failed on mysql_query('%s'): %s",
+			 query, mysql_error(conn));
+	res = mysql_store_result(conn);
+	if (!res)
+		Elog("failed on mysql_store_result: %s", mysql_error(conn));
+	if (mysql_num_rows(res) == 0)
+		Elog("table '%s' has no primary key, use --parallel-key", table_name);
+	if (mysql_num_rows(res) > 1)
+		Elog("primary key of table '%s' has multiple columns, use --parallel-key",
+			 table_name);
+	row = mysql_fetch_row(res);
+	key_name = pstrdup(row[0]);
+	mysql_free_result(res);
+
+	return key_name;
+}
+
+/*
+ * sqldb_parallel_key_range
+ *
+ * It fetches the min/max value of the key column. It returns false, if
+ * the table is empty.
+ */
+bool
+sqldb_parallel_key_range(void *sqldb_state,
+						 const char *table_name,
+						 const char *key_name,
+						 int64 *p_min_value,
+						 int64 *p_max_value)
+{
+	MYSTATE	   *mystate = (MYSTATE *)sqldb_state;
+	MYSQL	   *conn = mystate->conn;
+	MYSQL_RES  *res;
+	MYSQL_ROW	row;
+	MYSQL_FIELD *field;
+	char	   *query;
+	char	   *end;
+	char	   *qtable = sqldb_quote_identifier(table_name, true);
+	char	   *qkey = sqldb_quote_identifier(key_name, false);
+
+	query = palloc(strlen(qtable) + 2 * strlen(qkey) + 100);
+	sprintf(query, "SELECT MIN(%s), MAX(%s) FROM %s",
+			qkey, qkey, qtable);
+	if (mysql_query(conn, query) != 0)
+		Elog("failed on mysql_query('%s'): %s",
+			 query, mysql_error(conn));
+	res = mysql_store_result(conn);
+	if (!res)
+		Elog("failed on mysql_store_result: %s", mysql_error(conn));
+	if (mysql_num_fields(res) != 2 ||
+		mysql_num_rows(res) != 1)
+		Elog("unexpected query result for '%s'", query);
+	field = mysql_fetch_field_direct(res, 0);
+	switch (field->type)
+	{
+		case MYSQL_TYPE_TINY:
+		case MYSQL_TYPE_SHORT:
+		case MYSQL_TYPE_INT24:
+		case MYSQL_TYPE_LONG:
+		case MYSQL_TYPE_LONGLONG:
+			break;
+		default:
+			Elog("--parallel requires integer key, but '%s' is not",
+				 key_name);
+	}
+	row = mysql_fetch_row(res);
+	if (!row[0] || !row[1])
+	{
+		mysql_free_result(res);
+		return false;
+	}
+	errno = 0;
+	*p_min_value = strtol(row[0], &end, 10);
+	if (*end != '\0' || errno != 0)
+		Elog("key value '%s' is out of range", row[0]);
+	*p_max_value = strtol(row[1], &end, 10);
+	if (*end != '\0' || errno != 0)
+		Elog("key value '%s' is out of range", row[1]);
+	mysql_free_result(res);
+	pfree(query);
+	pfree(qkey);
+	pfree(qtable);
+
+	return true;
+}
+
+/*
+ * sqldb_parallel_begin_snapshot
+ *
+ * It starts consistent snapshot transactions on the worker connections.
+ * Tables are locked by the leader connection during the snapshots are
+ * started, for all the workers to see an identical snapshot. If FLUSH
+ * TABLES WITH READ LOCK is not allowed (RELOAD privilege is required),
+ * workers may see slightly different snapshots, so we raise a warning.
+ */
+void
+sqldb_parallel_begin_snapshot(void *leader_state,
+							  void **worker_states,
+							  int num_workers)
+{
+	MYSTATE	   *leader = (MYSTATE *)leader_state;
+	const char *query;
+	bool		has_lock = true;
+	int			i;
+
+	query = "FLUSH TABLES WITH READ LOCK";
+	if (mysql_query(leader->conn, query) != 0)
+	{
+		fprintf(stderr,
+				"WARNING: failed on mysql_query('%s'): %s\n"
+				"         so, parallel workers may see different snapshots.\n",
+				query, mysql_error(leader->conn));
+		has_lock = false;
+	}
+
+	query = "START TRANSACTION WITH CONSISTENT SNAPSHOT, READ ONLY";
+	for (i=0; i < num_workers; i++)
+	{
+		MYSTATE	   *mystate = (MYSTATE *)worker_states[i];
+
+		if (mysql_query(mystate->conn, query) != 0)
+			Elog("failed on mysql_query('%s'): %s",
+				 query, mysql_error(mystate->conn));
+		mystate->in_snapshot = true;
+	}
+
+	if (has_lock)
+	{
+		query = "UNLOCK TABLES";
+		if (mysql_query(leader->conn, query) != 0)
+			Elog("failed on mysql_query('%s'): %s",
+				 query, mysql_error(leader->conn));
+	}
+}
+
+void
+sqldb_thread_init(void)
+{
+	if (mysql_thread_init() != 0)
+		Elog("failed on mysql_thread_init");
+}
+
+void
+sqldb_thread_end(void)
+{
+	mysql_thread_end();
+}
+
 /*
  * misc functions
  */
@@ -1132,6 +1385,12 @@ repalloc(void *old, Size sz)
 	return ptr;
 }
 
+void
+pfree(void *ptr)
+{
+	free(ptr);
+}
+
 /*
  * PG12 or later replaces XXprintf by pg_XXprintf
  */
@@ -7,11 +7,13 @@
  * it under the terms of the PostgreSQL License. See the LICENSE file.
  */
 #include "sql2arrow.h"
+#include <arpa/inet.h>
 #include <limits.h>
 #include <libpq-fe.h>
 
 #define CURSOR_NAME		"curr_pg2arrow"
 static char	   *server_timezone = NULL;
+bool			pgsql_copy_binary_mode = false;
 
 static void		pgsql_setup_composite_type(PGconn *conn,
 										   SQLtable *root,
@@ -34,6 +36,15 @@ typedef struct
 	PGresult   *res;
 	uint32		nitems;
 	uint32		index;
+	/* state of COPY BINARY mode */
+	bool		copy_mode;
+	bool		copy_header_done;
+	char	   *copy_buf;		/* current CopyData message */
+	char	   *copy_pos;		/* current read position of the message */
+	char	   *copy_end;		/* tail of the message */
+	int			copy_nfields;	/* number of fields */
+	const char **copy_addrs;	/* values of the current row */
+	int		   *copy_sizes;		/* length of the values */
 } PGSTATE;
 
 static inline bool
@@ -536,6 +547,172 @@ pgsql_create_buffer(PGconn *conn, PGresult *res,
 	return table;
 }
 
+/*
+ * pgsql_begin_copy_binary
+ *
+ * It runs the query using COPY (query) TO STDOUT WITH (FORMAT binary).
+ * Because COPY does not return the definition of the result, it is
+ * obtained by PQdescribePrepared() on the unnamed statement prior to
+ * the COPY command.
+ */
+static SQLtable *
+pgsql_begin_copy_binary(PGSTATE *pgstate,
+						const char *sqldb_command,
+						ArrowFileInfo *af_info,
+						SQLdictionary *dictionary_list)
+{
+	PGconn	   *conn = pgstate->conn;
+	PGresult   *res;
+	SQLtable   *table;
+	char	   *query;
+
+	/* fetch definition of the query result */
+	res = PQprepare(conn, "", sqldb_command, 0, NULL);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		Elog("unable to prepare the SQL command: %s",
+			 PQresultErrorMessage(res));
+	PQclear(res);
+	res = PQdescribePrepared(conn, "");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		Elog("unable to describe the SQL command: %s",
+			 PQresultErrorMessage(res));
+	table = pgsql_create_buffer(conn, res, af_info, dictionary_list);
+	pgstate->copy_nfields = PQnfields(res);
+	pgstate->copy_addrs = palloc0(sizeof(char *) * pgstate->copy_nfields);
+	pgstate->copy_sizes = palloc0(sizeof(int) * pgstate->copy_nfields);
+	PQclear(res);
+
+	/* kick COPY command */
+	query = palloc(strlen(sqldb_command) + 1024);
+	sprintf(query, "COPY (%s) TO STDOUT WITH (FORMAT binary)",
+			sqldb_command);
+	res = PQexec(conn, query);
+	if (PQresultStatus(res) != PGRES_COPY_OUT)
+		Elog("unable to run COPY command: %s", PQresultErrorMessage(res));
+	PQclear(res);
+	pfree(query);
+
+	pgstate->copy_mode = true;
+
+	return table;
+}
+
+/*
+ * pgsql_copy_next_row
+ *
+ * It parses the next tuple in the binary COPY stream. Values are not
+ * copied; copy_addrs[] points the CopyData message of libpq, so they
+ * are valid until the next call.
+ */
+static inline int16
+__copy_fetch_int16(PGSTATE *pgstate)
+{
+	uint16		value;
+
+	if (pgstate->copy_pos + sizeof(uint16) > pgstate->copy_end)
+		Elog("binary COPY stream is truncated");
+	memcpy(&value, pgstate->copy_pos, sizeof(uint16));
+	pgstate->copy_pos += sizeof(uint16);
+	return (int16)ntohs(value);
+}
+
+static inline int32
+__copy_fetch_int32(PGSTATE *pgstate)
+{
+	uint32		value;
+
+	if (pgstate->copy_pos + sizeof(uint32) > pgstate->copy_end)
+		Elog("binary COPY stream is truncated");
+	memcpy(&value, pgstate->copy_pos, sizeof(uint32));
+	pgstate->copy_pos += sizeof(uint32);
+	return (int32)ntohl(value);
+}
+
+static bool
+pgsql_copy_next_row(PGSTATE *pgstate)
+{
+	static const char copy_signature[11] = "PGCOPY\n\377\r\n\0";
+	int16		nfields;
+	int32		len;
+	int			j;
+
+	while (pgstate->copy_pos >= pgstate->copy_end)
+	{
+		PGconn	   *conn = pgstate->conn;
+		PGresult   *res;
+		char	   *buf;
+		int			nbytes;
+
+		if (pgstate->copy_buf)
+		{
+			PQfreemem(pgstate->copy_buf);
+			pgstate->copy_buf = NULL;
+			pgstate->copy_pos = NULL;
+			pgstate->copy_end = NULL;
+		}
+		nbytes = PQgetCopyData(conn, &buf, 0);
+		if (nbytes == -1)
+		{
+			/* end of the COPY */
+			res = PQgetResult(conn);
+			if (PQresultStatus(res) != PGRES_COMMAND_OK)
+				Elog("COPY command failed: %s", PQresultErrorMessage(res));
+			PQclear(res);
+			return false;
+		}
+		else if (nbytes < 0)
+			Elog("failed on PQgetCopyData: %s", PQerrorMessage(conn));
+		pgstate->copy_buf = buf;
+		pgstate->copy_pos = buf;
+		pgstate->copy_end = buf + nbytes;
+
+		if (!pgstate->copy_header_done)
+		{
+			/* signature, flags and header extension */
+			if (nbytes < sizeof(copy_signature) ||
+				memcmp(buf, copy_signature, sizeof(copy_signature)) != 0)
+				Elog("binary COPY stream has unexpected signature");
+			pgstate->copy_pos += sizeof(copy_signature);
+			if ((__copy_fetch_int32(pgstate) & 0x00010000) != 0)
+				Elog("binary COPY stream with OIDs is not supported");
+			len = __copy_fetch_int32(pgstate);
+			if (len < 0 || pgstate->copy_pos + len > pgstate->copy_end)
+				Elog("binary COPY stream has corrupted header extension");
+			pgstate->copy_pos += len;
+			pgstate->copy_header_done = true;
+		}
+	}
+
+	nfields = __copy_fetch_int16(pgstate);
+	if (nfields < 0)
+	{
+		/* file trailer; the next PQgetCopyData shall return -1 */
+		pgstate->copy_pos = pgstate->copy_end;
+		return pgsql_copy_next_row(pgstate);
+	}
+	if (nfields != pgstate->copy_nfields)
+		Elog("binary COPY stream has unexpected number of fields (%d of %d)",
+			 nfields, pgstate->copy_nfields);
+	for (j=0; j < nfields; j++)
+	{
+		len = __copy_fetch_int32(pgstate);
+		if (len < 0)
+		{
+			pgstate->copy_addrs[j] = NULL;
+			pgstate->copy_sizes[j] = 0;
+		}
+		else
+		{
+			if (pgstate->copy_pos + len > pgstate->copy_end)
+				Elog("binary COPY stream is truncated");
+			pgstate->copy_addrs[j] = pgstate->copy_pos;
+			pgstate->copy_sizes[j] = len;
+			pgstate->copy_pos += len;
+		}
+	}
+	return true;
+}
+
 /*
  * sqldb_server_connect - open and init session
  */
@@ -621,6 +798,14 @@ sqldb_begin_query(void *sqldb_state,
 		Elog("unable to begin transaction: %s", PQresultErrorMessage(res));
 	PQclear(res);
 
+	/*
+	 * COPY BINARY mode; query results are read from the COPY stream
+	 * directly, without PGresult materialization for each chunk.
+	 */
+	if (pgsql_copy_binary_mode)
+		return pgsql_begin_copy_binary(pgstate, sqldb_command,
+									   af_info, dictionary_list);
+
 	/* declare cursor */
 	query = palloc(strlen(sqldb_command) + 1024);
 	sprintf(query, "DECLARE " CURSOR_NAME " BINARY CURSOR FOR %s",
@@ -639,45 +824,52 @@ sqldb_begin_query(void *sqldb_state,
 	return pgsql_create_buffer(conn, res, af_info, dictionary_list);
 }
 
-ssize_t
-sqldb_fetch_results(void *sqldb_state, SQLtable *table)
+/*
+ * sqldb_fetch_row - move to the next row of the query result
+ */
+bool
+sqldb_fetch_row(void *sqldb_state)
 {
 	PGSTATE	   *pgstate = sqldb_state;
-	PGresult   *res = pgstate->res;
-	int			j, index = pgstate->index++;
-	size_t		usage = 0;
 
-	if (index >= pgstate->nitems)
+	if (pgstate->copy_mode)
+		return pgsql_copy_next_row(pgstate);
+
+	if (pgstate->index >= pgstate->nitems)
 	{
-		res = pgsql_next_result(pgstate);
-		if (!res)
-			return -1;		/* end of the scan */
-		index = pgstate->index++;
+		if (!pgsql_next_result(pgstate))
+			return false;	/* end of the scan */
 	}
+	pgstate->index++;
+	return true;
+}
 
-	table->nitems++;
-	for (j=0; j < table->nfields; j++)
-	{
-		SQLfield   *column = &table->columns[j];
-		const char *addr;
-		size_t		sz;
+/*
+ * sqldb_fetch_value - returns a value of the current row in binary form
+ */
+const char *
+sqldb_fetch_value(void *sqldb_state, int fieldnum, int *p_sz)
+{
+	PGSTATE	   *pgstate = sqldb_state;
+	PGresult   *res = pgstate->res;
+	int			index = pgstate->index - 1;
 
-		/* data must be binary format */
-		assert(PQfformat(res, j) == 1);
-		if (PQgetisnull(res, index, j))
-		{
-			addr = NULL;
-			sz = 0;
-		}
-		else
-		{
-			addr = PQgetvalue(res, index, j);
-			sz = PQgetlength(res, index, j);
-		}
-		usage += sql_field_put_value(column, addr, sz);
-		assert(table->nitems == column->nitems);
+	if (pgstate->copy_mode)
+	{
+		assert(fieldnum >= 0 && fieldnum < pgstate->copy_nfields);
+		*p_sz = pgstate->copy_sizes[fieldnum];
+		return pgstate->copy_addrs[fieldnum];
+	}
+	assert(index >= 0 && index < pgstate->nitems);
+	/* data must be binary format */
+	assert(PQfformat(res, fieldnum) == 1);
+	if (PQgetisnull(res, index, fieldnum))
+	{
+		*p_sz = 0;
+		return NULL;
 	}
-	return usage;
+	*p_sz = PQgetlength(res, index, fieldnum);
+	return PQgetvalue(res, index, fieldnum);
 }
 
 void
@@ -689,12 +881,20 @@ sqldb_close_connection(void *sqldb_state)
 
 	if (pgstate->res)
 		PQclear(pgstate->res);
-	/* close the cursor */
-	res = PQexec(conn, "CLOSE " CURSOR_NAME);
-	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-		Elog("failed on close cursor '%s': %s", CURSOR_NAME,
-			 PQresultErrorMessage(res));
-	PQclear(res);
+	if (pgstate->copy_mode)
+	{
+		if (pgstate->copy_buf)
+			PQfreemem(pgstate->copy_buf);
+	}
+	else
+	{
+		/* close the cursor */
+		res = PQexec(conn, "CLOSE " CURSOR_NAME);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			Elog("failed on close cursor '%s': %s", CURSOR_NAME,
+				 PQresultErrorMessage(res));
+		PQclear(res);
+	}
 	/* close the connection */
 	PQfinish(conn);
 }
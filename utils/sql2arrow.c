@@ -9,8 +9,12 @@
 #include "sql2arrow.h"
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <getopt.h>
 #include <limits.h>
+#ifdef __MYSQL2ARROW__
+#include <pthread.h>
+#endif
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -29,6 +33,14 @@ static char	   *sqldb_database = NULL;
 static char	   *dump_arrow_filename = NULL;
 static int		shows_progress = 0;
 static userConfigOption *sqldb_session_configs = NULL;
+static size_t	max_file_size = 0;
+static char	   *partition_by = NULL;
+static size_t	partition_buffer_sz = 0;
+#ifdef __MYSQL2ARROW__
+static char	   *sqldb_table_name = NULL;
+static int		num_parallel_workers = 0;
+static char	   *parallel_key_name = NULL;
+#endif
 
 /*
  * loadArrowDictionaryBatches
@@ -312,6 +324,33 @@ setup_output_file(SQLtable *table, const char *output_filename)
 	if (nbytes != 8)
 		Elog("failed on write(2): %m");
 	writeArrowSchema(table);
+	/* write out dictionary batch, if any */
+	writeArrowDictionaryBatches(table);
+}
+
+/*
+ * close_output_file
+ *
+ * It writes out the footer portion, then closes the current output file.
+ * The table can be associated with the next output file again.
+ */
+static void
+close_output_file(SQLtable *table)
+{
+	assert(table->fdesc >= 0);
+	writeArrowFooter(table);
+	if (close(table->fdesc) != 0)
+		Elog("failed on close('%s'): %m", table->filename);
+	table->fdesc = -1;
+
+	if (table->recordBatches)
+		pfree(table->recordBatches);
+	table->recordBatches = NULL;
+	table->numRecordBatches = 0;
+	if (table->dictionaries)
+		pfree(table->dictionaries);
+	table->dictionaries = NULL;
+	table->numDictionaries = 0;
 }
 
 static void
@@ -324,6 +363,8 @@ shows_record_batch_progress(SQLtable *table, size_t nitems)
 
 		assert(index >= 0);
 		block = &table->recordBatches[index];
+		if (max_file_size > 0 || partition_by)
+			printf("%s: ", table->filename);
 		printf("RecordBatch[%d]: "
 			   "offset=%lu length=%lu (meta=%u, body=%lu) nitems=%zu\n",
 			   index,
@@ -335,6 +376,837 @@ shows_record_batch_progress(SQLtable *table, size_t nitems)
 	}
 }
 
+/*
+ * MEMO: Output of pg2arrow/mysql2arrow is managed per partition.
+ * If --partition-by is not given, only one partition exists and all the
+ * result rows are written to the file given by -o or --append. Elsewhere,
+ * every distinct combination of the partition keys has its own SQLtable
+ * buffer, and its RecordBatches are written to the files under the
+ * Hive-style directory (col=value/...) of the output directory.
+ * If --max-file-size is given, every partition switches its output file
+ * to the next numbered one prior to the file size exceeds the threshold.
+ * Output file of the partition is closed (without footer) after each flush,
+ * then reopened at the next flush, because the number of partitions may be
+ * larger than the number of file descriptors we can open.
+ */
+typedef struct arrowPartition	arrowPartition;
+struct arrowPartition
+{
+	arrowPartition *next;		/* next item in the hash slot */
+	uint32		hash;			/* hash value of the partition key */
+	SQLtable   *table;			/* buffer of the partition */
+	size_t		usage;			/* current usage of the buffer */
+	int			file_seqno;		/* sequence number of the output file */
+	bool		file_suspended;	/* output file is closed temporarily */
+	char	   *dirname;		/* directory of the partition, if any */
+	uint32		key_len;
+	char		key[FLEXIBLE_ARRAY_MEMBER];	/* col=value[/col=value...] */
+};
+
+typedef struct
+{
+	int			attnum;			/* column index of the partition key */
+	SQLfield	field;			/* working buffer to render the key */
+} partitionKey;
+
+#define PARTITION_NUM_SLOTS			4096
+#define HIVE_DEFAULT_PARTITION		"__HIVE_DEFAULT_PARTITION__"
+static partitionKey	   *partition_keys = NULL;
+static int				num_partition_keys = 0;
+static arrowPartition  *partition_slots[PARTITION_NUM_SLOTS];
+static arrowPartition **partition_array = NULL;
+static int				num_partitions = 0;
+static size_t			total_buffer_usage = 0;
+
+/*
+ * sql_table_clone - makes an empty SQLtable with identical schema
+ */
+static void
+__sql_field_clone(SQLfield *dest, const SQLfield *src)
+{
+	int		j;
+
+	memcpy(dest, src, sizeof(SQLfield));
+	dest->nitems = 0;
+	dest->nullcount = 0;
+	sql_buffer_init(&dest->nullmap);
+	sql_buffer_init(&dest->values);
+	sql_buffer_init(&dest->extra);
+	dest->__curr_usage__ = 0;
+
+	if (src->element)
+	{
+		dest->element = palloc(sizeof(SQLfield));
+		__sql_field_clone(dest->element, src->element);
+	}
+	if (src->subfields)
+	{
+		dest->subfields = palloc(sizeof(SQLfield) * src->nfields);
+		for (j=0; j < src->nfields; j++)
+			__sql_field_clone(&dest->subfields[j], &src->subfields[j]);
+	}
+}
+
+static SQLtable *
+sql_table_clone(const SQLtable *src)
+{
+	SQLtable   *dest;
+	int			j;
+
+	dest = palloc0(offsetof(SQLtable, columns[src->nfields]));
+	dest->filename = NULL;
+	dest->fdesc = -1;
+	dest->numFieldNodes = src->numFieldNodes;
+	dest->numBuffers = src->numBuffers;
+	dest->customMetadata = src->customMetadata;
+	dest->numCustomMetadata = src->numCustomMetadata;
+	dest->sql_dict_list = src->sql_dict_list;
+	dest->segment_sz = src->segment_sz;
+	dest->nitems = 0;
+	dest->nfields = src->nfields;
+	for (j=0; j < src->nfields; j++)
+		__sql_field_clone(&dest->columns[j], &src->columns[j]);
+	return dest;
+}
+
+/*
+ * sql_field_release - releases buffers of the (already flushed) field
+ */
+static void
+__sql_buffer_release(SQLbuffer *buf)
+{
+	if (buf->data)
+		pfree(buf->data);
+	sql_buffer_init(buf);
+}
+
+static void
+sql_field_release(SQLfield *column)
+{
+	int		j;
+
+	assert(column->nitems == 0);
+	__sql_buffer_release(&column->nullmap);
+	__sql_buffer_release(&column->values);
+	__sql_buffer_release(&column->extra);
+	if (column->element)
+		sql_field_release(column->element);
+	for (j=0; j < column->nfields; j++)
+		sql_field_release(&column->subfields[j]);
+}
+
+/*
+ * sql_table_put_row - puts the current row of the query result
+ */
+static ssize_t
+sql_table_put_row(void *sqldb_state, SQLtable *table)
+{
+	ssize_t		usage = 0;
+	int			j;
+
+	table->nitems++;
+	for (j=0; j < table->nfields; j++)
+	{
+		SQLfield   *column = &table->columns[j];
+		const char *addr;
+		int			sz;
+
+		addr = sqldb_fetch_value(sqldb_state, j, &sz);
+		usage += sql_field_put_value(column, addr, sz);
+		assert(table->nitems == column->nitems);
+	}
+	return usage;
+}
+
+/*
+ * next_output_filename
+ */
+static const char *
+next_output_filename(arrowPartition *part)
+{
+	const char *pos;
+	const char *suffix;
+	char	   *fname;
+	int			seqno = part->file_seqno++;
+
+	if (part->dirname)
+	{
+		fname = palloc(strlen(part->dirname) + 40);
+		sprintf(fname, "%s/part-%04d.arrow", part->dirname, seqno);
+	}
+	else if (max_file_size == 0)
+	{
+		/* only one file; NULL means a temporary file */
+		assert(seqno == 0);
+		return output_filename;
+	}
+	else
+	{
+		/* FILENAME.arrow -> FILENAME.NNNN.arrow */
+		pos = strrchr(output_filename, '/');
+		suffix = strrchr(pos ? pos + 1 : output_filename, '.');
+		if (!suffix)
+			suffix = output_filename + strlen(output_filename);
+		fname = palloc(strlen(output_filename) + 40);
+		sprintf(fname, "%.*s.%04d%s",
+				(int)(suffix - output_filename), output_filename,
+				seqno, suffix);
+	}
+	return fname;
+}
+
+/*
+ * suspend_output_file / resume_output_file
+ *
+ * They close the output file of the partition temporarily, and reopen it
+ * to append the next RecordBatch. Footer is not written until the output
+ * file is closed by close_output_file().
+ */
+static void
+suspend_output_file(arrowPartition *part)
+{
+	SQLtable   *table = part->table;
+
+	assert(table->fdesc >= 0 && !part->file_suspended);
+	if (close(table->fdesc) != 0)
+		Elog("failed on close('%s'): %m", table->filename);
+	table->fdesc = -1;
+	part->file_suspended = true;
+}
+
+static void
+resume_output_file(arrowPartition *part)
+{
+	SQLtable   *table = part->table;
+	int			fdesc;
+
+	assert(table->fdesc < 0 && part->file_suspended);
+	fdesc = open(table->filename, O_RDWR);
+	if (fdesc < 0)
+		Elog("failed on open('%s'): %m", table->filename);
+	if (lseek(fdesc, 0, SEEK_END) < 0)
+		Elog("failed on lseek('%s'): %m", table->filename);
+	table->fdesc = fdesc;
+	part->file_suspended = false;
+}
+
+/*
+ * flush_partition_buffer
+ */
+static void
+flush_partition_buffer(arrowPartition *part)
+{
+	SQLtable   *table = part->table;
+	size_t		nitems = table->nitems;
+	int			j;
+
+	if (nitems == 0)
+		return;
+	if (part->file_suspended)
+		resume_output_file(part);
+	/* switch to the next file, if this RecordBatch overflows */
+	if (table->fdesc >= 0 &&
+		max_file_size > 0 &&
+		table->numRecordBatches > 0)
+	{
+		off_t	curr_pos = lseek(table->fdesc, 0, SEEK_CUR);
+
+		if (curr_pos < 0)
+			Elog("failed on lseek('%s'): %m", table->filename);
+		if (curr_pos + part->usage > max_file_size)
+			close_output_file(table);
+	}
+	if (table->fdesc < 0)
+		setup_output_file(table, next_output_filename(part));
+
+	writeArrowRecordBatch(table);
+	shows_record_batch_progress(table, nitems);
+	total_buffer_usage -= part->usage;
+	part->usage = 0;
+
+	/*
+	 * Buffers and output file of the partition are released once, because
+	 * it may not receive rows for a long time, and unused buffers should not
+	 * consume the memory budget of --partition-buffer-size.
+	 */
+	if (partition_by)
+	{
+		for (j=0; j < table->nfields; j++)
+			sql_field_release(&table->columns[j]);
+		suspend_output_file(part);
+	}
+}
+
+/*
+ * reclaim_partition_buffers
+ *
+ * It flushes the largest partition buffers until the total buffer usage
+ * gets less than 3/4 of the --partition-buffer-size.
+ */
+static void
+reclaim_partition_buffers(void)
+{
+	size_t		threshold = partition_buffer_sz - partition_buffer_sz / 4;
+
+	while (total_buffer_usage > threshold)
+	{
+		arrowPartition *victim = NULL;
+		int			i;
+
+		for (i=0; i < num_partitions; i++)
+		{
+			arrowPartition *part = partition_array[i];
+
+			if (!victim || victim->usage < part->usage)
+				victim = part;
+		}
+		if (!victim || victim->usage == 0)
+			break;
+		flush_partition_buffer(victim);
+	}
+}
+
+/*
+ * setup_partition_keys
+ */
+static void
+setup_partition_keys(SQLtable *table)
+{
+	char	   *temp = pstrdup(partition_by);
+	char	   *tok, *pos;
+	int			i, j;
+
+	partition_keys = palloc0(sizeof(partitionKey) * table->nfields);
+	for (tok = strtok_r(temp, ",", &pos);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ",", &pos))
+	{
+		partitionKey *pkey;
+		SQLfield   *column = NULL;
+		char	   *tail;
+
+		while (isspace(*tok))
+			tok++;
+		tail = tok + strlen(tok) - 1;
+		while (tail >= tok && isspace(*tail))
+			*tail-- = '\0';
+
+		for (j=0; j < table->nfields; j++)
+		{
+			if (strcmp(table->columns[j].field_name, tok) == 0)
+			{
+				column = &table->columns[j];
+				break;
+			}
+		}
+		if (!column)
+			Elog("--partition-by: column '%s' was not found", tok);
+		for (i=0; i < num_partition_keys; i++)
+		{
+			if (partition_keys[i].attnum == j)
+				Elog("--partition-by: column '%s' appeared twice", tok);
+		}
+		if (column->element || column->subfields)
+			Elog("--partition-by: column '%s' is not a scalar type", tok);
+		switch (column->arrow_type.node.tag)
+		{
+			case ArrowNodeTag__Bool:
+			case ArrowNodeTag__Int:
+			case ArrowNodeTag__Utf8:
+			case ArrowNodeTag__Binary:
+			case ArrowNodeTag__Date:
+			case ArrowNodeTag__Timestamp:
+				break;
+			case ArrowNodeTag__FloatingPoint:
+				if (column->arrow_type.FloatingPoint.precision
+					!= ArrowPrecision__Half)
+					break;
+			default:
+				Elog("--partition-by: column '%s' has unsupported type (%s)",
+					 tok, column->arrow_typename);
+		}
+		pkey = &partition_keys[num_partition_keys++];
+		pkey->attnum = j;
+		__sql_field_clone(&pkey->field, column);
+	}
+	if (num_partition_keys == 0)
+		Elog("--partition-by: no partition key columns");
+	pfree(temp);
+}
+
+/*
+ * __append_partition_escaped - appends a token with Hive style escape
+ */
+static void
+__append_partition_escaped(SQLbuffer *buf, const char *str, int len)
+{
+	static const char *hex = "0123456789ABCDEF";
+	int		i;
+
+	for (i=0; i < len; i++)
+	{
+		unsigned char c = str[i];
+
+		if (c < 0x20 || c == 0x7f ||
+			strchr("\"#%'*/:=?\\{[]^", c) != NULL)
+		{
+			char	temp[3];
+
+			temp[0] = '%';
+			temp[1] = hex[(c >> 4) & 0x0f];
+			temp[2] = hex[c & 0x0f];
+			sql_buffer_append(buf, temp, 3);
+		}
+		else
+		{
+			sql_buffer_append(buf, &c, 1);
+		}
+	}
+}
+
+/*
+ * __append_partition_value - appends the value (row-0) of the column
+ */
+static void
+__append_partition_value(SQLbuffer *buf, SQLfield *column)
+{
+	const char *values = column->values.data;
+	const char *addr = NULL;
+	char		temp[200];
+	int			len = -1;
+
+	switch (column->arrow_type.node.tag)
+	{
+		case ArrowNodeTag__Bool:
+			strcpy(temp, (values[0] & 1) != 0 ? "true" : "false");
+			break;
+
+		case ArrowNodeTag__Int:
+			switch (column->arrow_type.Int.bitWidth)
+			{
+				case 8:
+					if (column->arrow_type.Int.is_signed)
+						sprintf(temp, "%d", (int)*((int8 *)values));
+					else
+						sprintf(temp, "%u", (unsigned int)*((uint8 *)values));
+					break;
+				case 16:
+					if (column->arrow_type.Int.is_signed)
+						sprintf(temp, "%d", (int)*((int16 *)values));
+					else
+						sprintf(temp, "%u", (unsigned int)*((uint16 *)values));
+					break;
+				case 32:
+					if (column->arrow_type.Int.is_signed)
+						sprintf(temp, "%d", *((int32 *)values));
+					else
+						sprintf(temp, "%u", *((uint32 *)values));
+					break;
+				case 64:
+					if (column->arrow_type.Int.is_signed)
+						sprintf(temp, "%ld", *((int64 *)values));
+					else
+						sprintf(temp, "%lu", *((uint64 *)values));
+					break;
+				default:
+					Elog("unexpected Int bitWidth (%d)",
+						 column->arrow_type.Int.bitWidth);
+			}
+			break;
+
+		case ArrowNodeTag__FloatingPoint:
+			if (column->arrow_type.FloatingPoint.precision
+				== ArrowPrecision__Single)
+				sprintf(temp, "%.9g", (double)*((float *)values));
+			else
+				sprintf(temp, "%.17g", *((double *)values));
+			break;
+
+		case ArrowNodeTag__Utf8:
+		case ArrowNodeTag__Binary:
+			if (column->enumdict)
+			{
+				SQLdictionary *dict = column->enumdict;
+				uint32		index = *((uint32 *)values);
+				uint32	   *offset = (uint32 *)dict->values.data;
+
+				assert(index < dict->nitems);
+				addr = dict->extra.data + offset[index];
+				len = offset[index+1] - offset[index];
+			}
+			else
+			{
+				uint32	   *offset = (uint32 *)values;
+
+				addr = column->extra.data + offset[0];
+				len = offset[1] - offset[0];
+			}
+			break;
+
+		case ArrowNodeTag__Date:
+			{
+				time_t		t;
+				struct tm	tm;
+
+				if (column->arrow_type.Date.unit == ArrowDateUnit__Day)
+					t = (time_t)(*((int32 *)values)) * 86400;
+				else
+					t = (time_t)(*((int64 *)values) / 1000);
+				if (!gmtime_r(&t, &tm))
+					Elog("failed on gmtime_r: %m");
+				strftime(temp, sizeof(temp), "%Y-%m-%d", &tm);
+			}
+			break;
+
+		case ArrowNodeTag__Timestamp:
+			{
+				int64		value = *((int64 *)values);
+				int64		scale;
+				int64		frac;
+				time_t		t;
+				struct tm	tm;
+
+				switch (column->arrow_type.Timestamp.unit)
+				{
+					case ArrowTimeUnit__Second:
+						scale = 1L;
+						break;
+					case ArrowTimeUnit__MilliSecond:
+						scale = 1000L;
+						break;
+					case ArrowTimeUnit__MicroSecond:
+						scale = 1000000L;
+						break;
+					default:
+						scale = 1000000000L;
+						break;
+				}
+				t = value / scale;
+				frac = value % scale;
+				if (frac < 0)
+				{
+					t--;
+					frac += scale;
+				}
+				if (!gmtime_r(&t, &tm))
+					Elog("failed on gmtime_r: %m");
+				len = strftime(temp, sizeof(temp), "%Y-%m-%d %H:%M:%S", &tm);
+				if (frac != 0)
+				{
+					/* microsecond resolution is sufficient for the key */
+					if (scale > 1000000L)
+						frac /= (scale / 1000000L);
+					else
+						frac *= (1000000L / scale);
+					sprintf(temp + len, ".%06ld", frac);
+				}
+				len = -1;
+			}
+			break;
+
+		default:
+			Elog("Bug? unsupported partition key type (%s)",
+				 column->arrow_typename);
+	}
+
+	if (len < 0)
+	{
+		addr = temp;
+		len = strlen(temp);
+	}
+	if (len == 0)
+		sql_buffer_append(buf, HIVE_DEFAULT_PARTITION,
+						  strlen(HIVE_DEFAULT_PARTITION));
+	else
+		__append_partition_escaped(buf, addr, len);
+}
+
+/*
+ * __mkdir_recursive
+ */
+static void
+__mkdir_recursive(char *pathname)
+{
+	char	   *pos;
+
+	for (pos = strchr(pathname + 1, '/'); pos; pos = strchr(pos + 1, '/'))
+	{
+		*pos = '\0';
+		if (mkdir(pathname, 0755) != 0 && errno != EEXIST)
+			Elog("failed on mkdir('%s'): %m", pathname);
+		*pos = '/';
+	}
+	if (mkdir(pathname, 0755) != 0 && errno != EEXIST)
+		Elog("failed on mkdir('%s'): %m", pathname);
+}
+
+/*
+ * lookup_partition_root - setup a partition for all the rows
+ */
+static arrowPartition *
+lookup_partition_root(SQLtable *table)
+{
+	arrowPartition *part;
+
+	assert(num_partitions == 0);
+	part = palloc0(offsetof(arrowPartition, key[1]));
+	part->table = table;
+	partition_array = palloc(sizeof(arrowPartition *));
+	partition_array[num_partitions++] = part;
+
+	return part;
+}
+
+/*
+ * lookup_partition - lookup or create a partition of the current row
+ */
+static arrowPartition *
+lookup_partition(void *sqldb_state, SQLtable *root)
+{
+	static SQLbuffer key_buf = { NULL, 0, 0 };
+	arrowPartition *part;
+	uint32		hash;
+	uint32		hindex;
+	int			i;
+
+	sql_buffer_clear(&key_buf);
+	for (i=0; i < num_partition_keys; i++)
+	{
+		partitionKey *pkey = &partition_keys[i];
+		SQLfield   *column = &pkey->field;
+		const char *addr;
+		int			sz;
+
+		if (i > 0)
+			sql_buffer_append(&key_buf, "/", 1);
+		__append_partition_escaped(&key_buf, column->field_name,
+								   strlen(column->field_name));
+		sql_buffer_append(&key_buf, "=", 1);
+
+		addr = sqldb_fetch_value(sqldb_state, pkey->attnum, &sz);
+		if (!addr)
+			sql_buffer_append(&key_buf, HIVE_DEFAULT_PARTITION,
+							  strlen(HIVE_DEFAULT_PARTITION));
+		else
+		{
+			sql_field_put_value(column, addr, sz);
+			__append_partition_value(&key_buf, column);
+			/* reset the working buffer */
+			column->nitems = 0;
+			column->nullcount = 0;
+			sql_buffer_clear(&column->nullmap);
+			sql_buffer_clear(&column->values);
+			sql_buffer_clear(&column->extra);
+		}
+	}
+
+	hash = hash_any((unsigned char *)key_buf.data, key_buf.usage);
+	hindex = hash % PARTITION_NUM_SLOTS;
+	for (part = partition_slots[hindex]; part != NULL; part = part->next)
+	{
+		if (part->hash == hash &&
+			part->key_len == key_buf.usage &&
+			memcmp(part->key, key_buf.data, key_buf.usage) == 0)
+			return part;
+	}
+
+	/* not found, so create a new partition */
+	part = palloc0(offsetof(arrowPartition, key[key_buf.usage + 1]));
+	part->hash = hash;
+	part->table = sql_table_clone(root);
+	part->key_len = key_buf.usage;
+	memcpy(part->key, key_buf.data, key_buf.usage);
+	part->key[key_buf.usage] = '\0';
+	part->dirname = palloc(strlen(output_filename) + key_buf.usage + 2);
+	sprintf(part->dirname, "%s/%s", output_filename, part->key);
+	__mkdir_recursive(part->dirname);
+
+	part->next = partition_slots[hindex];
+	partition_slots[hindex] = part;
+
+	if ((num_partitions & (num_partitions - 1)) == 0)
+	{
+		size_t	sz = sizeof(arrowPartition *) * Max(2 * num_partitions, 32);
+
+		if (!partition_array)
+			partition_array = palloc(sz);
+		else
+			partition_array = repalloc(partition_array, sz);
+	}
+	partition_array[num_partitions++] = part;
+
+	return part;
+}
+
+#ifdef __MYSQL2ARROW__
+/*
+ * Parallel extraction of mysql2arrow
+ *
+ * The table given by -t is split into --parallel=N ranges according to
+ * the min/max value of the key, then each worker fetches its own range
+ * on the individual connection that shares a consistent snapshot.
+ * Workers have their own SQLtable buffer, and the RecordBatches are
+ * written to the shared output file under the arrow_writer_lock.
+ */
+typedef struct
+{
+	pthread_t	thread;
+	void	   *sqldb_state;
+	SQLtable   *table;
+	char	   *command;
+} parallelWorker;
+
+static pthread_mutex_t	arrow_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static SQLtable		   *arrow_writer_table = NULL;
+
+static void
+parallel_write_record_batch(SQLtable *table)
+{
+	SQLtable   *master = arrow_writer_table;
+	size_t		nitems = table->nitems;
+	int			index;
+
+	pthread_mutex_lock(&arrow_writer_lock);
+	table->fdesc = master->fdesc;
+	index = writeArrowRecordBatch(table);
+
+	/* RecordBatch shall be listed on the footer of the master */
+	if (!master->recordBatches)
+		master->recordBatches = palloc(sizeof(ArrowBlock) * 32);
+	else if ((master->numRecordBatches & 31) == 0)
+		master->recordBatches = repalloc(master->recordBatches,
+										 sizeof(ArrowBlock) *
+										 (master->numRecordBatches + 32));
+	master->recordBatches[master->numRecordBatches++]
+		= table->recordBatches[index];
+	shows_record_batch_progress(master, nitems);
+	pthread_mutex_unlock(&arrow_writer_lock);
+}
+
+static void *
+parallel_worker_main(void *__priv)
+{
+	parallelWorker *pw = __priv;
+	SQLtable   *table = pw->table;
+	ssize_t		usage;
+
+	sqldb_thread_init();
+	while (sqldb_fetch_row(pw->sqldb_state))
+	{
+		usage = sql_table_put_row(pw->sqldb_state, table);
+		if (usage > batch_segment_sz)
+			parallel_write_record_batch(table);
+	}
+	if (table->nitems > 0)
+		parallel_write_record_batch(table);
+	sqldb_thread_end();
+
+	return NULL;
+}
+
+static int
+parallel_main(void *sqldb_state, ArrowKeyValue *kv)
+{
+	parallelWorker *workers;
+	void	  **worker_states;
+	SQLtable   *master;
+	char	   *key_name = parallel_key_name;
+	char	   *qtable;
+	char	   *qkey;
+	int64		min_value;
+	int64		max_value;
+	uint64		width = 0;
+	int			nworkers = num_parallel_workers;
+	int			i;
+
+	if (!key_name)
+		key_name = sqldb_parallel_lookup_key(sqldb_state, sqldb_table_name);
+	if (!sqldb_parallel_key_range(sqldb_state, sqldb_table_name, key_name,
+								  &min_value, &max_value))
+		nworkers = 1;	/* empty table */
+	else
+		width = ((uint64)max_value - (uint64)min_value) / nworkers;
+	qtable = sqldb_quote_identifier(sqldb_table_name, true);
+	qkey = sqldb_quote_identifier(key_name, false);
+
+	/* open worker connections, then start consistent snapshots */
+	workers = palloc0(sizeof(parallelWorker) * nworkers);
+	worker_states = palloc0(sizeof(void *) * nworkers);
+	for (i=0; i < nworkers; i++)
+	{
+		worker_states[i] = sqldb_server_connect(sqldb_hostname,
+												sqldb_port_num,
+												sqldb_username,
+												sqldb_password,
+												sqldb_database,
+												sqldb_session_configs);
+		workers[i].sqldb_state = worker_states[i];
+	}
+	sqldb_parallel_begin_snapshot(sqldb_state, worker_states, nworkers);
+
+	/*
+	 * Build range queries. The first and last ranges are open-ended,
+	 * because min/max were fetched outside of the snapshot.
+	 */
+	for (i=0; i < nworkers; i++)
+	{
+		parallelWorker *pw = &workers[i];
+		int64		lower = min_value + (int64)(width * i);
+		int64		upper = min_value + (int64)(width * (i+1));
+		char	   *pos;
+
+		pw->command = palloc(strlen(qtable) + 2 * strlen(qkey) + 200);
+		pos = pw->command;
+		pos += sprintf(pos, "SELECT * FROM %s", qtable);
+		if (nworkers > 1)
+		{
+			if (i == 0)
+				sprintf(pos, " WHERE %s < %ld OR %s IS NULL",
+						qkey, upper, qkey);
+			else if (i == nworkers - 1)
+				sprintf(pos, " WHERE %s >= %ld",
+						qkey, lower);
+			else
+				sprintf(pos, " WHERE %s >= %ld AND %s < %ld",
+						qkey, lower, qkey, upper);
+		}
+		pw->table = sqldb_begin_query(pw->sqldb_state,
+									  pw->command,
+									  NULL, NULL);
+		pw->table->segment_sz = batch_segment_sz;
+		if (i > 0 && pw->table->nfields != workers[0].table->nfields)
+			Elog("Bug? parallel workers have different schema");
+	}
+
+	/* setup the output file */
+	master = sql_table_clone(workers[0].table);
+	master->customMetadata = kv;
+	master->numCustomMetadata = 1;
+	setup_output_file(master, output_filename);
+	arrow_writer_table = master;
+
+	/* launch the workers */
+	for (i=0; i < nworkers; i++)
+	{
+		if ((errno = pthread_create(&workers[i].thread, NULL,
+									parallel_worker_main,
+									&workers[i])) != 0)
+			Elog("failed on pthread_create: %m");
+	}
+	for (i=0; i < nworkers; i++)
+	{
+		if ((errno = pthread_join(workers[i].thread, NULL)) != 0)
+			Elog("failed on pthread_join: %m");
+		sqldb_close_connection(workers[i].sqldb_state);
+	}
+	/* write out footer portion */
+	close_output_file(master);
+	sqldb_close_connection(sqldb_state);
+
+	return 0;
+}
+#endif	/* __MYSQL2ARROW__ */
+
 static int
 dumpArrowFile(const char *filename)
 {
@@ -387,6 +1259,18 @@ usage(void)
 		  "\n"
 		  "Arrow format options:\n"
 		  "  -s, --segment-size=SIZE size of record batch for each\n"
+		  "      --max-file-size=SIZE switch the output file to the next\n"
+		  "                       numbered one (FILENAME.NNNN.arrow) if\n"
+		  "                       file size would exceed this limit\n"
+		  "\n"
+		  "Partitioning options:\n"
+		  "      --partition-by=COLUMN[,COLUMN...]\n"
+		  "                       writes out rows to the Hive-style\n"
+		  "                       directories (COLUMN=VALUE/part-NNNN.arrow)\n"
+		  "                       under the -o, --output=DIRECTORY\n"
+		  "      --partition-buffer-size=SIZE\n"
+		  "                       total buffer size of the partitions\n"
+		  "                       (default: 1GB)\n"
 		  "\n"
 		  "Connection options:\n"
 		  "  -h, --host=HOSTNAME  database server host\n"
@@ -395,9 +1279,17 @@ usage(void)
 #ifdef __PG2ARROW__
 		  "  -w, --no-password    never prompt for password\n"
 		  "  -W, --password       force password prompt\n"
+		  "      --copy-binary    fetch query results by COPY TO STDOUT\n"
+		  "                       with binary format, instead of cursor\n"
 #endif
 #ifdef __MYSQL2ARROW__
 		  "  -P, --password=PASS  Password to use when connecting to server\n"
+		  "\n"
+		  "Parallel options:\n"
+		  "      --parallel=N     fetch the table (-t) by N connections,\n"
+		  "                       according to the ranges of the key\n"
+		  "      --parallel-key=COLUMN integer column to split the table\n"
+		  "                       (default: single-column primary key)\n"
 #endif
 		  "\n"
 		  "Other options:\n"
@@ -411,6 +1303,32 @@ usage(void)
 	exit(1);
 }
 
+static size_t
+parse_size_option(const char *value, const char *label)
+{
+	const char *pos = value;
+	size_t		sz = 0;
+
+	while (isdigit(*pos))
+		pos++;
+	if (pos == value)
+		sz = 0;
+	else if (*pos == '\0')
+		sz = atol(value);
+	else if (strcasecmp(pos, "k") == 0 ||
+			 strcasecmp(pos, "kb") == 0)
+		sz = atol(value) * (1UL << 10);
+	else if (strcasecmp(pos, "m") == 0 ||
+			 strcasecmp(pos, "mb") == 0)
+		sz = atol(value) * (1UL << 20);
+	else if (strcasecmp(pos, "g") == 0 ||
+			 strcasecmp(pos, "gb") == 0)
+		sz = atol(value) * (1UL << 30);
+	if (sz == 0)
+		Elog("%s is not valid: %s", label, value);
+	return sz;
+}
+
 static void
 parse_options(int argc, char * const argv[])
 {
@@ -427,13 +1345,19 @@ parse_options(int argc, char * const argv[])
 #ifdef __PG2ARROW__
 		{"no-password",  no_argument,       NULL, 'w'},
 		{"password",     no_argument,       NULL, 'W'},
+		{"copy-binary",  no_argument,       NULL, 1100},
 #endif /* __PG2ARROW__ */
 #ifdef __MYSQL2ARROW__
 		{"password",     required_argument, NULL, 'P'},
+		{"parallel",     required_argument, NULL, 1200},
+		{"parallel-key", required_argument, NULL, 1201},
 #endif /* __MYSQL2ARROW__ */
 		{"dump",         required_argument, NULL, 1001},
 		{"progress",     no_argument,       NULL, 1002},
 		{"set",          required_argument, NULL, 1003},
+		{"max-file-size", required_argument, NULL, 1004},
+		{"partition-by", required_argument, NULL, 1005},
+		{"partition-buffer-size", required_argument, NULL, 1006},
 		{"help",         no_argument,       NULL, 9999},
 		{NULL, 0, NULL, 0},
 	};
@@ -441,7 +1365,6 @@ parse_options(int argc, char * const argv[])
 	bool		meet_command = false;
 	bool		meet_table = false;
 	int			password_prompt = 0;
-	const char *pos;
 	userConfigOption *last_user_config = NULL;
 
 	while ((c = getopt_long(argc, argv, "d:c:t:o:s:h:P:u:p:",
@@ -472,6 +1395,9 @@ parse_options(int argc, char * const argv[])
 				if (!sqldb_command)
 					Elog("out of memory");
 				sprintf(sqldb_command, "SELECT * FROM %s", optarg);
+#ifdef __MYSQL2ARROW__
+				sqldb_table_name = optarg;
+#endif
 				break;
 
 			case 'o':
@@ -493,22 +1419,7 @@ parse_options(int argc, char * const argv[])
 			case 's':
 				if (batch_segment_sz != 0)
 					Elog("-s option was supplied twice");
-				pos = optarg;
-				while (isdigit(*pos))
-					pos++;
-				if (*pos == '\0')
-					batch_segment_sz = atol(optarg);
-				else if (strcasecmp(pos, "k") == 0 ||
-						 strcasecmp(pos, "kb") == 0)
-					batch_segment_sz = atol(optarg) * (1UL << 10);
-				else if (strcasecmp(pos, "m") == 0 ||
-						 strcasecmp(pos, "mb") == 0)
-					batch_segment_sz = atol(optarg) * (1UL << 20);
-				else if (strcasecmp(pos, "g") == 0 ||
-						 strcasecmp(pos, "gb") == 0)
-					batch_segment_sz = atol(optarg) * (1UL << 30);
-				else
-					Elog("segment size is not valid: %s", optarg);
+				batch_segment_sz = parse_size_option(optarg, "segment size");
 				break;
 
 			case 'h':
@@ -539,6 +1450,11 @@ parse_options(int argc, char * const argv[])
 					Elog("-w and -W options are exclusive");
 				password_prompt = 1;
 				break;
+			case 1100:		/* --copy-binary */
+				if (pgsql_copy_binary_mode)
+					Elog("--copy-binary option was supplied twice");
+				pgsql_copy_binary_mode = true;
+				break;
 #endif	/* __PG2ARROW__ */
 #ifdef __MYSQL2ARROW__
 			case 'P':
@@ -546,6 +1462,18 @@ parse_options(int argc, char * const argv[])
 					Elog("-p option was supplied twice");
 				sqldb_password = optarg;
 				break;
+			case 1200:		/* --parallel */
+				if (num_parallel_workers != 0)
+					Elog("--parallel option was supplied twice");
+				num_parallel_workers = atoi(optarg);
+				if (num_parallel_workers < 1)
+					Elog("--parallel must be a positive number: %s", optarg);
+				break;
+			case 1201:		/* --parallel-key */
+				if (parallel_key_name)
+					Elog("--parallel-key option was supplied twice");
+				parallel_key_name = optarg;
+				break;
 #endif /* __MYSQL2ARROW__ */
 			case 1001:		/* --dump */
 				if (dump_arrow_filename)
@@ -583,6 +1511,25 @@ parse_options(int argc, char * const argv[])
 				}
 				break;
 
+			case 1004:		/* --max-file-size */
+				if (max_file_size != 0)
+					Elog("--max-file-size option was supplied twice");
+				max_file_size = parse_size_option(optarg, "max file size");
+				break;
+
+			case 1005:		/* --partition-by */
+				if (partition_by)
+					Elog("--partition-by option was supplied twice");
+				partition_by = optarg;
+				break;
+
+			case 1006:		/* --partition-buffer-size */
+				if (partition_buffer_sz != 0)
+					Elog("--partition-buffer-size option was supplied twice");
+				partition_buffer_sz = parse_size_option(optarg,
+														"partition buffer size");
+				break;
+
 			case 9999:		/* --help */
 			default:
 				usage();
@@ -624,6 +1571,54 @@ parse_options(int argc, char * const argv[])
 		Elog("Neither -c nor -t options are supplied");
 	if (batch_segment_sz == 0)
 		batch_segment_sz = (1UL << 28);		/* 256MB in default */
+	if (max_file_size > 0)
+	{
+		if (!output_filename)
+			Elog("--max-file-size option requires -o, --output=FILENAME");
+		if (append_filename)
+			Elog("--max-file-size and --append are exclusive");
+		/* a RecordBatch must fit into a file */
+		batch_segment_sz = Min(batch_segment_sz, max_file_size);
+	}
+	if (partition_by)
+	{
+		if (!output_filename)
+			Elog("--partition-by option requires -o, --output=DIRECTORY");
+		if (append_filename)
+			Elog("--partition-by and --append are exclusive");
+		if (partition_buffer_sz == 0)
+			partition_buffer_sz = (1UL << 30);	/* 1GB in default */
+	}
+	else if (partition_buffer_sz != 0)
+		Elog("--partition-buffer-size option requires --partition-by");
+#ifdef __MYSQL2ARROW__
+	if (num_parallel_workers > 0)
+	{
+		if (!sqldb_table_name)
+			Elog("--parallel option requires -t, --table=TABLENAME");
+		if (append_filename || partition_by || max_file_size > 0)
+			Elog("--parallel is exclusive with --append, --partition-by and --max-file-size");
+	}
+	else if (parallel_key_name)
+		Elog("--parallel-key option requires --parallel");
+#endif
+}
+
+/*
+ * __make_sql_command_metadata
+ */
+static ArrowKeyValue *
+__make_sql_command_metadata(const char *command)
+{
+	ArrowKeyValue  *kv = palloc0(sizeof(ArrowKeyValue));
+
+	initArrowNode(kv, KeyValue);
+	kv->key = "sql_command";
+	kv->_key_len = 11;
+	kv->value = command;
+	kv->_value_len = strlen(command);
+
+	return kv;
 }
 
 /*
@@ -635,10 +1630,11 @@ int main(int argc, char * const argv[])
 	ArrowFileInfo	af_info;
 	void		   *sqldb_state;
 	SQLtable	   *table;
-	ArrowKeyValue  *kv;
+	arrowPartition *part = NULL;
 	ssize_t			usage;
 	SQLdictionary  *sql_dict_list = NULL;
-	
+	int				i;
+
 	parse_options(argc, argv);
 
 	/* special case if --dump=FILENAME */
@@ -652,6 +1648,11 @@ int main(int argc, char * const argv[])
 									   sqldb_password,
 									   sqldb_database,
 									   sqldb_session_configs);
+#ifdef __MYSQL2ARROW__
+	if (num_parallel_workers > 0)
+		return parallel_main(sqldb_state,
+							 __make_sql_command_metadata(sqldb_command));
+#endif
 	/* read the original arrow file, if --append mode */
 	if (append_filename)
 	{
@@ -671,50 +1672,58 @@ int main(int argc, char * const argv[])
 	table->segment_sz = batch_segment_sz;
 
 	/* save the SQL command as custom metadata */
-	kv = palloc0(sizeof(ArrowKeyValue));
-	initArrowNode(kv, KeyValue);
-	kv->key = "sql_command";
-	kv->_key_len = 11;
-	kv->value = sqldb_command;
-	kv->_value_len = strlen(sqldb_command);
-	table->customMetadata = kv;
+	table->customMetadata = __make_sql_command_metadata(sqldb_command);
 	table->numCustomMetadata = 1;
 	
 	/* open & setup result file */
 	if (!append_filename)
-		setup_output_file(table, output_filename);
+		table->fdesc = -1;		/* open on the first RecordBatch */
 	else
 	{
 		table->fdesc = append_fdesc;
 		table->filename = append_filename;
 		setup_append_file(table, &af_info);
+		/* write out dictionary batch, if any */
+		writeArrowDictionaryBatches(table);
 	}
-	/* write out dictionary batch, if any */
-	writeArrowDictionaryBatches(table);
-	/* main loop to fetch and write result */
-	while ((usage = sqldb_fetch_results(sqldb_state, table)) >= 0)
-	{
-		if (usage > batch_segment_sz)
-		{
-			size_t		nitems = table->nitems;
 
-			writeArrowRecordBatch(table);
-			shows_record_batch_progress(table, nitems);
-		}
+	if (!partition_by)
+		part = lookup_partition_root(table);
+	else
+	{
+		__mkdir_recursive(pstrdup(output_filename));
+		setup_partition_keys(table);
 	}
-	if (table->nitems > 0)
+
+	/* main loop to fetch and write result */
+	while (sqldb_fetch_row(sqldb_state))
 	{
-		size_t		nitems = table->nitems;
+		if (partition_by)
+			part = lookup_partition(sqldb_state, table);
+		usage = sql_table_put_row(sqldb_state, part->table);
+		total_buffer_usage += usage - part->usage;
+		part->usage = usage;
 
-		writeArrowRecordBatch(table);
-		shows_record_batch_progress(table, nitems);
+		if (usage > batch_segment_sz)
+			flush_partition_buffer(part);
+		else if (partition_by && total_buffer_usage > partition_buffer_sz)
+			reclaim_partition_buffers();
 	}
-	/* write out footer portion */
-	writeArrowFooter(table);
 
+	/* write out remaining buffers and footer portion */
+	for (i=0; i < num_partitions; i++)
+	{
+		part = partition_array[i];
+
+		flush_partition_buffer(part);
+		if (part->file_suspended)
+			resume_output_file(part);
+		else if (part->table->fdesc < 0)
+			setup_output_file(part->table, next_output_filename(part));
+		close_output_file(part->table);
+	}
 	/* cleanup */
 	sqldb_close_connection(sqldb_state);
-	close(table->fdesc);
 
 	return 0;
 }
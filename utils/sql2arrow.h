@@ -22,17 +22,45 @@ sqldb_begin_query(void *sqldb_state,
 				  const char *sqldb_command,
 				  ArrowFileInfo *af_info,
 				  SQLdictionary *dictionary_list);
-extern ssize_t
-sqldb_fetch_results(void *sqldb_state, SQLtable *table);
+extern bool
+sqldb_fetch_row(void *sqldb_state);
+extern const char *
+sqldb_fetch_value(void *sqldb_state, int fieldnum, int *p_sz);
 
 extern void
 sqldb_close_connection(void *sqldb_state);
 
+#ifdef __MYSQL2ARROW__
+/* mysql_client.c */
+extern char *
+sqldb_quote_identifier(const char *ident, bool qualified);
+extern char *
+sqldb_parallel_lookup_key(void *sqldb_state, const char *table_name);
+extern bool
+sqldb_parallel_key_range(void *sqldb_state,
+						 const char *table_name,
+						 const char *key_name,
+						 int64 *p_min_value,
+						 int64 *p_max_value);
+extern void
+sqldb_parallel_begin_snapshot(void *leader_state,
+							  void **worker_states,
+							  int num_workers);
+extern void		sqldb_thread_init(void);
+extern void		sqldb_thread_end(void);
+#endif	/* __MYSQL2ARROW__ */
+
+#ifdef __PG2ARROW__
+/* pgsql_client.c */
+extern bool		pgsql_copy_binary_mode;
+#endif	/* __PG2ARROW__ */
+
 /* misc functions */
 extern void	   *palloc(Size sz);
 extern void	   *palloc0(Size sz);
 extern char	   *pstrdup(const char *str);
 extern void	   *repalloc(void *ptr, Size sz);
+extern void		pfree(void *ptr);
 extern Datum	hash_any(const unsigned char *k, int keylen);
 
 #endif	/* SQL2ARROW_H */